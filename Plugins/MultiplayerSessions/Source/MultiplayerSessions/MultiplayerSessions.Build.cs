@@ -43,6 +43,8 @@ public class MultiplayerSessions : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"AssetRegistry", // Travel map preloading (dependencies of the map)
+				"Sockets", // QoS pings of the QuickJoin candidates
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
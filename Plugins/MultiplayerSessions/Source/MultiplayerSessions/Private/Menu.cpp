@@ -4,9 +4,24 @@
 #include "Menu.h"
 #include "Components/Button.h"
 #include "MultiplayerSessionsSubsystem.h"
+#include "MultiplayerSessions.h" // Who needs: LogMultiplayerSessions, LLM tags
+#include "MultiplayerSessionsTrace.h" // Who needs: FMultiplayerSessionsTrace
+#include "MultiplayerSessionsEventLog.h" // Who needs: MULTIPLAYERSESSIONS_EVENT
 
 void UMenu::MenuSetup(const int32 NumberOfPublicConnections, FString TypeOfMatch, FString PathToLobby)
 {
+	// Extra: A dedicated server has no viewport and no player to show this to; it doesn't host through the menu either
+	if (IsRunningDedicatedServer()) return;
+	LLM_SCOPE_BYTAG(MultiplayerSessions_UI);
+
+	// Extra: Cold start to the main menu, once per process (the session interface is resolved after this now)
+	static bool bColdStartLogged{ false };
+	if (!bColdStartLogged)
+	{
+		bColdStartLogged = true;
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Menu shown %.2f s after process start"), FPlatformTime::Seconds() - GStartTime);
+	}
+
 	AddToViewport();
 	SetVisibility(ESlateVisibility::Visible);
 	SetIsFocusable(true);
@@ -32,16 +47,21 @@ void UMenu::MenuSetup(const int32 NumberOfPublicConnections, FString TypeOfMatch
 	MultiplayerSessionsSubsystem = GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>();
 
 	check(MultiplayerSessionsSubsystem);
+	MultiplayerSessionsSubsystem->SetTravelMap(PathToLobby);
 	MultiplayerSessionsSubsystem->MultiplayerOnCreateSessionComplete.AddDynamic(this, &ThisClass::OnCreateSession);
 	MultiplayerSessionsSubsystem->MultiplayerOnFindSessionComplete.AddUObject(this, &ThisClass::OnFindSessions);
 	MultiplayerSessionsSubsystem->MultiplayerOnJoinSessionComplete.AddUObject(this, &ThisClass::OnJoinSession);
 	MultiplayerSessionsSubsystem->MultiplayerOnDestroySessionComplete.AddDynamic(this, &ThisClass::OnDestroySession);
 	MultiplayerSessionsSubsystem->MultiplayerOnStartSessionComplete.AddDynamic(this, &ThisClass::OnStartSession);
+
+	// Extra: Search while the player looks at the menu, so clicking Join usually hits the session cache
+	MultiplayerSessionsSubsystem->PrefetchSessions(MatchType);
 }
 
 // It's like the constructor of the UUserWidget
 bool UMenu::Initialize()
 {
+	LLM_SCOPE_BYTAG(MultiplayerSessions_UI);
 	if (!Super::Initialize()) return false;
 
 	if (ButtonHost)
@@ -66,12 +86,15 @@ void UMenu::OnCreateSession(const bool bWasSuccessful)
 {
 	if (bWasSuccessful)
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, FString(TEXT("Session created successfully!")));
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Session created successfully!"));
+		FMultiplayerSessionsTrace::Phase(TEXT("ServerTravel"));
+		MULTIPLAYERSESSIONS_EVENT(Travel, NAME_GameSession, 1);
 		GetWorld()->ServerTravel(LobbyMap);
 	}
 	else
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("Failed to create session!")));
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Failed to create session!"));
+		FMultiplayerSessionsTrace::EndFlow(false, TEXT("CreateSessionFailed"));
 		ButtonHost->SetIsEnabled(true);
 	}
 }
@@ -81,49 +104,31 @@ void UMenu::OnFindSessions(const TArray<FOnlineSessionSearchResult>& SearchResul
 	check(MultiplayerSessionsSubsystem);
 
 	// Debug messages
-	if (bWasSuccessful) GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, FString(TEXT("Completed finding sessions")));
-	else GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("Error trying to find sessions")));
+	if (bWasSuccessful) UE_LOG(LogMultiplayerSessions, Log, TEXT("Completed finding sessions"));
+	else UE_LOG(LogMultiplayerSessions, Warning, TEXT("Error trying to find sessions"));
 	// --------------
 
-	if (bWasSuccessful)
+	if (bWasSuccessful && SearchResults.IsEmpty())
 	{
-		if (SearchResults.IsEmpty())
-		{
-			GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Orange, FString(TEXT("Seach Results was empty")));
-			ButtonJoin->SetIsEnabled(true);
-			return;
-		}
-
-		for (auto& Result : SearchResults)
-		{
-			FString ResultMatchType;
-			Result.Session.SessionSettings.Get(MultiplayerSessionsSubsystem->MatchTypeKey, ResultMatchType);
-			if (ResultMatchType == MatchType)
-			{
-				// FOUNDS SESSION AND TRIES TO JOIN IT
-				GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, FString(TEXT("Joining session...")));
-				MultiplayerSessionsSubsystem->JoinSession(Result);
-				return;
-			}
-		}
-
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Orange, FString(TEXT("Could not find any session")));
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Could not find any session"));
 	}
-	
-	ButtonJoin->SetIsEnabled(true);
 }
 
-void UMenu::OnJoinSession(const FString& Address, const EOnJoinSessionCompleteResult::Type Result) const
+void UMenu::OnJoinSession(const FString& Address, const EOnJoinSessionCompleteResult::Type Result)
 {
 	if (Result == EOnJoinSessionCompleteResult::Success)
 	{
 		check(Address != FString());
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, FString::Printf(TEXT("Success joining session! Address %s"), *Address));
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Success joining session! Address %s"), *Address);
+		FMultiplayerSessionsTrace::Phase(TEXT("ClientTravel"));
+		MULTIPLAYERSESSIONS_EVENT(Travel, NAME_GameSession, 0);
 		GetWorld()->GetFirstPlayerController()->ClientTravel(Address, ETravelType::TRAVEL_Absolute);
 	}
 	else
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString("Failed to join session!"));
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("%s"), Result == EOnJoinSessionCompleteResult::SessionDoesNotExist
+			? TEXT("Could not find any session") : TEXT("Failed to join session!"));
+		FMultiplayerSessionsTrace::EndFlow(false, TEXT("JoinSessionFailed"));
 		ButtonJoin->SetIsEnabled(true);
 	}
 }
@@ -136,8 +141,9 @@ void UMenu::OnStartSession(bool bWasSuccessful)
 {
 	if (bWasSuccessful)
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, FString("Started Session"));
-		GetWorld()->ServerTravel("/Game/Maps/Level");
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Started Session"));
+		// Extra: ?listen, so the host keeps listening when the game mode travels hard (Blaster.SeamlessTravel 0)
+		GetWorld()->ServerTravel("/Game/Maps/Level?listen");
 	}
 	else
 	{
@@ -150,6 +156,8 @@ void UMenu::ButtonHostClicked()
 	check(MultiplayerSessionsSubsystem);
 	if (!MultiplayerSessionsSubsystem) return;
 	ButtonHost->SetIsEnabled(false);
+	FMultiplayerSessionsTrace::BeginFlow(EMultiplayerSessionsFlow::Host, TEXT("HostClicked"));
+	MULTIPLAYERSESSIONS_EVENT(MenuHost, NAME_GameSession, 0, NumPublicConnections);
 	MultiplayerSessionsSubsystem->CreateSession(NumPublicConnections, MatchType);
 }
 
@@ -158,7 +166,10 @@ void UMenu::ButtonJoinClicked()
 	check(MultiplayerSessionsSubsystem);
 	if (!MultiplayerSessionsSubsystem) return;
 	ButtonJoin->SetIsEnabled(false);
-	MultiplayerSessionsSubsystem->FindSessions(1000000000);
+	FMultiplayerSessionsTrace::BeginFlow(EMultiplayerSessionsFlow::Join, TEXT("JoinClicked"));
+	MULTIPLAYERSESSIONS_EVENT(MenuJoin, NAME_GameSession);
+	// Extra: Joins a cached session right away if there's one, or the first good one the search finds
+	MultiplayerSessionsSubsystem->QuickJoin(MatchType);
 }
 
 void UMenu::ButtonStartClicked()
@@ -166,6 +177,7 @@ void UMenu::ButtonStartClicked()
 	check(MultiplayerSessionsSubsystem);
 	if (!MultiplayerSessionsSubsystem) return;
 	ButtonStart->SetIsEnabled(false);
+	MULTIPLAYERSESSIONS_EVENT(MenuStart, NAME_GameSession);
 	MultiplayerSessionsSubsystem->StartSession();
 }
 
@@ -0,0 +1,719 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MockOnlineSession.h"
+#include "MultiplayerSessions.h" // Who needs: LogMultiplayerSessions
+#include "MultiplayerSessionsAttributes.h" // Who needs: MultiplayerSessionsAttributes::Write
+#include "OnlineSubsystemTypes.h" // Who needs: FUniqueNetIdString
+#include <Online/OnlineSessionNames.h> // Who needs: Macro SEARCH_PRESENCE
+#include "HAL/IConsoleManager.h" // Who needs: FAutoConsoleVariableRef
+#include "Misc/CommandLine.h"
+
+namespace MockOnlineSession
+{
+	static const FName MockType{ TEXT("MOCK") };
+	// Search results arrive in this many slices over the search latency
+	static constexpr int32 NumSearchSlices{ 4 };
+
+	//
+	// Settings of the next mock created (the subsystem creates it once). Set them on the command line
+	// (-ini:Engine:[ConsoleVariables]:MultiplayerSessions.Mock.NumSessions=5000) or in DefaultEngine.ini [ConsoleVariables].
+	//
+	static bool bEnable = false;
+	static FMockOnlineSessionSettings ConsoleSettings;
+	static int32 Distribution = static_cast<int32>(EMockLatencyDistribution::LogNormal);
+
+	static FAutoConsoleVariableRef CVarEnable(TEXT("MultiplayerSessions.Mock.Enable"), bEnable,
+		TEXT("Use the in-process mock session backend instead of the online subsystem (same as -MockSessions). Read when the subsystem is created."));
+	static FAutoConsoleVariableRef CVarNumSessions(TEXT("MultiplayerSessions.Mock.NumSessions"), ConsoleSettings.NumSessions,
+		TEXT("Advertised fake sessions."));
+	static FAutoConsoleVariableRef CVarSeed(TEXT("MultiplayerSessions.Mock.Seed"), ConsoleSettings.Seed,
+		TEXT("Random seed. Same seed and settings, same run."));
+	static FAutoConsoleVariableRef CVarMatchTypes(TEXT("MultiplayerSessions.Mock.MatchTypes"), ConsoleSettings.MatchTypes,
+		TEXT("Comma separated match types given to the advertised sessions. Advertised as their position in this list (plus 1), so keep it in the order of the subsystem's MatchTypes."));
+	static FAutoConsoleVariableRef CVarDistribution(TEXT("MultiplayerSessions.Mock.LatencyDistribution"), Distribution,
+		TEXT("0: uniform (mean +- jitter), 1: normal, 2: log-normal (long tail)."));
+	static FAutoConsoleVariableRef CVarCreateLatency(TEXT("MultiplayerSessions.Mock.CreateLatencyMs"), ConsoleSettings.CreateLatencyMs, TEXT("Mean latency of CreateSession."));
+	static FAutoConsoleVariableRef CVarFindLatency(TEXT("MultiplayerSessions.Mock.FindLatencyMs"), ConsoleSettings.FindLatencyMs, TEXT("Mean latency of FindSessions (until the last slice)."));
+	static FAutoConsoleVariableRef CVarJoinLatency(TEXT("MultiplayerSessions.Mock.JoinLatencyMs"), ConsoleSettings.JoinLatencyMs, TEXT("Mean latency of JoinSession."));
+	static FAutoConsoleVariableRef CVarDestroyLatency(TEXT("MultiplayerSessions.Mock.DestroyLatencyMs"), ConsoleSettings.DestroyLatencyMs, TEXT("Mean latency of DestroySession."));
+	static FAutoConsoleVariableRef CVarStartLatency(TEXT("MultiplayerSessions.Mock.StartLatencyMs"), ConsoleSettings.StartLatencyMs, TEXT("Mean latency of StartSession."));
+	static FAutoConsoleVariableRef CVarJitter(TEXT("MultiplayerSessions.Mock.JitterMs"), ConsoleSettings.JitterMs, TEXT("Spread of every latency (see LatencyDistribution)."));
+	static FAutoConsoleVariableRef CVarFailureRate(TEXT("MultiplayerSessions.Mock.FailureRate"), ConsoleSettings.FailureRate, TEXT("0..1, operations that complete with a failure."));
+	static FAutoConsoleVariableRef CVarDropRate(TEXT("MultiplayerSessions.Mock.DropRate"), ConsoleSettings.DropRate, TEXT("0..1, operations whose callback never comes."));
+	static FAutoConsoleVariableRef CVarJoinFullRate(TEXT("MultiplayerSessions.Mock.JoinFullRate"), ConsoleSettings.JoinFullRate, TEXT("0..1, joins that find the session full."));
+
+	// Connect string and id of a mock session
+	class FOnlineSessionInfoMock : public FOnlineSessionInfo
+	{
+	public:
+		FOnlineSessionInfoMock(const FString& Id, const FString& InAddress) :
+			SessionId(FUniqueNetIdString::Create(Id, MockType)),
+			Address(InAddress)
+		{
+		}
+
+		virtual const uint8* GetBytes() const override { return nullptr; }
+		virtual int32 GetSize() const override { return sizeof(FOnlineSessionInfoMock); }
+		virtual bool IsValid() const override { return true; }
+		virtual FString ToString() const override { return SessionId->ToString(); }
+		virtual FString ToDebugString() const override { return FString::Printf(TEXT("MockSession %s at %s"), *SessionId->ToString(), *Address); }
+		virtual const FUniqueNetId& GetSessionId() const override { return *SessionId; }
+
+		FUniqueNetIdRef SessionId;
+		FString Address;
+	};
+
+	static const FOnlineSessionInfoMock* GetMockInfo(const FOnlineSession& Session)
+	{
+		const FOnlineSessionInfo* Info = Session.SessionInfo.Get();
+		return Info && Info->GetSessionId().GetType() == MockType ? static_cast<const FOnlineSessionInfoMock*>(Info) : nullptr;
+	}
+
+	static FUniqueNetIdRef MakeLocalUserId(const int32 LocalUserNum)
+	{
+		return FUniqueNetIdString::Create(FString::Printf(TEXT("MockUser%d"), LocalUserNum), MockType);
+	}
+
+	static bool IsNumeric(const EOnlineKeyValuePairDataType::Type Type)
+	{
+		return Type == EOnlineKeyValuePairDataType::Int32 || Type == EOnlineKeyValuePairDataType::UInt32
+			|| Type == EOnlineKeyValuePairDataType::Int64 || Type == EOnlineKeyValuePairDataType::UInt64
+			|| Type == EOnlineKeyValuePairDataType::Float || Type == EOnlineKeyValuePairDataType::Double;
+	}
+}
+
+FMockOnlineSessionSettings FMockOnlineSessionSettings::FromConsoleVariables()
+{
+	FMockOnlineSessionSettings Result = MockOnlineSession::ConsoleSettings;
+	Result.Distribution = static_cast<EMockLatencyDistribution>(FMath::Clamp(MockOnlineSession::Distribution, 0, 2));
+	return Result;
+}
+
+FMockOnlineSession::FMockOnlineSession(const FMockOnlineSessionSettings& InSettings) :
+	Settings(InSettings),
+	Random(InSettings.Seed)
+{
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FMockOnlineSession::Tick));
+}
+
+FMockOnlineSession::~FMockOnlineSession()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+}
+
+bool FMockOnlineSession::IsEnabled()
+{
+	return MockOnlineSession::bEnable || FParse::Param(FCommandLine::Get(), TEXT("MockSessions"));
+}
+
+void FMockOnlineSession::GenerateAdvertisedSessions()
+{
+	using namespace MockOnlineSession;
+
+	TArray<FString> MatchTypes;
+	Settings.MatchTypes.ParseIntoArray(MatchTypes, TEXT(","));
+	if (MatchTypes.IsEmpty()) MatchTypes.Add(TEXT("FreeForAll"));
+
+	// Its own stream: the sessions are the same whatever operations ran before the first search
+	FRandomStream SessionRandom(Settings.Seed);
+	const int32 LocalBuildVersion = MultiplayerSessionsAttributes::GetLocalBuildVersion();
+	AdvertisedSessions.Reserve(Settings.NumSessions);
+	for (int32 Index = 0; Index < Settings.NumSessions; ++Index)
+	{
+		FOnlineSessionSearchResult& Result = AdvertisedSessions.AddDefaulted_GetRef();
+		Result.PingInMs = SessionRandom.RandRange(10, 250);
+
+		FOnlineSession& Session = Result.Session;
+		Session.OwningUserId = FUniqueNetIdString::Create(FString::Printf(TEXT("MockHost%05d"), Index), MockType);
+		Session.OwningUserName = FString::Printf(TEXT("MockHost%05d"), Index);
+		Session.SessionSettings.NumPublicConnections = SessionRandom.RandRange(2, 16);
+		Session.SessionSettings.bShouldAdvertise = true;
+		Session.SessionSettings.bUsesPresence = true;
+		Session.SessionSettings.bAllowJoinInProgress = true;
+		Session.SessionSettings.bUseLobbiesIfAvailable = true;
+		FMultiplayerSessionAttributes Attributes;
+		// About 1 in 20 hosts runs another build, so the search filters have something to reject
+		Attributes.BuildVersion = SessionRandom.FRand() < 0.05f ? LocalBuildVersion + 1 : LocalBuildVersion;
+		Attributes.MatchType = static_cast<uint8>(SessionRandom.RandHelper(MatchTypes.Num()) + 1);
+		Attributes.Region = static_cast<uint8>(SessionRandom.RandRange(1, 4));
+		Attributes.Map = static_cast<uint8>(SessionRandom.RandRange(1, 2));
+		Attributes.SkillBand = static_cast<uint8>(SessionRandom.RandRange(0, MultiplayerSessionsAttributes::MaxSkillBand));
+		MultiplayerSessionsAttributes::Write(Attributes, Session.SessionSettings);
+		// About 1 in 8 is full
+		Session.NumOpenPublicConnections = SessionRandom.FRand() < 0.125f ? 0 : SessionRandom.RandRange(1, Session.SessionSettings.NumPublicConnections);
+		Session.SessionInfo = MakeShared<FOnlineSessionInfoMock>(FString::Printf(TEXT("MockSession%05d"), Index),
+			FString::Printf(TEXT("10.%d.%d.%d:7777"), (Index >> 16) & 0xFF, (Index >> 8) & 0xFF, Index & 0xFF));
+	}
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Mock session backend: %d sessions advertised (seed %d)"), AdvertisedSessions.Num(), Settings.Seed);
+}
+
+bool FMockOnlineSession::MatchesQuery(const FOnlineSessionSearchResult& Result, const FOnlineSessionSearch& Search) const
+{
+	for (const auto& SearchParam : Search.QuerySettings.SearchParams)
+	{
+		if (SearchParam.Key == SEARCH_PRESENCE) continue; // Every mock session uses presence
+
+		const FVariantData& Wanted = SearchParam.Value.Data;
+		const FOnlineSessionSetting* Setting = Result.Session.SessionSettings.Settings.Find(SearchParam.Key);
+		if (!Setting) return false;
+		const FVariantData& Have = Setting->Data;
+
+		switch (SearchParam.Value.ComparisonOp)
+		{
+		case EOnlineComparisonOp::Equals:
+			if (!(Have == Wanted)) return false;
+			break;
+		case EOnlineComparisonOp::NotEquals:
+			if (Have == Wanted) return false;
+			break;
+		case EOnlineComparisonOp::GreaterThan:
+		case EOnlineComparisonOp::GreaterThanEquals:
+		case EOnlineComparisonOp::LessThan:
+		case EOnlineComparisonOp::LessThanEquals:
+			{
+				if (!MockOnlineSession::IsNumeric(Have.GetType()) || !MockOnlineSession::IsNumeric(Wanted.GetType())) return false;
+				const double A = FCString::Atod(*Have.ToString());
+				const double B = FCString::Atod(*Wanted.ToString());
+				const EOnlineComparisonOp::Type Op = SearchParam.Value.ComparisonOp;
+				const bool bPass = Op == EOnlineComparisonOp::GreaterThan ? A > B
+					: Op == EOnlineComparisonOp::GreaterThanEquals ? A >= B
+					: Op == EOnlineComparisonOp::LessThan ? A < B
+					: A <= B;
+				if (!bPass) return false;
+			}
+			break;
+		default:
+			break; // Near, In... not used by the subsystem
+		}
+	}
+	return true;
+}
+
+float FMockOnlineSession::DrawLatencySeconds(const float MeanMs)
+{
+	// Box-Muller, on our stream so runs repeat
+	auto Gaussian = [this]()
+	{
+		const float U1 = FMath::Max(Random.GetFraction(), UE_SMALL_NUMBER);
+		const float U2 = Random.GetFraction();
+		return FMath::Sqrt(-2.f * FMath::Loge(U1)) * FMath::Cos(2.f * UE_PI * U2);
+	};
+
+	const float Jitter = Settings.JitterMs;
+	float Ms = MeanMs;
+	switch (Settings.Distribution)
+	{
+	case EMockLatencyDistribution::Uniform:
+		Ms = MeanMs + Random.FRandRange(-Jitter, Jitter);
+		break;
+	case EMockLatencyDistribution::Normal:
+		Ms = MeanMs + Jitter * Gaussian();
+		break;
+	case EMockLatencyDistribution::LogNormal:
+		if (MeanMs > 0.f)
+		{
+			// Same mean and standard deviation as the normal one, but skewed: a few operations take much longer
+			const float Sigma = FMath::Sqrt(FMath::Loge(1.f + FMath::Square(Jitter / MeanMs)));
+			Ms = MeanMs * FMath::Exp(Sigma * Gaussian() - 0.5f * Sigma * Sigma);
+		}
+		break;
+	}
+	return FMath::Max(Ms, 0.f) / 1000.f;
+}
+
+FMockOnlineSession::EOutcome FMockOnlineSession::DrawOutcome()
+{
+	const float Roll = Random.GetFraction();
+	if (Roll < Settings.DropRate) return EOutcome::Drop;
+	if (Roll < Settings.DropRate + Settings.FailureRate) return EOutcome::Fail;
+	return EOutcome::Succeed;
+}
+
+void FMockOnlineSession::Schedule(const float DelaySeconds, TFunction<void()>&& Callback)
+{
+	// Never synchronous, even with no latency: a real backend answers on a later frame, and the subsystem counts on it
+	FScheduledCallback& Scheduled = ScheduledCallbacks.AddDefaulted_GetRef();
+	Scheduled.DueTime = FPlatformTime::Seconds() + DelaySeconds;
+	Scheduled.Order = ++LastScheduledOrder;
+	Scheduled.Callback = MoveTemp(Callback);
+}
+
+bool FMockOnlineSession::Tick(float DeltaTime)
+{
+	if (ScheduledCallbacks.IsEmpty()) return true;
+
+	// Take the due ones out first: callbacks trigger delegates, and listeners call us back
+	const double Now = FPlatformTime::Seconds();
+	TArray<FScheduledCallback> Due;
+	for (int32 Index = ScheduledCallbacks.Num() - 1; Index >= 0; --Index)
+	{
+		if (ScheduledCallbacks[Index].DueTime <= Now)
+		{
+			Due.Add(MoveTemp(ScheduledCallbacks[Index]));
+			ScheduledCallbacks.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+		}
+	}
+	Due.Sort([](const FScheduledCallback& A, const FScheduledCallback& B)
+	{
+		return A.DueTime != B.DueTime ? A.DueTime < B.DueTime : A.Order < B.Order;
+	});
+
+	for (FScheduledCallback& Scheduled : Due)
+		Scheduled.Callback();
+	return true;
+}
+
+//
+// Sessions
+//
+
+FUniqueNetIdPtr FMockOnlineSession::CreateSessionIdFromString(const FString& SessionIdStr)
+{
+	return FUniqueNetIdString::Create(SessionIdStr, MockOnlineSession::MockType);
+}
+
+FNamedOnlineSession* FMockOnlineSession::GetNamedSession(const FName SessionName)
+{
+	const TUniquePtr<FNamedOnlineSession>* Session = NamedSessions.Find(SessionName);
+	return Session ? Session->Get() : nullptr;
+}
+
+FNamedOnlineSession* FMockOnlineSession::AddNamedSession(const FName SessionName, const FOnlineSessionSettings& SessionSettings)
+{
+	return NamedSessions.Add(SessionName, MakeUnique<FNamedOnlineSession>(SessionName, SessionSettings)).Get();
+}
+
+FNamedOnlineSession* FMockOnlineSession::AddNamedSession(const FName SessionName, const FOnlineSession& Session)
+{
+	return NamedSessions.Add(SessionName, MakeUnique<FNamedOnlineSession>(SessionName, Session)).Get();
+}
+
+void FMockOnlineSession::RemoveNamedSession(const FName SessionName)
+{
+	NamedSessions.Remove(SessionName);
+}
+
+EOnlineSessionState::Type FMockOnlineSession::GetSessionState(const FName SessionName) const
+{
+	const TUniquePtr<FNamedOnlineSession>* Session = NamedSessions.Find(SessionName);
+	return Session ? (*Session)->SessionState : EOnlineSessionState::NoSession;
+}
+
+bool FMockOnlineSession::HasPresenceSession()
+{
+	for (const TPair<FName, TUniquePtr<FNamedOnlineSession>>& Pair : NamedSessions)
+	{
+		if (Pair.Value->SessionSettings.bUsesPresence) return true;
+	}
+	return false;
+}
+
+bool FMockOnlineSession::CreateSession(const int32 HostingPlayerNum, const FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	return CreateSession(*MockOnlineSession::MakeLocalUserId(HostingPlayerNum), SessionName, NewSessionSettings);
+}
+
+bool FMockOnlineSession::CreateSession(const FUniqueNetId& HostingPlayerId, const FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	if (GetNamedSession(SessionName)) return false;
+
+	FNamedOnlineSession* Session = AddNamedSession(SessionName, NewSessionSettings);
+	Session->SessionState = EOnlineSessionState::Creating;
+	Session->bHosting = true;
+	Session->OwningUserId = HostingPlayerId.AsShared();
+	Session->NumOpenPublicConnections = NewSessionSettings.NumPublicConnections;
+
+	const EOutcome Outcome = DrawOutcome();
+	Schedule(DrawLatencySeconds(Settings.CreateLatencyMs), [this, SessionName, Outcome]()
+	{
+		FNamedOnlineSession* Created = GetNamedSession(SessionName);
+		if (!Created || Created->SessionState != EOnlineSessionState::Creating) return; // Destroyed meanwhile
+
+		if (Outcome == EOutcome::Fail)
+		{
+			RemoveNamedSession(SessionName);
+			TriggerOnCreateSessionCompleteDelegates(SessionName, false);
+			return;
+		}
+
+		// Dropped: created on the service side, the callback just never comes
+		Created->SessionState = EOnlineSessionState::Pending;
+		Created->SessionInfo = MakeShared<MockOnlineSession::FOnlineSessionInfoMock>(FString::Printf(TEXT("MockHosted%s"), *SessionName.ToString()), TEXT("127.0.0.1:7777"));
+		if (Outcome == EOutcome::Succeed) TriggerOnCreateSessionCompleteDelegates(SessionName, true);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::StartSession(const FName SessionName)
+{
+	const FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (!Session || (Session->SessionState != EOnlineSessionState::Pending && Session->SessionState != EOnlineSessionState::Ended)) return false;
+
+	const EOutcome Outcome = DrawOutcome();
+	Schedule(DrawLatencySeconds(Settings.StartLatencyMs), [this, SessionName, Outcome]()
+	{
+		FNamedOnlineSession* Started = GetNamedSession(SessionName);
+		if (!Started) return;
+
+		if (Outcome != EOutcome::Fail) Started->SessionState = EOnlineSessionState::InProgress;
+		if (Outcome != EOutcome::Drop) TriggerOnStartSessionCompleteDelegates(SessionName, Outcome == EOutcome::Succeed);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::UpdateSession(const FName SessionName, FOnlineSessionSettings& UpdatedSessionSettings, const bool bShouldRefreshOnlineData)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (!Session) return false;
+
+	Session->SessionSettings = UpdatedSessionSettings;
+	Schedule(0.f, [this, SessionName]()
+	{
+		TriggerOnUpdateSessionCompleteDelegates(SessionName, true);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::EndSession(const FName SessionName)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (!Session || Session->SessionState != EOnlineSessionState::InProgress) return false;
+
+	Session->SessionState = EOnlineSessionState::Ended;
+	Schedule(0.f, [this, SessionName]()
+	{
+		TriggerOnEndSessionCompleteDelegates(SessionName, true);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::DestroySession(const FName SessionName, const FOnDestroySessionCompleteDelegate& CompletionDelegate)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (!Session || Session->SessionState == EOnlineSessionState::Destroying) return false;
+
+	const EOnlineSessionState::Type PreviousState = Session->SessionState;
+	Session->SessionState = EOnlineSessionState::Destroying;
+
+	const EOutcome Outcome = DrawOutcome();
+	Schedule(DrawLatencySeconds(Settings.DestroyLatencyMs), [this, SessionName, CompletionDelegate, PreviousState, Outcome]()
+	{
+		FNamedOnlineSession* Destroyed = GetNamedSession(SessionName);
+		if (!Destroyed) return;
+
+		if (Outcome == EOutcome::Fail)
+		{
+			Destroyed->SessionState = PreviousState;
+			CompletionDelegate.ExecuteIfBound(SessionName, false);
+			TriggerOnDestroySessionCompleteDelegates(SessionName, false);
+			return;
+		}
+
+		// Leaving a joined session gives its slot back
+		if (const MockOnlineSession::FOnlineSessionInfoMock* Info = !Destroyed->bHosting ? MockOnlineSession::GetMockInfo(*Destroyed) : nullptr)
+		{
+			for (FOnlineSessionSearchResult& Advertised : AdvertisedSessions)
+			{
+				if (Advertised.Session.SessionInfo.Get() == Info)
+				{
+					++Advertised.Session.NumOpenPublicConnections;
+					break;
+				}
+			}
+		}
+
+		RemoveNamedSession(SessionName);
+		if (Outcome == EOutcome::Succeed)
+		{
+			CompletionDelegate.ExecuteIfBound(SessionName, true);
+			TriggerOnDestroySessionCompleteDelegates(SessionName, true);
+		}
+	});
+	return true;
+}
+
+bool FMockOnlineSession::IsPlayerInSession(const FName SessionName, const FUniqueNetId& UniqueId)
+{
+	const FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (!Session) return false;
+
+	for (const FUniqueNetIdRef& Player : Session->RegisteredPlayers)
+	{
+		if (*Player == UniqueId) return true;
+	}
+	return false;
+}
+
+//
+// Search
+//
+
+bool FMockOnlineSession::FindSessions(const int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	return FindSessions(*MockOnlineSession::MakeLocalUserId(SearchingPlayerNum), SearchSettings);
+}
+
+bool FMockOnlineSession::FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	// One at a time, like the real ones
+	if (CurrentSearch.IsValid()) return false;
+	if (AdvertisedSessions.IsEmpty()) GenerateAdvertisedSessions();
+
+	CurrentSearch = SearchSettings;
+	SearchSettings->SearchState = EOnlineAsyncTaskState::InProgress;
+	SearchSettings->SearchResults.Reset();
+	const uint32 Generation = ++SearchGeneration;
+
+	// The service does the filtering, so it isn't part of what's measured on our side
+	TArray<FOnlineSessionSearchResult> Matches;
+	for (const FOnlineSessionSearchResult& Advertised : AdvertisedSessions)
+	{
+		if (Matches.Num() >= SearchSettings->MaxSearchResults) break;
+		if (MatchesQuery(Advertised, *SearchSettings)) Matches.Add(Advertised);
+	}
+
+	const EOutcome Outcome = DrawOutcome();
+	const float Latency = DrawLatencySeconds(Settings.FindLatencyMs);
+	if (Outcome == EOutcome::Drop) return true; // Stays "in progress" until canceled
+
+	auto Finish = [this, Generation](const bool bWasSuccessful)
+	{
+		if (Generation != SearchGeneration || !CurrentSearch.IsValid()) return;
+		CurrentSearch->SearchState = bWasSuccessful ? EOnlineAsyncTaskState::Done : EOnlineAsyncTaskState::Failed;
+		CurrentSearch.Reset();
+		TriggerOnFindSessionsCompleteDelegates(bWasSuccessful);
+	};
+
+	if (Outcome == EOutcome::Fail)
+	{
+		Schedule(Latency, [Finish]() { Finish(false); });
+		return true;
+	}
+
+	// Slices over the latency, the last one with the completion
+	const int32 SliceSize = FMath::DivideAndRoundUp(FMath::Max(Matches.Num(), 1), MockOnlineSession::NumSearchSlices);
+	for (int32 Slice = 0; Slice < MockOnlineSession::NumSearchSlices; ++Slice)
+	{
+		TArray<FOnlineSessionSearchResult> SliceResults;
+		for (int32 Index = Slice * SliceSize; Index < FMath::Min((Slice + 1) * SliceSize, Matches.Num()); ++Index)
+			SliceResults.Add(MoveTemp(Matches[Index]));
+
+		const bool bLast = Slice == MockOnlineSession::NumSearchSlices - 1;
+		Schedule(Latency * (Slice + 1) / MockOnlineSession::NumSearchSlices, [this, Generation, Finish, bLast, SliceResults = MoveTemp(SliceResults)]()
+		{
+			if (Generation != SearchGeneration || !CurrentSearch.IsValid()) return;
+			CurrentSearch->SearchResults.Append(SliceResults);
+			if (bLast) Finish(true);
+		});
+	}
+	return true;
+}
+
+bool FMockOnlineSession::CancelFindSessions()
+{
+	if (!CurrentSearch.IsValid()) return false;
+
+	++SearchGeneration;
+	CurrentSearch->SearchState = EOnlineAsyncTaskState::Failed;
+	CurrentSearch.Reset();
+	Schedule(0.f, [this]()
+	{
+		TriggerOnCancelFindSessionsCompleteDelegates(true);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::PingSearchResults(const FOnlineSessionSearchResult& SearchResult)
+{
+	return false;
+}
+
+//
+// Join
+//
+
+bool FMockOnlineSession::JoinSession(const int32 LocalUserNum, const FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	return JoinSession(*MockOnlineSession::MakeLocalUserId(LocalUserNum), SessionName, DesiredSession);
+}
+
+bool FMockOnlineSession::JoinSession(const FUniqueNetId& LocalUserId, const FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	const float Latency = DrawLatencySeconds(Settings.JoinLatencyMs);
+	if (GetNamedSession(SessionName))
+	{
+		Schedule(Latency, [this, SessionName]()
+		{
+			TriggerOnJoinSessionCompleteDelegates(SessionName, EOnJoinSessionCompleteResult::AlreadyInSession);
+		});
+		return true;
+	}
+
+	const FString SessionId = DesiredSession.GetSessionIdStr();
+	const EOutcome Outcome = DrawOutcome();
+	const bool bFull = Random.GetFraction() < Settings.JoinFullRate;
+	Schedule(Latency, [this, SessionName, SessionId, Outcome, bFull]()
+	{
+		if (GetNamedSession(SessionName))
+		{
+			TriggerOnJoinSessionCompleteDelegates(SessionName, EOnJoinSessionCompleteResult::AlreadyInSession);
+			return;
+		}
+
+		FOnlineSessionSearchResult* Advertised = AdvertisedSessions.FindByPredicate([&SessionId](const FOnlineSessionSearchResult& Result)
+		{
+			return Result.GetSessionIdStr() == SessionId;
+		});
+
+		EOnJoinSessionCompleteResult::Type Result = EOnJoinSessionCompleteResult::Success;
+		if (Outcome == EOutcome::Fail) Result = EOnJoinSessionCompleteResult::UnknownError;
+		else if (!Advertised) Result = EOnJoinSessionCompleteResult::SessionDoesNotExist;
+		else if (bFull || Advertised->Session.NumOpenPublicConnections <= 0) Result = EOnJoinSessionCompleteResult::SessionIsFull;
+
+		if (Result == EOnJoinSessionCompleteResult::Success)
+		{
+			--Advertised->Session.NumOpenPublicConnections;
+			FNamedOnlineSession* Joined = AddNamedSession(SessionName, Advertised->Session);
+			Joined->SessionState = EOnlineSessionState::Pending;
+			Joined->bHosting = false;
+		}
+		if (Outcome != EOutcome::Drop) TriggerOnJoinSessionCompleteDelegates(SessionName, Result);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::GetResolvedConnectString(const FName SessionName, FString& ConnectInfo, FName PortType)
+{
+	const FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	const MockOnlineSession::FOnlineSessionInfoMock* Info = Session ? MockOnlineSession::GetMockInfo(*Session) : nullptr;
+	if (!Info) return false;
+
+	ConnectInfo = Info->Address;
+	return true;
+}
+
+bool FMockOnlineSession::GetResolvedConnectString(const FOnlineSessionSearchResult& SearchResult, FName PortType, FString& ConnectInfo)
+{
+	const MockOnlineSession::FOnlineSessionInfoMock* Info = MockOnlineSession::GetMockInfo(SearchResult.Session);
+	if (!Info) return false;
+
+	ConnectInfo = Info->Address;
+	return true;
+}
+
+FOnlineSessionSettings* FMockOnlineSession::GetSessionSettings(const FName SessionName)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	return Session ? &Session->SessionSettings : nullptr;
+}
+
+int32 FMockOnlineSession::GetNumSessions()
+{
+	return NamedSessions.Num();
+}
+
+void FMockOnlineSession::DumpSessionState()
+{
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Mock session backend: %d advertised, %d named, %d callbacks scheduled"),
+		AdvertisedSessions.Num(), NamedSessions.Num(), ScheduledCallbacks.Num());
+	for (const TPair<FName, TUniquePtr<FNamedOnlineSession>>& Pair : NamedSessions)
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("  %s: %s, %s, %d/%d open"), *Pair.Key.ToString(), EOnlineSessionState::ToString(Pair.Value->SessionState),
+			Pair.Value->bHosting ? TEXT("hosting") : TEXT("joined"), Pair.Value->NumOpenPublicConnections, Pair.Value->SessionSettings.NumPublicConnections);
+	}
+}
+
+//
+// Not simulated
+//
+
+bool FMockOnlineSession::StartMatchmaking(const TArray<FUniqueNetIdRef>& LocalPlayers, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	return false;
+}
+
+bool FMockOnlineSession::CancelMatchmaking(int32 SearchingPlayerNum, FName SessionName)
+{
+	return false;
+}
+
+bool FMockOnlineSession::CancelMatchmaking(const FUniqueNetId& SearchingPlayerId, FName SessionName)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindSessionById(const FUniqueNetId& SearchingUserId, const FUniqueNetId& SessionId, const FUniqueNetId& FriendId, const FOnSingleSessionResultCompleteDelegate& CompletionDelegate)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindFriendSession(int32 LocalUserNum, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindFriendSession(const FUniqueNetId& LocalUserId, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindFriendSession(const FUniqueNetId& LocalUserId, const TArray<FUniqueNetIdRef>& FriendList)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriend(int32 LocalUserNum, FName SessionName, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriend(const FUniqueNetId& LocalUserId, FName SessionName, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriends(int32 LocalUserNum, FName SessionName, const TArray<FUniqueNetIdRef>& Friends)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriends(const FUniqueNetId& LocalUserId, FName SessionName, const TArray<FUniqueNetIdRef>& Friends)
+{
+	return false;
+}
+
+bool FMockOnlineSession::RegisterPlayer(FName SessionName, const FUniqueNetId& PlayerId, bool bWasInvited)
+{
+	return false;
+}
+
+bool FMockOnlineSession::RegisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players, bool bWasInvited)
+{
+	return false;
+}
+
+bool FMockOnlineSession::UnregisterPlayer(FName SessionName, const FUniqueNetId& PlayerId)
+{
+	return false;
+}
+
+bool FMockOnlineSession::UnregisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players)
+{
+	return false;
+}
+
+void FMockOnlineSession::RegisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnRegisterLocalPlayerCompleteDelegate& Delegate)
+{
+	Delegate.ExecuteIfBound(PlayerId, EOnJoinSessionCompleteResult::Success);
+}
+
+void FMockOnlineSession::UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnUnregisterLocalPlayerCompleteDelegate& Delegate)
+{
+	Delegate.ExecuteIfBound(PlayerId, true);
+}
+
+void FMockOnlineSession::RemovePlayerFromSession(int32 LocalUserNum, FName SessionName, const FUniqueNetId& TargetPlayerId)
+{
+}
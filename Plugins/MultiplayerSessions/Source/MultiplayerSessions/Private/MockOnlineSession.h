@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/OnlineSessionInterface.h" // Who needs: IOnlineSession
+#include "OnlineSessionSettings.h" // Who needs: FOnlineSessionSearchResult, FNamedOnlineSession
+#include "Containers/Ticker.h" // Who needs: FTSTicker
+
+// How the latency of a mock operation is drawn around its mean
+enum class EMockLatencyDistribution : uint8
+{
+	Uniform, // Mean +- Jitter
+	Normal, // Jitter is the standard deviation
+	LogNormal // Long tail, like a real backend. Jitter is roughly the standard deviation.
+};
+
+// Extra: Everything the mock backend can be told to do. Read from the MultiplayerSessions.Mock.* cvars when it's created.
+struct FMockOnlineSessionSettings
+{
+	int32 NumSessions{ 2000 };
+	int32 Seed{ 1234 };
+	// Comma separated. Each advertised session gets one of them.
+	FString MatchTypes{ TEXT("FreeForAll,Teams,CaptureTheFlag") };
+
+	EMockLatencyDistribution Distribution{ EMockLatencyDistribution::LogNormal };
+	float CreateLatencyMs{ 150.f };
+	float FindLatencyMs{ 600.f };
+	float JoinLatencyMs{ 250.f };
+	float DestroyLatencyMs{ 100.f };
+	float StartLatencyMs{ 50.f };
+	float JitterMs{ 80.f };
+
+	// Operations that complete with a failure
+	float FailureRate{ 0.f };
+	// Operations that never complete (the subsystem times them out)
+	float DropRate{ 0.f };
+	// Joins that find the session full, on top of the sessions that really are full
+	float JoinFullRate{ 0.f };
+
+	static FMockOnlineSessionSettings FromConsoleVariables();
+};
+
+/**
+ * Extra: In-process session backend, for benchmarks and tests on a machine with no Steam and no network.
+ * Advertises NumSessions fake sessions and completes every operation on the core ticker after a random latency,
+ * with failures and dropped callbacks injected at the configured rates. Seeded, so the same settings give the same run.
+ *
+ * Search results show up in slices while the search is running, like the services that fill SearchResults as
+ * responses arrive. QuerySettings are checked against the advertised settings like an online filter: Equals and
+ * NotEquals on any type, GreaterThan(Equals) and LessThan(Equals) on numbers. Other ops (Near, In...) always pass.
+ *
+ * Used by UMultiplayerSessionsSubsystem instead of the online subsystem's session interface when started with
+ * -MockSessions (or MultiplayerSessions.Mock.Enable=1). Game thread only.
+ */
+class FMockOnlineSession : public IOnlineSession
+{
+public:
+	explicit FMockOnlineSession(const FMockOnlineSessionSettings& InSettings);
+	virtual ~FMockOnlineSession() override;
+
+	static bool IsEnabled();
+
+	// Advertised sessions, for the benchmark
+	int32 GetNumAdvertisedSessions() const { return AdvertisedSessions.Num(); }
+
+	//
+	// IOnlineSession. What UMultiplayerSessionsSubsystem uses is simulated, the rest fails.
+	//
+	virtual FUniqueNetIdPtr CreateSessionIdFromString(const FString& SessionIdStr) override;
+	virtual FNamedOnlineSession* GetNamedSession(FName SessionName) override;
+	virtual void RemoveNamedSession(FName SessionName) override;
+	virtual EOnlineSessionState::Type GetSessionState(FName SessionName) const override;
+	virtual bool HasPresenceSession() override;
+	virtual bool CreateSession(int32 HostingPlayerNum, FName SessionName, const FOnlineSessionSettings& NewSessionSettings) override;
+	virtual bool CreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings) override;
+	virtual bool StartSession(FName SessionName) override;
+	virtual bool UpdateSession(FName SessionName, FOnlineSessionSettings& UpdatedSessionSettings, bool bShouldRefreshOnlineData = true) override;
+	virtual bool EndSession(FName SessionName) override;
+	virtual bool DestroySession(FName SessionName, const FOnDestroySessionCompleteDelegate& CompletionDelegate = FOnDestroySessionCompleteDelegate()) override;
+	virtual bool IsPlayerInSession(FName SessionName, const FUniqueNetId& UniqueId) override;
+	virtual bool StartMatchmaking(const TArray<FUniqueNetIdRef>& LocalPlayers, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool CancelMatchmaking(int32 SearchingPlayerNum, FName SessionName) override;
+	virtual bool CancelMatchmaking(const FUniqueNetId& SearchingPlayerId, FName SessionName) override;
+	virtual bool FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool FindSessionById(const FUniqueNetId& SearchingUserId, const FUniqueNetId& SessionId, const FUniqueNetId& FriendId, const FOnSingleSessionResultCompleteDelegate& CompletionDelegate) override;
+	virtual bool CancelFindSessions() override;
+	virtual bool PingSearchResults(const FOnlineSessionSearchResult& SearchResult) override;
+	virtual bool JoinSession(int32 LocalUserNum, FName SessionName, const FOnlineSessionSearchResult& DesiredSession) override;
+	virtual bool JoinSession(const FUniqueNetId& LocalUserId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession) override;
+	virtual bool FindFriendSession(int32 LocalUserNum, const FUniqueNetId& Friend) override;
+	virtual bool FindFriendSession(const FUniqueNetId& LocalUserId, const FUniqueNetId& Friend) override;
+	virtual bool FindFriendSession(const FUniqueNetId& LocalUserId, const TArray<FUniqueNetIdRef>& FriendList) override;
+	virtual bool SendSessionInviteToFriend(int32 LocalUserNum, FName SessionName, const FUniqueNetId& Friend) override;
+	virtual bool SendSessionInviteToFriend(const FUniqueNetId& LocalUserId, FName SessionName, const FUniqueNetId& Friend) override;
+	virtual bool SendSessionInviteToFriends(int32 LocalUserNum, FName SessionName, const TArray<FUniqueNetIdRef>& Friends) override;
+	virtual bool SendSessionInviteToFriends(const FUniqueNetId& LocalUserId, FName SessionName, const TArray<FUniqueNetIdRef>& Friends) override;
+	virtual bool GetResolvedConnectString(FName SessionName, FString& ConnectInfo, FName PortType = NAME_GamePort) override;
+	virtual bool GetResolvedConnectString(const FOnlineSessionSearchResult& SearchResult, FName PortType, FString& ConnectInfo) override;
+	virtual FOnlineSessionSettings* GetSessionSettings(FName SessionName) override;
+	virtual bool RegisterPlayer(FName SessionName, const FUniqueNetId& PlayerId, bool bWasInvited) override;
+	virtual bool RegisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players, bool bWasInvited = false) override;
+	virtual bool UnregisterPlayer(FName SessionName, const FUniqueNetId& PlayerId) override;
+	virtual bool UnregisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players) override;
+	virtual void RegisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnRegisterLocalPlayerCompleteDelegate& Delegate) override;
+	virtual void UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnUnregisterLocalPlayerCompleteDelegate& Delegate) override;
+	virtual void RemovePlayerFromSession(int32 LocalUserNum, FName SessionName, const FUniqueNetId& TargetPlayerId) override;
+	virtual int32 GetNumSessions() override;
+	virtual void DumpSessionState() override;
+
+protected:
+	virtual FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings) override;
+	virtual FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSession& Session) override;
+
+private:
+	enum class EOutcome : uint8
+	{
+		Succeed,
+		Fail,
+		Drop
+	};
+
+	void GenerateAdvertisedSessions();
+	bool MatchesQuery(const FOnlineSessionSearchResult& Result, const FOnlineSessionSearch& Search) const;
+
+	float DrawLatencySeconds(float MeanMs);
+	EOutcome DrawOutcome();
+
+	// Runs Callback on the core ticker DelaySeconds from now. Dropped when the mock goes away.
+	void Schedule(float DelaySeconds, TFunction<void()>&& Callback);
+	bool Tick(float DeltaTime);
+
+	FMockOnlineSessionSettings Settings;
+	FRandomStream Random;
+
+	TArray<FOnlineSessionSearchResult> AdvertisedSessions;
+	// Ours, hosted or joined. TUniquePtr so GetNamedSession pointers survive adding another one.
+	TMap<FName, TUniquePtr<FNamedOnlineSession>> NamedSessions;
+
+	struct FScheduledCallback
+	{
+		double DueTime{ 0.0 };
+		uint64 Order{ 0 }; // Same due time: first scheduled, first run
+		TFunction<void()> Callback;
+	};
+	TArray<FScheduledCallback> ScheduledCallbacks;
+	uint64 LastScheduledOrder{ 0 };
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	TSharedPtr<FOnlineSessionSearch> CurrentSearch;
+	// Bumped by CancelFindSessions and by every new search, so the slices of an old one do nothing
+	uint32 SearchGeneration{ 0 };
+};
@@ -1,18 +1,34 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "MultiplayerSessions.h"
+#include "MultiplayerSessionsTrace.h"
+#include "MultiplayerSessionsEventLog.h"
+
+DEFINE_LOG_CATEGORY(LogMultiplayerSessions);
+
+LLM_DEFINE_TAG(MultiplayerSessions);
+LLM_DEFINE_TAG(MultiplayerSessions_Search, NAME_None, TEXT("MultiplayerSessions"));
+LLM_DEFINE_TAG(MultiplayerSessions_UI, NAME_None, TEXT("MultiplayerSessions"));
 
 #define LOCTEXT_NAMESPACE "FMultiplayerSessionsModule"
 
 void FMultiplayerSessionsModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+	FMultiplayerSessionsTrace::Startup();
+#if MULTIPLAYERSESSIONS_WITH_EVENT_LOG
+	FMultiplayerSessionsEventLog::Startup();
+#endif
 }
 
 void FMultiplayerSessionsModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FMultiplayerSessionsTrace::Shutdown();
+#if MULTIPLAYERSESSIONS_WITH_EVENT_LOG
+	FMultiplayerSessionsEventLog::Shutdown();
+#endif
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsAttributes.h"
+#include "OnlineSessionSettings.h" // Who needs: FOnlineSessionSettings
+#include "Misc/NetworkVersion.h" // Who needs: FNetworkVersion
+
+namespace MultiplayerSessionsAttributes
+{
+	void Write(const FMultiplayerSessionAttributes& Attributes, FOnlineSessionSettings& OutSettings)
+	{
+		// If we don't define the InType, it won't advertise these values to the online session search
+		OutSettings.Set(BuildKey, Attributes.BuildVersion, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+		OutSettings.Set(MatchTypeKey, static_cast<int32>(Attributes.MatchType), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+		OutSettings.Set(InfoKey, PackInfo(Attributes), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	}
+
+	bool Read(const FOnlineSessionSettings& Settings, FMultiplayerSessionAttributes& OutAttributes)
+	{
+		int32 MatchType{ 0 };
+		int32 Info{ 0 };
+		if (!Settings.Get(BuildKey, OutAttributes.BuildVersion) || !Settings.Get(MatchTypeKey, MatchType) || !Settings.Get(InfoKey, Info))
+			return false;
+
+		OutAttributes.MatchType = static_cast<uint8>(MatchType);
+		UnpackInfo(Info, OutAttributes);
+		return true;
+	}
+
+	int32 GetLocalBuildVersion()
+	{
+		// Same number the engine checks when the client connects, so a session we accept is one we can play in
+		return static_cast<int32>(FNetworkVersion::GetLocalNetworkVersion());
+	}
+}
@@ -0,0 +1,252 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsBenchmark.h"
+#include "MultiplayerSessions.h" // Who needs: LogMultiplayerSessions
+#include "OnlineSessionSettings.h" // Who needs: FOnlineSessionSearchResult
+#include "Engine/GameInstance.h" // Who needs: UGameInstance::GetSubsystem (console command)
+#include "HAL/IConsoleManager.h" // Who needs: FAutoConsoleCommandWithWorldAndArgs
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+TSharedPtr<FMultiplayerSessionsBenchmark> FMultiplayerSessionsBenchmark::Running;
+
+namespace MultiplayerSessionsBenchmark
+{
+	static const TCHAR* OpNames[] = { TEXT("Create"), TEXT("Find"), TEXT("Join"), TEXT("Destroy"), TEXT("Start") };
+	static_assert(UE_ARRAY_COUNT(OpNames) == static_cast<int32>(EMultiplayerSessionOp::MAX), "One name per EMultiplayerSessionOp");
+
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+		TEXT("MultiplayerSessions.Benchmark"),
+		TEXT("[Iterations=100] [MatchType=FreeForAll] Runs Find/Join/Destroy and Create/Destroy, then prints latency percentiles and throughput per operation. Use with -MockSessions."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+			UMultiplayerSessionsSubsystem* Subsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+			if (!Subsystem) return;
+
+			const int32 Iterations = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100;
+			FMultiplayerSessionsBenchmark::Run(Subsystem, FMath::Max(Iterations, 1), Args.Num() > 1 ? Args[1] : FString(TEXT("FreeForAll")));
+		}));
+
+	// Nearest rank, on a sorted array
+	static double Percentile(const TArray<double>& Sorted, const double P)
+	{
+		if (Sorted.IsEmpty()) return 0.0;
+		const int32 Rank = FMath::Clamp(FMath::CeilToInt(P * Sorted.Num()), 1, Sorted.Num());
+		return Sorted[Rank - 1];
+	}
+
+	// What a result keeps on the heap, roughly. Shared ids are not counted (the backend owns them).
+	static int64 GetResultSize(const FOnlineSessionSearchResult& Result)
+	{
+		const FOnlineSession& Session = Result.Session;
+		int64 Size = sizeof(FOnlineSessionSearchResult) + Session.OwningUserName.GetAllocatedSize()
+			+ Session.SessionSettings.Settings.GetAllocatedSize() + Session.SessionSettings.MemberSettings.GetAllocatedSize();
+		for (const auto& Setting : Session.SessionSettings.Settings)
+		{
+			if (Setting.Value.Data.GetType() == EOnlineKeyValuePairDataType::String)
+				Size += (Setting.Value.Data.ToString().Len() + 1) * sizeof(TCHAR);
+		}
+		if (Session.SessionInfo.IsValid()) Size += Session.SessionInfo->GetSize();
+		return Size;
+	}
+}
+
+void FMultiplayerSessionsBenchmark::Run(UMultiplayerSessionsSubsystem* Subsystem, const int32 Iterations, const FString& MatchType)
+{
+	check(Subsystem);
+	if (Running.IsValid())
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Benchmark: already running (iteration %d/%d)"), Running->Iteration + 1, Running->Iterations);
+		return;
+	}
+	if (!Subsystem->IsUsingMockSessionBackend())
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Benchmark: not using the mock backend (-MockSessions), numbers depend on the online service"));
+
+	Running = MakeShared<FMultiplayerSessionsBenchmark>();
+	Running->Subsystem = Subsystem;
+	Running->Iterations = Iterations;
+	Running->MatchType = MatchType;
+	Running->Start();
+}
+
+FMultiplayerSessionsBenchmark::~FMultiplayerSessionsBenchmark()
+{
+	if (TickerHandle.IsValid()) FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	if (UMultiplayerSessionsSubsystem* SessionsSubsystem = Subsystem.Get())
+		SessionsSubsystem->MultiplayerOnFindSessionComplete.Remove(FindSessionsHandle);
+}
+
+void FMultiplayerSessionsBenchmark::Start()
+{
+	UMultiplayerSessionsSubsystem* SessionsSubsystem = Subsystem.Get();
+	check(SessionsSubsystem);
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Benchmark: %d iterations of Find/Join/Destroy and Create/Destroy (%s)"), Iterations, *MatchType);
+
+	// Every search goes to the backend
+	SessionsSubsystem->InvalidateSessionCache();
+	FindSessionsHandle = SessionsSubsystem->MultiplayerOnFindSessionComplete.AddSP(this, &FMultiplayerSessionsBenchmark::OnFindSessions);
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FMultiplayerSessionsBenchmark::Tick));
+
+	StartTime = FPlatformTime::Seconds();
+	StartStep(EStep::Find);
+}
+
+bool FMultiplayerSessionsBenchmark::Tick(float DeltaTime)
+{
+	if (!Subsystem.IsValid())
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Benchmark: subsystem went away, stopped"));
+		TickerHandle.Reset();
+		Running.Reset(); // Deletes us. Fine: the ticker doesn't touch us after we return.
+		return false;
+	}
+
+	if (Pending.IsSet() && Pending->IsReady())
+	{
+		const FMultiplayerSessionOpResult Result = Pending->Get();
+		Pending.Reset();
+		OnStepFinished(Result);
+	}
+
+	if (Step == EStep::Done)
+	{
+		TickerHandle.Reset();
+		Finish();
+		return false;
+	}
+	return true;
+}
+
+void FMultiplayerSessionsBenchmark::StartStep(const EStep NextStep)
+{
+	UMultiplayerSessionsSubsystem* SessionsSubsystem = Subsystem.Get();
+	check(SessionsSubsystem);
+
+	Step = NextStep;
+	switch (Step)
+	{
+	case EStep::Find:
+		LastSearchResults.Reset();
+		Pending = SessionsSubsystem->QueueFindSessions(UMultiplayerSessionsSubsystem::MaxSearchPageSize, MatchType);
+		break;
+	case EStep::Join:
+		{
+			// Spread the joins over the results, like many players would
+			TArray<const FOnlineSessionSearchResult*> Open;
+			for (const FOnlineSessionSearchResult& Result : LastSearchResults)
+			{
+				if (Result.Session.NumOpenPublicConnections > 0) Open.Add(&Result);
+			}
+			if (Open.IsEmpty())
+			{
+				StartStep(EStep::Create);
+				return;
+			}
+			Pending = SessionsSubsystem->QueueJoinSession(*Open[Iteration % Open.Num()]);
+		}
+		break;
+	case EStep::LeaveJoined:
+	case EStep::DestroyCreated:
+		Pending = SessionsSubsystem->QueueDestroySession();
+		break;
+	case EStep::Create:
+		Pending = SessionsSubsystem->QueueCreateSession(4, MatchType);
+		break;
+	case EStep::Done:
+		break;
+	}
+}
+
+void FMultiplayerSessionsBenchmark::OnStepFinished(const FMultiplayerSessionOpResult& Result)
+{
+	FOpSamples& OpSamples = Samples[static_cast<int32>(Result.Op)];
+	OpSamples.LatenciesMs.Add((Result.QueueTime + Result.RunTime) * 1000.0);
+	switch (Result.Status)
+	{
+	case EMultiplayerSessionOpStatus::Succeeded: ++OpSamples.Succeeded; break;
+	case EMultiplayerSessionOpStatus::TimedOut: ++OpSamples.TimedOut; break;
+	default: ++OpSamples.Failed; break;
+	}
+
+	switch (Step)
+	{
+	case EStep::Find:
+		StartStep(EStep::Join);
+		break;
+	case EStep::Join:
+		StartStep(Result.WasSuccessful() ? EStep::LeaveJoined : EStep::Create);
+		break;
+	case EStep::LeaveJoined:
+		StartStep(EStep::Create);
+		break;
+	case EStep::Create:
+		// A create that timed out may still have created the session: destroy anyway, it's a no-op without one
+		StartStep(EStep::DestroyCreated);
+		break;
+	case EStep::DestroyCreated:
+		if (++Iteration < Iterations) StartStep(EStep::Find);
+		else Step = EStep::Done;
+		break;
+	case EStep::Done:
+		break;
+	}
+}
+
+void FMultiplayerSessionsBenchmark::OnFindSessions(const TArray<FOnlineSessionSearchResult>& Results, bool bWasSuccessful)
+{
+	if (Step != EStep::Find) return;
+
+	LastSearchResults = Results;
+	for (const FOnlineSessionSearchResult& Result : Results)
+		SearchResultBytes += MultiplayerSessionsBenchmark::GetResultSize(Result);
+	SearchResults += Results.Num();
+}
+
+void FMultiplayerSessionsBenchmark::Finish()
+{
+	using namespace MultiplayerSessionsBenchmark;
+
+	const double WallSeconds = FPlatformTime::Seconds() - StartTime;
+	int32 TotalOps = 0;
+
+	FString Csv = TEXT("Op,Samples,Succeeded,Failed,TimedOut,P50Ms,P90Ms,P99Ms,MaxMs,OpsPerSecond\n");
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("%8s %8s %9s %7s %8s %9s %9s %9s %9s %9s"), TEXT("Op"), TEXT("Samples"), TEXT("Succeeded"), TEXT("Failed"),
+		TEXT("TimedOut"), TEXT("P50 ms"), TEXT("P90 ms"), TEXT("P99 ms"), TEXT("Max ms"), TEXT("Ops/s"));
+	for (int32 Index = 0; Index < static_cast<int32>(EMultiplayerSessionOp::MAX); ++Index)
+	{
+		FOpSamples& OpSamples = Samples[Index];
+		if (OpSamples.LatenciesMs.IsEmpty()) continue;
+
+		TotalOps += OpSamples.LatenciesMs.Num();
+		OpSamples.LatenciesMs.Sort();
+		double TotalMs = 0.0;
+		for (const double Ms : OpSamples.LatenciesMs) TotalMs += Ms;
+
+		// One at a time, so the throughput of an operation type is 1 / its mean latency
+		const double OpsPerSecond = TotalMs > 0.0 ? OpSamples.LatenciesMs.Num() * 1000.0 / TotalMs : 0.0;
+		const double P50 = Percentile(OpSamples.LatenciesMs, 0.5);
+		const double P90 = Percentile(OpSamples.LatenciesMs, 0.9);
+		const double P99 = Percentile(OpSamples.LatenciesMs, 0.99);
+		const double Max = OpSamples.LatenciesMs.Last();
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("%8s %8d %9d %7d %8d %9.1f %9.1f %9.1f %9.1f %9.1f"), OpNames[Index], OpSamples.LatenciesMs.Num(),
+			OpSamples.Succeeded, OpSamples.Failed, OpSamples.TimedOut, P50, P90, P99, Max, OpsPerSecond);
+		Csv += FString::Printf(TEXT("%s,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f\n"), OpNames[Index], OpSamples.LatenciesMs.Num(),
+			OpSamples.Succeeded, OpSamples.Failed, OpSamples.TimedOut, P50, P90, P99, Max, OpsPerSecond);
+	}
+
+	// The subsystem keeps each result twice: in the last search and in the session cache
+	const double BytesPerResult = SearchResults > 0 ? static_cast<double>(SearchResultBytes) / SearchResults : 0.0;
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Benchmark: %d operations in %.2f s (%.1f ops/s). %lld search results, ~%.0f bytes each (x2 held: last search + cache)."),
+		TotalOps, WallSeconds, WallSeconds > 0.0 ? TotalOps / WallSeconds : 0.0, SearchResults, BytesPerResult);
+	Csv += FString::Printf(TEXT("All,%d,,,,,,,,%.3f\n"), TotalOps, WallSeconds > 0.0 ? TotalOps / WallSeconds : 0.0);
+	Csv += FString::Printf(TEXT("BytesPerResult,%lld,,,,,,,,%.1f\n"), SearchResults, BytesPerResult);
+
+	const FString CsvPath = FPaths::ProfilingDir() / TEXT("SessionBenchmark.csv");
+	if (FFileHelper::SaveStringToFile(Csv, *CsvPath))
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Wrote %s"), *CsvPath);
+
+	Running.Reset(); // Deletes us
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h" // Who needs: FTSTicker
+#include "MultiplayerSessionsSubsystem.h" // Who needs: FMultiplayerSessionOpFuture, EMultiplayerSessionOp
+
+/**
+ * Extra: Runs Find -> Join -> Destroy and Create -> Destroy through UMultiplayerSessionsSubsystem, Iterations times,
+ * one operation after the other, and reports the latency percentiles and throughput of each operation type, plus the
+ * memory held per search result. Meant for the mock backend (-MockSessions), where the numbers repeat run after run.
+ *
+ * "MultiplayerSessions.Benchmark [Iterations] [MatchType]". Writes Saved/Profiling/SessionBenchmark.csv.
+ * Run it where no Menu is open: the Menu travels on every successful join.
+ */
+class FMultiplayerSessionsBenchmark : public TSharedFromThis<FMultiplayerSessionsBenchmark>
+{
+public:
+	static void Run(UMultiplayerSessionsSubsystem* Subsystem, int32 Iterations, const FString& MatchType);
+
+	~FMultiplayerSessionsBenchmark();
+
+private:
+	enum class EStep : uint8
+	{
+		Find,
+		Join,
+		LeaveJoined,
+		Create,
+		DestroyCreated,
+		Done
+	};
+
+	void Start();
+	bool Tick(float DeltaTime);
+	void StartStep(EStep NextStep);
+	void OnStepFinished(const FMultiplayerSessionOpResult& Result);
+	void OnFindSessions(const TArray<FOnlineSessionSearchResult>& SearchResults, bool bWasSuccessful);
+	void Finish();
+
+	TWeakObjectPtr<UMultiplayerSessionsSubsystem> Subsystem;
+	int32 Iterations{ 0 };
+	int32 Iteration{ 0 };
+	FString MatchType;
+
+	EStep Step{ EStep::Find };
+	TOptional<FMultiplayerSessionOpFuture> Pending;
+	TArray<FOnlineSessionSearchResult> LastSearchResults;
+	FDelegateHandle FindSessionsHandle;
+	FTSTicker::FDelegateHandle TickerHandle;
+	double StartTime{ 0.0 };
+
+	struct FOpSamples
+	{
+		TArray<double> LatenciesMs; // Queue + run
+		int32 Succeeded{ 0 };
+		int32 Failed{ 0 };
+		int32 TimedOut{ 0 };
+	};
+	FOpSamples Samples[static_cast<int32>(EMultiplayerSessionOp::MAX)];
+
+	int64 SearchResults{ 0 };
+	int64 SearchResultBytes{ 0 };
+
+	// One at a time
+	static TSharedPtr<FMultiplayerSessionsBenchmark> Running;
+};
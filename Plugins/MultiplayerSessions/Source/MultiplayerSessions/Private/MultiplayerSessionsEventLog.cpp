@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsEventLog.h"
+
+#if MULTIPLAYERSESSIONS_WITH_EVENT_LOG
+
+#include "MultiplayerSessionsSubsystem.h" // Who needs: EMultiplayerSessionOp, EMultiplayerSessionOpStatus
+#include "Engine/Engine.h" // Who needs: GEngine->AddOnScreenDebugMessage
+#include "Containers/Ticker.h" // Who needs: FTSTicker
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTLS.h"
+#include "Misc/CoreDelegates.h" // Who needs: FCoreDelegates::OnHandleSystemError
+#include <atomic>
+
+namespace MultiplayerSessionsEventLog
+{
+	static_assert(FMath::IsPowerOfTwo(FMultiplayerSessionsEventLog::Capacity), "Capacity must be a power of two");
+
+	// Stamp: 2 * Sequence + 1 while the record is written, 2 * Sequence + 2 once it's done
+	struct FSlot
+	{
+		std::atomic<uint64> Stamp{ 0 };
+		FMultiplayerSessionsEventRecord Record;
+	};
+
+	static FSlot Slots[FMultiplayerSessionsEventLog::Capacity];
+	// Sequence of the next record. Sequences start at 1, so a zeroed stamp is never a valid one.
+	static std::atomic<uint64> NextSequence{ 1 };
+
+	static int32 MirrorToScreen = 0;
+	static FAutoConsoleVariableRef CVarMirrorToScreen(TEXT("MultiplayerSessions.EventLog.Screen"), MirrorToScreen,
+		TEXT("1: also print each session event on screen as it happens (development builds)."));
+
+	static FAutoConsoleCommandWithArgsAndOutputDevice DumpCommand(
+		TEXT("MultiplayerSessions.EventLog"),
+		TEXT("[N=64] Prints the last N session events (ring of the last 1024)."),
+		FConsoleCommandWithArgsAndOutputDeviceDelegate::CreateLambda([](const TArray<FString>& Args, FOutputDevice& Ar)
+		{
+			FMultiplayerSessionsEventLog::Dump(Ar, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 64);
+		}));
+
+	static FTSTicker::FDelegateHandle MirrorTickerHandle;
+	static FDelegateHandle SystemErrorHandle;
+	static uint64 LastMirroredSequence{ 0 };
+
+	static const TCHAR* ToString(const EMultiplayerSessionsEvent Event)
+	{
+		switch (Event)
+		{
+		case EMultiplayerSessionsEvent::OpQueued: return TEXT("OpQueued");
+		case EMultiplayerSessionsEvent::OpCoalesced: return TEXT("OpCoalesced");
+		case EMultiplayerSessionsEvent::OpStarted: return TEXT("OpStarted");
+		case EMultiplayerSessionsEvent::OpFinished: return TEXT("OpFinished");
+		case EMultiplayerSessionsEvent::JoinResult: return TEXT("JoinResult");
+		case EMultiplayerSessionsEvent::SearchBatch: return TEXT("SearchBatch");
+		case EMultiplayerSessionsEvent::QuickJoin: return TEXT("QuickJoin");
+		case EMultiplayerSessionsEvent::QosProbe: return TEXT("QosProbe");
+		case EMultiplayerSessionsEvent::BuildMismatch: return TEXT("BuildMismatch");
+		case EMultiplayerSessionsEvent::QosResponder: return TEXT("QosResponder");
+		case EMultiplayerSessionsEvent::MenuHost: return TEXT("MenuHost");
+		case EMultiplayerSessionsEvent::MenuJoin: return TEXT("MenuJoin");
+		case EMultiplayerSessionsEvent::MenuStart: return TEXT("MenuStart");
+		case EMultiplayerSessionsEvent::Travel: return TEXT("Travel");
+		default: return TEXT("Unknown");
+		}
+	}
+
+	static void Write(const FMultiplayerSessionsEventRecord& Record)
+	{
+		const uint64 Sequence = NextSequence.fetch_add(1, std::memory_order_relaxed);
+		FSlot& Slot = Slots[Sequence & (FMultiplayerSessionsEventLog::Capacity - 1)];
+
+		Slot.Stamp.store(2 * Sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		Slot.Record = Record;
+		Slot.Record.Sequence = Sequence;
+		Slot.Stamp.store(2 * Sequence + 2, std::memory_order_release);
+	}
+
+	static bool TickMirror(float DeltaTime)
+	{
+		if (!MirrorToScreen || !GEngine)
+		{
+			LastMirroredSequence = NextSequence.load(std::memory_order_relaxed) - 1;
+			return true;
+		}
+
+		static TArray<FMultiplayerSessionsEventRecord> Records;
+		FMultiplayerSessionsEventLog::Snapshot(Records, FMultiplayerSessionsEventLog::Capacity, LastMirroredSequence);
+		const double Now = FPlatformTime::Seconds();
+		for (const FMultiplayerSessionsEventRecord& Record : Records)
+		{
+			const bool bBad = (Record.Event == EMultiplayerSessionsEvent::OpFinished && Record.ResultCode != static_cast<int32>(EMultiplayerSessionOpStatus::Succeeded))
+				|| (Record.Event == EMultiplayerSessionsEvent::JoinResult && Record.ResultCode != EOnJoinSessionCompleteResult::Success)
+				|| Record.Event == EMultiplayerSessionsEvent::BuildMismatch;
+			GEngine->AddOnScreenDebugMessage(-1, 8.f, bBad ? FColor::Orange : FColor::Cyan, FMultiplayerSessionsEventLog::ToString(Record, Now));
+			LastMirroredSequence = Record.Sequence;
+		}
+		return true;
+	}
+}
+
+void FMultiplayerSessionsEventLog::Record(const EMultiplayerSessionsEvent Event, const FName SessionName, const int32 ResultCode, const int32 Value)
+{
+	FMultiplayerSessionsEventRecord NewRecord;
+	NewRecord.Time = FPlatformTime::Seconds();
+	NewRecord.SessionName = SessionName;
+	NewRecord.ResultCode = ResultCode;
+	NewRecord.Value = Value;
+	NewRecord.ThreadId = FPlatformTLS::GetCurrentThreadId();
+	NewRecord.Event = Event;
+	MultiplayerSessionsEventLog::Write(NewRecord);
+}
+
+void FMultiplayerSessionsEventLog::RecordOp(const EMultiplayerSessionsEvent Event, const EMultiplayerSessionOp Op, const uint32 OpId, const int32 ResultCode, const int32 Value)
+{
+	FMultiplayerSessionsEventRecord NewRecord;
+	NewRecord.Time = FPlatformTime::Seconds();
+	NewRecord.SessionName = NAME_GameSession; // Every operation of the subsystem works on it
+	NewRecord.ResultCode = ResultCode;
+	NewRecord.Value = Value;
+	NewRecord.OpId = OpId;
+	NewRecord.ThreadId = FPlatformTLS::GetCurrentThreadId();
+	NewRecord.Event = Event;
+	NewRecord.Op = static_cast<uint8>(Op);
+	MultiplayerSessionsEventLog::Write(NewRecord);
+}
+
+void FMultiplayerSessionsEventLog::Snapshot(TArray<FMultiplayerSessionsEventRecord>& OutRecords, const int32 MaxRecords, const uint64 AfterSequence)
+{
+	using namespace MultiplayerSessionsEventLog;
+
+	OutRecords.Reset();
+	const uint64 End = NextSequence.load(std::memory_order_acquire);
+	const uint64 Count = FMath::Clamp(MaxRecords, 0, static_cast<int32>(Capacity));
+	const uint64 Begin = FMath::Max3<uint64>(End > Count ? End - Count : 1, AfterSequence + 1, 1);
+	for (uint64 Sequence = Begin; Sequence < End; ++Sequence)
+	{
+		const FSlot& Slot = Slots[Sequence & (Capacity - 1)];
+		const uint64 Expected = 2 * Sequence + 2;
+		if (Slot.Stamp.load(std::memory_order_acquire) != Expected) continue; // Still being written, or already overwritten
+
+		const FMultiplayerSessionsEventRecord Copy = Slot.Record;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (Slot.Stamp.load(std::memory_order_relaxed) != Expected) continue; // Overwritten while we copied it
+
+		OutRecords.Add(Copy);
+	}
+}
+
+void FMultiplayerSessionsEventLog::Dump(FOutputDevice& Ar, const int32 MaxRecords)
+{
+	TArray<FMultiplayerSessionsEventRecord> Records;
+	Snapshot(Records, MaxRecords);
+
+	const double Now = FPlatformTime::Seconds();
+	Ar.Logf(TEXT("MultiplayerSessions event log: %d records"), Records.Num());
+	for (const FMultiplayerSessionsEventRecord& Record : Records)
+		Ar.Logf(TEXT("  %s"), *ToString(Record, Now));
+}
+
+FString FMultiplayerSessionsEventLog::ToString(const FMultiplayerSessionsEventRecord& Record, const double Now)
+{
+	FString Result;
+	switch (Record.Event)
+	{
+	case EMultiplayerSessionsEvent::OpFinished:
+		Result = StaticEnum<EMultiplayerSessionOpStatus>()->GetNameStringByValue(Record.ResultCode);
+		break;
+	case EMultiplayerSessionsEvent::JoinResult:
+		Result = LexToString(static_cast<EOnJoinSessionCompleteResult::Type>(Record.ResultCode));
+		break;
+	default:
+		Result = FString::FromInt(Record.ResultCode);
+		break;
+	}
+
+	const FString Op = Record.Op != 0xFF
+		? FString::Printf(TEXT(" %s #%u"), *StaticEnum<EMultiplayerSessionOp>()->GetNameStringByValue(Record.Op), Record.OpId)
+		: FString();
+	return FString::Printf(TEXT("[%llu] %.3f s ago, thread %u: %s%s %s result %s value %d"), Record.Sequence, Now - Record.Time, Record.ThreadId,
+		MultiplayerSessionsEventLog::ToString(Record.Event), *Op, *Record.SessionName.ToString(), *Result, Record.Value);
+}
+
+void FMultiplayerSessionsEventLog::Startup()
+{
+	using namespace MultiplayerSessionsEventLog;
+
+	MirrorTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&TickMirror));
+	// What led to the crash. The log is flushed by the crash handler after this.
+	SystemErrorHandle = FCoreDelegates::OnHandleSystemError.AddLambda([]()
+	{
+		if (GLog) Dump(*GLog);
+	});
+}
+
+void FMultiplayerSessionsEventLog::Shutdown()
+{
+	using namespace MultiplayerSessionsEventLog;
+
+	FTSTicker::GetCoreTicker().RemoveTicker(MirrorTickerHandle);
+	FCoreDelegates::OnHandleSystemError.Remove(SystemErrorHandle);
+}
+
+#endif // MULTIPLAYERSESSIONS_WITH_EVENT_LOG
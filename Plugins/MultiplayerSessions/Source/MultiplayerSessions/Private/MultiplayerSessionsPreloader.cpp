@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsPreloader.h"
+#include "MultiplayerSessions.h" // Who needs: LogMultiplayerSessions
+#include "MultiplayerSessionsTrace.h" // Who needs: MULTIPLAYERSESSIONS_TRACE_SCOPE
+#include "AssetRegistry/IAssetRegistry.h" // Who needs: IAssetRegistry::GetDependencies
+#include "Misc/PackageName.h"
+#include "UObject/UObjectGlobals.h" // Who needs: FCoreUObjectDelegates::PreLoadMap, PostLoadMapWithWorld
+
+FMultiplayerSessionsPreloader::FMultiplayerSessionsPreloader()
+{
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddRaw(this, &FMultiplayerSessionsPreloader::OnPreLoadMap);
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FMultiplayerSessionsPreloader::OnPostLoadMap);
+}
+
+FMultiplayerSessionsPreloader::~FMultiplayerSessionsPreloader()
+{
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	FTSTicker::GetCoreTicker().RemoveTicker(TimeoutHandle);
+
+	Release(TEXT("shutdown"));
+}
+
+void FMultiplayerSessionsPreloader::Preload(const FString& MapPath)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::Preload");
+
+	FString MapPackageName;
+	MapPath.Split(TEXT("?"), &MapPackageName, nullptr);
+	if (MapPackageName.IsEmpty()) MapPackageName = MapPath;
+	MapPackageName = FPackageName::ObjectPathToPackageName(MapPackageName);
+	if (!FPackageName::IsValidLongPackageName(MapPackageName)) return;
+
+	if (Handle.IsValid() && MapPackage == FName(MapPackageName)) return;
+	Release(TEXT("another map"));
+
+	MapPackage = FName(MapPackageName);
+	TArray<FSoftObjectPath> Assets;
+	GatherDependencies(MapPackage, Assets);
+	if (Assets.IsEmpty())
+	{
+		// Cooked builds only have dependencies in the asset registry if it was cooked with them
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Preload: no dependencies known for %s, nothing to preload"), *MapPackageName);
+		return;
+	}
+
+	NumAssets = Assets.Num();
+	PreloadStartTime = FPlatformTime::Seconds();
+	PreloadEndTime = 0.0;
+	TravelStartTime = 0.0;
+
+	// Extra: Weak pointer, the streamable manager may complete after we're gone (it's cancelled in the destructor, but
+	// the callback of an already completed request can still be queued)
+	TWeakPtr<FMultiplayerSessionsPreloader> WeakThis = AsShared();
+	Handle = StreamableManager.RequestAsyncLoad(MoveTemp(Assets), [WeakThis]()
+	{
+		if (const TSharedPtr<FMultiplayerSessionsPreloader> This = WeakThis.Pin())
+			This->OnPreloadComplete();
+	}, FStreamableManager::AsyncLoadHighPriority);
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Preload: streaming %d assets of %s"), NumAssets, *MapPackageName);
+
+	if (!TimeoutHandle.IsValid())
+	{
+		TimeoutHandle = FTSTicker::GetCoreTicker().AddTicker(
+			FTickerDelegate::CreateSP(this, &FMultiplayerSessionsPreloader::TickTimeout), 5.f);
+	}
+}
+
+void FMultiplayerSessionsPreloader::GatherDependencies(const FName InMapPackage, TArray<FSoftObjectPath>& OutAssets) const
+{
+	const IAssetRegistry* AssetRegistry = IAssetRegistry::Get();
+	if (!AssetRegistry) return;
+
+	// Breadth first through the hard package dependencies. Script packages are always loaded, skip them.
+	TSet<FName> Visited;
+	TArray<FName> Pending{ InMapPackage };
+	Visited.Add(InMapPackage);
+	TArray<FName> Dependencies;
+	for (int32 Index = 0; Index < Pending.Num() && Visited.Num() < MaxPackages; ++Index)
+	{
+		Dependencies.Reset();
+		AssetRegistry->GetDependencies(Pending[Index], Dependencies, UE::AssetRegistry::EDependencyCategory::Package, UE::AssetRegistry::EDependencyQuery::Hard);
+		for (const FName Dependency : Dependencies)
+		{
+			if (FPackageName::IsScriptPackage(Dependency.ToString()) || Visited.Contains(Dependency)) continue;
+			Visited.Add(Dependency);
+			Pending.Add(Dependency);
+		}
+	}
+
+	TArray<FAssetData> PackageAssets;
+	for (int32 Index = 1; Index < Pending.Num(); ++Index) // 0 is the map
+	{
+		PackageAssets.Reset();
+		AssetRegistry->GetAssetsByPackageName(Pending[Index], PackageAssets);
+		for (const FAssetData& Asset : PackageAssets)
+			OutAssets.Add(Asset.GetSoftObjectPath());
+	}
+}
+
+void FMultiplayerSessionsPreloader::OnPreloadComplete()
+{
+	PreloadEndTime = FPlatformTime::Seconds();
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Preload: %d assets of %s loaded in %.2f s%s"), NumAssets, *MapPackage.ToString(),
+		PreloadEndTime - PreloadStartTime, TravelStartTime > 0.0 ? TEXT(" (travel already started)") : TEXT(""));
+}
+
+void FMultiplayerSessionsPreloader::OnPreLoadMap(const FString& MapName)
+{
+	if (Handle.IsValid() && TravelStartTime == 0.0)
+		TravelStartTime = FPlatformTime::Seconds();
+}
+
+void FMultiplayerSessionsPreloader::OnPostLoadMap(UWorld* LoadedWorld)
+{
+	if (!Handle.IsValid() || TravelStartTime == 0.0) return;
+
+	// Extra: What ran before the travel started overlapped the session round trip, so the travel didn't pay for it
+	const double Now = FPlatformTime::Seconds();
+	const double PreloadEnd = PreloadEndTime > 0.0 ? PreloadEndTime : Now;
+	const double Overlapped = FMath::Max(0.0, FMath::Min(PreloadEnd, TravelStartTime) - PreloadStartTime);
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Preload: map load took %.2f s. Preload took %.2f s, %.2f s of it during the session round trip (saved)%s"),
+		Now - TravelStartTime, PreloadEnd - PreloadStartTime, Overlapped,
+		PreloadEndTime > 0.0 ? TEXT("") : TEXT(", not finished when the map was loaded"));
+
+	// The new map holds what it needs now
+	Release(TEXT("travel done"));
+}
+
+bool FMultiplayerSessionsPreloader::TickTimeout(float DeltaTime)
+{
+	if (!Handle.IsValid())
+	{
+		TimeoutHandle.Reset();
+		return false;
+	}
+
+	if (TravelStartTime == 0.0 && FPlatformTime::Seconds() - PreloadStartTime > ReleaseTimeout)
+	{
+		Release(TEXT("no travel"));
+		TimeoutHandle.Reset();
+		return false;
+	}
+	return true;
+}
+
+void FMultiplayerSessionsPreloader::Release(const TCHAR* Reason)
+{
+	if (!Handle.IsValid()) return;
+
+	UE_LOG(LogMultiplayerSessions, Verbose, TEXT("Preload: releasing %s (%s)"), *MapPackage.ToString(), Reason);
+	// Cancel releases too. A loaded handle has nothing to cancel.
+	if (Handle->IsLoadingInProgress()) Handle->CancelHandle();
+	else Handle->ReleaseHandle();
+	Handle.Reset();
+	MapPackage = NAME_None;
+}
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h" // Who needs: FStreamableManager, FStreamableHandle
+#include "Containers/Ticker.h" // Who needs: FTSTicker
+
+/**
+ * Extra: Streams in what a map needs while the session round trip is still running, so the travel that follows finds
+ * most of it in memory. Started by UMultiplayerSessionsSubsystem when a session is created or searched for.
+ *
+ * Loads the hard dependencies of the map package (asset registry, recursively: meshes, animations, materials...),
+ * not the map itself: a world loaded outside of LoadMap/seamless travel is not something the engine expects.
+ * What was loaded is held until the travel is done (the new map references it by then) and released after,
+ * or released if no travel starts within ReleaseTimeout.
+ *
+ * Each travel logs how long the preload took and how much of it ran during the session round trip
+ * (time the travel no longer pays), next to how long the map load itself took.
+ */
+class FMultiplayerSessionsPreloader : public TSharedFromThis<FMultiplayerSessionsPreloader>
+{
+public:
+	FMultiplayerSessionsPreloader();
+	~FMultiplayerSessionsPreloader();
+
+	// MapPath: "/Game/Maps/Lobby" (URL options are ignored). Does nothing if that map is already preloading or loaded.
+	void Preload(const FString& MapPath);
+	void Release(const TCHAR* Reason);
+
+	bool IsPreloading() const { return Handle.IsValid(); }
+
+	// Seconds without a travel before the preload is given up
+	static constexpr double ReleaseTimeout{ 120.0 };
+	// Upper bound on the packages walked through the dependency graph
+	static constexpr int32 MaxPackages{ 4096 };
+
+private:
+	void GatherDependencies(FName MapPackage, TArray<FSoftObjectPath>& OutAssets) const;
+	void OnPreloadComplete();
+	void OnPreLoadMap(const FString& MapName);
+	void OnPostLoadMap(UWorld* LoadedWorld);
+	bool TickTimeout(float DeltaTime);
+
+	FStreamableManager StreamableManager;
+	TSharedPtr<FStreamableHandle> Handle;
+
+	FName MapPackage;
+	int32 NumAssets{ 0 };
+	double PreloadStartTime{ 0.0 };
+	double PreloadEndTime{ 0.0 };
+	double TravelStartTime{ 0.0 };
+
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+	FTSTicker::FDelegateHandle TimeoutHandle;
+};
@@ -0,0 +1,234 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsQos.h"
+#include "MultiplayerSessions.h" // Who needs: LogMultiplayerSessions
+#include "Sockets.h" // Who needs: FSocket
+#include "SocketSubsystem.h" // Who needs: ISocketSubsystem
+#include "IPAddress.h" // Who needs: FInternetAddr
+#include "HAL/RunnableThread.h"
+
+namespace MultiplayerSessionsQos
+{
+	static void WritePacket(uint8* Packet, const uint16 TargetIndex, const uint16 ProbeIndex)
+	{
+		Packet[0] = Magic & 0xFF;
+		Packet[1] = (Magic >> 8) & 0xFF;
+		Packet[2] = (Magic >> 16) & 0xFF;
+		Packet[3] = (Magic >> 24) & 0xFF;
+		Packet[4] = TargetIndex & 0xFF;
+		Packet[5] = TargetIndex >> 8;
+		Packet[6] = ProbeIndex & 0xFF;
+		Packet[7] = ProbeIndex >> 8;
+	}
+
+	static bool ReadPacket(const uint8* Packet, const int32 Size, uint16& OutTargetIndex, uint16& OutProbeIndex)
+	{
+		if (Size != PacketSize) return false;
+		const uint32 PacketMagic = Packet[0] | (Packet[1] << 8) | (Packet[2] << 16) | (static_cast<uint32>(Packet[3]) << 24);
+		if (PacketMagic != Magic) return false;
+
+		OutTargetIndex = static_cast<uint16>(Packet[4] | (Packet[5] << 8));
+		OutProbeIndex = static_cast<uint16>(Packet[6] | (Packet[7] << 8));
+		return true;
+	}
+
+	static FSocket* CreateSocket(ISocketSubsystem* SocketSubsystem, const TCHAR* Description, const int32 Port)
+	{
+		FSocket* Socket = SocketSubsystem->CreateSocket(NAME_DGram, Description, FNetworkProtocolTypes::IPv4);
+		if (!Socket) return nullptr;
+
+		const TSharedRef<FInternetAddr> Address = SocketSubsystem->CreateInternetAddr(FNetworkProtocolTypes::IPv4);
+		Address->SetAnyAddress();
+		Address->SetPort(Port);
+		if (!Socket->SetNonBlocking(true) || !Socket->Bind(*Address))
+		{
+			SocketSubsystem->DestroySocket(Socket);
+			return nullptr;
+		}
+		return Socket;
+	}
+
+	static void DestroySocket(ISocketSubsystem* SocketSubsystem, FSocket*& Socket)
+	{
+		if (!Socket) return;
+		Socket->Close();
+		SocketSubsystem->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+}
+
+FMultiplayerSessionsQosProber::FMultiplayerSessionsQosProber(TArray<FMultiplayerSessionsQosTarget>&& InTargets, const int32 InProbeCount, const float InIntervalMs, const float InTimeoutMs):
+	Targets(MoveTemp(InTargets)),
+	ProbeCount(FMath::Clamp(InProbeCount, 1, 0xFFFF)),
+	Interval(FMath::Max(InIntervalMs, 1.f) / 1000.0),
+	Timeout(FMath::Max(InTimeoutMs, 1.f) / 1000.0)
+{
+	Results.SetNum(Targets.Num());
+	for (int32 Index = 0; Index < Targets.Num(); ++Index)
+		Results[Index].SessionId = Targets[Index].SessionId;
+}
+
+FMultiplayerSessionsQosProber::~FMultiplayerSessionsQosProber()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	MultiplayerSessionsQos::DestroySocket(SocketSubsystem, Socket);
+}
+
+bool FMultiplayerSessionsQosProber::Start()
+{
+	StartTime = FPlatformTime::Seconds();
+	FinishTime = StartTime;
+
+	const bool bAnyAddress = Targets.ContainsByPredicate([](const FMultiplayerSessionsQosTarget& Target) { return Target.Address.IsValid(); });
+	SocketSubsystem = bAnyAddress && Targets.Num() <= 0xFFFF ? ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM) : nullptr;
+	Socket = SocketSubsystem ? MultiplayerSessionsQos::CreateSocket(SocketSubsystem, TEXT("MultiplayerSessionsQosProber"), 0) : nullptr;
+	if (!Socket)
+	{
+		bDone = true;
+		return false;
+	}
+
+	SendTimes.SetNumZeroed(Targets.Num() * ProbeCount);
+	RttSums.SetNumZeroed(Targets.Num());
+	Thread = FRunnableThread::Create(this, TEXT("MultiplayerSessionsQosProber"), 0, TPri_AboveNormal);
+	if (!Thread)
+	{
+		bDone = true;
+		return false;
+	}
+	return true;
+}
+
+uint32 FMultiplayerSessionsQosProber::Run()
+{
+	for (int32 ProbeIndex = 0; ProbeIndex < ProbeCount && !bStopping; ++ProbeIndex)
+	{
+		SendRound(ProbeIndex);
+		ReceiveReplies(FPlatformTime::Seconds() + Interval);
+	}
+	ReceiveReplies(FPlatformTime::Seconds() + Timeout);
+
+	for (int32 Index = 0; Index < Results.Num(); ++Index)
+	{
+		if (Results[Index].Received > 0)
+			Results[Index].AvgRttMs = static_cast<float>(RttSums[Index] * 1000.0 / Results[Index].Received);
+	}
+	FinishTime = FPlatformTime::Seconds();
+	bDone.store(true, std::memory_order_release);
+	return 0;
+}
+
+void FMultiplayerSessionsQosProber::SendRound(const int32 ProbeIndex)
+{
+	uint8 Packet[MultiplayerSessionsQos::PacketSize];
+	for (int32 Index = 0; Index < Targets.Num(); ++Index)
+	{
+		if (!Targets[Index].Address.IsValid()) continue;
+
+		MultiplayerSessionsQos::WritePacket(Packet, static_cast<uint16>(Index), static_cast<uint16>(ProbeIndex));
+		int32 BytesSent{ 0 };
+		SendTimes[Index * ProbeCount + ProbeIndex] = FPlatformTime::Seconds();
+		if (Socket->SendTo(Packet, MultiplayerSessionsQos::PacketSize, BytesSent, *Targets[Index].Address))
+			++Results[Index].Sent;
+		else
+			SendTimes[Index * ProbeCount + ProbeIndex] = 0.0;
+	}
+}
+
+void FMultiplayerSessionsQosProber::ReceiveReplies(const double Until)
+{
+	const TSharedRef<FInternetAddr> Source = SocketSubsystem->CreateInternetAddr(FNetworkProtocolTypes::IPv4);
+	uint8 Packet[MultiplayerSessionsQos::PacketSize + 1];
+	for (double Now = FPlatformTime::Seconds(); Now < Until && !bStopping; Now = FPlatformTime::Seconds())
+	{
+		if (!Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(Until - Now))) continue;
+
+		int32 BytesRead{ 0 };
+		while (Socket->RecvFrom(Packet, sizeof(Packet), BytesRead, *Source))
+		{
+			const double ReceiveTime = FPlatformTime::Seconds();
+			uint16 TargetIndex{ 0 };
+			uint16 ProbeIndex{ 0 };
+			if (!MultiplayerSessionsQos::ReadPacket(Packet, BytesRead, TargetIndex, ProbeIndex)) continue;
+			if (TargetIndex >= Targets.Num() || ProbeIndex >= ProbeCount) continue;
+			// Hosts without an IP address (P2P) were never probed, whatever index a packet names
+			const TSharedPtr<FInternetAddr>& TargetAddress = Targets[TargetIndex].Address;
+			if (!TargetAddress.IsValid()) continue;
+			// A reply from anyone else than the host we probed doesn't count
+			if (!Source->CompareEndpoints(*TargetAddress)) continue;
+
+			// Duplicates are ignored: a probe counts once
+			double& SendTime = SendTimes[TargetIndex * ProbeCount + ProbeIndex];
+			if (SendTime <= 0.0) continue;
+
+			const double Rtt = ReceiveTime - SendTime;
+			SendTime = 0.0;
+			FMultiplayerSessionsQosResult& Result = Results[TargetIndex];
+			Result.MinRttMs = Result.Received == 0 ? static_cast<float>(Rtt * 1000.0) : FMath::Min(Result.MinRttMs, static_cast<float>(Rtt * 1000.0));
+			++Result.Received;
+			RttSums[TargetIndex] += Rtt;
+		}
+	}
+}
+
+FMultiplayerSessionsQosResponder::FMultiplayerSessionsQosResponder(const int32 InPort):
+	Port(InPort)
+{
+}
+
+FMultiplayerSessionsQosResponder::~FMultiplayerSessionsQosResponder()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	MultiplayerSessionsQos::DestroySocket(SocketSubsystem, Socket);
+}
+
+bool FMultiplayerSessionsQosResponder::Start()
+{
+	SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	Socket = SocketSubsystem ? MultiplayerSessionsQos::CreateSocket(SocketSubsystem, TEXT("MultiplayerSessionsQosResponder"), Port) : nullptr;
+	if (!Socket)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("QoS responder: couldn't bind UDP port %d, this host won't answer pings"), Port);
+		return false;
+	}
+
+	Thread = FRunnableThread::Create(this, TEXT("MultiplayerSessionsQosResponder"), 0, TPri_AboveNormal);
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("QoS responder listening on UDP port %d"), Port);
+	return Thread != nullptr;
+}
+
+uint32 FMultiplayerSessionsQosResponder::Run()
+{
+	const TSharedRef<FInternetAddr> Source = SocketSubsystem->CreateInternetAddr(FNetworkProtocolTypes::IPv4);
+	uint8 Packet[MultiplayerSessionsQos::PacketSize + 1];
+	while (!bStopping)
+	{
+		// Short wait: it's also how long Stop takes to be noticed
+		if (!Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(100))) continue;
+
+		int32 BytesRead{ 0 };
+		while (Socket->RecvFrom(Packet, sizeof(Packet), BytesRead, *Source))
+		{
+			// Same size back, to the sender only: nothing to amplify
+			uint16 TargetIndex{ 0 };
+			uint16 ProbeIndex{ 0 };
+			if (!MultiplayerSessionsQos::ReadPacket(Packet, BytesRead, TargetIndex, ProbeIndex)) continue;
+
+			int32 BytesSent{ 0 };
+			if (Socket->SendTo(Packet, MultiplayerSessionsQos::PacketSize, BytesSent, *Source))
+				NumReplies.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include <atomic>
+
+class FSocket;
+class FInternetAddr;
+class FRunnableThread;
+class ISocketSubsystem;
+
+// Probe and reply: "BQOS", target index, probe index. The responder sends it back as is.
+namespace MultiplayerSessionsQos
+{
+	constexpr uint32 Magic{ 0x534F5142 }; // "BQOS"
+	constexpr int32 PacketSize{ 8 };
+}
+
+struct FMultiplayerSessionsQosTarget
+{
+	FString SessionId;
+	TSharedPtr<FInternetAddr> Address; // Null: not reachable over UDP (e.g. Steam P2P), not probed
+};
+
+struct FMultiplayerSessionsQosResult
+{
+	FString SessionId;
+	int32 Sent{ 0 };
+	int32 Received{ 0 };
+	float AvgRttMs{ 0.f };
+	float MinRttMs{ 0.f };
+
+	bool WasProbed() const { return Sent > 0; }
+	float GetLoss() const { return Sent > 0 ? 1.f - static_cast<float>(Received) / Sent : 1.f; }
+};
+
+/**
+ * Extra: Pings a few hosts at once over UDP before QuickJoin picks one. Runs on its own thread, so the round trip is
+ * measured when the reply arrives, not at the next game frame.
+ *
+ * Sends ProbeCount rounds (one probe to every target per round, IntervalMs apart), then waits TimeoutMs for the last
+ * replies. The hosts answer with FMultiplayerSessionsQosResponder. A host that doesn't run one counts as 100% loss.
+ */
+class FMultiplayerSessionsQosProber : public FRunnable
+{
+public:
+	FMultiplayerSessionsQosProber(TArray<FMultiplayerSessionsQosTarget>&& InTargets, int32 InProbeCount, float InIntervalMs, float InTimeoutMs);
+	virtual ~FMultiplayerSessionsQosProber() override;
+
+	// false: no socket, or nothing to probe (IsDone right away, with empty results)
+	bool Start();
+	bool IsDone() const { return bDone.load(std::memory_order_acquire); }
+	// Same order as the targets. Only once IsDone.
+	const TArray<FMultiplayerSessionsQosResult>& GetResults() const { check(IsDone()); return Results; }
+	double GetElapsedSeconds() const { return FinishTime - StartTime; }
+
+	//~ Begin FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override { bStopping = true; }
+	//~ End FRunnable
+
+private:
+	TArray<FMultiplayerSessionsQosTarget> Targets;
+	TArray<FMultiplayerSessionsQosResult> Results;
+	// Targets * ProbeCount, 0 until sent
+	TArray<double> SendTimes;
+	TArray<double> RttSums;
+	int32 ProbeCount{ 0 };
+	double Interval{ 0.0 };
+	double Timeout{ 0.0 };
+	double StartTime{ 0.0 };
+	double FinishTime{ 0.0 };
+
+	ISocketSubsystem* SocketSubsystem{ nullptr };
+	FSocket* Socket{ nullptr };
+	FRunnableThread* Thread{ nullptr };
+	std::atomic<bool> bStopping{ false };
+	std::atomic<bool> bDone{ false };
+
+	void SendRound(int32 ProbeIndex);
+	void ReceiveReplies(double Until);
+};
+
+/**
+ * Extra: Answers the probes of FMultiplayerSessionsQosProber on the host, from its own thread (a reply that waits for
+ * the host's next frame would add its frame time to every measured RTT). Started while we host a session.
+ */
+class FMultiplayerSessionsQosResponder : public FRunnable
+{
+public:
+	explicit FMultiplayerSessionsQosResponder(int32 InPort);
+	virtual ~FMultiplayerSessionsQosResponder() override;
+
+	// false: the port is taken (e.g. another server on this machine)
+	bool Start();
+	int32 GetPort() const { return Port; }
+	uint64 GetNumReplies() const { return NumReplies.load(std::memory_order_relaxed); }
+
+	//~ Begin FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override { bStopping = true; }
+	//~ End FRunnable
+
+private:
+	int32 Port{ 0 };
+	ISocketSubsystem* SocketSubsystem{ nullptr };
+	FSocket* Socket{ nullptr };
+	FRunnableThread* Thread{ nullptr };
+	std::atomic<bool> bStopping{ false };
+	std::atomic<uint64> NumReplies{ 0 };
+};
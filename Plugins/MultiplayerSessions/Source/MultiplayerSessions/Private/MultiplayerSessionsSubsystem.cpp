@@ -2,9 +2,70 @@
 
 
 #include "MultiplayerSessionsSubsystem.h"
+#include "MultiplayerSessions.h" // Who needs: LogMultiplayerSessions
+#include "MultiplayerSessionsTrace.h" // Who needs: FMultiplayerSessionsTrace, MULTIPLAYERSESSIONS_TRACE_SCOPE
+#include "MultiplayerSessionsEventLog.h" // Who needs: MULTIPLAYERSESSIONS_EVENT, MULTIPLAYERSESSIONS_OP_EVENT
+#include "MockOnlineSession.h" // Who needs: FMockOnlineSession
+#include "MultiplayerSessionsPreloader.h" // Who needs: FMultiplayerSessionsPreloader
+#include "MultiplayerSessionsQos.h" // Who needs: FMultiplayerSessionsQosProber, FMultiplayerSessionsQosResponder
+#include "SocketSubsystem.h" // Who needs: ISocketSubsystem (QoS addresses)
+#include "IPAddress.h" // Who needs: FInternetAddr
 #include "OnlineSubsystem.h" // Who needs: IOnlineSubsystem
 #include "OnlineSessionSettings.h" // Who needs: FOnlineSessionSettings
 #include <Online/OnlineSessionNames.h> // Who needs: Macro SEARCH_PRESENCE (inside FindSessions)
+#include "Engine/GameInstance.h" // Who needs: UGameInstance::GetSubsystem (console command)
+#include "HAL/IConsoleManager.h" // Who needs: FAutoConsoleCommandWithWorld
+
+namespace MultiplayerSessionsCache
+{
+	static FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("MultiplayerSessions.CacheStats"),
+		TEXT("Prints the session cache hit/miss counts and the QuickJoin time to join."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](const UWorld* World)
+		{
+			const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+			if (const UMultiplayerSessionsSubsystem* Subsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr)
+				Subsystem->LogSessionCacheStats();
+		}));
+}
+
+namespace MultiplayerSessionOps
+{
+	static FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("MultiplayerSessions.OpStats"),
+		TEXT("Prints the outcome and latency of each session operation type, and the queue depth."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](const UWorld* World)
+		{
+			const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+			if (const UMultiplayerSessionsSubsystem* Subsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr)
+				Subsystem->LogSessionOpStats();
+		}));
+
+	static const TCHAR* ToString(const EMultiplayerSessionOp Op)
+	{
+		switch (Op)
+		{
+		case EMultiplayerSessionOp::Create: return TEXT("Create");
+		case EMultiplayerSessionOp::Find: return TEXT("Find");
+		case EMultiplayerSessionOp::Join: return TEXT("Join");
+		case EMultiplayerSessionOp::Destroy: return TEXT("Destroy");
+		case EMultiplayerSessionOp::Start: return TEXT("Start");
+		default: return TEXT("Unknown");
+		}
+	}
+
+	static const TCHAR* ToString(const EMultiplayerSessionOpStatus Status)
+	{
+		switch (Status)
+		{
+		case EMultiplayerSessionOpStatus::Succeeded: return TEXT("Succeeded");
+		case EMultiplayerSessionOpStatus::Failed: return TEXT("Failed");
+		case EMultiplayerSessionOpStatus::TimedOut: return TEXT("TimedOut");
+		case EMultiplayerSessionOpStatus::Canceled: return TEXT("Canceled");
+		default: return TEXT("Unknown");
+		}
+	}
+}
 
 UMultiplayerSessionsSubsystem::UMultiplayerSessionsSubsystem():
 	CreateSessionCompleteDelegate(FOnCreateSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnCreateSessionComplete)),
@@ -13,26 +74,124 @@ UMultiplayerSessionsSubsystem::UMultiplayerSessionsSubsystem():
 	DestroySessionCompleteDelegate(FOnDestroySessionCompleteDelegate::CreateUObject(this, &ThisClass::OnDestroySessionComplete)),
 	StartSessionCompleteDelegate(FOnStartSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnStartSessionComplete))
 {
-	if (IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get())
+	// Extra: Nothing else here, the constructor also runs for the class default object at module load
+}
+
+void UMultiplayerSessionsSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Extra: -MockSessions swaps the online service for an in-process one (benchmarks, machines with no Steam)
+	bUsingMockSessionBackend = FMockOnlineSession::IsEnabled();
+}
+
+bool UMultiplayerSessionsSubsystem::ResolveSessionInterface()
+{
+	if (SessionInterface.IsValid()) return true;
+	if (bSessionInterfaceResolveAttempted) return false;
+	bSessionInterfaceResolveAttempted = true;
+
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::ResolveSessionInterface");
+	LLM_SCOPE_BYTAG(MultiplayerSessions);
+	const double StartTime = FPlatformTime::Seconds();
+
+	if (bUsingMockSessionBackend)
+	{
+		SessionInterface = MakeShared<FMockOnlineSession>(FMockOnlineSessionSettings::FromConsoleVariables());
+		SessionServiceName = TEXT("Mock");
+	}
+	else if (IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get())
+	{
 		SessionInterface = OnlineSubsystem->GetSessionInterface();
+		SessionServiceName = OnlineSubsystem->GetSubsystemName();
+	}
+
+	// Before/after of the lazy resolve: this used to be paid in the constructor, before the main menu
+	const double EndTime = FPlatformTime::Seconds();
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Session interface (%s) %s in %.1f ms, %.2f s after process start"),
+		*SessionServiceName.ToString(), SessionInterface.IsValid() ? TEXT("resolved") : TEXT("unavailable"), (EndTime - StartTime) * 1000.0, EndTime - GStartTime);
+	return SessionInterface.IsValid();
+}
+
+void UMultiplayerSessionsSubsystem::Deinitialize()
+{
+	if (DeferredPrefetchHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(DeferredPrefetchHandle);
+		DeferredPrefetchHandle.Reset();
+	}
+	CancelAllSessionOps();
+	StopSearchResultsStream();
+	if (SessionOpTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(SessionOpTickerHandle);
+		SessionOpTickerHandle.Reset();
+	}
+	if (SessionCacheRefreshHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(SessionCacheRefreshHandle);
+		SessionCacheRefreshHandle.Reset();
+	}
+	Preloader.Reset();
+	CancelQosProbe();
+	QosResponder.Reset();
+	SessionInterface.Reset();
+	SessionServiceName = NAME_None;
+	bSessionInterfaceResolveAttempted = false;
+
+	Super::Deinitialize();
 }
 
 void UMultiplayerSessionsSubsystem::CreateSession(const int32 NumPublicConnections, const FString& MatchType)
 {
-	if (!SessionInterface.IsValid()) return;
+	QueueCreateSession(NumPublicConnections, MatchType);
+}
 
-	auto ExistingSession = GetCurrentGameSession();
-	if (ExistingSession) // should I use ExistingSession != nullptr?
+FMultiplayerSessionOpFuture UMultiplayerSessionsSubsystem::QueueCreateSession(const int32 NumPublicConnections, const FString& MatchType)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::QueueCreateSession");
+	if (!ResolveSessionInterface())
 	{
-		GEngine->AddOnScreenDebugMessage(-1,15.f, FColor::Cyan, FString(TEXT("Destroying current session to create a new one")));
-		bCreateSessionOnDestroy = true;
-		LastNumPublicConnections = NumPublicConnections;
-		LastMatchType = MatchType;
 		MultiplayerOnCreateSessionComplete.Broadcast(false);
-		DestroySession();
-		return;
+		return MakeFinishedSessionOp(EMultiplayerSessionOp::Create, EMultiplayerSessionOpStatus::Failed);
+	}
+
+	// Coalesce before queueing the destroy below, or a double click would destroy what the first click created
+	const FString Key = FString::Printf(TEXT("%d %s"), NumPublicConnections, *MatchType);
+	if (FSessionOperation* Coalesced = FindCoalescableSessionOp(EMultiplayerSessionOp::Create, Key))
+	{
+		++SessionOpStats[static_cast<int32>(EMultiplayerSessionOp::Create)].Coalesced;
+		return Coalesced->Future;
 	}
 
+	// Extra: Destroy → Create, as two queued operations. If we're in a session now, or an operation in the queue
+	// may put us in one, destroy it first. The destroy does nothing if there's no session by the time it runs.
+	if (GetCurrentGameSession())
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Destroying current session to create a new one"));
+		QueueDestroySession();
+	}
+	else if (!SessionOpLane.IsEmpty())
+	{
+		QueueDestroySession();
+	}
+
+	FMultiplayerSessionsTrace::Phase(TEXT("CreateSessionQueued"));
+	PreloadTravelMap();
+	return EnqueueSessionOp(EMultiplayerSessionOp::Create, Key, [this, NumPublicConnections, MatchType]()
+	{
+		return StartCreateSession(NumPublicConnections, MatchType);
+	});
+}
+
+bool UMultiplayerSessionsSubsystem::StartCreateSession(const int32 NumPublicConnections, const FString& MatchType)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::StartCreateSession");
+	LLM_SCOPE_BYTAG(MultiplayerSessions_Search);
+
+	// The destroy queued before us failed
+	if (GetCurrentGameSession()) return false;
+
 	LastSessionSettings = MakeShareable(new FOnlineSessionSettings());
 	LastSessionSettings->bIsLANMatch = ShouldBeLanMatch();
 	LastSessionSettings->NumPublicConnections = NumPublicConnections;
@@ -41,10 +200,25 @@ void UMultiplayerSessionsSubsystem::CreateSession(const int32 NumPublicConnectio
 	LastSessionSettings->bShouldAdvertise = true; // Must be set to true, so Steam can show this session when we search for a session (if false, the session will still be available, but cannot be found in a normal session search... I think)
 	LastSessionSettings->bUsesPresence = true; // Must be set to true, so Steam can use the user's presence to be used for the search results (if false, the session won't work on Steam)
 	LastSessionSettings->bUseLobbiesIfAvailable = true; // Since UE5 Preview 2, we need to add this line for lobbies to work
-	LastSessionSettings->Set(MatchTypeKey, MatchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing); // If we don't define the InType, it won't advertise this value to the online session search
 	// LastSessionSettings->BuildUniqueId = 1; // Problem: For some reason, I can't join session with this thing.
 
-	GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Cyan, FString::Printf(TEXT("MatchTypeKey: %s, MatchTypeValue: %s"), *MatchTypeKey.ToString(), *MatchType));
+	// Extra: Typed attributes instead of the MatchType string. The build version does what BuildUniqueId was meant to.
+	const int32 MatchTypeId = GetMatchTypeId(MatchType);
+	if (MatchTypeId == INDEX_NONE)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Can't create a session of match type %s: not in MatchTypes"), *MatchType);
+		return false;
+	}
+	FMultiplayerSessionAttributes Attributes;
+	Attributes.BuildVersion = MultiplayerSessionsAttributes::GetLocalBuildVersion();
+	Attributes.MatchType = static_cast<uint8>(MatchTypeId);
+	Attributes.Region = Region;
+	Attributes.Map = GetSessionMapId(TravelMap);
+	Attributes.SkillBand = SkillBand;
+	MultiplayerSessionsAttributes::Write(Attributes, *LastSessionSettings);
+
+	UE_LOG(LogMultiplayerSessions, Verbose, TEXT("Session attributes: build %d, match type %s (%d), region %d, map %d, skill band %d"),
+		Attributes.BuildVersion, *MatchType, MatchTypeId, Attributes.Region, Attributes.Map, Attributes.SkillBand);
 
 	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
 	check(LocalPlayer);
@@ -59,80 +233,843 @@ void UMultiplayerSessionsSubsystem::CreateSession(const int32 NumPublicConnectio
 		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
 		
 		// Teacher comment: Broadcast our own custom delegate
-		MultiplayerOnCreateSessionComplete.Broadcast(false);
+		// Extra: FinishSessionOp broadcasts it (see HandleFinishedSessionOp)
+		return false;
+	}
+	FMultiplayerSessionsTrace::Phase(TEXT("CreateSessionStarted"));
+	return true;
+}
+
+void UMultiplayerSessionsSubsystem::FindSessions(const int32 MaxSearchResults, const FString& MatchType)
+{
+	FindSessions(MaxSearchResults, MatchType, FOnlineSearchSettings());
+}
+
+void UMultiplayerSessionsSubsystem::FindSessions(const int32 MaxSearchResults, const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings)
+{
+	QueueFindSessions(MaxSearchResults, MatchType, ExtraQuerySettings);
+}
+
+FMultiplayerSessionOpFuture UMultiplayerSessionsSubsystem::QueueFindSessions(const int32 MaxSearchResults, const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings)
+{
+	// The player searches to join: the session will most likely be on the same travel map
+	PreloadTravelMap();
+	return QueueSessionSearch(MaxSearchResults, MatchType, ExtraQuerySettings, SessionFilter, false, false);
+}
+
+FMultiplayerSessionOpFuture UMultiplayerSessionsSubsystem::QueueSessionSearch(const int32 MaxSearchResults, const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings,
+	const FMultiplayerSessionFilter& Filter, const bool bInternal, const bool bBackground)
+{
+	if (!ResolveSessionInterface())
+	{
+		// Same as a search that failed to start (see HandleFinishedSearch): an empty last batch, then the failure
+		if (!bInternal)
+		{
+			MultiplayerOnFindSessionsBatch.Broadcast(TArray<FOnlineSessionSearchResult>(), true);
+			MultiplayerOnFindSessionComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+		}
+		return MakeFinishedSessionOp(EMultiplayerSessionOp::Find, EMultiplayerSessionOpStatus::Failed);
+	}
+
+	const FString CacheKey = MakeSessionCacheKey(MatchType, ExtraQuerySettings, Filter);
+	const FString Key = FString::Printf(TEXT("%s %d"), *CacheKey, FMath::Clamp(MaxSearchResults, 1, MaxSearchPageSize));
+	if (FSessionOperation* Coalesced = FindCoalescableSessionOp(EMultiplayerSessionOp::Find, Key, bInternal, bBackground))
+	{
+		++SessionOpStats[static_cast<int32>(EMultiplayerSessionOp::Find)].Coalesced;
+		return Coalesced->Future;
+	}
+
+	// Background searches only use an idle lane. Anything else makes them give way.
+	if (bBackground)
+	{
+		if (!SearchOpLane.IsEmpty()) return MakeFinishedSessionOp(EMultiplayerSessionOp::Find, EMultiplayerSessionOpStatus::Canceled);
+	}
+	else
+	{
+		for (int32 Index = SearchOpLane.Num() - 1; Index >= 0; --Index)
+		{
+			const FSessionOperationRef Op = SearchOpLane[Index];
+			if (!Op->bBackground) continue;
+			if (Op->bRunning)
+			{
+				AbortRunningSessionOp(*Op);
+				FinishSessionOp(EMultiplayerSessionOp::Find, EMultiplayerSessionOpStatus::Canceled);
+			}
+			else
+			{
+				CancelQueuedSessionOp(Op);
+			}
+		}
 	}
+
+	const FSessionOperationRef Op = MakeShared<FSessionOperation>();
+	Op->Type = EMultiplayerSessionOp::Find;
+	Op->Key = Key;
+	Op->CacheKey = CacheKey;
+	Op->bInternal = bInternal;
+	Op->bBackground = bBackground;
+	Op->Start = [this, MaxSearchResults, MatchType, ExtraQuerySettings, Filter, bInternal, bBackground]()
+	{
+		const bool bStarted = StartFindSessions(MaxSearchResults, MatchType, ExtraQuerySettings, Filter, bInternal);
+		// Prefetches aren't what the player waits for
+		if (bStarted && !bBackground) FMultiplayerSessionsTrace::Phase(TEXT("FindSessionsStarted"));
+		return bStarted;
+	};
+	return EnqueueSessionOp(Op);
 }
 
-void UMultiplayerSessionsSubsystem::FindSessions(const int32 MaxSearchResults)
+bool UMultiplayerSessionsSubsystem::StartFindSessions(const int32 MaxSearchResults, const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings,
+	const FMultiplayerSessionFilter& Filter, const bool bInternal)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::StartFindSessions");
+	LLM_SCOPE_BYTAG(MultiplayerSessions_Search);
 	check(SessionInterface.IsValid());
 
+	const int32 MatchTypeId = GetMatchTypeId(MatchType);
+	if (MatchTypeId == INDEX_NONE)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Can't search for match type %s: not in MatchTypes"), *MatchType);
+		return false;
+	}
+
 	LastSessionSearch = MakeShareable(new FOnlineSessionSearch);
-	LastSessionSearch->MaxSearchResults = MaxSearchResults;
+	LastSessionSearch->MaxSearchResults = FMath::Clamp(MaxSearchResults, 1, MaxSearchPageSize);
 	LastSessionSearch->bIsLanQuery = ShouldBeLanMatch();
 	LastSessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
 
+	// Extra: Let the online service filter, instead of receiving everything and comparing here. Integer compares only:
+	// sessions of another build never reach us (or are dropped by MatchesSearch when the service ignores this).
+	CompileSessionQuery(MatchTypeId, Filter, LastSearchQuery);
+	LastSessionSearch->QuerySettings.Set(MultiplayerSessionsAttributes::BuildKey, LastSearchQuery.BuildVersion, EOnlineComparisonOp::Equals);
+	if (MatchTypeId != 0)
+		LastSessionSearch->QuerySettings.Set(MultiplayerSessionsAttributes::MatchTypeKey, MatchTypeId, EOnlineComparisonOp::Equals);
+	for (const auto& SearchParam : ExtraQuerySettings.SearchParams)
+		LastSessionSearch->QuerySettings.SearchParams.Add(SearchParam.Key, SearchParam.Value);
+
+	LastSearchMatchType = MatchType;
+	LastSearchExtraQuerySettings = ExtraQuerySettings;
+	LastSearchFilter = Filter;
+	LastSearchCacheKey = MakeSessionCacheKey(MatchType, ExtraQuerySettings, Filter);
+	bLastSearchIsInternal = bInternal;
+	NumSearchResultsStreamed = 0;
+	LastSearchMatches.Reset();
+
 	FindSessionCompleteDelegateHandle = SessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate);
 	if (!SessionInterface->FindSessions(GetPreferredUniqueNetId(), LastSessionSearch.ToSharedRef()))
 	{
 		SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionCompleteDelegateHandle);
+		LastSessionSearch.Reset();
 		//MultiplayerOnFindSessionComplete.Broadcast(LastSessionSearch->SearchResults, false); // or pass empty array in the first param: TArray<FOnlineSessionSearchResult>()
-		MultiplayerOnFindSessionComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+		// Extra: FinishSessionOp broadcasts it (see HandleFinishedSearch)
+		return false;
 	}
+
+	// Extra: Some online services fill SearchResults as responses arrive. Hand them out as soon as they show up.
+	SearchResultsStreamHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickSearchResultsStream));
+	return true;
 }
 
-void UMultiplayerSessionsSubsystem::JoinSession(const FOnlineSessionSearchResult& SessionResult)
+void UMultiplayerSessionsSubsystem::CancelFindSessions()
 {
-	if (!SessionInterface.IsValid())
+	// Queued ones first, so the running one doesn't hand the lane to them
+	for (int32 Index = SearchOpLane.Num() - 1; Index >= 0; --Index)
 	{
-		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
-		MultiplayerOnJoinSessionComplete.Broadcast( FString(), EOnJoinSessionCompleteResult::UnknownError);
+		if (!SearchOpLane[Index]->bRunning)
+			CancelQueuedSessionOp(SearchOpLane[Index]);
+	}
+
+	if (!SearchOpLane.IsEmpty() && !SearchOpLane[0]->bFinished)
+	{
+		AbortRunningSessionOp(*SearchOpLane[0]);
+		FinishSessionOp(EMultiplayerSessionOp::Find, EMultiplayerSessionOpStatus::Canceled);
+	}
+}
+
+bool UMultiplayerSessionsSubsystem::IsSearchQueued(const FString& CacheKey) const
+{
+	for (const FSessionOperationRef& Op : SearchOpLane)
+	{
+		if (!Op->bFinished && Op->CacheKey == CacheKey)
+			return true;
+	}
+	return false;
+}
+
+bool UMultiplayerSessionsSubsystem::TickSearchResultsStream(float DeltaTime)
+{
+	if (LastSessionSearch.IsValid() && LastSessionSearch->SearchResults.Num() > NumSearchResultsStreamed)
+		BroadcastNewSearchResults(false);
+
+	return true; // Keep ticking until the search completes or is canceled
+}
+
+void UMultiplayerSessionsSubsystem::BroadcastNewSearchResults(const bool bIsLastBatch)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::BroadcastNewSearchResults");
+	LLM_SCOPE_BYTAG(MultiplayerSessions_Search);
+
+	// Keep it alive and notice if a listener cancels or starts another search during a broadcast
+	const TSharedPtr<FOnlineSessionSearch> Search = LastSessionSearch;
+	if (!Search.IsValid()) return;
+	const TArray<FOnlineSessionSearchResult>& SearchResults = Search->SearchResults;
+
+	TArray<FOnlineSessionSearchResult> Batch;
+	Batch.Reserve(SearchBatchSize);
+	while (NumSearchResultsStreamed < SearchResults.Num())
+	{
+		const FOnlineSessionSearchResult& Result = SearchResults[NumSearchResultsStreamed++];
+		int32 BuildVersion{ 0 };
+		if (!MatchesSearch(Result, BuildVersion))
+		{
+			// Each result is streamed once per search, so it's counted here and only here
+			if (BuildVersion != LastSearchQuery.BuildVersion)
+			{
+				++SessionCacheStats.BuildMismatchesRejected;
+				MULTIPLAYERSESSIONS_EVENT(BuildMismatch, NAME_GameSession, 0, BuildVersion);
+			}
+			continue;
+		}
+
+		LastSearchMatches.Add(Result);
+		Batch.Add(Result);
+		if (Batch.Num() == SearchBatchSize && NumSearchResultsStreamed < SearchResults.Num())
+		{
+			HandleSearchBatch(Batch, false);
+			Batch.Reset();
+			if (LastSessionSearch != Search) return;
+		}
+	}
+
+	if (Batch.Num() > 0 || bIsLastBatch)
+		HandleSearchBatch(Batch, bIsLastBatch);
+}
+
+void UMultiplayerSessionsSubsystem::HandleSearchBatch(const TArray<FOnlineSessionSearchResult>& Batch, const bool bIsLastBatch)
+{
+	MULTIPLAYERSESSIONS_EVENT(SearchBatch, NAME_GameSession, bIsLastBatch ? 1 : 0, Batch.Num());
+	if (!bLastSearchIsInternal)
+	{
+		MultiplayerOnFindSessionsBatch.Broadcast(Batch, bIsLastBatch);
 		return;
 	}
 
+	// A QuickJoin waiting for results joins the best one of the first batch, and doesn't wait for the whole search
+	if (!bQuickJoinPending || bQuickJoinInFlight || LastSearchCacheKey != QuickJoinKey || Batch.IsEmpty()) return;
+
+	TArray<FOnlineSessionSearchResult> RankedBatch = Batch;
+	RankSessionResults(RankedBatch);
+	if (PickQuickJoinCandidate(RankedBatch))
+	{
+		FMultiplayerSessionsTrace::Phase(TEXT("FirstSearchBatch"));
+		ProbeQuickJoinCandidates(RankedBatch, false);
+	}
+}
+
+int32 UMultiplayerSessionsSubsystem::GetMatchTypeId(const FString& MatchType) const
+{
+	if (MatchType.IsEmpty()) return 0;
+	const int32 Index = MatchTypes.IndexOfByKey(MatchType);
+	return Index == INDEX_NONE ? INDEX_NONE : Index + 1;
+}
+
+uint8 UMultiplayerSessionsSubsystem::GetSessionMapId(const FString& MapPath) const
+{
+	const int32 Index = SessionMaps.IndexOfByKey(MapPath);
+	return Index == INDEX_NONE ? 0 : static_cast<uint8>(FMath::Min(Index + 1, 0xFF));
+}
+
+bool UMultiplayerSessionsSubsystem::GetSessionAttributes(const FOnlineSessionSearchResult& Result, FMultiplayerSessionAttributes& OutAttributes)
+{
+	return MultiplayerSessionsAttributes::Read(Result.Session.SessionSettings, OutAttributes);
+}
+
+void UMultiplayerSessionsSubsystem::CompileSessionQuery(const int32 MatchTypeId, const FMultiplayerSessionFilter& Filter, FCompiledSessionQuery& OutQuery) const
+{
+	using namespace MultiplayerSessionsAttributes;
+
+	OutQuery = FCompiledSessionQuery();
+	OutQuery.BuildVersion = GetLocalBuildVersion();
+	OutQuery.MatchType = MatchTypeId;
+	if (Filter.Region != 0)
+	{
+		OutQuery.InfoMask |= RegionMask;
+		OutQuery.InfoValue |= Filter.Region << RegionShift;
+	}
+	if (Filter.Map != 0)
+	{
+		OutQuery.InfoMask |= MapMask;
+		OutQuery.InfoValue |= Filter.Map << MapShift;
+	}
+	if (Filter.SkillBand != 0)
+	{
+		OutQuery.MinSkillBand = FMath::Max(Filter.SkillBand - Filter.SkillBandTolerance, 0);
+		OutQuery.MaxSkillBand = FMath::Min(Filter.SkillBand + Filter.SkillBandTolerance, static_cast<int32>(MaxSkillBand));
+	}
+	OutQuery.MinOpenSlots = FMath::Max(Filter.MinOpenSlots, 0);
+}
+
+bool UMultiplayerSessionsSubsystem::MatchesSearch(const FOnlineSessionSearchResult& Result, int32& OutBuildVersion) const
+{
+	using namespace MultiplayerSessionsAttributes;
+
+	// Build first: a session of another build would only fail later, at the connection (after a whole join round trip)
+	const FOnlineSessionSettings& Settings = Result.Session.SessionSettings;
+	OutBuildVersion = 0;
+	if (!Settings.Get(BuildKey, OutBuildVersion) || OutBuildVersion != LastSearchQuery.BuildVersion) return false;
+
+	int32 MatchType{ 0 };
+	int32 Info{ 0 };
+	if (!Settings.Get(MatchTypeKey, MatchType) || !Settings.Get(InfoKey, Info)) return false;
+	if (LastSearchQuery.MatchType != 0 && MatchType != LastSearchQuery.MatchType) return false;
+	if ((Info & LastSearchQuery.InfoMask) != LastSearchQuery.InfoValue) return false;
+
+	const int32 ResultSkillBand = (Info & SkillBandMask) >> SkillBandShift;
+	return ResultSkillBand >= LastSearchQuery.MinSkillBand && ResultSkillBand <= LastSearchQuery.MaxSkillBand
+		&& Result.Session.NumOpenPublicConnections >= LastSearchQuery.MinOpenSlots;
+}
+
+void UMultiplayerSessionsSubsystem::StopSearchResultsStream()
+{
+	if (SearchResultsStreamHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(SearchResultsStreamHandle);
+		SearchResultsStreamHandle.Reset();
+	}
+}
+
+void UMultiplayerSessionsSubsystem::JoinSession(const FOnlineSessionSearchResult& SessionResult)
+{
+	QueueJoinSession(SessionResult);
+}
+
+FMultiplayerSessionOpFuture UMultiplayerSessionsSubsystem::QueueJoinSession(const FOnlineSessionSearchResult& SessionResult)
+{
+	if (!ResolveSessionInterface())
+	{
+		HandleJoinSessionResult(FString(), EOnJoinSessionCompleteResult::UnknownError);
+		return MakeFinishedSessionOp(EMultiplayerSessionOp::Join, EMultiplayerSessionOpStatus::Failed);
+	}
+
+	return EnqueueSessionOp(EMultiplayerSessionOp::Join, SessionResult.GetSessionIdStr(), [this, SessionResult]()
+	{
+		return StartJoinSession(SessionResult);
+	});
+}
+
+bool UMultiplayerSessionsSubsystem::StartJoinSession(const FOnlineSessionSearchResult& SessionResult)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::StartJoinSession");
+
+	// Extra: Results the Menu kept from elsewhere didn't go through MatchesSearch. Don't spend a join on another build.
+	FMultiplayerSessionAttributes Attributes;
+	if (!GetSessionAttributes(SessionResult, Attributes) || Attributes.BuildVersion != MultiplayerSessionsAttributes::GetLocalBuildVersion())
+	{
+		++SessionCacheStats.BuildMismatchesRejected;
+		MULTIPLAYERSESSIONS_EVENT(BuildMismatch, NAME_GameSession, 0, Attributes.BuildVersion);
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Not joining %s: build %d, ours is %d"), *SessionResult.GetSessionIdStr(),
+			Attributes.BuildVersion, MultiplayerSessionsAttributes::GetLocalBuildVersion());
+		return false;
+	}
+
 	JoinSessionCompleteDelegateHandle = SessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
 	if (!SessionInterface->JoinSession(GetPreferredUniqueNetId(), NAME_GameSession, SessionResult))
 	{
+		// Extra: Used to be a checkNoEntry(). It happens (e.g. already in a session), so it's a failed operation now.
 		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+		return false;
+	}
+	FMultiplayerSessionsTrace::Phase(TEXT("JoinSessionStarted"));
+	return true;
+}
+
+void UMultiplayerSessionsSubsystem::QuickJoin(const FString& MatchType)
+{
+	QuickJoin(MatchType, FOnlineSearchSettings());
+}
+
+void UMultiplayerSessionsSubsystem::QuickJoin(const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::QuickJoin");
+
+	if (!ResolveSessionInterface())
+	{
 		MultiplayerOnJoinSessionComplete.Broadcast(FString(), EOnJoinSessionCompleteResult::UnknownError);
-		checkNoEntry();
+		return;
+	}
+
+	PreloadTravelMap();
+
+	const double Now = FPlatformTime::Seconds();
+	const FMultiplayerSessionFilter Filter = SessionFilter;
+	QuickJoinKey = MakeSessionCacheKey(MatchType, ExtraQuerySettings, Filter);
+	QuickJoinTriedSessions.Reset();
+	QuickJoinProbedCandidates.Reset();
+	CancelQosProbe();
+	QuickJoinStartTime = Now;
+	bQuickJoinPending = true;
+	bQuickJoinInFlight = false;
+	bQuickJoinSearched = false;
+
+	FSessionCacheEntry* Entry = SessionCache.Find(QuickJoinKey);
+	const bool bHit = Entry && !Entry->Results.IsEmpty();
+	const bool bStale = !Entry || Now - Entry->FetchTime > SessionCacheTTL;
+	if (Entry) Entry->LastUsedTime = Now;
+
+	if (!bHit) ++SessionCacheStats.Misses;
+	else if (bStale) ++SessionCacheStats.StaleHits;
+	else ++SessionCacheStats.Hits;
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("QuickJoin %s: cache %s"), *QuickJoinKey, !bHit ? TEXT("miss") : bStale ? TEXT("hit (stale)") : TEXT("hit"));
+	FMultiplayerSessionsTrace::Phase(!bHit ? TEXT("QuickJoinCacheMiss") : bStale ? TEXT("QuickJoinCacheStaleHit") : TEXT("QuickJoinCacheHit"));
+	MULTIPLAYERSESSIONS_EVENT(QuickJoin, NAME_GameSession, !bHit ? 0 : bStale ? 2 : 1);
+
+	// Join the cached candidate first, then refresh. The join doesn't wait for the refresh.
+	if (bHit) ContinueQuickJoin(EOnJoinSessionCompleteResult::SessionDoesNotExist);
+	if (bStale && bQuickJoinPending && !bQuickJoinSearched)
+	{
+		bQuickJoinSearched = true;
+		QueueSessionSearch(MaxSearchPageSize, MatchType, ExtraQuerySettings, Filter, true, false);
 	}
 }
 
-void UMultiplayerSessionsSubsystem::DestroySession()
+void UMultiplayerSessionsSubsystem::ContinueQuickJoin(const EOnJoinSessionCompleteResult::Type FailureResult)
+{
+	check(bQuickJoinPending);
+
+	// 0. Next probed candidate: already measured, no new search or probe
+	for (const FProbedCandidate& Probed : QuickJoinProbedCandidates)
+	{
+		if (QuickJoinTriedSessions.Contains(Probed.Result.GetSessionIdStr())) continue;
+
+		QuickJoinCandidateRttMs = Probed.RttMs;
+		QuickJoinCandidateLoss = Probed.Loss;
+		JoinQuickJoinCandidate(Probed.Result, bQuickJoinCandidateFromCache);
+		return;
+	}
+
+	// 1. Next cached candidates, probed first
+	if (const FSessionCacheEntry* Entry = SessionCache.Find(QuickJoinKey))
+	{
+		if (PickQuickJoinCandidate(Entry->Results))
+		{
+			ProbeQuickJoinCandidates(Entry->Results, true);
+			return;
+		}
+	}
+
+	// 2. A search for this query is queued or running: its next batch gets joined (see HandleSearchBatch)
+	if (IsSearchQueued(QuickJoinKey)) return;
+
+	// 3. Nothing left in the cache, and it may be old. Search once.
+	if (!bQuickJoinSearched)
+	{
+		bQuickJoinSearched = true;
+		if (const FSessionCacheEntry* Entry = SessionCache.Find(QuickJoinKey))
+		{
+			// A search that fails comes back here through HandleFinishedSearch
+			QueueSessionSearch(MaxSearchPageSize, Entry->MatchType, Entry->ExtraQuerySettings, Entry->Filter, true, false);
+			return;
+		}
+	}
+
+	// 4. Give up
+	bQuickJoinPending = false;
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("QuickJoin %s: no session to join (%s)"), *QuickJoinKey, LexToString(FailureResult));
+	MultiplayerOnJoinSessionComplete.Broadcast(FString(), FailureResult);
+}
+
+void UMultiplayerSessionsSubsystem::JoinQuickJoinCandidate(const FOnlineSessionSearchResult& Candidate, const bool bFromCache)
+{
+	QuickJoinTriedSessions.Add(Candidate.GetSessionIdStr());
+	bQuickJoinInFlight = true;
+	bQuickJoinCandidateFromCache = bFromCache;
+	UE_LOG(LogMultiplayerSessions, Verbose, TEXT("QuickJoin %s: joining %s (%d ms, %d open slots, from %s)"), *QuickJoinKey, *Candidate.GetSessionIdStr(),
+		Candidate.PingInMs, Candidate.Session.NumOpenPublicConnections, bFromCache ? TEXT("cache") : TEXT("search"));
+
+	// Copy: a failing JoinSession can come back here synchronously and change the cache
+	const FOnlineSessionSearchResult CandidateCopy = Candidate;
+	JoinSession(CandidateCopy);
+}
+
+const FOnlineSessionSearchResult* UMultiplayerSessionsSubsystem::PickQuickJoinCandidate(const TArray<FOnlineSessionSearchResult>& RankedResults) const
+{
+	for (const FOnlineSessionSearchResult& Result : RankedResults)
+	{
+		if (!QuickJoinTriedSessions.Contains(Result.GetSessionIdStr()))
+			return &Result;
+	}
+	return nullptr;
+}
+
+void UMultiplayerSessionsSubsystem::ProbeQuickJoinCandidates(const TArray<FOnlineSessionSearchResult>& RankedResults, const bool bFromCache)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::ProbeQuickJoinCandidates");
+	LLM_SCOPE_BYTAG(MultiplayerSessions_Search);
+	CancelQosProbe();
+
+	// Copies: the cache entry can be refreshed while the probe runs
+	QuickJoinProbedCandidates.Reset();
+	TArray<FMultiplayerSessionsQosTarget> Targets;
+	for (const FOnlineSessionSearchResult& Result : RankedResults)
+	{
+		if (QuickJoinProbedCandidates.Num() >= FMath::Max(QosProbeCandidates, 1)) break;
+		if (QuickJoinTriedSessions.Contains(Result.GetSessionIdStr())) continue;
+
+		QuickJoinProbedCandidates.Add({ Result, static_cast<float>(Result.PingInMs), 0.f, 0.f });
+		Targets.Add({ Result.GetSessionIdStr(), QosProbeCandidates > 0 ? ResolveQosAddress(Result) : nullptr });
+	}
+	if (QuickJoinProbedCandidates.IsEmpty()) return;
+	bQuickJoinCandidateFromCache = bFromCache;
+
+	// Nothing reachable over UDP (e.g. Steam P2P lobbies): the search order (advertised ping) decides
+	const int32 NumTargets = Targets.Num();
+	QosProber = MakeShared<FMultiplayerSessionsQosProber>(MoveTemp(Targets), QosProbesPerHost, QosProbeIntervalMs, QosProbeTimeoutMs);
+	if (QosProbeCandidates <= 0 || !QosProber->Start())
+	{
+		QosProber.Reset();
+		ContinueQuickJoin(EOnJoinSessionCompleteResult::SessionDoesNotExist);
+		return;
+	}
+
+	// Busy until the probe ends: the batches of a search running meanwhile don't start another one
+	bQuickJoinInFlight = true;
+	++SessionCacheStats.QosProbes;
+	FMultiplayerSessionsTrace::Phase(TEXT("QosProbeStarted"));
+	UE_LOG(LogMultiplayerSessions, Verbose, TEXT("QuickJoin %s: probing %d hosts"), *QuickJoinKey, NumTargets);
+	QosProbeHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickQosProbe));
+}
+
+bool UMultiplayerSessionsSubsystem::TickQosProbe(float DeltaTime)
+{
+	if (!QosProber.IsValid() || !QosProber->IsDone()) return true;
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::TickQosProbe");
+
+	const TArray<FMultiplayerSessionsQosResult>& Results = QosProber->GetResults();
+	check(Results.Num() == QuickJoinProbedCandidates.Num());
+	for (int32 Index = 0; Index < Results.Num(); ++Index)
+	{
+		FProbedCandidate& Candidate = QuickJoinProbedCandidates[Index];
+		const FMultiplayerSessionsQosResult& Result = Results[Index];
+		if (Result.Received > 0) Candidate.RttMs = Result.AvgRttMs;
+		Candidate.Loss = Result.GetLoss();
+		Candidate.Score = ScoreQosResult(Candidate.Result, Result);
+	}
+	QuickJoinProbedCandidates.StableSort([](const FProbedCandidate& A, const FProbedCandidate& B) { return A.Score < B.Score; });
+
+	const FProbedCandidate& Best = QuickJoinProbedCandidates[0];
+	const double ProbeTime = QosProber->GetElapsedSeconds();
+	SessionCacheStats.LastQosProbeTime = ProbeTime;
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("QuickJoin %s: probed %d hosts in %.0f ms, best %s (RTT %.0f ms, loss %.0f%%, %d open slots)"), *QuickJoinKey,
+		Results.Num(), ProbeTime * 1000.0, *Best.Result.GetSessionIdStr(), Best.RttMs, Best.Loss * 100.f, Best.Result.Session.NumOpenPublicConnections);
+	FMultiplayerSessionsTrace::Phase(TEXT("QosProbeFinished"));
+	MULTIPLAYERSESSIONS_EVENT(QosProbe, NAME_GameSession, Results.Num(), FMath::RoundToInt(Best.RttMs));
+
+	QosProber.Reset();
+	QosProbeHandle.Reset();
+	bQuickJoinInFlight = false;
+	if (bQuickJoinPending)
+		ContinueQuickJoin(EOnJoinSessionCompleteResult::SessionDoesNotExist);
+	return false; // Removes the ticker
+}
+
+void UMultiplayerSessionsSubsystem::CancelQosProbe()
+{
+	if (QosProbeHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(QosProbeHandle);
+		QosProbeHandle.Reset();
+	}
+	// Joins its thread: at most one socket wait
+	QosProber.Reset();
+}
+
+float UMultiplayerSessionsSubsystem::ScoreQosResult(const FOnlineSessionSearchResult& Candidate, const FMultiplayerSessionsQosResult& Result) const
+{
+	// No reply at all: the advertised ping, if any, with the full loss penalty. Never better than a host that answers.
+	const float RttMs = Result.Received > 0 ? Result.AvgRttMs : Candidate.PingInMs > 0 ? static_cast<float>(Candidate.PingInMs) : QosProbeTimeoutMs;
+	const int32 FreeSlots = FMath::Clamp(Candidate.Session.NumOpenPublicConnections, 0, QosMaxSlotBonus);
+	return RttMs + Result.GetLoss() * QosLossPenaltyMs - FreeSlots * QosFreeSlotBonusMs;
+}
+
+TSharedPtr<FInternetAddr> UMultiplayerSessionsSubsystem::ResolveQosAddress(const FOnlineSessionSearchResult& Candidate) const
+{
+	// "1.2.3.4:7777". Anything else (steam.1234...) isn't reachable with a plain UDP socket.
+	FString ConnectString;
+	if (!SessionInterface->GetResolvedConnectString(Candidate, NAME_GamePort, ConnectString)) return nullptr;
+
+	FString Host;
+	if (!ConnectString.Split(TEXT(":"), &Host, nullptr, ESearchCase::IgnoreCase, ESearchDir::FromEnd)) Host = ConnectString;
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedPtr<FInternetAddr> Address = SocketSubsystem ? SocketSubsystem->GetAddressFromString(Host) : nullptr;
+	if (!Address.IsValid() || !Address->IsValid()) return nullptr;
+
+	Address->SetPort(QosPort);
+	return Address;
+}
+
+void UMultiplayerSessionsSubsystem::StartQosResponder()
+{
+	if (QosResponder.IsValid() || QosProbeCandidates <= 0) return;
+
+	QosResponder = MakeShared<FMultiplayerSessionsQosResponder>(QosPort);
+	if (!QosResponder->Start())
+		QosResponder.Reset();
+	else
+		MULTIPLAYERSESSIONS_EVENT(QosResponder, NAME_GameSession, 1, QosPort);
+}
+
+void UMultiplayerSessionsSubsystem::HandleJoinSessionResult(const FString& Address, const EOnJoinSessionCompleteResult::Type Result)
+{
+	if (bQuickJoinPending)
+	{
+		bQuickJoinInFlight = false;
+		if (Result != EOnJoinSessionCompleteResult::Success)
+		{
+			// The cached session may be full or gone by now. Try the next one.
+			ContinueQuickJoin(Result);
+			return;
+		}
+
+		bQuickJoinPending = false;
+		const double TimeToJoin = FPlatformTime::Seconds() - QuickJoinStartTime;
+		SessionCacheStats.LastTimeToJoin = TimeToJoin;
+		if (bQuickJoinCandidateFromCache)
+		{
+			++SessionCacheStats.JoinsFromCache;
+			SessionCacheStats.TotalTimeToJoinFromCache += TimeToJoin;
+		}
+		else
+		{
+			++SessionCacheStats.JoinsFromSearch;
+			SessionCacheStats.TotalTimeToJoinFromSearch += TimeToJoin;
+		}
+		SessionCacheStats.LastChosenHostRttMs = QuickJoinCandidateRttMs;
+		SessionCacheStats.LastChosenHostLoss = QuickJoinCandidateLoss;
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("QuickJoin %s: joined in %.0f ms (from %s), host RTT %.0f ms, loss %.0f%%"), *QuickJoinKey, TimeToJoin * 1000.0,
+			bQuickJoinCandidateFromCache ? TEXT("cache") : TEXT("search"), QuickJoinCandidateRttMs, QuickJoinCandidateLoss * 100.f);
+	}
+
+	MultiplayerOnJoinSessionComplete.Broadcast(Address, Result);
+}
+
+void UMultiplayerSessionsSubsystem::PrefetchSessions(const FString& MatchType)
 {
+	// Extra: Usually the first use, from the menu being opened. Resolve a bit later, so the menu is drawn before the
+	// online subsystem starts.
 	if (!SessionInterface.IsValid())
 	{
-		MultiplayerOnDestroySessionComplete.Broadcast(false);
+		if (!bSessionInterfaceResolveAttempted && !DeferredPrefetchHandle.IsValid())
+		{
+			DeferredPrefetchHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this, MatchType](float)
+			{
+				DeferredPrefetchHandle.Reset();
+				if (ResolveSessionInterface()) PrefetchSessions(MatchType);
+				return false;
+			}), FMath::Max(SessionInterfaceResolveDelay, 0.f));
+		}
+		return;
+	}
+
+	const FString Key = MakeSessionCacheKey(MatchType, FOnlineSearchSettings(), SessionFilter);
+	if (const FSessionCacheEntry* Entry = SessionCache.Find(Key); Entry && FPlatformTime::Seconds() - Entry->FetchTime <= SessionCacheTTL)
 		return;
+
+	QueueSessionSearch(MaxSearchPageSize, MatchType, FOnlineSearchSettings(), SessionFilter, true, true);
+}
+
+void UMultiplayerSessionsSubsystem::InvalidateSessionCache()
+{
+	SessionCache.Empty();
+}
+
+void UMultiplayerSessionsSubsystem::LogSessionCacheStats() const
+{
+	const FMultiplayerSessionsCacheStats& Stats = SessionCacheStats;
+	const int32 Lookups = Stats.Hits + Stats.StaleHits + Stats.Misses;
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Session cache: %d entries, %d lookups, %d hits, %d stale hits, %d misses (hit rate %.0f%%), %d background refreshes"),
+		SessionCache.Num(), Lookups, Stats.Hits, Stats.StaleHits, Stats.Misses,
+		Lookups > 0 ? 100.0 * (Stats.Hits + Stats.StaleHits) / Lookups : 0.0, Stats.BackgroundRefreshes);
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("QuickJoin time to join: last %.0f ms, from cache avg %.0f ms (%d joins), from search avg %.0f ms (%d joins)"),
+		Stats.LastTimeToJoin * 1000.0,
+		Stats.JoinsFromCache > 0 ? Stats.TotalTimeToJoinFromCache * 1000.0 / Stats.JoinsFromCache : 0.0, Stats.JoinsFromCache,
+		Stats.JoinsFromSearch > 0 ? Stats.TotalTimeToJoinFromSearch * 1000.0 / Stats.JoinsFromSearch : 0.0, Stats.JoinsFromSearch);
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Sessions of another build rejected: %d (build %d)"), Stats.BuildMismatchesRejected,
+		MultiplayerSessionsAttributes::GetLocalBuildVersion());
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("QoS: %d probes, last took %.0f ms, last chosen host RTT %.0f ms, loss %.0f%%"), Stats.QosProbes,
+		Stats.LastQosProbeTime * 1000.0, Stats.LastChosenHostRttMs, Stats.LastChosenHostLoss * 100.f);
+}
+
+FString UMultiplayerSessionsSubsystem::MakeSessionCacheKey(const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings, const FMultiplayerSessionFilter& Filter) const
+{
+	// Same query, same key, whatever the order the params were added in
+	TArray<FString> Params;
+	for (const auto& SearchParam : ExtraQuerySettings.SearchParams)
+	{
+		Params.Add(FString::Printf(TEXT("%s %s %s"), *SearchParam.Key.ToString(),
+			EOnlineComparisonOp::ToString(SearchParam.Value.ComparisonOp), *SearchParam.Value.Data.ToString()));
+	}
+	Params.Sort();
+
+	return FString::Printf(TEXT("%s|%s|%s|%s"), ShouldBeLanMatch() ? TEXT("LAN") : TEXT("Online"), *MatchType, *Filter.ToString(), *FString::Join(Params, TEXT(",")));
+}
+
+void UMultiplayerSessionsSubsystem::UpdateSessionCache()
+{
+	LLM_SCOPE_BYTAG(MultiplayerSessions_Search);
+	check(LastSessionSearch.IsValid());
+	const double Now = FPlatformTime::Seconds();
+
+	FSessionCacheEntry& Entry = SessionCache.FindOrAdd(LastSearchCacheKey);
+	if (Entry.LastUsedTime == 0.0) Entry.LastUsedTime = Now;
+	Entry.MatchType = LastSearchMatchType;
+	Entry.ExtraQuerySettings = LastSearchExtraQuerySettings;
+	Entry.Filter = LastSearchFilter;
+	Entry.FetchTime = Now;
+	// Everything was streamed (and filtered) before the search finished
+	Entry.Results = MoveTemp(LastSearchMatches);
+	LastSearchMatches.Reset();
+	RankSessionResults(Entry.Results);
+
+	if (!SessionCacheRefreshHandle.IsValid())
+	{
+		SessionCacheRefreshHandle = FTSTicker::GetCoreTicker().AddTicker(
+			FTickerDelegate::CreateUObject(this, &ThisClass::TickSessionCacheRefresh), SessionCacheRefreshInterval);
+	}
+}
+
+bool UMultiplayerSessionsSubsystem::TickSessionCacheRefresh(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	for (auto It = SessionCache.CreateIterator(); It; ++It)
+	{
+		if (Now - It->Value.LastUsedTime > SessionCacheMaxIdleTime)
+			It.RemoveCurrent();
+	}
+
+	if (SessionCache.IsEmpty())
+	{
+		SessionCacheRefreshHandle.Reset();
+		return false; // Removes the ticker. UpdateSessionCache adds it back.
+	}
+
+	if (!SearchOpLane.IsEmpty() || !CanSearchInBackground()) return true;
+
+	// Oldest entry that will be stale before the next tick, so QuickJoin mostly finds fresh results
+	const FSessionCacheEntry* Oldest = nullptr;
+	for (const TPair<FString, FSessionCacheEntry>& Pair : SessionCache)
+	{
+		const bool bDue = Now - Pair.Value.FetchTime > SessionCacheTTL - SessionCacheRefreshInterval;
+		if (bDue && (!Oldest || Pair.Value.FetchTime < Oldest->FetchTime))
+			Oldest = &Pair.Value;
+	}
+
+	if (Oldest)
+	{
+		++SessionCacheStats.BackgroundRefreshes;
+		QueueSessionSearch(MaxSearchPageSize, Oldest->MatchType, Oldest->ExtraQuerySettings, Oldest->Filter, true, true);
+	}
+	return true;
+}
+
+bool UMultiplayerSessionsSubsystem::CanSearchInBackground() const
+{
+	// In a match nobody is browsing. Don't spend bandwidth on it.
+	if (!SessionInterface.IsValid() || GetCurrentGameSession()) return false;
+
+	const UWorld* World = GetWorld();
+	return World && World->GetFirstLocalPlayerFromController();
+}
+
+void UMultiplayerSessionsSubsystem::RankSessionResults(TArray<FOnlineSessionSearchResult>& Results)
+{
+	Results.RemoveAll([](const FOnlineSessionSearchResult& Result)
+	{
+		return Result.Session.NumOpenPublicConnections <= 0;
+	});
+
+	// Lowest ping first, then most open slots. Steam lobbies often have no ping (all equal), so the slots decide.
+	Results.StableSort([](const FOnlineSessionSearchResult& A, const FOnlineSessionSearchResult& B)
+	{
+		if (A.PingInMs != B.PingInMs) return A.PingInMs < B.PingInMs;
+		return A.Session.NumOpenPublicConnections > B.Session.NumOpenPublicConnections;
+	});
+}
+
+void UMultiplayerSessionsSubsystem::DestroySession()
+{
+	QueueDestroySession();
+}
+
+FMultiplayerSessionOpFuture UMultiplayerSessionsSubsystem::QueueDestroySession()
+{
+	if (!ResolveSessionInterface())
+	{
+		MultiplayerOnDestroySessionComplete.Broadcast(false);
+		return MakeFinishedSessionOp(EMultiplayerSessionOp::Destroy, EMultiplayerSessionOpStatus::Failed);
 	}
 
+	return EnqueueSessionOp(EMultiplayerSessionOp::Destroy, FString(), [this]()
+	{
+		return StartDestroySession();
+	});
+}
+
+bool UMultiplayerSessionsSubsystem::StartDestroySession()
+{
+	// Extra: Queued before a create that may not need it (see QueueCreateSession). Nothing to destroy is a success.
+	if (!GetCurrentGameSession())
+	{
+		FinishSessionOp(EMultiplayerSessionOp::Destroy, EMultiplayerSessionOpStatus::Succeeded);
+		return true;
+	}
+
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::StartDestroySession");
 	DestroySessionCompleteDelegateHandle = SessionInterface->AddOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate);
 	if (!SessionInterface->DestroySession(NAME_GameSession))
 	{
 		SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
-		MultiplayerOnDestroySessionComplete.Broadcast(false);
+		return false;
 	}
+	FMultiplayerSessionsTrace::Phase(TEXT("DestroySessionStarted"));
+	return true;
 }
 
 void UMultiplayerSessionsSubsystem::StartSession()
 {
-	check(SessionInterface);
+	QueueStartSession();
+}
+
+FMultiplayerSessionOpFuture UMultiplayerSessionsSubsystem::QueueStartSession()
+{
+	if (!ResolveSessionInterface())
+	{
+		MultiplayerOnStartSessionComplete.Broadcast(false);
+		return MakeFinishedSessionOp(EMultiplayerSessionOp::Start, EMultiplayerSessionOpStatus::Failed);
+	}
+
+	return EnqueueSessionOp(EMultiplayerSessionOp::Start, FString(), [this]()
+	{
+		return StartStartSession();
+	});
+}
+
+bool UMultiplayerSessionsSubsystem::StartStartSession()
+{
 	if (const FNamedOnlineSession* CurrentSession = GetCurrentGameSession())
 	{
 		const ENetRole RemoteRole = GetWorld()->GetFirstLocalPlayerFromController()->PlayerController->GetLocalRole(); // GetRemoteRole() gave me ROLE_SimulatedProxy
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Silver, UEnum::GetValueAsString(RemoteRole));
+		UE_LOG(LogMultiplayerSessions, Verbose, TEXT("StartSession: %s"), *UEnum::GetValueAsString(RemoteRole));
 		if (RemoteRole != ROLE_Authority)
 		{
-			GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString(TEXT("User does not have authority to start session")));
-			return;
+			UE_LOG(LogMultiplayerSessions, Warning, TEXT("User does not have authority to start session"));
+			return false;
 		}
 		
 		StartSessionCompleteDelegateHandle = SessionInterface->AddOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegate);
 		if (!SessionInterface->StartSession(CurrentSession->SessionName))
 		{
 			SessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
-			MultiplayerOnStartSessionComplete.Broadcast(false);
+			return false;
 		}
 		
 		// if (CurrentSession->bHosting)
@@ -144,79 +1081,401 @@ void UMultiplayerSessionsSubsystem::StartSession()
 		// {
 		// 	GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Orange, FString(TEXT("Cannot StartSession (you are not the session host)")));
 		// }
+		return true;
 	}
-	else
+
+	UE_LOG(LogMultiplayerSessions, Warning, TEXT("Cannot StartSession (no session created or joined)"));
+	return false;
+}
+
+//
+// Extra: Operation queue
+//
+
+UMultiplayerSessionsSubsystem::FSessionOperation* UMultiplayerSessionsSubsystem::FindCoalescableSessionOp(const EMultiplayerSessionOp Type, const FString& Key, const bool bInternal, const bool bBackground)
+{
+	// Only the last one of the lane: coalescing with an older one would reorder operations
+	TArray<FSessionOperationRef>& Lane = GetSessionOpLane(Type);
+	if (Lane.IsEmpty()) return nullptr;
+
+	FSessionOperation& Last = *Lane.Last();
+	const bool bSame = !Last.bFinished && Last.Type == Type && Last.Key == Key && Last.bInternal == bInternal && Last.bBackground == bBackground;
+	return bSame ? &Last : nullptr;
+}
+
+FMultiplayerSessionOpFuture UMultiplayerSessionsSubsystem::EnqueueSessionOp(const EMultiplayerSessionOp Type, const FString& Key, TFunction<bool()>&& Start)
+{
+	if (FSessionOperation* Coalesced = FindCoalescableSessionOp(Type, Key))
+	{
+		++SessionOpStats[static_cast<int32>(Type)].Coalesced;
+		UE_LOG(LogMultiplayerSessions, Verbose, TEXT("%s #%u: coalesced a duplicate request"), MultiplayerSessionOps::ToString(Type), Coalesced->Id);
+		MULTIPLAYERSESSIONS_OP_EVENT(OpCoalesced, Type, Coalesced->Id);
+		return Coalesced->Future;
+	}
+
+	const FSessionOperationRef Op = MakeShared<FSessionOperation>();
+	Op->Type = Type;
+	Op->Key = Key;
+	Op->Start = MoveTemp(Start);
+	return EnqueueSessionOp(Op);
+}
+
+FMultiplayerSessionOpFuture UMultiplayerSessionsSubsystem::EnqueueSessionOp(const FSessionOperationRef& Op)
+{
+	Op->Id = ++LastSessionOpId;
+	Op->Future = Op->Promise.GetFuture().Share();
+	Op->QueuedTime = FPlatformTime::Seconds();
+	Op->Timeout = GetSessionOpTimeout(Op->Type);
+	++SessionOpStats[static_cast<int32>(Op->Type)].Queued;
+
+	TArray<FSessionOperationRef>& Lane = GetSessionOpLane(Op->Type);
+	Lane.Add(Op);
+	MaxSessionOpQueueDepth = FMath::Max(MaxSessionOpQueueDepth, GetSessionOpQueueDepth());
+	UE_LOG(LogMultiplayerSessions, Verbose, TEXT("%s #%u: queued (queue depth %d)"), MultiplayerSessionOps::ToString(Op->Type), Op->Id, GetSessionOpQueueDepth());
+	MULTIPLAYERSESSIONS_OP_EVENT(OpQueued, Op->Type, Op->Id, 0, GetSessionOpQueueDepth());
+
+	if (!SessionOpTickerHandle.IsValid())
+	{
+		SessionOpTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickSessionOps), 0.25f);
+	}
+
+	// Keep the future: the operation can finish (and leave the lane) right away
+	const FMultiplayerSessionOpFuture Future = Op->Future;
+	if (Lane.Num() == 1) StartNextSessionOp(Lane);
+	return Future;
+}
+
+void UMultiplayerSessionsSubsystem::StartNextSessionOp(TArray<FSessionOperationRef>& Lane)
+{
+	if (Lane.IsEmpty() || Lane[0]->bRunning) return;
+
+	const FSessionOperationRef Op = Lane[0];
+	Op->bRunning = true;
+	Op->StartTime = FPlatformTime::Seconds();
+	UE_LOG(LogMultiplayerSessions, Verbose, TEXT("%s #%u: started after %.0f ms in the queue"), MultiplayerSessionOps::ToString(Op->Type), Op->Id,
+		(Op->StartTime - Op->QueuedTime) * 1000.0);
+	MULTIPLAYERSESSIONS_OP_EVENT(OpStarted, Op->Type, Op->Id);
+
+	if (!Op->Start())
+		FinishSessionOp(Op->Type, EMultiplayerSessionOpStatus::Failed);
+}
+
+void UMultiplayerSessionsSubsystem::FinishSessionOp(const EMultiplayerSessionOp Type, const EMultiplayerSessionOpStatus Status, const FString& Address, const EOnJoinSessionCompleteResult::Type JoinResult)
+{
+	TArray<FSessionOperationRef>& Lane = GetSessionOpLane(Type);
+	if (Lane.IsEmpty() || !Lane[0]->bRunning || Lane[0]->bFinished || Lane[0]->Type != Type)
+	{
+		// A callback for an operation that already timed out or was canceled
+		UE_LOG(LogMultiplayerSessions, Verbose, TEXT("%s: late callback ignored"), MultiplayerSessionOps::ToString(Type));
+		return;
+	}
+
+	const FSessionOperationRef Op = Lane[0];
+	Op->bFinished = true;
+
+	const double Now = FPlatformTime::Seconds();
+	FMultiplayerSessionOpResult Result;
+	Result.Op = Type;
+	Result.Status = Status;
+	Result.Address = Address;
+	Result.JoinResult = Status == EMultiplayerSessionOpStatus::Succeeded ? JoinResult
+		: JoinResult != EOnJoinSessionCompleteResult::Success ? JoinResult : EOnJoinSessionCompleteResult::UnknownError;
+	Result.QueueTime = Op->StartTime - Op->QueuedTime;
+	Result.RunTime = Now - Op->StartTime;
+
+	FSessionOpStats& Stats = SessionOpStats[static_cast<int32>(Type)];
+	switch (Status)
+	{
+	case EMultiplayerSessionOpStatus::Succeeded: ++Stats.Succeeded; break;
+	case EMultiplayerSessionOpStatus::Failed: ++Stats.Failed; break;
+	case EMultiplayerSessionOpStatus::TimedOut: ++Stats.TimedOut; break;
+	case EMultiplayerSessionOpStatus::Canceled: ++Stats.Canceled; break;
+	}
+	Stats.TotalQueueTime += Result.QueueTime;
+	Stats.TotalRunTime += Result.RunTime;
+	Stats.MaxLatency = FMath::Max(Stats.MaxLatency, Result.QueueTime + Result.RunTime);
+	UE_LOG(LogMultiplayerSessions, Verbose, TEXT("%s #%u: %s (queued %.0f ms, ran %.0f ms)"), MultiplayerSessionOps::ToString(Type), Op->Id,
+		MultiplayerSessionOps::ToString(Status), Result.QueueTime * 1000.0, Result.RunTime * 1000.0);
+	MULTIPLAYERSESSIONS_OP_EVENT(OpFinished, Type, Op->Id, static_cast<int32>(Status), FMath::RoundToInt((Result.QueueTime + Result.RunTime) * 1000.0));
+	if (Type == EMultiplayerSessionOp::Join)
+		MULTIPLAYERSESSIONS_OP_EVENT(JoinResult, Type, Op->Id, static_cast<int32>(Result.JoinResult));
+
+	// Broadcast while still at the head of the lane: anything queued by a listener waits behind it
+	HandleFinishedSessionOp(*Op, Result);
+
+	Lane.Remove(Op);
+	Op->Promise.SetValue(Result);
+	StartNextSessionOp(Lane);
+}
+
+void UMultiplayerSessionsSubsystem::HandleFinishedSessionOp(const FSessionOperation& Op, const FMultiplayerSessionOpResult& Result)
+{
+	const bool bWasSuccessful = Result.WasSuccessful();
+	switch (Op.Type)
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Orange, FString(TEXT("Cannot StartSession (no session created or joined)")));
+	case EMultiplayerSessionOp::Create:
+		// No travel is coming
+		if (!bWasSuccessful && Preloader.IsValid()) Preloader->Release(TEXT("create failed"));
+		MultiplayerOnCreateSessionComplete.Broadcast(bWasSuccessful);
+		break;
+	case EMultiplayerSessionOp::Find:
+		HandleFinishedSearch(Op, Result.Status);
+		break;
+	case EMultiplayerSessionOp::Join:
+		HandleJoinSessionResult(Result.Address, Result.JoinResult);
+		break;
+	case EMultiplayerSessionOp::Destroy:
+		MultiplayerOnDestroySessionComplete.Broadcast(bWasSuccessful);
+		break;
+	case EMultiplayerSessionOp::Start:
+		MultiplayerOnStartSessionComplete.Broadcast(bWasSuccessful);
+		break;
+	default:
+		break;
+	}
+}
+
+void UMultiplayerSessionsSubsystem::CancelQueuedSessionOp(const FSessionOperationRef& Op)
+{
+	check(!Op->bRunning);
+	GetSessionOpLane(Op->Type).Remove(Op);
+	Op->bFinished = true;
+	++SessionOpStats[static_cast<int32>(Op->Type)].Canceled;
+
+	FMultiplayerSessionOpResult Result;
+	Result.Op = Op->Type;
+	Result.Status = EMultiplayerSessionOpStatus::Canceled;
+	Result.QueueTime = FPlatformTime::Seconds() - Op->QueuedTime;
+	Op->Promise.SetValue(Result);
+}
+
+void UMultiplayerSessionsSubsystem::AbortRunningSessionOp(const FSessionOperation& Op)
+{
+	// The online service callback won't come back to us. The call itself may still finish on the service side.
+	if (!SessionInterface.IsValid()) return;
+
+	switch (Op.Type)
+	{
+	case EMultiplayerSessionOp::Create:
+		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+		break;
+	case EMultiplayerSessionOp::Find:
+		SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionCompleteDelegateHandle);
+		SessionInterface->CancelFindSessions();
+		break;
+	case EMultiplayerSessionOp::Join:
+		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+		break;
+	case EMultiplayerSessionOp::Destroy:
+		SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
+		break;
+	case EMultiplayerSessionOp::Start:
+		SessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
+		break;
+	default:
+		break;
+	}
+}
+
+void UMultiplayerSessionsSubsystem::CancelAllSessionOps()
+{
+	// No broadcasts: the listeners are going away too
+	for (TArray<FSessionOperationRef>* Lane : { &SessionOpLane, &SearchOpLane })
+	{
+		for (const FSessionOperationRef& Op : *Lane)
+		{
+			if (Op->bRunning) AbortRunningSessionOp(*Op);
+			if (Op->bFinished) continue;
+			Op->bFinished = true;
+
+			FMultiplayerSessionOpResult Result;
+			Result.Op = Op->Type;
+			Result.Status = EMultiplayerSessionOpStatus::Canceled;
+			Op->Promise.SetValue(Result);
+		}
+		Lane->Empty();
+	}
+}
+
+bool UMultiplayerSessionsSubsystem::TickSessionOps(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	for (TArray<FSessionOperationRef>* Lane : { &SessionOpLane, &SearchOpLane })
+	{
+		if (Lane->IsEmpty()) continue;
+
+		const FSessionOperationRef Op = (*Lane)[0];
+		if (Op->bRunning && !Op->bFinished && Op->Timeout > 0.f && Now - Op->StartTime > Op->Timeout)
+		{
+			UE_LOG(LogMultiplayerSessions, Warning, TEXT("%s #%u: timed out after %.1f s"), MultiplayerSessionOps::ToString(Op->Type), Op->Id, Now - Op->StartTime);
+			AbortRunningSessionOp(*Op);
+			FinishSessionOp(Op->Type, EMultiplayerSessionOpStatus::TimedOut);
+		}
+	}
+
+	if (SessionOpLane.IsEmpty() && SearchOpLane.IsEmpty())
+	{
+		SessionOpTickerHandle.Reset();
+		return false; // Removes the ticker. EnqueueSessionOp adds it back.
+	}
+	return true;
+}
+
+float UMultiplayerSessionsSubsystem::GetSessionOpTimeout(const EMultiplayerSessionOp Type) const
+{
+	switch (Type)
+	{
+	case EMultiplayerSessionOp::Create: return CreateSessionTimeout;
+	case EMultiplayerSessionOp::Find: return FindSessionsTimeout;
+	case EMultiplayerSessionOp::Join: return JoinSessionTimeout;
+	case EMultiplayerSessionOp::Destroy: return DestroySessionTimeout;
+	case EMultiplayerSessionOp::Start: return StartSessionTimeout;
+	default: return 0.f;
+	}
+}
+
+FMultiplayerSessionOpFuture UMultiplayerSessionsSubsystem::MakeFinishedSessionOp(const EMultiplayerSessionOp Type, const EMultiplayerSessionOpStatus Status)
+{
+	FMultiplayerSessionOpResult Result;
+	Result.Op = Type;
+	Result.Status = Status;
+	return MakeFulfilledPromise<FMultiplayerSessionOpResult>(MoveTemp(Result)).GetFuture().Share();
+}
+
+void UMultiplayerSessionsSubsystem::LogSessionOpStats() const
+{
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Session operations: queue depth %d (max %d)"), GetSessionOpQueueDepth(), MaxSessionOpQueueDepth);
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("%8s %7s %9s %9s %7s %8s %8s %12s %10s %10s"), TEXT("Op"), TEXT("Queued"), TEXT("Coalesced"),
+		TEXT("Succeeded"), TEXT("Failed"), TEXT("TimedOut"), TEXT("Canceled"), TEXT("Avg wait ms"), TEXT("Avg run ms"), TEXT("Max ms"));
+	for (int32 Index = 0; Index < static_cast<int32>(EMultiplayerSessionOp::MAX); ++Index)
+	{
+		const FSessionOpStats& Stats = SessionOpStats[Index];
+		const int32 Finished = Stats.Succeeded + Stats.Failed + Stats.TimedOut + Stats.Canceled;
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("%8s %7d %9d %9d %7d %8d %8d %12.1f %10.1f %10.1f"), MultiplayerSessionOps::ToString(static_cast<EMultiplayerSessionOp>(Index)),
+			Stats.Queued, Stats.Coalesced, Stats.Succeeded, Stats.Failed, Stats.TimedOut, Stats.Canceled,
+			Finished > 0 ? Stats.TotalQueueTime * 1000.0 / Finished : 0.0, Finished > 0 ? Stats.TotalRunTime * 1000.0 / Finished : 0.0, Stats.MaxLatency * 1000.0);
 	}
 }
 
 void UMultiplayerSessionsSubsystem::OnCreateSessionComplete(FName SessionName, bool bWasSuccessful)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::OnCreateSessionComplete");
+	FMultiplayerSessionsTrace::Phase(TEXT("CreateSessionComplete"));
+
 	if (SessionInterface)
 		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
 
-	MultiplayerOnCreateSessionComplete.Broadcast(bWasSuccessful);
+	// Extra: Answer the QoS pings of the players looking for a session
+	if (bWasSuccessful) StartQosResponder();
+
+	FinishSessionOp(EMultiplayerSessionOp::Create, bWasSuccessful ? EMultiplayerSessionOpStatus::Succeeded : EMultiplayerSessionOpStatus::Failed);
 }
 
 void UMultiplayerSessionsSubsystem::OnFindSessionsComplete(bool bWasSuccessful)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::OnFindSessionsComplete");
 	check(SessionInterface);
 	SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionCompleteDelegateHandle);
 
-	// Teacher preferred that this broadcast should broadcast as false if no results were found (even if the search was successful),
-	// but I don't want that to happen.
-	/*if (LastSessionSearch->SearchResults.Num() <= 0)
+	FinishSessionOp(EMultiplayerSessionOp::Find, bWasSuccessful ? EMultiplayerSessionOpStatus::Succeeded : EMultiplayerSessionOpStatus::Failed);
+}
+
+void UMultiplayerSessionsSubsystem::HandleFinishedSearch(const FSessionOperation& Op, const EMultiplayerSessionOpStatus Status)
+{
+	LLM_SCOPE_BYTAG(MultiplayerSessions_Search);
+	StopSearchResultsStream();
+	const bool bWasSuccessful = Status == EMultiplayerSessionOpStatus::Succeeded;
+	if (!Op.bBackground) FMultiplayerSessionsTrace::Phase(TEXT("FindSessionsComplete"));
+
+	if (Status == EMultiplayerSessionOpStatus::Canceled)
 	{
-		MultiplayerOnFindSessionComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
-		return;
-	}*/
+		LastSessionSearch.Reset();
+	}
+	else
+	{
+		// Extra: Whatever was not streamed yet goes in the last batch (an empty one if the search didn't even start)
+		if (LastSessionSearch.IsValid()) BroadcastNewSearchResults(true);
+		else if (!Op.bInternal) MultiplayerOnFindSessionsBatch.Broadcast(TArray<FOnlineSessionSearchResult>(), true);
+
+		// Extra: Every search feeds the cache, whoever started it
+		if (bWasSuccessful && LastSessionSearch.IsValid()) UpdateSessionCache();
+
+		if (!Op.bInternal)
+		{
+			// Teacher preferred that this broadcast should broadcast as false if no results were found (even if the search was successful),
+			// but I don't want that to happen.
+			/*if (LastSessionSearch->SearchResults.Num() <= 0)
+			{
+				MultiplayerOnFindSessionComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+				return;
+			}*/
+
+			// Keep it alive: a listener may start another search
+			const TSharedPtr<FOnlineSessionSearch> Search = LastSessionSearch;
+			MultiplayerOnFindSessionComplete.Broadcast(Search.IsValid() ? Search->SearchResults : TArray<FOnlineSessionSearchResult>(), bWasSuccessful);
+		}
+	}
 
-	MultiplayerOnFindSessionComplete.Broadcast(LastSessionSearch->SearchResults, bWasSuccessful);
+	// Nothing joined from the batches: the cache has the full ranked list now (or the search failed)
+	if (Op.bInternal && bQuickJoinPending && !bQuickJoinInFlight && Op.CacheKey == QuickJoinKey)
+		ContinueQuickJoin(bWasSuccessful ? EOnJoinSessionCompleteResult::SessionDoesNotExist : EOnJoinSessionCompleteResult::UnknownError);
 }
 
 void UMultiplayerSessionsSubsystem::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE("MultiplayerSessions::OnJoinSessionComplete");
+	FMultiplayerSessionsTrace::Phase(TEXT("JoinSessionComplete"));
+
 	check(SessionInterface);
 	SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
 
 	FString Address;
-	SessionInterface->GetResolvedConnectString(SessionName, Address);
-	MultiplayerOnJoinSessionComplete.Broadcast(Address, Result);
+	if (SessionInterface->GetResolvedConnectString(SessionName, Address))
+		FMultiplayerSessionsTrace::Phase(TEXT("ConnectStringResolved"));
+	FinishSessionOp(EMultiplayerSessionOp::Join, Result == EOnJoinSessionCompleteResult::Success ? EMultiplayerSessionOpStatus::Succeeded : EMultiplayerSessionOpStatus::Failed,
+		Address, Result);
 }
 
 void UMultiplayerSessionsSubsystem::OnDestroySessionComplete(FName SessionName, bool bWasSuccessful)
 {
-	const FString LogSuccess = FString(TEXT("Session Destroyed"));
-	const FString LogFailure = FString(TEXT("Failed to destroy session"));
+	FMultiplayerSessionsTrace::Phase(TEXT("DestroySessionComplete"));
+	if (bWasSuccessful) UE_LOG(LogMultiplayerSessions, Log, TEXT("Session Destroyed"));
+	else UE_LOG(LogMultiplayerSessions, Warning, TEXT("Failed to destroy session"));
 
-	GEngine->AddOnScreenDebugMessage(-1, 15.f, bWasSuccessful ? FColor::Cyan : FColor::Red, bWasSuccessful ? LogSuccess : LogFailure);
-	
 	check(SessionInterface);
 	SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
-	MultiplayerOnDestroySessionComplete.Broadcast(bWasSuccessful);
-	
-	if (bWasSuccessful && bCreateSessionOnDestroy)
+	if (bWasSuccessful && QosResponder.IsValid())
 	{
-		bCreateSessionOnDestroy = false;
-		CreateSession(LastNumPublicConnections, LastMatchType);
+		QosResponder.Reset();
+		MULTIPLAYERSESSIONS_EVENT(QosResponder, SessionName, 0, QosPort);
 	}
+
+	// Extra: A create waiting for this destroy is the next operation in the queue (no more bCreateSessionOnDestroy)
+	FinishSessionOp(EMultiplayerSessionOp::Destroy, bWasSuccessful ? EMultiplayerSessionOpStatus::Succeeded : EMultiplayerSessionOpStatus::Failed);
 }
 
 void UMultiplayerSessionsSubsystem::OnStartSessionComplete(FName SessionName, bool bWasSuccessful)
 {
-	const FString LogSuccess = FString(TEXT("Session started successfully!"));
-	const FString LogFailure = FString(TEXT("Failed to start session"));
-	
-	GEngine->AddOnScreenDebugMessage(-1, 15.f, bWasSuccessful ? FColor::Cyan : FColor::Red, bWasSuccessful ? LogSuccess : LogFailure);
+	if (bWasSuccessful) UE_LOG(LogMultiplayerSessions, Log, TEXT("Session started successfully!"));
+	else UE_LOG(LogMultiplayerSessions, Warning, TEXT("Failed to start session"));
 
 	SessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
-	MultiplayerOnStartSessionComplete.Broadcast(bWasSuccessful);
+	FinishSessionOp(EMultiplayerSessionOp::Start, bWasSuccessful ? EMultiplayerSessionOpStatus::Succeeded : EMultiplayerSessionOpStatus::Failed);
+}
+
+void UMultiplayerSessionsSubsystem::PreloadTravelMap()
+{
+	if (!bPreloadTravelMap || TravelMap.IsEmpty()) return;
+
+	if (!Preloader.IsValid())
+		Preloader = MakeShared<FMultiplayerSessionsPreloader>();
+	Preloader->Preload(TravelMap);
 }
 
-bool UMultiplayerSessionsSubsystem::ShouldBeLanMatch()
+bool UMultiplayerSessionsSubsystem::ShouldBeLanMatch() const
 {
-	return IOnlineSubsystem::Get()->GetSubsystemName() == "NULL" ? true : false;
+	// Extra: The mock backend is in-process, like the NULL subsystem's LAN sessions
+	return SessionServiceName == "NULL" || SessionServiceName == "Mock";
 }
 
 const FUniqueNetId& UMultiplayerSessionsSubsystem::GetPreferredUniqueNetId() const
@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsTrace.h"
+#include "MultiplayerSessions.h" // Who needs: LogMultiplayerSessions
+#include "Trace/Trace.inl" // Who needs: UE_TRACE_LOG
+#include "ProfilingDebugging/MiscTrace.h" // Who needs: TRACE_BOOKMARK, TRACE_BEGIN_REGION
+#include "UObject/UObjectGlobals.h" // Who needs: FCoreUObjectDelegates::PreLoadMap
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+UE_TRACE_CHANNEL_DEFINE(MultiplayerSessionsChannel);
+
+UE_TRACE_EVENT_BEGIN(MultiplayerSessions, LifecyclePhase)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, FlowId)
+	UE_TRACE_EVENT_FIELD(uint8, Flow)
+	UE_TRACE_EVENT_FIELD(double, SincePreviousMs)
+	UE_TRACE_EVENT_FIELD(double, SinceStartMs)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Name)
+UE_TRACE_EVENT_END()
+
+namespace MultiplayerSessionsTrace
+{
+	struct FRunningFlow
+	{
+		EMultiplayerSessionsFlow Flow{ EMultiplayerSessionsFlow::Host };
+		uint32 Id{ 0 };
+		double StartTime{ 0.0 };
+		double LastPhaseTime{ 0.0 };
+		int32 NumPhases{ 0 };
+		FString FlowRegion;
+		FString PhaseRegion;
+	};
+
+	// Game thread only, like everything that calls it
+	static TOptional<FRunningFlow> RunningFlow;
+	static uint32 LastFlowId{ 0 };
+
+	// "Host/CreateSessionComplete" -> time from the previous phase to this one (ms). "Host/Total" for whole flows.
+	static TMap<FString, TArray<double>> PhaseDurations;
+	static TMap<FString, int32> FailedFlows;
+
+	static FDelegateHandle PreLoadMapHandle;
+	static FDelegateHandle PostLoadMapHandle;
+
+	static const TCHAR* ToString(const EMultiplayerSessionsFlow Flow)
+	{
+		return Flow == EMultiplayerSessionsFlow::Host ? TEXT("Host") : TEXT("Join");
+	}
+
+	static void AddSample(const EMultiplayerSessionsFlow Flow, const TCHAR* Name, const double Ms)
+	{
+		PhaseDurations.FindOrAdd(FString::Printf(TEXT("%s/%s"), ToString(Flow), Name)).Add(Ms);
+	}
+
+	// Nearest rank, on a sorted array
+	static double Percentile(const TArray<double>& Sorted, const double P)
+	{
+		if (Sorted.IsEmpty()) return 0.0;
+		const int32 Rank = FMath::Clamp(FMath::CeilToInt(P * Sorted.Num()), 1, Sorted.Num());
+		return Sorted[Rank - 1];
+	}
+
+	static void MarkPhase(FRunningFlow& Running, const TCHAR* PhaseName, const bool bLast)
+	{
+		const double Now = FPlatformTime::Seconds();
+		const double SincePreviousMs = (Now - Running.LastPhaseTime) * 1000.0;
+		const double SinceStartMs = (Now - Running.StartTime) * 1000.0;
+		Running.LastPhaseTime = Now;
+
+		if (Running.NumPhases++ > 0) // The first phase has nothing before it
+			AddSample(Running.Flow, PhaseName, SincePreviousMs);
+		UE_LOG(LogMultiplayerSessions, Verbose, TEXT("%s #%u: %s (+%.1f ms, %.1f ms total)"), ToString(Running.Flow), Running.Id, PhaseName, SincePreviousMs, SinceStartMs);
+
+		if (!UE_TRACE_CHANNELEXPR_IS_ENABLED(MultiplayerSessionsChannel)) return;
+
+		UE_TRACE_LOG(MultiplayerSessions, LifecyclePhase, MultiplayerSessionsChannel)
+			<< LifecyclePhase.Cycle(FPlatformTime::Cycles64())
+			<< LifecyclePhase.FlowId(Running.Id)
+			<< LifecyclePhase.Flow(static_cast<uint8>(Running.Flow))
+			<< LifecyclePhase.SincePreviousMs(SincePreviousMs)
+			<< LifecyclePhase.SinceStartMs(SinceStartMs)
+			<< LifecyclePhase.Name(PhaseName, FCString::Strlen(PhaseName));
+
+		TRACE_BOOKMARK(TEXT("%s #%u: %s"), ToString(Running.Flow), Running.Id, PhaseName);
+
+		// Each phase is a region that lasts until the next one
+		if (!Running.PhaseRegion.IsEmpty()) TRACE_END_REGION(*Running.PhaseRegion);
+		Running.PhaseRegion = bLast ? FString() : FString::Printf(TEXT("%s #%u: %s"), ToString(Running.Flow), Running.Id, PhaseName);
+		if (!Running.PhaseRegion.IsEmpty()) TRACE_BEGIN_REGION(*Running.PhaseRegion);
+	}
+
+	static FAutoConsoleCommand ReportCommand(
+		TEXT("MultiplayerSessions.LifecycleReport"),
+		TEXT("Prints the percentiles of each Host/Join phase and writes them as CSV to Saved/Profiling."),
+		FConsoleCommandDelegate::CreateStatic(&FMultiplayerSessionsTrace::WriteReport));
+}
+
+void FMultiplayerSessionsTrace::BeginFlow(const EMultiplayerSessionsFlow Flow, const TCHAR* FirstPhase)
+{
+	using namespace MultiplayerSessionsTrace;
+
+	if (RunningFlow.IsSet()) EndFlow(false, TEXT("Abandoned"));
+
+	FRunningFlow& Running = RunningFlow.Emplace();
+	Running.Flow = Flow;
+	Running.Id = ++LastFlowId;
+	Running.StartTime = FPlatformTime::Seconds();
+	Running.LastPhaseTime = Running.StartTime;
+
+	if (UE_TRACE_CHANNELEXPR_IS_ENABLED(MultiplayerSessionsChannel))
+	{
+		Running.FlowRegion = FString::Printf(TEXT("%s #%u"), ToString(Flow), Running.Id);
+		TRACE_BEGIN_REGION(*Running.FlowRegion);
+	}
+
+	MarkPhase(Running, FirstPhase, false);
+}
+
+void FMultiplayerSessionsTrace::Phase(const TCHAR* PhaseName)
+{
+	using namespace MultiplayerSessionsTrace;
+
+	if (RunningFlow.IsSet())
+		MarkPhase(RunningFlow.GetValue(), PhaseName, false);
+}
+
+void FMultiplayerSessionsTrace::EndFlow(const bool bSucceeded, const TCHAR* LastPhase)
+{
+	using namespace MultiplayerSessionsTrace;
+
+	if (!RunningFlow.IsSet()) return;
+	FRunningFlow& Running = RunningFlow.GetValue();
+	MarkPhase(Running, LastPhase, true);
+
+	const double TotalMs = (Running.LastPhaseTime - Running.StartTime) * 1000.0;
+	if (bSucceeded) AddSample(Running.Flow, TEXT("Total"), TotalMs);
+	else ++FailedFlows.FindOrAdd(ToString(Running.Flow));
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("%s #%u %s after %.0f ms (%s)"), ToString(Running.Flow), Running.Id,
+		bSucceeded ? TEXT("done") : TEXT("failed"), TotalMs, LastPhase);
+
+	if (!Running.FlowRegion.IsEmpty()) TRACE_END_REGION(*Running.FlowRegion);
+	RunningFlow.Reset();
+}
+
+bool FMultiplayerSessionsTrace::IsFlowRunning()
+{
+	return MultiplayerSessionsTrace::RunningFlow.IsSet();
+}
+
+void FMultiplayerSessionsTrace::WriteReport()
+{
+	using namespace MultiplayerSessionsTrace;
+
+	FString Csv = TEXT("Phase,Samples,P50Ms,P90Ms,P99Ms,MaxMs\n");
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Session lifecycle (ms from the previous phase, Total: whole successful flows):"));
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("%-40s %8s %10s %10s %10s %10s"), TEXT("Phase"), TEXT("Samples"), TEXT("P50"), TEXT("P90"), TEXT("P99"), TEXT("Max"));
+
+	TArray<FString> Names;
+	PhaseDurations.GetKeys(Names);
+	Names.Sort();
+	for (const FString& Name : Names)
+	{
+		TArray<double> Sorted = PhaseDurations[Name];
+		Sorted.Sort();
+		const double P50 = Percentile(Sorted, 0.5);
+		const double P90 = Percentile(Sorted, 0.9);
+		const double P99 = Percentile(Sorted, 0.99);
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("%-40s %8d %10.1f %10.1f %10.1f %10.1f"), *Name, Sorted.Num(), P50, P90, P99, Sorted.Last());
+		Csv += FString::Printf(TEXT("%s,%d,%.3f,%.3f,%.3f,%.3f\n"), *Name, Sorted.Num(), P50, P90, P99, Sorted.Last());
+	}
+	for (const TPair<FString, int32>& Pair : FailedFlows)
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("%s flows failed: %d"), *Pair.Key, Pair.Value);
+	}
+
+	const FString CsvPath = FPaths::ProfilingDir() / TEXT("SessionLifecycle.csv");
+	if (FFileHelper::SaveStringToFile(Csv, *CsvPath))
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Wrote %s"), *CsvPath);
+}
+
+void FMultiplayerSessionsTrace::Startup()
+{
+	using namespace MultiplayerSessionsTrace;
+
+	// Host ends in the lobby (ServerTravel) and Join in the host's map (ClientTravel): both are a map load
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddLambda([](const FString& MapName)
+	{
+		Phase(TEXT("MapLoadStarted"));
+	});
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddLambda([](UWorld* World)
+	{
+		EndFlow(World != nullptr, TEXT("MapLoaded"));
+	});
+}
+
+void FMultiplayerSessionsTrace::Shutdown()
+{
+	using namespace MultiplayerSessionsTrace;
+
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+
+	// Module shutdown is the last chance for a benchmark run to get its phase percentiles into the log and
+	// Saved/Profiling/SessionLifecycle.csv without anyone running MultiplayerSessions.LifecycleReport
+	if (!PhaseDurations.IsEmpty())
+		WriteReport();
+}
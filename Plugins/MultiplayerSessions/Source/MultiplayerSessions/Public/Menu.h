@@ -37,7 +37,7 @@ protected:
 	// Multicast Delegate (NON DYNAMIC)
 	void OnFindSessions(const TArray<FOnlineSessionSearchResult>& SearchResults, bool bWasSuccessful);
 	// Multicast Delegate (NON DYNAMIC)
-	void OnJoinSession(const FString& Address, EOnJoinSessionCompleteResult::Type Result) const;
+	void OnJoinSession(const FString& Address, EOnJoinSessionCompleteResult::Type Result);
 	// Dynamic Multicast Delegate
 	UFUNCTION()
 	void OnDestroySession(bool bWasSuccessful);
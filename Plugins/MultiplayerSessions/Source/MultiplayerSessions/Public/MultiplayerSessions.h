@@ -4,6 +4,15 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "HAL/LowLevelMemTracker.h" // Who needs: LLM_DECLARE_TAG_API
+
+MULTIPLAYERSESSIONS_API DECLARE_LOG_CATEGORY_EXTERN(LogMultiplayerSessions, Log, All);
+
+// Extra: Low-level memory tracker tags ("-llm"). Search: search results, the session cache and the session settings we
+// keep. UI: the menu widget.
+LLM_DECLARE_TAG_API(MultiplayerSessions, MULTIPLAYERSESSIONS_API);
+LLM_DECLARE_TAG_API(MultiplayerSessions_Search, MULTIPLAYERSESSIONS_API);
+LLM_DECLARE_TAG_API(MultiplayerSessions_UI, MULTIPLAYERSESSIONS_API);
 
 class FMultiplayerSessionsModule : public IModuleInterface
 {
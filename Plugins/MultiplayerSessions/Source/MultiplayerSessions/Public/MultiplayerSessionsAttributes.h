@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MultiplayerSessionsAttributes.generated.h"
+
+class FOnlineSessionSettings;
+
+//
+// Extra: What a session advertises about itself. Every field is a small integer id, so the whole schema fits in three
+// int32 settings (see MultiplayerSessionsAttributes::BuildKey...) instead of free-form strings. Ids are positions
+// (starting at 1) in the lists of UMultiplayerSessionsSubsystem (MatchTypes, SessionMaps), 0 means "unknown".
+//
+USTRUCT(BlueprintType)
+struct FMultiplayerSessionAttributes
+{
+	GENERATED_BODY()
+
+	// FNetworkVersion::GetLocalNetworkVersion of the host. Sessions of another build are never joined.
+	UPROPERTY(BlueprintReadOnly)
+	int32 BuildVersion{ 0 };
+
+	UPROPERTY(BlueprintReadOnly)
+	uint8 MatchType{ 0 };
+
+	UPROPERTY(BlueprintReadOnly)
+	uint8 Region{ 0 };
+
+	UPROPERTY(BlueprintReadOnly)
+	uint8 Map{ 0 };
+
+	// 0..15
+	UPROPERTY(BlueprintReadOnly)
+	uint8 SkillBand{ 0 };
+};
+
+//
+// Extra: What a search wants. 0 means "any" for Region, Map and SkillBand. The build version and match type go to the
+// online service in QuerySettings, the rest is checked on the packed integer of each result.
+//
+USTRUCT(BlueprintType)
+struct FMultiplayerSessionFilter
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadWrite)
+	uint8 Region{ 0 };
+
+	UPROPERTY(BlueprintReadWrite)
+	uint8 Map{ 0 };
+
+	UPROPERTY(BlueprintReadWrite)
+	uint8 SkillBand{ 0 };
+
+	// Bands away from SkillBand still accepted
+	UPROPERTY(BlueprintReadWrite)
+	uint8 SkillBandTolerance{ 1 };
+
+	UPROPERTY(BlueprintReadWrite)
+	int32 MinOpenSlots{ 1 };
+
+	FString ToString() const
+	{
+		return FString::Printf(TEXT("R%d M%d S%d~%d O%d"), Region, Map, SkillBand, SkillBandTolerance, MinOpenSlots);
+	}
+};
+
+namespace MultiplayerSessionsAttributes
+{
+	// Short keys: they're sent with every advertised session
+	const FName BuildKey{ TEXT("BLD") };
+	const FName MatchTypeKey{ TEXT("MT") };
+	const FName InfoKey{ TEXT("INFO") };
+
+	//
+	// INFO bitfield: Region in bits 0-7, Map in bits 8-15, SkillBand in bits 16-19.
+	//
+	constexpr int32 RegionShift{ 0 };
+	constexpr int32 MapShift{ 8 };
+	constexpr int32 SkillBandShift{ 16 };
+	constexpr int32 RegionMask{ 0xFF << RegionShift };
+	constexpr int32 MapMask{ 0xFF << MapShift };
+	constexpr int32 SkillBandMask{ 0x0F << SkillBandShift };
+	constexpr uint8 MaxSkillBand{ 15 };
+
+	inline int32 PackInfo(const FMultiplayerSessionAttributes& Attributes)
+	{
+		return (Attributes.Region << RegionShift)
+			| (Attributes.Map << MapShift)
+			| (FMath::Min(Attributes.SkillBand, MaxSkillBand) << SkillBandShift);
+	}
+
+	inline void UnpackInfo(const int32 Info, FMultiplayerSessionAttributes& OutAttributes)
+	{
+		OutAttributes.Region = static_cast<uint8>((Info & RegionMask) >> RegionShift);
+		OutAttributes.Map = static_cast<uint8>((Info & MapMask) >> MapShift);
+		OutAttributes.SkillBand = static_cast<uint8>((Info & SkillBandMask) >> SkillBandShift);
+	}
+
+	// Adds the three settings, advertised to the online service and to pings
+	MULTIPLAYERSESSIONS_API void Write(const FMultiplayerSessionAttributes& Attributes, FOnlineSessionSettings& OutSettings);
+	// false if the session doesn't advertise the schema (e.g. another game, or an old build of this one)
+	MULTIPLAYERSESSIONS_API bool Read(const FOnlineSessionSettings& Settings, FMultiplayerSessionAttributes& OutAttributes);
+
+	MULTIPLAYERSESSIONS_API int32 GetLocalBuildVersion();
+}
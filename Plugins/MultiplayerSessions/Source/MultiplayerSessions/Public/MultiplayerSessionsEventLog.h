@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Extra: Off in Shipping. The MULTIPLAYERSESSIONS_EVENT macros compile to nothing then.
+#ifndef MULTIPLAYERSESSIONS_WITH_EVENT_LOG
+#define MULTIPLAYERSESSIONS_WITH_EVENT_LOG !UE_BUILD_SHIPPING
+#endif
+
+enum class EMultiplayerSessionOp : uint8;
+
+// What a record is about. ResultCode and Value mean what the comment says (0 when not used).
+enum class EMultiplayerSessionsEvent : uint8
+{
+	OpQueued,
+	OpCoalesced,
+	OpStarted,
+	OpFinished,       // ResultCode: EMultiplayerSessionOpStatus, Value: queue + run time (ms)
+	JoinResult,       // ResultCode: EOnJoinSessionCompleteResult::Type
+	SearchBatch,      // ResultCode: 1 if last batch, Value: results in the batch
+	QuickJoin,        // ResultCode: 0 cache miss, 1 hit, 2 stale hit
+	QosProbe,         // ResultCode: hosts probed, Value: best host RTT (ms)
+	BuildMismatch,    // Value: build version of the rejected session
+	QosResponder,     // ResultCode: 1 started, 0 stopped
+	MenuHost,
+	MenuJoin,
+	MenuStart,
+	Travel,           // ResultCode: 1 server travel, 0 client travel
+
+	MAX
+};
+
+struct FMultiplayerSessionsEventRecord
+{
+	uint64 Sequence{ 0 };
+	double Time{ 0.0 }; // FPlatformTime::Seconds
+	FName SessionName;
+	int32 ResultCode{ 0 };
+	int32 Value{ 0 };
+	uint32 OpId{ 0 };
+	uint32 ThreadId{ 0 };
+	EMultiplayerSessionsEvent Event{ EMultiplayerSessionsEvent::MAX };
+	uint8 Op{ 0xFF }; // EMultiplayerSessionOp, 0xFF: none
+};
+
+#if MULTIPLAYERSESSIONS_WITH_EVENT_LOG
+
+/**
+ * Extra: Last session events of this process, in a fixed ring of typed records. Nothing is allocated or formatted when
+ * an event is recorded, and any thread can record: a writer claims a slot with one atomic increment and stamps it
+ * (seqlock), a reader skips the slots being written. Old records are overwritten.
+ *
+ * Read it with "MultiplayerSessions.EventLog [N]", on a crash (dumped to the log), or on screen as events happen with
+ * "MultiplayerSessions.EventLog.Screen 1".
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerSessionsEventLog
+{
+public:
+	static constexpr uint32 Capacity{ 1024 }; // Power of two
+
+	static void Record(EMultiplayerSessionsEvent Event, FName SessionName, int32 ResultCode = 0, int32 Value = 0);
+	static void RecordOp(EMultiplayerSessionsEvent Event, EMultiplayerSessionOp Op, uint32 OpId, int32 ResultCode = 0, int32 Value = 0);
+
+	// The last MaxRecords records, oldest first. Records being written meanwhile are left out.
+	static void Snapshot(TArray<FMultiplayerSessionsEventRecord>& OutRecords, int32 MaxRecords = Capacity, uint64 AfterSequence = 0);
+	static void Dump(FOutputDevice& Ar, int32 MaxRecords = Capacity);
+	static FString ToString(const FMultiplayerSessionsEventRecord& Record, double Now);
+
+	// Called by the module
+	static void Startup();
+	static void Shutdown();
+};
+
+#define MULTIPLAYERSESSIONS_EVENT(Event, ...) FMultiplayerSessionsEventLog::Record(EMultiplayerSessionsEvent::Event, ##__VA_ARGS__)
+#define MULTIPLAYERSESSIONS_OP_EVENT(Event, ...) FMultiplayerSessionsEventLog::RecordOp(EMultiplayerSessionsEvent::Event, ##__VA_ARGS__)
+
+#else
+
+#define MULTIPLAYERSESSIONS_EVENT(...) ((void)0)
+#define MULTIPLAYERSESSIONS_OP_EVENT(...) ((void)0)
+
+#endif
@@ -6,8 +6,17 @@
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "Interfaces/OnlineSessionInterface.h" // To use IOnlineSessionPtr
 #include "FindSessionsCallbackProxy.h" // FBlueprintSessionResult
+#include "Containers/Ticker.h" // FTSTicker
+#include "Async/Future.h" // TPromise, TSharedFuture
+#include "MultiplayerSessionsAttributes.h" // FMultiplayerSessionAttributes, FMultiplayerSessionFilter
 #include "MultiplayerSessionsSubsystem.generated.h"
 
+class FMultiplayerSessionsPreloader;
+class FMultiplayerSessionsQosProber;
+class FMultiplayerSessionsQosResponder;
+struct FMultiplayerSessionsQosResult;
+class FInternetAddr;
+
 //
 // Teacher comment:
 // Declaring our own custom delegate for the Menu class to bind callbacks to
@@ -33,6 +42,13 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnCreateSessionComplete,
 //
 DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnFindSessionComplete, const TArray<FOnlineSessionSearchResult>& SearchResults, bool bWasSuccessful); // I can change to FBlueprintSessionResult (must include "FindSessionsCallbackProxy.h")
 
+//
+// Extra: Streaming version of FindSessions. Broadcast with each batch of new results while the search is still running,
+// so the Menu can join the first good session without waiting for the whole list. bIsLastBatch is true once the search
+// is over (the batch can be empty). Not DYNAMIC for the same reason as above.
+//
+DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnFindSessionsBatch, const TArray<FOnlineSessionSearchResult>& Batch, bool bIsLastBatch);
+
 //
 // This delegate cannot use DYNAMIC because EOnJoinSessionCompleteResult::Type is not compatible with Blueprints,
 // because EOnJoinSessionCompleteResult::Type is not a UENUM. Remember: DYNAMIC only works with U macros to maintain
@@ -52,10 +68,110 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnDestroySessionComplete
 //
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnStartSessionComplete, bool, bWasSuccessful);
 
+//
+// Extra: Operations of the subsystem. They go through a queue (see UMultiplayerSessionsSubsystem::EnqueueSessionOp).
+//
+UENUM(BlueprintType)
+enum class EMultiplayerSessionOp : uint8
+{
+	Create,
+	Find,
+	Join,
+	Destroy,
+	Start,
+
+	MAX UMETA(Hidden)
+};
+
+UENUM(BlueprintType)
+enum class EMultiplayerSessionOpStatus : uint8
+{
+	Succeeded,
+	Failed,
+	TimedOut,
+	Canceled
+};
+
+//
+// Extra: What the future of a queued operation resolves to. Not a USTRUCT because of EOnJoinSessionCompleteResult.
+//
+struct FMultiplayerSessionOpResult
+{
+	EMultiplayerSessionOp Op{ EMultiplayerSessionOp::Create };
+	EMultiplayerSessionOpStatus Status{ EMultiplayerSessionOpStatus::Failed };
+
+	// Join only
+	FString Address;
+	EOnJoinSessionCompleteResult::Type JoinResult{ EOnJoinSessionCompleteResult::UnknownError };
+
+	// Seconds waiting in the queue, and seconds running (from the call to the online service to its callback)
+	double QueueTime{ 0.0 };
+	double RunTime{ 0.0 };
+
+	bool WasSuccessful() const { return Status == EMultiplayerSessionOpStatus::Succeeded; }
+};
+
+// Extra: Handle of a queued operation. Shared, because coalesced requests get the same one.
+using FMultiplayerSessionOpFuture = TSharedFuture<FMultiplayerSessionOpResult>;
+
+//
+// Extra: Numbers of the session cache and of QuickJoin. See UMultiplayerSessionsSubsystem::GetSessionCacheStats and
+// the "MultiplayerSessions.CacheStats" console command.
+//
+USTRUCT(BlueprintType)
+struct FMultiplayerSessionsCacheStats
+{
+	GENERATED_BODY()
+
+	// QuickJoin found results younger than SessionCacheTTL
+	UPROPERTY(BlueprintReadOnly)
+	int32 Hits{ 0 };
+
+	// QuickJoin found results older than SessionCacheTTL. They were used anyway, and refreshed in the background.
+	UPROPERTY(BlueprintReadOnly)
+	int32 StaleHits{ 0 };
+
+	// QuickJoin found nothing cached and had to wait for a search
+	UPROPERTY(BlueprintReadOnly)
+	int32 Misses{ 0 };
+
+	// Searches started by the refresh timer
+	UPROPERTY(BlueprintReadOnly)
+	int32 BackgroundRefreshes{ 0 };
+
+	// Successful QuickJoins, split by where the joined session came from
+	UPROPERTY(BlueprintReadOnly)
+	int32 JoinsFromCache{ 0 };
+	UPROPERTY(BlueprintReadOnly)
+	int32 JoinsFromSearch{ 0 };
+
+	// Time to join: from the QuickJoin call to the join completing (seconds)
+	UPROPERTY(BlueprintReadOnly)
+	double LastTimeToJoin{ 0.0 };
+	UPROPERTY(BlueprintReadOnly)
+	double TotalTimeToJoinFromCache{ 0.0 };
+	UPROPERTY(BlueprintReadOnly)
+	double TotalTimeToJoinFromSearch{ 0.0 };
+
+	// Search results of another build, dropped before anything tried to join them
+	UPROPERTY(BlueprintReadOnly)
+	int32 BuildMismatchesRejected{ 0 };
+
+	// QoS probes run by QuickJoin, and the last one: how long it took, and what the host it picked measured
+	UPROPERTY(BlueprintReadOnly)
+	int32 QosProbes{ 0 };
+	UPROPERTY(BlueprintReadOnly)
+	double LastQosProbeTime{ 0.0 };
+	UPROPERTY(BlueprintReadOnly)
+	float LastChosenHostRttMs{ 0.f };
+	UPROPERTY(BlueprintReadOnly)
+	float LastChosenHostLoss{ 0.f };
+};
+
 /**
  *
  */
-UCLASS()
+UCLASS(Config=Game)
 class MULTIPLAYERSESSIONS_API UMultiplayerSessionsSubsystem : public UGameInstanceSubsystem
 {
 	GENERATED_BODY()
@@ -69,14 +185,81 @@ public:
 	//
 	UFUNCTION(BlueprintCallable)
 	void CreateSession(const int32 NumPublicConnections, const FString& MatchType);
+	//
+	// Extra: The MatchType filter (and any ExtraQuerySettings) goes to the online service in QuerySettings, so it does the
+	// filtering and we only receive sessions we can join. MaxSearchResults is clamped to MaxSearchPageSize.
+	// Empty MatchType: any match type.
+	//
+	UFUNCTION(BlueprintCallable)
+	void FindSessions(const int32 MaxSearchResults, const FString& MatchType);
+	void FindSessions(const int32 MaxSearchResults, const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings);
 	UFUNCTION(BlueprintCallable)
-	void FindSessions(const int32 MaxSearchResults);
+	void CancelFindSessions();
 	void JoinSession(const FOnlineSessionSearchResult& SessionResult);
+	//
+	// Extra: Joins the best session of the given MatchType, answering through MultiplayerOnJoinSessionComplete only.
+	// If the session cache has results for this query, its best ones (lowest ping, then most open slots) are candidates
+	// right away, and the entry is refreshed in the background if it's stale. If not, a search runs and the best sessions
+	// of its first batch are. The top QosProbeCandidates are pinged over UDP at once, and joined in order of measured
+	// RTT, loss and free slots (see ScoreQosResult). Failed candidates are skipped until none is left (SessionDoesNotExist).
+	//
+	UFUNCTION(BlueprintCallable)
+	void QuickJoin(const FString& MatchType);
+	void QuickJoin(const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings);
+	// Extra: Fills the cache for this query in the background (e.g. when the menu opens), so the next QuickJoin is a hit
+	UFUNCTION(BlueprintCallable)
+	void PrefetchSessions(const FString& MatchType);
+	UFUNCTION(BlueprintCallable)
+	void InvalidateSessionCache();
+	UFUNCTION(BlueprintPure)
+	FMultiplayerSessionsCacheStats GetSessionCacheStats() const { return SessionCacheStats; }
+	void LogSessionCacheStats() const;
 	UFUNCTION(BlueprintCallable)
 	void DestroySession();
 	UFUNCTION(BlueprintCallable)
 	void StartSession();
 
+	//
+	// Extra: The functions above go through an operation queue, and these return its handle. Create/Join/Destroy/Start
+	// run one after the other (they all work on the same named session). Searches run in their own lane, so they overlap
+	// with them. A request equal to the last one queued in its lane (e.g. a double click) is coalesced: same future.
+	// Every operation has a timeout (see CreateSessionTimeout...). The delegates above are broadcast as before.
+	//
+	FMultiplayerSessionOpFuture QueueCreateSession(const int32 NumPublicConnections, const FString& MatchType);
+	FMultiplayerSessionOpFuture QueueFindSessions(const int32 MaxSearchResults, const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings = FOnlineSearchSettings());
+	FMultiplayerSessionOpFuture QueueJoinSession(const FOnlineSessionSearchResult& SessionResult);
+	FMultiplayerSessionOpFuture QueueDestroySession();
+	FMultiplayerSessionOpFuture QueueStartSession();
+	// Operations queued or running, both lanes
+	int32 GetSessionOpQueueDepth() const { return SessionOpLane.Num() + SearchOpLane.Num(); }
+	void LogSessionOpStats() const;
+	// Extra: Started with -MockSessions (see FMockOnlineSession)
+	bool IsUsingMockSessionBackend() const { return bUsingMockSessionBackend; }
+	//
+	// Extra: Map the next travel goes to (e.g. the lobby). Its dependencies are streamed in as soon as a session is created
+	// or searched for, so loading overlaps the session round trip (see FMultiplayerSessionsPreloader).
+	//
+	UFUNCTION(BlueprintCallable)
+	void SetTravelMap(const FString& MapPath) { TravelMap = MapPath; }
+
+	//
+	// Extra: Typed session attributes (see FMultiplayerSessionAttributes). Match types and maps are names at this edge and
+	// ids on the wire: a name's id is its position in MatchTypes/SessionMaps (config), plus 1. The filter applies to the
+	// searches queued after it's set (FindSessions, QuickJoin, PrefetchSessions).
+	//
+	UFUNCTION(BlueprintCallable)
+	void SetSkillBand(const uint8 InSkillBand) { SkillBand = FMath::Min(InSkillBand, MultiplayerSessionsAttributes::MaxSkillBand); }
+	UFUNCTION(BlueprintCallable)
+	void SetSessionFilter(const FMultiplayerSessionFilter& Filter) { SessionFilter = Filter; }
+	UFUNCTION(BlueprintPure)
+	FMultiplayerSessionFilter GetSessionFilter() const { return SessionFilter; }
+	// 0: empty name (any match type). INDEX_NONE: not in MatchTypes.
+	UFUNCTION(BlueprintPure)
+	int32 GetMatchTypeId(const FString& MatchType) const;
+	UFUNCTION(BlueprintPure)
+	FString GetMatchTypeName(const int32 MatchTypeId) const { return MatchTypes.IsValidIndex(MatchTypeId - 1) ? MatchTypes[MatchTypeId - 1] : FString(); }
+	static bool GetSessionAttributes(const FOnlineSessionSearchResult& Result, FMultiplayerSessionAttributes& OutAttributes);
+
 	//
 	// Teacher comment:
 	// Our own custom delegates for the Menu class to bind callbacks to
@@ -87,22 +270,31 @@ public:
 	// Not Dynamic Multicast Delegate
 	FMultiplayerOnFindSessionComplete MultiplayerOnFindSessionComplete;
 	// Not Dynamic Multicast Delegate
+	FMultiplayerOnFindSessionsBatch MultiplayerOnFindSessionsBatch;
+	// Not Dynamic Multicast Delegate
 	FMultiplayerOnJoinSessionComplete MultiplayerOnJoinSessionComplete;
 	// Dynamic Multicast Delegate
 	FMultiplayerOnDestroySessionComplete MultiplayerOnDestroySessionComplete;
 	// Dynamic Multicast Delegate
 	FMultiplayerOnStartSessionComplete MultiplayerOnStartSessionComplete;
 
-	// Extra: const key of MatchType
+	// Extra: const key of MatchType. It's an int32 id now (see MultiplayerSessionsAttributes).
 	// const FName MatchTypeKey = FName("MatchType");
 	// 
 	// Some info about list initialization:
 	// https://stackoverflow.com/questions/47861532/use-curly-braces-or-equal-sign-when-initialize-a-variable
 	// https://stackoverflow.com/questions/18222926/what-are-the-advantages-of-list-initialization-using-curly-braces
 	// https://herbsutter.com/2013/08/12/gotw-94-solution-aaa-style-almost-always-auto/
-	const FName MatchTypeKey{ TEXT("MatchType") };
+	const FName MatchTypeKey{ MultiplayerSessionsAttributes::MatchTypeKey };
+
+	// Extra: Upper bound for a single search. Asking Steam for more than this only costs time and memory.
+	static constexpr int32 MaxSearchPageSize{ 50 };
+	// Extra: How many results go in each MultiplayerOnFindSessionsBatch broadcast
+	static constexpr int32 SearchBatchSize{ 10 };
 
 protected:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
 
 	//
 	// Teacher comment:
@@ -116,19 +308,263 @@ protected:
 	void OnStartSessionComplete(FName SessionName, bool bWasSuccessful);
 
 private:
+	//
+	// Extra: Resolved on first use, not when the game instance starts (Steam starts with the online subsystem, and
+	// most launches reach the main menu long before anyone hosts or joins). The menu's prefetch is usually that first
+	// use, and it waits SessionInterfaceResolveDelay so the menu is on screen first. Only tried once per game instance.
+	//
 	IOnlineSessionPtr SessionInterface;
+	bool bSessionInterfaceResolveAttempted{ false };
+	bool bUsingMockSessionBackend{ false };
+	// Online subsystem the session interface came from ("Mock" for the mock backend), None until resolved
+	FName SessionServiceName;
+	bool ResolveSessionInterface();
+	UPROPERTY(Config)
+	float SessionInterfaceResolveDelay{ 0.1f };
+	FTSTicker::FDelegateHandle DeferredPrefetchHandle;
+
+	// Extra: Travel map preloading. Off: the map loads when the travel starts, as before.
+	UPROPERTY(Config)
+	bool bPreloadTravelMap{ true };
+	FString TravelMap;
+	TSharedPtr<FMultiplayerSessionsPreloader> Preloader;
+	void PreloadTravelMap();
 	TSharedPtr<FOnlineSessionSettings> LastSessionSettings;
 	TSharedPtr<FOnlineSessionSearch> LastSessionSearch;
 
+	// Extra: Session attributes. Index + 1 is the id advertised.
+	UPROPERTY(Config)
+	TArray<FString> MatchTypes;
+	UPROPERTY(Config)
+	TArray<FString> SessionMaps;
+	// Region advertised by the sessions we create (0: unknown)
+	UPROPERTY(Config)
+	uint8 Region{ 0 };
+	uint8 SkillBand{ 0 };
+	FMultiplayerSessionFilter SessionFilter;
+	uint8 GetSessionMapId(const FString& MapPath) const;
+
 	// Extra: Helper function to define if the creation of a session
-	// should be LAN or online.
-	static bool ShouldBeLanMatch();
+	// should be LAN or online. Asks the service the session interface was resolved from.
+	bool ShouldBeLanMatch() const;
 
 	// Extra: Get Preferred Unique Net User Id
 	const FUniqueNetId& GetPreferredUniqueNetId() const;
 
 	// Extra: Gets current session, if there's one
 	FNamedOnlineSession* GetCurrentGameSession() const;
+
+	//
+	// Extra: Operation queue. Each lane runs its first operation, and the next one starts when it finishes
+	// (FinishSessionOp), either from the online service callback, a failure to start, a timeout or a cancel.
+	//
+	struct FSessionOperation
+	{
+		uint32 Id{ 0 };
+		EMultiplayerSessionOp Type{ EMultiplayerSessionOp::Create };
+		FString Key; // Coalescing: same type, key and flags as the last queued operation
+		// Calls the online service. false: failed to start. true: running, or already finished (nothing to do).
+		TFunction<bool()> Start;
+		TPromise<FMultiplayerSessionOpResult> Promise;
+		FMultiplayerSessionOpFuture Future;
+		double QueuedTime{ 0.0 };
+		double StartTime{ 0.0 };
+		float Timeout{ 0.f };
+		bool bRunning{ false };
+		bool bFinished{ false };
+		// Find only. Internal: started by QuickJoin or the cache, doesn't broadcast. Background: yields to everything else.
+		bool bInternal{ false };
+		bool bBackground{ false };
+		FString CacheKey;
+	};
+	using FSessionOperationRef = TSharedRef<FSessionOperation>;
+	TArray<FSessionOperationRef> SessionOpLane;
+	TArray<FSessionOperationRef> SearchOpLane;
+	uint32 LastSessionOpId{ 0 };
+
+	TArray<FSessionOperationRef>& GetSessionOpLane(const EMultiplayerSessionOp Type) { return Type == EMultiplayerSessionOp::Find ? SearchOpLane : SessionOpLane; }
+	FSessionOperation* FindCoalescableSessionOp(EMultiplayerSessionOp Type, const FString& Key, bool bInternal = false, bool bBackground = false);
+	FMultiplayerSessionOpFuture EnqueueSessionOp(EMultiplayerSessionOp Type, const FString& Key, TFunction<bool()>&& Start);
+	FMultiplayerSessionOpFuture EnqueueSessionOp(const FSessionOperationRef& Op);
+	void StartNextSessionOp(TArray<FSessionOperationRef>& Lane);
+	void FinishSessionOp(EMultiplayerSessionOp Type, EMultiplayerSessionOpStatus Status, const FString& Address = FString(), EOnJoinSessionCompleteResult::Type JoinResult = EOnJoinSessionCompleteResult::UnknownError);
+	void HandleFinishedSessionOp(const FSessionOperation& Op, const FMultiplayerSessionOpResult& Result);
+	void CancelQueuedSessionOp(const FSessionOperationRef& Op);
+	void AbortRunningSessionOp(const FSessionOperation& Op);
+	void CancelAllSessionOps();
+	bool TickSessionOps(float DeltaTime);
+	FTSTicker::FDelegateHandle SessionOpTickerHandle;
+	float GetSessionOpTimeout(EMultiplayerSessionOp Type) const;
+	static FMultiplayerSessionOpFuture MakeFinishedSessionOp(EMultiplayerSessionOp Type, EMultiplayerSessionOpStatus Status);
+
+	// Start functions of each operation
+	bool StartCreateSession(int32 NumPublicConnections, const FString& MatchType);
+	bool StartFindSessions(int32 MaxSearchResults, const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings, const FMultiplayerSessionFilter& Filter, bool bInternal);
+	bool StartJoinSession(const FOnlineSessionSearchResult& SessionResult);
+	bool StartDestroySession();
+	bool StartStartSession();
+
+	// Seconds before a running operation is given up (0: never)
+	UPROPERTY(Config)
+	float CreateSessionTimeout{ 15.f };
+	UPROPERTY(Config)
+	float FindSessionsTimeout{ 30.f };
+	UPROPERTY(Config)
+	float JoinSessionTimeout{ 20.f };
+	UPROPERTY(Config)
+	float DestroySessionTimeout{ 10.f };
+	UPROPERTY(Config)
+	float StartSessionTimeout{ 10.f };
+
+	// Per operation type: outcomes and latency (queue wait + run)
+	struct FSessionOpStats
+	{
+		int32 Queued{ 0 };
+		int32 Coalesced{ 0 };
+		int32 Succeeded{ 0 };
+		int32 Failed{ 0 };
+		int32 TimedOut{ 0 };
+		int32 Canceled{ 0 };
+		double TotalQueueTime{ 0.0 };
+		double TotalRunTime{ 0.0 };
+		double MaxLatency{ 0.0 };
+	};
+	FSessionOpStats SessionOpStats[static_cast<int32>(EMultiplayerSessionOp::MAX)];
+	int32 MaxSessionOpQueueDepth{ 0 };
+
+	// Extra: Streams the results of the running search in batches (see MultiplayerOnFindSessionsBatch)
+	bool TickSearchResultsStream(float DeltaTime);
+	void BroadcastNewSearchResults(bool bIsLastBatch);
+	void StopSearchResultsStream();
+	FTSTicker::FDelegateHandle SearchResultsStreamHandle;
+	int32 NumSearchResultsStreamed{ 0 };
+	// Results of the running search that passed MatchesSearch while streamed. The cache takes them as they are.
+	TArray<FOnlineSessionSearchResult> LastSearchMatches;
+	FString LastSearchMatchType;
+	FOnlineSearchSettings LastSearchExtraQuerySettings;
+	FMultiplayerSessionFilter LastSearchFilter;
+	FString LastSearchCacheKey;
+	// Extra: Internal searches (QuickJoin and background refreshes) only feed the cache and QuickJoin, and don't broadcast
+	// MultiplayerOnFindSessionsBatch/MultiplayerOnFindSessionComplete (the Menu would think the player asked for them)
+	bool bLastSearchIsInternal{ false };
+
+	FMultiplayerSessionOpFuture QueueSessionSearch(int32 MaxSearchResults, const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings, const FMultiplayerSessionFilter& Filter, bool bInternal, bool bBackground);
+	void HandleSearchBatch(const TArray<FOnlineSessionSearchResult>& Batch, bool bIsLastBatch);
+	void HandleFinishedSearch(const FSessionOperation& Op, EMultiplayerSessionOpStatus Status);
+
+	//
+	// Extra: The last search's filter, compiled to integers once, so each result costs a few map lookups and compares.
+	// Checked again here because the LAN (NULL) subsystem ignores QuerySettings.
+	//
+	struct FCompiledSessionQuery
+	{
+		int32 BuildVersion{ 0 };
+		int32 MatchType{ 0 }; // 0: any
+		int32 InfoMask{ 0 };
+		int32 InfoValue{ 0 };
+		int32 MinSkillBand{ 0 };
+		int32 MaxSkillBand{ MultiplayerSessionsAttributes::MaxSkillBand };
+		int32 MinOpenSlots{ 1 };
+	};
+	FCompiledSessionQuery LastSearchQuery;
+	void CompileSessionQuery(int32 MatchTypeId, const FMultiplayerSessionFilter& Filter, FCompiledSessionQuery& OutQuery) const;
+	// OutBuildVersion: the build the result advertises (0 if none), for the caller to count other builds once
+	bool MatchesSearch(const FOnlineSessionSearchResult& Result, int32& OutBuildVersion) const;
+	bool IsSearchQueued(const FString& CacheKey) const;
+
+	//
+	// Extra: Session cache. Results of every successful search, ranked, per query (see MakeSessionCacheKey).
+	// Entries older than SessionCacheTTL are stale: still used by QuickJoin, but refreshed. Entries nobody used for
+	// SessionCacheMaxIdleTime are dropped instead of refreshed.
+	//
+	struct FSessionCacheEntry
+	{
+		FString MatchType;
+		FOnlineSearchSettings ExtraQuerySettings;
+		FMultiplayerSessionFilter Filter;
+		TArray<FOnlineSessionSearchResult> Results; // Best first (see RankSessionResults)
+		double FetchTime{ 0.0 };
+		double LastUsedTime{ 0.0 };
+	};
+	TMap<FString, FSessionCacheEntry> SessionCache;
+
+	UPROPERTY(Config)
+	float SessionCacheTTL{ 30.f };
+	// How often the refresh timer looks for entries about to go stale (seconds). At most one search per tick.
+	UPROPERTY(Config)
+	float SessionCacheRefreshInterval{ 10.f };
+	UPROPERTY(Config)
+	float SessionCacheMaxIdleTime{ 300.f };
+
+	FString MakeSessionCacheKey(const FString& MatchType, const FOnlineSearchSettings& ExtraQuerySettings, const FMultiplayerSessionFilter& Filter) const;
+	void UpdateSessionCache();
+	bool TickSessionCacheRefresh(float DeltaTime);
+	bool CanSearchInBackground() const;
+	FTSTicker::FDelegateHandle SessionCacheRefreshHandle;
+	static void RankSessionResults(TArray<FOnlineSessionSearchResult>& Results);
+
+	//
+	// Extra: QuickJoin state
+	//
+	void ContinueQuickJoin(EOnJoinSessionCompleteResult::Type FailureResult);
+	void JoinQuickJoinCandidate(const FOnlineSessionSearchResult& Candidate, bool bFromCache);
+	const FOnlineSessionSearchResult* PickQuickJoinCandidate(const TArray<FOnlineSessionSearchResult>& RankedResults) const;
+	void HandleJoinSessionResult(const FString& Address, EOnJoinSessionCompleteResult::Type Result);
+	FString QuickJoinKey;
+	TSet<FString> QuickJoinTriedSessions; // Session ids, so a candidate that failed isn't tried again
+	// Probed candidates, best first, with what they measured. Joined in this order before going back to the cache.
+	struct FProbedCandidate
+	{
+		FOnlineSessionSearchResult Result;
+		float RttMs{ 0.f };
+		float Loss{ 0.f };
+		float Score{ 0.f };
+	};
+	TArray<FProbedCandidate> QuickJoinProbedCandidates;
+	double QuickJoinStartTime{ 0.0 };
+	bool bQuickJoinPending{ false };
+	bool bQuickJoinInFlight{ false }; // A JoinSession call is running
+	bool bQuickJoinSearched{ false }; // A search for QuickJoinKey started after the QuickJoin call
+	bool bQuickJoinCandidateFromCache{ false };
+	float QuickJoinCandidateRttMs{ 0.f };
+	float QuickJoinCandidateLoss{ 0.f };
+
+	//
+	// Extra: QoS probing of the QuickJoin candidates (see FMultiplayerSessionsQosProber). A host answers the probes while
+	// it has a session (FMultiplayerSessionsQosResponder on QosPort).
+	//
+	void ProbeQuickJoinCandidates(const TArray<FOnlineSessionSearchResult>& RankedResults, bool bFromCache);
+	bool TickQosProbe(float DeltaTime);
+	void CancelQosProbe();
+	float ScoreQosResult(const FOnlineSessionSearchResult& Candidate, const FMultiplayerSessionsQosResult& Result) const;
+	TSharedPtr<FInternetAddr> ResolveQosAddress(const FOnlineSessionSearchResult& Candidate) const;
+	void StartQosResponder();
+	TSharedPtr<FMultiplayerSessionsQosProber> QosProber;
+	TSharedPtr<FMultiplayerSessionsQosResponder> QosResponder;
+	FTSTicker::FDelegateHandle QosProbeHandle;
+
+	// Candidates pinged at once. 0: no probing, join in search order.
+	UPROPERTY(Config)
+	int32 QosProbeCandidates{ 4 };
+	UPROPERTY(Config)
+	int32 QosProbesPerHost{ 5 };
+	UPROPERTY(Config)
+	float QosProbeIntervalMs{ 20.f };
+	// Wait for the last replies. Also the worst case the probing adds to a QuickJoin: ProbesPerHost * Interval + this.
+	UPROPERTY(Config)
+	float QosProbeTimeoutMs{ 250.f };
+	// UDP port of the responder, on every host
+	UPROPERTY(Config)
+	int32 QosPort{ 7787 };
+	// Score = RTT + loss (0..1) * QosLossPenaltyMs - free slots * QosFreeSlotBonusMs (capped at QosMaxSlotBonus slots)
+	UPROPERTY(Config)
+	float QosLossPenaltyMs{ 200.f };
+	UPROPERTY(Config)
+	float QosFreeSlotBonusMs{ 5.f };
+	UPROPERTY(Config)
+	int32 QosMaxSlotBonus{ 8 };
+
+	FMultiplayerSessionsCacheStats SessionCacheStats;
 	
 	//
 	// Teacher comment:
@@ -145,8 +581,4 @@ private:
 	FDelegateHandle DestroySessionCompleteDelegateHandle;
 	FOnStartSessionCompleteDelegate StartSessionCompleteDelegate;
 	FDelegateHandle StartSessionCompleteDelegateHandle;
-
-	bool bCreateSessionOnDestroy;
-	int32 LastNumPublicConnections;
-	FString LastMatchType;
 };
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h" // Who needs: UE_TRACE_CHANNEL_EXTERN
+#include "ProfilingDebugging/CpuProfilerTrace.h" // Who needs: TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR
+
+//
+// Extra: Trace channel of the plugin. Enable it with -trace=default,MultiplayerSessions (or "Trace.Enable MultiplayerSessions").
+//
+UE_TRACE_CHANNEL_EXTERN(MultiplayerSessionsChannel, MULTIPLAYERSESSIONS_API);
+
+// Extra: CPU timing scope on the MultiplayerSessions channel (Timing Insights, needs the cpu channel too)
+#define MULTIPLAYERSESSIONS_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR(Name, MultiplayerSessionsChannel)
+
+// What the player is waiting for, from the click to standing in the new map
+enum class EMultiplayerSessionsFlow : uint8
+{
+	Host,
+	Join
+};
+
+/**
+ * Session lifecycle tracing. A flow starts on a Menu click, every step of the way marks a phase, and the flow ends when
+ * the new map is loaded (or something fails).
+ *
+ * Each phase is a bookmark and a timing region in Insights ("Host: CreateSessionStarted" lasts until the next phase),
+ * and a LifecyclePhase event on the MultiplayerSessions channel. Phase durations are also kept in memory, so headless
+ * runs can write their percentiles as CSV (Saved/Profiling/SessionLifecycle.csv) with "MultiplayerSessions.LifecycleReport"
+ * or on shutdown.
+ *
+ * Only one flow at a time: there's one local player clicking.
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerSessionsTrace
+{
+public:
+	// Starts a flow. A flow still running is ended as abandoned.
+	static void BeginFlow(EMultiplayerSessionsFlow Flow, const TCHAR* FirstPhase);
+
+	// Marks a phase of the running flow. Does nothing without one (e.g. background searches from the menu).
+	static void Phase(const TCHAR* PhaseName);
+
+	static void EndFlow(bool bSucceeded, const TCHAR* LastPhase);
+
+	static bool IsFlowRunning();
+
+	// Logs the percentiles of each phase and writes them as CSV to the profiling folder
+	static void WriteReport();
+
+	// Called by the module
+	static void Startup();
+	static void Shutdown();
+};
@@ -0,0 +1,57 @@
+#!/usr/bin/env bash
+# Load test: one server and N headless clients on this machine, over the IP net driver (no Steam).
+# Each client runs a UBlasterLoadTestSubsystem bot, the server writes Saved/Profiling/LoadTest_*.csv.
+#
+# Usage: UE_EDITOR=/path/to/UnrealEditor Scripts/LoadTest.sh [Clients] [Seconds] [Map] [listen|dedicated]
+#   Clients   Bots to start (default 8)
+#   Seconds   How long the server measures before it exits (default 120)
+#   Map       Default /Game/Maps/Lobby
+# PKTLAG=<ms> adds that much latency to every client's packets (e.g. PKTLAG=60 for ~120 ms of ping), to see
+# movement corrections under realistic conditions. Needs a non-shipping build.
+#
+# The clients are -nullrhi -nosound, so a few dozen fit on one machine. They compete with the server for CPU:
+# compare runs made on the same machine with the same number of clients.
+
+set -euo pipefail
+
+CLIENTS=${1:-8}
+SECONDS_TO_RUN=${2:-120}
+MAP=${3:-/Game/Maps/Lobby}
+MODE=${4:-listen}
+PORT=${PORT:-7777}
+PKTLAG=${PKTLAG:-0}
+
+PROJECT="$(cd "$(dirname "$0")/.." && pwd)/Blaster.uproject"
+EDITOR=${UE_EDITOR:?Set UE_EDITOR to the UnrealEditor (or UnrealEditor-Cmd) executable}
+COMMON=(-game -nosteam -unattended -nosplash -NoVerifyGC -log)
+
+PIDS=()
+cleanup()
+{
+	for PID in "${PIDS[@]}"; do kill "$PID" 2>/dev/null || true; done
+}
+trap cleanup EXIT
+
+if [ "$MODE" = "dedicated" ]; then
+	"$EDITOR" "$PROJECT" "$MAP" -server "${COMMON[@]}" -nullrhi -Port="$PORT" \
+		-LoadTest -LoadTestDuration="$SECONDS_TO_RUN" -log=LoadTestServer.log &
+else
+	"$EDITOR" "$PROJECT" "$MAP?listen" "${COMMON[@]}" -windowed -ResX=640 -ResY=360 -Port="$PORT" \
+		-LoadTest -LoadTestDuration="$SECONDS_TO_RUN" -log=LoadTestServer.log &
+fi
+SERVER=$!
+PIDS+=("$SERVER")
+
+# Let the server load the map before the clients knock
+sleep 10
+
+for ((I = 0; I < CLIENTS; I++)); do
+	"$EDITOR" "$PROJECT" "127.0.0.1:$PORT" "${COMMON[@]}" -nullrhi -nosound \
+		-LoadTestBot -LoadTestBotSeed="$I" -PktLag="$PKTLAG" -log="LoadTestClient$I.log" &
+	PIDS+=("$!")
+	sleep 0.5
+done
+
+# The server exits by itself after SECONDS_TO_RUN, the clients are killed on exit
+wait "$SERVER"
+echo "Done. Results in $(dirname "$PROJECT")/Saved/Profiling/"
@@ -10,6 +10,12 @@ public class Blaster : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput" });
 
+		// Replication graph (Net/BlasterReplicationGraph)
+		PublicDependencyModuleNames.AddRange(new string[] { "NetCore", "ReplicationGraph" });
+
+		// Animation budget (Character/BlasterAnimationBudgetSubsystem)
+		PublicDependencyModuleNames.Add("AnimationBudgetAllocator");
+
 		PrivateDependencyModuleNames.AddRange(new string[] {  });
 
 		// Uncomment if you are using Slate UI
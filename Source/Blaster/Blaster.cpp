@@ -2,5 +2,43 @@
 
 #include "Blaster.h"
 #include "Modules/ModuleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Blaster/Server/BlasterServerFootprint.h"
+#include "Blaster/Server/BlasterMemoryBudget.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Blaster, "Blaster" );
+DEFINE_LOG_CATEGORY(LogBlaster);
+
+LLM_DEFINE_TAG(Blaster);
+LLM_DEFINE_TAG(Blaster_Characters, NAME_None, TEXT("Blaster"));
+LLM_DEFINE_TAG(Blaster_Replay, NAME_None, TEXT("Blaster"));
+
+void BlasterProfiling::AppendCsvRow(const TCHAR* FileName, const TCHAR* Header, const FString& Row)
+{
+	const FString File = FPaths::Combine(FPaths::ProfilingDir(), FileName);
+
+	FString Text;
+	if (!FPaths::FileExists(File))
+		Text = FString(Header) + TEXT("\n");
+	Text += Row;
+
+	FFileHelper::SaveStringToFile(Text, *File, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+}
+
+class FBlasterGameModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		FBlasterServerFootprint::Startup();
+		FBlasterMemoryBudget::Startup();
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FBlasterMemoryBudget::Shutdown();
+		FBlasterServerFootprint::Shutdown();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FBlasterGameModule, Blaster, "Blaster" );
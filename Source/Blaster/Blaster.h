@@ -3,4 +3,23 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "HAL/LowLevelMemTracker.h" // Who needs: LLM_DECLARE_TAG
 
+DECLARE_LOG_CATEGORY_EXTERN(LogBlaster, Log, All);
+
+// Extra: Stat group for everything Blaster-specific. Use "stat Blaster" in the console to see it.
+DECLARE_STATS_GROUP(TEXT("Blaster"), STATGROUP_Blaster, STATCAT_Advanced);
+
+// Extra: Low-level memory tracker tags, so our allocations show up as Blaster/... in "-llm" runs (LLM Insights,
+// "stat LLMFULL", Blaster.MemBudget) instead of disappearing into the engine's buckets
+LLM_DECLARE_TAG(Blaster);
+LLM_DECLARE_TAG(Blaster_Characters);
+LLM_DECLARE_TAG(Blaster_Replay);
+
+namespace BlasterProfiling
+{
+	// Extra: Appends Row (newline included) to Saved/Profiling/FileName, after Header if the file is new. For the
+	// CSVs that keep one row per event across runs.
+	void AppendCsvRow(const TCHAR* FileName, const TCHAR* Header, const FString& Row);
+}
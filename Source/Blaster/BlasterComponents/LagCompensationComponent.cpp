@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationComponent.h"
+#include "Blaster.h" // Who needs: STATGROUP_Blaster
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Components/SkeletalMeshComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_BlasterLagCompensationRecord, STATGROUP_Blaster);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Rewind Query"), STAT_BlasterLagCompensationRewind, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Lag Compensation Rewind Queries"), STAT_BlasterLagCompensationRewindCount, STATGROUP_Blaster);
+DECLARE_MEMORY_STAT(TEXT("Lag Compensation History"), STAT_BlasterLagCompensationMemory, STATGROUP_Blaster);
+
+ULagCompensationComponent::ULagCompensationComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false; // Enabled on BeginPlay, only on the server
+	PrimaryComponentTick.TickGroup = TG_PostPhysics; // After movement and animation, so the bones are final for this frame
+
+	// UE4 Mannequin skeleton (AnimStarterPack)
+	HitBoxes = {
+		{ FName(TEXT("head")), FVector(12.f, 12.f, 14.f) },
+		{ FName(TEXT("pelvis")), FVector(18.f, 14.f, 12.f) },
+		{ FName(TEXT("spine_02")), FVector(18.f, 14.f, 14.f) },
+		{ FName(TEXT("spine_03")), FVector(20.f, 16.f, 14.f) },
+		{ FName(TEXT("upperarm_l")), FVector(16.f, 6.f, 6.f) },
+		{ FName(TEXT("upperarm_r")), FVector(16.f, 6.f, 6.f) },
+		{ FName(TEXT("lowerarm_l")), FVector(14.f, 5.f, 5.f) },
+		{ FName(TEXT("lowerarm_r")), FVector(14.f, 5.f, 5.f) },
+		{ FName(TEXT("thigh_l")), FVector(22.f, 8.f, 8.f) },
+		{ FName(TEXT("thigh_r")), FVector(22.f, 8.f, 8.f) },
+		{ FName(TEXT("calf_l")), FVector(22.f, 6.f, 6.f) },
+		{ FName(TEXT("calf_r")), FVector(22.f, 6.f, 6.f) },
+		{ FName(TEXT("foot_l")), FVector(10.f, 6.f, 5.f) },
+		{ FName(TEXT("foot_r")), FVector(10.f, 6.f, 5.f) },
+	};
+}
+
+void ULagCompensationComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Character = Cast<ABlasterCharacter>(GetOwner());
+	if (!Character || !Character->HasAuthority() || HitBoxes.IsEmpty()) return;
+
+	// Allocate the whole history once. Recording only overwrites slots from now on.
+	Capacity = FMath::CeilToInt32(MaxRecordTime * MaxRecordRate) + 1;
+	FrameTimes.SetNumZeroed(Capacity);
+	Samples.SetNumZeroed(Capacity * HitBoxes.Num());
+	NewestFrame = INDEX_NONE;
+	NumFrames = 0;
+
+	INC_MEMORY_STAT_BY(STAT_BlasterLagCompensationMemory, GetHistoryAllocatedSize());
+	SetComponentTickEnabled(true);
+}
+
+void ULagCompensationComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_MEMORY_STAT_BY(STAT_BlasterLagCompensationMemory, GetHistoryAllocatedSize());
+	FrameTimes.Empty();
+	Samples.Empty();
+	Capacity = 0;
+	NumFrames = 0;
+	NewestFrame = INDEX_NONE;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ULagCompensationComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	RecordFrame();
+}
+
+void ULagCompensationComponent::RecordFrame()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterLagCompensationRecord);
+
+	if (Capacity == 0 || !Character) return;
+	const USkeletalMeshComponent* Mesh = Character->GetMesh();
+	if (!Mesh) return;
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (NumFrames > 0 && FrameTimes[NewestFrame] == Now) return; // Already recorded this frame
+
+	NewestFrame = (NewestFrame + 1) % Capacity;
+	NumFrames = FMath::Min(NumFrames + 1, Capacity);
+	FrameTimes[NewestFrame] = Now;
+
+	const int32 NumHitBoxes = HitBoxes.Num();
+	FBlasterHitBoxSample* FrameSamples = &Samples[NewestFrame * NumHitBoxes];
+	for (int32 i = 0; i < NumHitBoxes; ++i)
+	{
+		const FTransform BoneTransform = Mesh->GetSocketTransform(HitBoxes[i].BoneName, RTS_World);
+		FrameSamples[i].Location = FVector3f(BoneTransform.GetLocation());
+		FrameSamples[i].Rotation = FQuat4f(BoneTransform.GetRotation());
+	}
+}
+
+bool ULagCompensationComponent::GetHitBoxTransformsAtTime(const double Time, TArray<FTransform>& OutTransforms) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterLagCompensationRewind);
+	INC_DWORD_STAT(STAT_BlasterLagCompensationRewindCount);
+
+	if (NumFrames == 0 || Time < FrameTimes[GetSlot(0)]) return false;
+
+	const int32 NumHitBoxes = HitBoxes.Num();
+	OutTransforms.SetNumUninitialized(NumHitBoxes, EAllowShrinking::No);
+
+	// Newer than anything we have: use the newest frame as it is
+	if (Time >= FrameTimes[NewestFrame])
+	{
+		const FBlasterHitBoxSample* FrameSamples = &Samples[NewestFrame * NumHitBoxes];
+		for (int32 i = 0; i < NumHitBoxes; ++i)
+		{
+			OutTransforms[i] = FTransform(FQuat(FrameSamples[i].Rotation), FVector(FrameSamples[i].Location));
+		}
+		return true;
+	}
+
+	// Binary search (by age, oldest first) for the last frame at or before Time
+	int32 Low = 0;
+	int32 High = NumFrames - 1;
+	while (High - Low > 1)
+	{
+		const int32 Mid = (Low + High) / 2;
+		if (FrameTimes[GetSlot(Mid)] <= Time) Low = Mid;
+		else High = Mid;
+	}
+
+	const int32 OlderSlot = GetSlot(Low);
+	const int32 YoungerSlot = GetSlot(High);
+	const double Range = FrameTimes[YoungerSlot] - FrameTimes[OlderSlot];
+	const float Alpha = Range > 0.0 ? static_cast<float>((Time - FrameTimes[OlderSlot]) / Range) : 0.f;
+
+	const FBlasterHitBoxSample* Older = &Samples[OlderSlot * NumHitBoxes];
+	const FBlasterHitBoxSample* Younger = &Samples[YoungerSlot * NumHitBoxes];
+	for (int32 i = 0; i < NumHitBoxes; ++i)
+	{
+		const FVector3f Location = FMath::Lerp(Older[i].Location, Younger[i].Location, Alpha);
+		const FQuat4f Rotation = FQuat4f::Slerp(Older[i].Rotation, Younger[i].Rotation, Alpha);
+		OutTransforms[i] = FTransform(FQuat(Rotation), FVector(Location));
+	}
+	return true;
+}
+
+double ULagCompensationComponent::GetOldestRecordedTime() const
+{
+	return NumFrames > 0 ? FrameTimes[GetSlot(0)] : 0.0;
+}
+
+double ULagCompensationComponent::GetNewestRecordedTime() const
+{
+	return NumFrames > 0 ? FrameTimes[NewestFrame] : 0.0;
+}
+
+SIZE_T ULagCompensationComponent::GetHistoryAllocatedSize() const
+{
+	return FrameTimes.GetAllocatedSize() + Samples.GetAllocatedSize();
+}
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "LagCompensationComponent.generated.h"
+
+class ABlasterCharacter;
+
+// A box attached to a bone of the character mesh, used for server-side hit validation
+USTRUCT(BlueprintType)
+struct FBlasterHitBox
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	FName BoneName;
+
+	UPROPERTY(EditAnywhere)
+	FVector BoxExtent{ 10.f, 10.f, 10.f };
+};
+
+// One hit box in one recorded frame. Kept in single precision: 28 bytes instead of the 96 of an FTransform.
+struct FBlasterHitBoxSample
+{
+	FVector3f Location;
+	FQuat4f Rotation;
+};
+
+/**
+ * Server-side rewind for hit validation.
+ *
+ * Every server tick the world transform of each hit box is recorded into a fixed-capacity ring buffer.
+ * All the memory is allocated once in BeginPlay, so recording never allocates:
+ *   FrameTimes: Capacity doubles
+ *   Samples:    Capacity * NumHitBoxes FBlasterHitBoxSample, frame-major (all boxes of a frame are contiguous)
+ *
+ * With the defaults (0.5 s at up to 60 Hz, 14 boxes) that is 31 frames * (8 + 14 * 28) bytes ~= 12 KB per
+ * character, ~775 KB for 64 players. See "stat Blaster" for the live number.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class BLASTER_API ULagCompensationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULagCompensationComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	//
+	// Rewinds the hit boxes to Time (server world time, which is what the client sees through
+	// AGameStateBase::GetServerWorldTimeSeconds()). Interpolates between the two recorded frames around it.
+	// OutTransforms gets one transform per entry of HitBoxes. Reuse the same array between calls to avoid allocations.
+	// Returns false if Time is older than the history (too much latency to be trusted).
+	//
+	bool GetHitBoxTransformsAtTime(double Time, TArray<FTransform>& OutTransforms) const;
+
+	const TArray<FBlasterHitBox>& GetHitBoxes() const { return HitBoxes; }
+	double GetOldestRecordedTime() const;
+	double GetNewestRecordedTime() const;
+
+	// Memory used by the history of one character with the current settings
+	SIZE_T GetHistoryAllocatedSize() const;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	UPROPERTY(EditDefaultsOnly, Category = "Lag Compensation")
+	TArray<FBlasterHitBox> HitBoxes;
+
+	// How far back in time we can rewind (seconds)
+	UPROPERTY(EditDefaultsOnly, Category = "Lag Compensation")
+	float MaxRecordTime{ 0.5f };
+
+	// Highest server tick rate the history is sized for. At higher rates the history covers less than MaxRecordTime.
+	UPROPERTY(EditDefaultsOnly, Category = "Lag Compensation")
+	float MaxRecordRate{ 60.f };
+
+	UPROPERTY()
+	ABlasterCharacter* Character;
+
+	// Ring buffer
+	TArray<double> FrameTimes;
+	TArray<FBlasterHitBoxSample> Samples;
+	int32 Capacity{ 0 };
+	int32 NewestFrame{ INDEX_NONE };
+	int32 NumFrames{ 0 };
+
+	void RecordFrame();
+
+	// Ring slot of the Nth oldest frame (0 is the oldest)
+	FORCEINLINE int32 GetSlot(const int32 Age) const { return (NewestFrame - NumFrames + 1 + Age + Capacity) % Capacity; }
+};
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterAnimInstance.h"
+#include "Blaster.h" // Who needs: STATGROUP_Blaster
+#include "BlasterCharacter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Anim Update (worker thread)"), STAT_BlasterAnimThreadSafeUpdate, STATGROUP_Blaster);
+
+void UBlasterAnimInstance::NativeInitializeAnimation()
+{
+	Super::NativeInitializeAnimation();
+
+	BlasterCharacter = Cast<ABlasterCharacter>(TryGetPawnOwner());
+	if (BlasterCharacter)
+		LastActorYaw = BlasterCharacter->GetActorRotation().Yaw;
+}
+
+void UBlasterAnimInstance::NativeThreadSafeUpdateAnimation(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterAnimThreadSafeUpdate);
+	Super::NativeThreadSafeUpdateAnimation(DeltaSeconds);
+
+	// Set once on the game thread (NativeInitializeAnimation), only read here
+	const ABlasterCharacter* Character = BlasterCharacter;
+	if (!Character || DeltaSeconds <= 0.f) return;
+
+	// Hot state, computed by the character's update
+	Speed = Character->GetSpeed();
+	bIsInAir = Character->IsInAir();
+	bIsAccelerating = Character->IsAccelerating();
+	bIsCrouched = Character->bIsCrouched;
+	AirTime = Character->GetAirTime();
+	AO_Yaw = Character->GetAO_Yaw();
+	AO_Pitch = Character->GetAO_Pitch();
+
+	// Strafing: where we move, relative to where we aim
+	const FVector Velocity = Character->GetVelocity();
+	const FRotator AimRotation = Character->GetBaseAimRotation();
+	if (Speed > UE_KINDA_SMALL_NUMBER)
+	{
+		const FRotator Target = (Velocity.Rotation() - AimRotation).GetNormalized();
+		DeltaAimRotation = FMath::RInterpTo(DeltaAimRotation, Target, DeltaSeconds, YawOffsetInterpSpeed);
+	}
+	YawOffset = DeltaAimRotation.Yaw;
+
+	// Leaning: turn rate of the actor
+	const float ActorYaw = Character->GetActorRotation().Yaw;
+	const float TurnRate = FRotator::NormalizeAxis(ActorYaw - LastActorYaw) / DeltaSeconds;
+	LastActorYaw = ActorYaw;
+	Lean = FMath::Clamp(FMath::FInterpTo(Lean, TurnRate, DeltaSeconds, LeanInterpSpeed), -90.f, 90.f);
+}
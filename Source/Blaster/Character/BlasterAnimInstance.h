@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimInstance.h"
+#include "BlasterAnimInstance.generated.h"
+
+class ABlasterCharacter;
+
+/**
+ * Native parent of the character's anim blueprint. Everything the blend spaces (BS_Jog, BS_CrouchWalk,
+ * Aim_Space_*) read is gathered in NativeThreadSafeUpdateAnimation, on a worker thread, so the blueprint
+ * needs no event graph and the game thread pays nothing per character for it.
+ *
+ * Safe to read the character there: the mesh ticks after the character's own update (actor tick, or the
+ * batched UBlasterCharacterUpdateSubsystem pass) and after its movement component, so none of what is
+ * read here changes while the worker runs.
+ */
+UCLASS()
+class BLASTER_API UBlasterAnimInstance : public UAnimInstance
+{
+	GENERATED_BODY()
+
+public:
+	virtual void NativeInitializeAnimation() override;
+	virtual void NativeThreadSafeUpdateAnimation(float DeltaSeconds) override;
+
+private:
+	UPROPERTY(Transient)
+	TObjectPtr<ABlasterCharacter> BlasterCharacter;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	float Speed{ 0.f };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	bool bIsInAir{ false };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	bool bIsAccelerating{ false };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	bool bIsCrouched{ false };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	float AirTime{ 0.f };
+
+	// Movement direction relative to the aim, for strafing (BS_Jog, BS_CrouchWalk)
+	UPROPERTY(BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	float YawOffset{ 0.f };
+
+	// How fast the character turns, clamped to [-90, 90]
+	UPROPERTY(BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	float Lean{ 0.f };
+
+	// Aim offsets (Aim_Space_*)
+	UPROPERTY(BlueprintReadOnly, Category = "Aim", meta = (AllowPrivateAccess = "true"))
+	float AO_Yaw{ 0.f };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Aim", meta = (AllowPrivateAccess = "true"))
+	float AO_Pitch{ 0.f };
+
+	// Smoothing of YawOffset and Lean
+	UPROPERTY(EditDefaultsOnly, Category = "Movement")
+	float YawOffsetInterpSpeed{ 6.f };
+
+	UPROPERTY(EditDefaultsOnly, Category = "Movement")
+	float LeanInterpSpeed{ 6.f };
+
+	FRotator DeltaAimRotation{ FRotator::ZeroRotator };
+	float LastActorYaw{ 0.f };
+};
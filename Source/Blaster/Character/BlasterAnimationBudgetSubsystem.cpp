@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterAnimationBudgetSubsystem.h"
+#include "Blaster.h" // Who needs: STATGROUP_Blaster, LogBlaster
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
+#include "AnimationBudgetAllocatorParameters.h"
+#include "IAnimationBudgetAllocator.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim Evaluated"), STAT_BlasterAnimEvaluated, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim Skipped"), STAT_BlasterAnimSkipped, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim Interpolated"), STAT_BlasterAnimInterpolated, STATGROUP_Blaster);
+
+namespace BlasterAnimationBudget
+{
+	static FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("Blaster.AnimBudgetStats"),
+		TEXT("Prints how many character animation updates were evaluated, skipped and interpolated so far."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (const UBlasterAnimationBudgetSubsystem* Subsystem = World ? World->GetSubsystem<UBlasterAnimationBudgetSubsystem>() : nullptr)
+				Subsystem->LogStats();
+		}));
+}
+
+bool UBlasterAnimationBudgetSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UBlasterAnimationBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UBlasterAnimationBudgetSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	IAnimationBudgetAllocator* Allocator = IAnimationBudgetAllocator::Get(&InWorld);
+	if (!Allocator) return;
+
+	FAnimationBudgetAllocatorParameters Parameters;
+	Parameters.BudgetInMs = BudgetInMs;
+	Parameters.MaxTickRate = MaxTickRate;
+	Parameters.MaxInterpolatedComponents = MaxInterpolatedComponents;
+	Parameters.AutoCalculatedSignificanceMaxDistance = SignificanceMaxDistance;
+	Allocator->SetParameters(Parameters);
+	Allocator->SetEnabled(bEnableAnimationBudget);
+
+	UE_LOG(LogBlaster, Log, TEXT("Animation budget %s: %.2f ms per frame"), bEnableAnimationBudget ? TEXT("on") : TEXT("off"), BudgetInMs);
+}
+
+void UBlasterAnimationBudgetSubsystem::Deinitialize()
+{
+	Meshes.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UBlasterAnimationBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBlasterAnimationBudgetSubsystem, STATGROUP_Tickables);
+}
+
+void UBlasterAnimationBudgetSubsystem::RegisterMesh(USkeletalMeshComponent* Mesh)
+{
+	if (!Mesh) return;
+	Meshes.AddUnique(Mesh);
+
+	// Extra: A listen server rewinds these bones for its clients' shots. A throttled or interpolated pose would
+	// record stale hitboxes.
+	const AActor* Owner = Mesh->GetOwner();
+	if (Owner && Owner->HasAuthority() && Owner->GetNetMode() == NM_ListenServer && Owner->FindComponentByClass<ULagCompensationComponent>())
+		ExcludeFromBudget(Mesh);
+}
+
+void UBlasterAnimationBudgetSubsystem::UnregisterMesh(USkeletalMeshComponent* Mesh)
+{
+	Meshes.RemoveSwap(Mesh);
+}
+
+void UBlasterAnimationBudgetSubsystem::ExcludeFromBudget(USkeletalMeshComponent* Mesh)
+{
+	USkeletalMeshComponentBudgeted* Budgeted = Cast<USkeletalMeshComponentBudgeted>(Mesh);
+	if (!Budgeted) return;
+
+	Budgeted->SetAutoRegisterWithBudgetAllocator(false);
+	if (IAnimationBudgetAllocator* Allocator = IAnimationBudgetAllocator::Get(GetWorld()))
+		Allocator->UnregisterComponent(Budgeted);
+}
+
+void UBlasterAnimationBudgetSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Extra: Ticks after the world's tick groups, so each mesh has decided what it did this frame
+	uint32 Evaluated{ 0 };
+	uint32 Skipped{ 0 };
+	uint32 Interpolated{ 0 };
+	for (int32 i = Meshes.Num() - 1; i >= 0; --i)
+	{
+		const USkeletalMeshComponent* Mesh = Meshes[i].Get();
+		if (!Mesh)
+		{
+			Meshes.RemoveAtSwap(i);
+			continue;
+		}
+
+		const FAnimUpdateRateParameters* RateParameters = Mesh->AnimUpdateRateParams;
+		if (!RateParameters || !Mesh->ShouldUseUpdateRateOptimizations() || !RateParameters->ShouldSkipEvaluation())
+			++Evaluated;
+		else if (RateParameters->ShouldInterpolateSkippedFrames())
+			++Interpolated;
+		else
+			++Skipped;
+	}
+
+	SET_DWORD_STAT(STAT_BlasterAnimEvaluated, Evaluated);
+	SET_DWORD_STAT(STAT_BlasterAnimSkipped, Skipped);
+	SET_DWORD_STAT(STAT_BlasterAnimInterpolated, Interpolated);
+	TotalEvaluated += Evaluated;
+	TotalSkipped += Skipped;
+	TotalInterpolated += Interpolated;
+}
+
+void UBlasterAnimationBudgetSubsystem::LogStats() const
+{
+	const uint64 Total = FMath::Max<uint64>(TotalEvaluated + TotalSkipped + TotalInterpolated, 1);
+	UE_LOG(LogBlaster, Log, TEXT("Animation budget (%s, %.2f ms): %d meshes. Updates: %llu evaluated (%.1f%%), %llu interpolated (%.1f%%), %llu skipped (%.1f%%)"),
+		bEnableAnimationBudget ? TEXT("on") : TEXT("off"), BudgetInMs, Meshes.Num(),
+		TotalEvaluated, 100.0 * TotalEvaluated / Total,
+		TotalInterpolated, 100.0 * TotalInterpolated / Total,
+		TotalSkipped, 100.0 * TotalSkipped / Total);
+}
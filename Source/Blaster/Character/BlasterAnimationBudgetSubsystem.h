@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BlasterAnimationBudgetSubsystem.generated.h"
+
+class USkeletalMeshComponent;
+
+/**
+ * Puts the animation of every ABlasterCharacter (but the local player's) under the engine's animation budget
+ * allocator: a cap in milliseconds per frame for all of them together. Characters far away or off screen are
+ * updated less often (and interpolated in between) first, so the close, visible ones keep a full rate.
+ * The character mesh is a USkeletalMeshComponentBudgeted, with significance computed from the distance to the view.
+ *
+ * Counts, every frame, how many character meshes were evaluated, skipped and interpolated
+ * ("stat Blaster", totals with "Blaster.AnimBudgetStats"). The allocator has its own stats too: "stat AnimationBudgetAllocator".
+ *
+ * Config:
+ *   [/Script/Blaster.BlasterAnimationBudgetSubsystem]
+ *   bEnableAnimationBudget=True
+ *   BudgetInMs=1.0
+ * The a.Budget.* console variables change the same parameters at runtime.
+ *
+ * Lag compensation records hitboxes from the bones of the server's meshes, so those have to be current: the subsystem
+ * isn't created on dedicated servers, and on listen servers the meshes of characters with lag compensation are kept
+ * out of the budget. Only clients and standalone games budget every remote character.
+ */
+UCLASS(Config=Game)
+class BLASTER_API UBlasterAnimationBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Called by the characters themselves on BeginPlay/EndPlay, for the stats. On a listen server, also takes the
+	// mesh out of the budget if its character is lag compensated.
+	void RegisterMesh(USkeletalMeshComponent* Mesh);
+	void UnregisterMesh(USkeletalMeshComponent* Mesh);
+
+	// The locally controlled character always animates at full rate
+	void ExcludeFromBudget(USkeletalMeshComponent* Mesh);
+
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	UPROPERTY(Config)
+	bool bEnableAnimationBudget{ true };
+
+	// All budgeted character meshes together, per frame
+	UPROPERTY(Config)
+	float BudgetInMs{ 1.f };
+
+	// Worst update rate under pressure: once every MaxTickRate frames
+	UPROPERTY(Config)
+	int32 MaxTickRate{ 10 };
+
+	// Meshes that skip frames and are interpolated in between (the others just skip)
+	UPROPERTY(Config)
+	int32 MaxInterpolatedComponents{ 16 };
+
+	// Significance falls to 0 at this distance from the view
+	UPROPERTY(Config)
+	float SignificanceMaxDistance{ 5000.f };
+
+	TArray<TWeakObjectPtr<USkeletalMeshComponent>> Meshes;
+
+	uint64 TotalEvaluated{ 0 };
+	uint64 TotalSkipped{ 0 };
+	uint64 TotalInterpolated{ 0 };
+};
@@ -2,27 +2,181 @@
 
 
 #include "BlasterCharacter.h"
+#include "Blaster.h" // Who needs: STATGROUP_Blaster, LogBlaster, LLM tags
+#include "BlasterCharacterUpdateSubsystem.h"
+#include "BlasterAnimationBudgetSubsystem.h"
+#include "BlasterCharacterMovementComponent.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
+#include "Blaster/Net/BlasterNetProfiler.h" // Who needs: FBlasterNetProfiler::FScopedRpc
+#include "Blaster/Weapon/BlasterHitscanSubsystem.h"
+#include "GameFramework/GameStateBase.h" // Who needs: GetServerWorldTimeSeconds
+#include "GameFramework/PlayerState.h" // Who needs: GetPingInMilliseconds
+#include "GameFramework/CharacterMovementComponent.h"
+#include "SkeletalMeshComponentBudgeted.h" // Who needs: USkeletalMeshComponentBudgeted (animation budget)
+#include "EnhancedInputComponent.h" // Who needs: UEnhancedInputComponent::BindAction
+#include "EnhancedInputSubsystems.h" // Who needs: UEnhancedInputLocalPlayerSubsystem
+#include "InputAction.h"
+#include "InputMappingContext.h"
+#include "Net/UnrealNetwork.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Tick (per-actor)"), STAT_BlasterCharacterTick, STATGROUP_Blaster);
 
 // Sets default values
-ABlasterCharacter::ABlasterCharacter()
+// Extra: The mesh is budgeted (see UBlasterAnimationBudgetSubsystem), the movement samples input at a fixed rate and counts corrections
+// (see UBlasterCharacterMovementComponent)
+ABlasterCharacter::ABlasterCharacter(const FObjectInitializer& ObjectInitializer):
+	Super(ObjectInitializer
+		.SetDefaultSubobjectClass<USkeletalMeshComponentBudgeted>(ACharacter::MeshComponentName)
+		.SetDefaultSubobjectClass<UBlasterCharacterMovementComponent>(ACharacter::CharacterMovementComponentName)),
+	bIsInAir(false),
+	bIsAccelerating(false)
 {
+	LLM_SCOPE_BYTAG(Blaster_Characters);
+
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+	// Extra: The tick is disabled on BeginPlay if the batched update subsystem takes over this character.
 	PrimaryActorTick.bCanEverTick = true;
 
+	LagCompensation = CreateDefaultSubobject<ULagCompensationComponent>(TEXT("LagCompensation"));
+
+	// Significance from the distance to the view, so far away characters are the first to update less often
+	if (USkeletalMeshComponentBudgeted* BudgetedMesh = Cast<USkeletalMeshComponentBudgeted>(GetMesh()))
+		BudgetedMesh->SetAutoCalculateSignificance(true);
+
+	BlasterMovement.Owner = this;
+}
+
+void ABlasterCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// The owning client has its own prediction through the CharacterMovementComponent
+	DOREPLIFETIME_CONDITION(ABlasterCharacter, BlasterMovement, COND_SimulatedOnly);
+
+	// Called on the CDO, so this is the class default
+	if (bUseQuantizedMovementReplication)
+	{
+		DISABLE_REPLICATED_PRIVATE_PROPERTY(AActor, ReplicatedMovement);
+		DISABLE_REPLICATED_PROPERTY(ACharacter, bIsCrouched);
+	}
+}
+
+void ABlasterCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	if (bUseQuantizedMovementReplication)
+		BlasterMovement.Capture(*this);
 }
 
 // Called when the game starts or when spawned
 void ABlasterCharacter::BeginPlay()
 {
+	LLM_SCOPE_BYTAG(Blaster_Characters);
 	Super::BeginPlay();
-	
+
+	if (UBlasterCharacterUpdateSubsystem* UpdateSubsystem = GetWorld()->GetSubsystem<UBlasterCharacterUpdateSubsystem>())
+	{
+		UpdateSubsystem->RegisterCharacter(this);
+		SetActorTickEnabled(false);
+	}
+
+	if (UBlasterAnimationBudgetSubsystem* BudgetSubsystem = GetWorld()->GetSubsystem<UBlasterAnimationBudgetSubsystem>())
+		BudgetSubsystem->RegisterMesh(GetMesh());
+}
+
+void ABlasterCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (BatchedUpdateIndex != INDEX_NONE)
+	{
+		if (UBlasterCharacterUpdateSubsystem* UpdateSubsystem = GetWorld()->GetSubsystem<UBlasterCharacterUpdateSubsystem>())
+			UpdateSubsystem->UnregisterCharacter(this);
+	}
+
+	if (UBlasterAnimationBudgetSubsystem* BudgetSubsystem = GetWorld()->GetSubsystem<UBlasterAnimationBudgetSubsystem>())
+		BudgetSubsystem->UnregisterMesh(GetMesh());
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
 void ABlasterCharacter::Tick(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_BlasterCharacterTick);
+
 	Super::Tick(DeltaTime);
 
+	// Same math as UBlasterCharacterUpdateSubsystem::UpdateCharacters, one character at a time.
+	const FVector Velocity = GetVelocity();
+	const FRotator BaseAimRotation = GetBaseAimRotation();
+	const EBlasterMovementFlags Flags = GetMovementFlags();
+
+	Speed = Velocity.Size2D();
+	bIsInAir = EnumHasAnyFlags(Flags, EBlasterMovementFlags::InAir);
+	bIsAccelerating = EnumHasAnyFlags(Flags, EBlasterMovementFlags::Accelerating);
+	AirTime = bIsInAir ? AirTime + DeltaTime : 0.f;
+
+	AO_Yaw = BlasterCharacterUpdate::ComputeAimOffsetYaw(BaseAimRotation.Yaw, Speed == 0.f && !bIsInAir, StartingAimYaw);
+	AO_Pitch = BlasterCharacterUpdate::ComputeAimOffsetPitch(BaseAimRotation.Pitch, EnumHasAnyFlags(Flags, EBlasterMovementFlags::LocallyControlled));
+}
+
+EBlasterMovementFlags ABlasterCharacter::GetMovementFlags() const
+{
+	EBlasterMovementFlags Flags = EBlasterMovementFlags::None;
+	const UCharacterMovementComponent* Movement = GetCharacterMovement();
+
+	if (Movement && Movement->IsFalling()) Flags |= EBlasterMovementFlags::InAir;
+	if (bIsCrouched) Flags |= EBlasterMovementFlags::Crouched;
+	if (IsLocallyControlled()) Flags |= EBlasterMovementFlags::LocallyControlled;
+
+	// Simulated proxies don't know the acceleration, only what the server told them
+	if (GetLocalRole() == ROLE_SimulatedProxy && bHasReplicatedMovement)
+	{
+		if (EnumHasAnyFlags(ReplicatedMovementFlags, EBlasterMovementFlags::Accelerating)) Flags |= EBlasterMovementFlags::Accelerating;
+	}
+	else if (Movement && Movement->GetCurrentAcceleration().SizeSquared() > 0.f)
+	{
+		Flags |= EBlasterMovementFlags::Accelerating;
+	}
+
+	return Flags;
+}
+
+bool ABlasterCharacter::CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack)
+{
+	const FBlasterNetProfiler::FScopedRpc ProfilerScope(Function);
+	return Super::CallRemoteFunction(Function, Parameters, OutParms, Stack);
+}
+
+FRotator ABlasterCharacter::GetBaseAimRotation() const
+{
+	if (bHasReplicatedMovement && GetLocalRole() == ROLE_SimulatedProxy)
+		return ReplicatedAimRotation;
+
+	return Super::GetBaseAimRotation();
+}
+
+void ABlasterCharacter::ApplyReplicatedMovement(const FVector& Location, const FVector& Velocity, const float ActorYaw, const FRotator& AimRotation, const EBlasterMovementFlags Flags)
+{
+	if (!bUseQuantizedMovementReplication || GetLocalRole() != ROLE_SimulatedProxy) return;
+
+	bHasReplicatedMovement = true;
+	ReplicatedAimRotation = AimRotation;
+	ReplicatedMovementFlags = Flags;
+
+	// Feed the stock path, so the CharacterMovementComponent smooths the correction like it always did
+	FRepMovement& RepMovement = GetReplicatedMovement_Mutable();
+	RepMovement.Location = Location;
+	RepMovement.LinearVelocity = Velocity;
+	RepMovement.Rotation = FRotator(0.0, ActorYaw, 0.0);
+	OnRep_ReplicatedMovement();
+
+	const bool bCrouched = EnumHasAnyFlags(Flags, EBlasterMovementFlags::Crouched);
+	if (bCrouched != static_cast<bool>(bIsCrouched))
+	{
+		bIsCrouched = bCrouched;
+		OnRep_IsCrouched();
+	}
 }
 
 // Called to bind functionality to input
@@ -30,5 +184,94 @@ void ABlasterCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCo
 {
 	Super::SetupPlayerInputComponent(PlayerInputComponent);
 
+	UEnhancedInputComponent* EnhancedInputComponent = Cast<UEnhancedInputComponent>(PlayerInputComponent);
+	if (!EnhancedInputComponent) return;
+
+	auto MakeTransientAction = [this](const TCHAR* Name, const EInputActionValueType ValueType)
+	{
+		UInputAction* Action = NewObject<UInputAction>(this, Name, RF_Transient);
+		Action->ValueType = ValueType;
+		return Action;
+	};
+	if (!MoveAction) MoveAction = MakeTransientAction(TEXT("IA_Move_Transient"), EInputActionValueType::Axis2D);
+	if (!LookAction) LookAction = MakeTransientAction(TEXT("IA_Look_Transient"), EInputActionValueType::Axis2D);
+	if (!JumpAction) JumpAction = MakeTransientAction(TEXT("IA_Jump_Transient"), EInputActionValueType::Boolean);
+
+	EnhancedInputComponent->BindAction(MoveAction, ETriggerEvent::Triggered, this, &ThisClass::Move);
+	EnhancedInputComponent->BindAction(LookAction, ETriggerEvent::Triggered, this, &ThisClass::Look);
+	EnhancedInputComponent->BindAction(JumpAction, ETriggerEvent::Started, this, &ACharacter::Jump);
+	EnhancedInputComponent->BindAction(JumpAction, ETriggerEvent::Completed, this, &ACharacter::StopJumping);
+}
+
+void ABlasterCharacter::PawnClientRestart()
+{
+	Super::PawnClientRestart();
+
+	// Extra: The player's own character animates at full rate, whatever the budget
+	if (UBlasterAnimationBudgetSubsystem* BudgetSubsystem = GetWorld()->GetSubsystem<UBlasterAnimationBudgetSubsystem>())
+		BudgetSubsystem->ExcludeFromBudget(GetMesh());
+
+	const APlayerController* PlayerController = Cast<APlayerController>(GetController());
+	if (!DefaultMappingContext || !PlayerController) return;
+
+	if (UEnhancedInputLocalPlayerSubsystem* InputSubsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
+		InputSubsystem->AddMappingContext(DefaultMappingContext, 0);
 }
 
+void ABlasterCharacter::Move(const FInputActionValue& Value)
+{
+	if (!Controller) return;
+
+	// X: right, Y: forward, relative to where the controller looks (yaw only)
+	const FVector2D Axis = Value.Get<FVector2D>();
+	const FRotationMatrix YawMatrix(FRotator(0.0, Controller->GetControlRotation().Yaw, 0.0));
+	AddMovementInput(YawMatrix.GetUnitAxis(EAxis::X), Axis.Y);
+	AddMovementInput(YawMatrix.GetUnitAxis(EAxis::Y), Axis.X);
+}
+
+void ABlasterCharacter::Look(const FInputActionValue& Value)
+{
+	const FVector2D Axis = Value.Get<FVector2D>();
+	AddControllerYawInput(Axis.X);
+	AddControllerPitchInput(Axis.Y);
+}
+
+
+void ABlasterCharacter::FireHitscan(const FVector& Start, const FVector& Direction)
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const double ShotTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+	ServerFireHitscan(Start, Direction.GetSafeNormal(), ShotTime);
+}
+
+void ABlasterCharacter::ServerFireHitscan_Implementation(const FVector_NetQuantize& Start, const FVector_NetQuantizeNormal& Direction, const double ShotTime)
+{
+	// Extra: The muzzle can't be far from the shooter. Anything else is a stale or forged shot, not worth a trace.
+	constexpr double MaxMuzzleDistance{ 300.0 };
+	if (FVector::DistSquared(Start, GetActorLocation()) > FMath::Square(MaxMuzzleDistance)) return;
+
+	UBlasterHitscanSubsystem* HitscanSubsystem = GetWorld()->GetSubsystem<UBlasterHitscanSubsystem>();
+	if (!HitscanSubsystem) return;
+
+	// Extra: The client's ShotTime can't be trusted as is. No later than now, and no further back than the shooter's
+	// ping (plus some slack) allows, capped by MaxShotRewindTime and by the lag compensation history.
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const double Now = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+	const APlayerState* ShooterState = GetPlayerState();
+	const double PingRewind = ShooterState ? ShooterState->GetPingInMilliseconds() / 1000.0 + ShotRewindSlack : MaxShotRewindTime;
+	double OldestShotTime = Now - FMath::Min<double>(PingRewind, MaxShotRewindTime);
+	if (LagCompensation && LagCompensation->GetOldestRecordedTime() > 0.0)
+		OldestShotTime = FMath::Max(OldestShotTime, LagCompensation->GetOldestRecordedTime());
+	if (ShotTime < OldestShotTime)
+	{
+		UE_LOG(LogBlaster, Verbose, TEXT("%s: shot dropped, %.0f ms in the past (%.0f ms allowed)"), *GetName(), (Now - ShotTime) * 1000.0, (Now - OldestShotTime) * 1000.0);
+		return;
+	}
+
+	FBlasterHitscanRequest Request;
+	Request.Shooter = this;
+	Request.Start = Start;
+	Request.End = Start + Direction * HitscanRange;
+	Request.ShotTime = FMath::Min(ShotTime, Now);
+	HitscanSubsystem->QueueShot(Request);
+}
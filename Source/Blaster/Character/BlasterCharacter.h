@@ -4,8 +4,15 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "BlasterCharacterTypes.h"
+#include "Blaster/Net/BlasterRepMovement.h"
 #include "BlasterCharacter.generated.h"
 
+class ULagCompensationComponent;
+class UInputAction;
+class UInputMappingContext;
+struct FInputActionValue;
+
 UCLASS()
 class BLASTER_API ABlasterCharacter : public ACharacter
 {
@@ -13,17 +20,135 @@ class BLASTER_API ABlasterCharacter : public ACharacter
 
 public:
 	// Sets default values for this character's properties
-	ABlasterCharacter();
+	ABlasterCharacter(const FObjectInitializer& ObjectInitializer);
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-public:	
+public:
 	// Called every frame
+	// Extra: Only used when the UBlasterCharacterUpdateSubsystem is disabled. Otherwise the actor tick is
+	// turned off and the subsystem updates every character in one batched pass.
 	virtual void Tick(float DeltaTime) override;
 
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
+	virtual void PawnClientRestart() override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	// Extra: Names the RPC bunches for the net profiler (Blaster.NetProfile)
+	virtual bool CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack) override;
+
+	// Extra: Simulated proxies use the aim received through FBlasterRepMovement (full pitch and yaw, not just RemoteViewPitch)
+	virtual FRotator GetBaseAimRotation() const override;
+
+	//
+	// Hot per-frame state (read by the animation)
+	//
+	FORCEINLINE float GetSpeed() const { return Speed; }
+	FORCEINLINE float GetAO_Yaw() const { return AO_Yaw; }
+	FORCEINLINE float GetAO_Pitch() const { return AO_Pitch; }
+	FORCEINLINE float GetAirTime() const { return AirTime; }
+	FORCEINLINE bool IsInAir() const { return bIsInAir; }
+	FORCEINLINE bool IsAccelerating() const { return bIsAccelerating; }
+
+	FORCEINLINE ULagCompensationComponent* GetLagCompensation() const { return LagCompensation; }
+
+	// Extra: Input actions, for anything that injects input (load test bots). Valid once input is set up.
+	FORCEINLINE const UInputAction* GetMoveAction() const { return MoveAction; }
+	FORCEINLINE const UInputAction* GetLookAction() const { return LookAction; }
+	FORCEINLINE const UInputAction* GetJumpAction() const { return JumpAction; }
+
+	//
+	// Extra: Hitscan fire. Called on the shooting client (or the listen server's own character); the shot is validated
+	// on the server by UBlasterHitscanSubsystem, against the other characters rewound to when it was fired.
+	//
+	void FireHitscan(const FVector& Start, const FVector& Direction);
+
+	// Extra: Server world time this character last fired or was hit (-1: never). Read by FBlasterAdaptiveNetUpdate.
+	FORCEINLINE double GetLastCombatTime() const { return LastCombatTime; }
+	FORCEINLINE void NotifyCombat(const double WorldTime) { LastCombatTime = WorldTime; }
+
+	// Current movement flags (LocallyControlled included)
+	EBlasterMovementFlags GetMovementFlags() const;
+
+	//
+	// Quantized movement replication (see FBlasterRepMovement)
+	//
+	FORCEINLINE const FBlasterMovementQuantization& GetMovementQuantization() const { return MovementQuantization; }
+	// Called on simulated proxies when a new movement state arrives
+	void ApplyReplicatedMovement(const FVector& Location, const FVector& Velocity, float ActorYaw, const FRotator& AimRotation, EBlasterMovementFlags Flags);
+
+private:
+	friend class UBlasterCharacterUpdateSubsystem;
+
+	// Server-side hit box history for rewinding shots
+	UPROPERTY(VisibleAnywhere)
+	ULagCompensationComponent* LagCompensation;
+
+	// Replace the stock ReplicatedMovement (and bIsCrouched) with FBlasterRepMovement for simulated proxies
+	UPROPERTY(EditDefaultsOnly, Category = "Replication")
+	bool bUseQuantizedMovementReplication{ true };
+
+	UPROPERTY(EditDefaultsOnly, Category = "Replication")
+	FBlasterMovementQuantization MovementQuantization;
+
+	UPROPERTY(Replicated)
+	FBlasterRepMovement BlasterMovement;
+
+	FRotator ReplicatedAimRotation{ FRotator::ZeroRotator };
+	EBlasterMovementFlags ReplicatedMovementFlags{ EBlasterMovementFlags::None };
+	bool bHasReplicatedMovement{ false };
+
+	//
+	// Enhanced Input. Actions not set on the blueprint get a transient one when input is set up, so injected
+	// input (UBlasterLoadTestSubsystem bots) goes through the same bindings as a player's.
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Input")
+	TObjectPtr<UInputMappingContext> DefaultMappingContext;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Input")
+	TObjectPtr<UInputAction> MoveAction;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Input")
+	TObjectPtr<UInputAction> LookAction;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Input")
+	TObjectPtr<UInputAction> JumpAction;
+
+	void Move(const FInputActionValue& Value);
+	void Look(const FInputActionValue& Value);
+
+	// How far a hitscan shot reaches (cm)
+	UPROPERTY(EditDefaultsOnly, Category = "Hitscan")
+	float HitscanRange{ 20000.f };
+
+	// Longest rewind granted to a shot, whatever the shooter's ping (seconds)
+	UPROPERTY(EditDefaultsOnly, Category = "Hitscan")
+	float MaxShotRewindTime{ 0.5f };
+
+	// Rewind granted on top of the shooter's measured ping, for jitter and interpolation delay (seconds)
+	UPROPERTY(EditDefaultsOnly, Category = "Hitscan")
+	float ShotRewindSlack{ 0.1f };
+
+	// Extra: Server world time the client saw when it fired, so the server can rewind to it
+	UFUNCTION(Server, Reliable)
+	void ServerFireHitscan(const FVector_NetQuantize& Start, const FVector_NetQuantizeNormal& Direction, double ShotTime);
+
+	double LastCombatTime{ -1.0 };
+
+	// Index inside UBlasterCharacterUpdateSubsystem arrays, or INDEX_NONE if ticking by itself
+	int32 BatchedUpdateIndex{ INDEX_NONE };
 
+	float Speed{ 0.f };
+	float AO_Yaw{ 0.f };
+	float AO_Pitch{ 0.f };
+	float StartingAimYaw{ 0.f };
+	float AirTime{ 0.f };
+	uint8 bIsInAir : 1;
+	uint8 bIsAccelerating : 1;
 };
@@ -0,0 +1,293 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterCharacterMovementComponent.h"
+#include "Blaster.h" // Who needs: STATGROUP_Blaster, LogBlaster
+#include "GameFramework/Character.h"
+#include "Engine/World.h"
+#include "EngineUtils.h" // Who needs: TActorIterator
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net Corrections"), STAT_BlasterNetCorrections, STATGROUP_Blaster);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Net Correction Error (cm)"), STAT_BlasterNetCorrectionError, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net Errors Absorbed"), STAT_BlasterNetErrorsAbsorbed, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net Moves Recovered"), STAT_BlasterNetMovesRecovered, STATGROUP_Blaster);
+
+namespace BlasterCharacterMovement
+{
+	static FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("Blaster.NetCorrectionStats"),
+		TEXT("Prints the movement corrections of every character so far (server side on the server, client side on clients)."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (!World) return;
+			for (TActorIterator<ACharacter> It(World); It; ++It)
+			{
+				const UBlasterCharacterMovementComponent* Movement = Cast<UBlasterCharacterMovementComponent>(It->GetCharacterMovement());
+				if (!Movement) continue;
+
+				const FBlasterCorrectionStats& Stats = Movement->GetCorrectionStats();
+				const int32 Divisor = FMath::Max(Stats.Corrections, 1);
+				UE_LOG(LogBlaster, Log, TEXT("%s: %d corrections (avg %.1f cm, max %.1f cm, avg age %.1f input frames / %.0f ms), %d absorbed, %d moves recovered"),
+					*It->GetName(), Stats.Corrections, Stats.GetAverageErrorCm(), Stats.MaxErrorCm,
+					static_cast<double>(Stats.TotalCorrectionAgeFrames) / Divisor, Stats.TotalCorrectionAgeMs / Divisor,
+					Stats.Absorbed, Stats.RecoveredMoves);
+			}
+		}));
+}
+
+//
+// Network move data
+//
+
+void FBlasterCharacterNetworkMoveData::ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType)
+{
+	Super::ClientFillNetworkMoveData(ClientMove, MoveType);
+
+	// Every saved move is allocated by FNetworkPredictionData_Client_Blaster
+	InputFrame = static_cast<const FSavedMove_Blaster&>(ClientMove).InputFrame;
+}
+
+bool FBlasterCharacterNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType)
+{
+	Super::Serialize(CharacterMovement, Ar, PackageMap, MoveType);
+
+	// 1 to 5 bytes, usually 3 in a match
+	Ar.SerializeIntPacked(InputFrame);
+	return !Ar.IsError();
+}
+
+FBlasterCharacterNetworkMoveDataContainer::FBlasterCharacterNetworkMoveDataContainer()
+{
+	NewMoveData = &BlasterMoveData[0];
+	PendingMoveData = &BlasterMoveData[1];
+	OldMoveData = &BlasterMoveData[2];
+}
+
+void FBlasterCharacterMoveResponseDataContainer::ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment)
+{
+	Super::ServerFillResponseData(CharacterMovement, PendingAdjustment);
+
+	ServerInputFrame = static_cast<const UBlasterCharacterMovementComponent&>(CharacterMovement).GetLastServerInputFrame();
+}
+
+bool FBlasterCharacterMoveResponseDataContainer::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap)
+{
+	if (!Super::Serialize(CharacterMovement, Ar, PackageMap))
+		return false;
+
+	Ar.SerializeIntPacked(ServerInputFrame);
+	return !Ar.IsError();
+}
+
+//
+// Saved moves
+//
+
+void FSavedMove_Blaster::Clear()
+{
+	Super::Clear();
+	InputFrame = 0;
+	InputTime = 0.0;
+}
+
+void FSavedMove_Blaster::SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+
+	const UBlasterCharacterMovementComponent* Movement = Cast<UBlasterCharacterMovementComponent>(C->GetCharacterMovement());
+	if (const FBlasterInputFrame* Frame = Movement ? Movement->GetInputBuffer().GetLatestFrame() : nullptr)
+	{
+		InputFrame = Frame->Frame;
+		InputTime = Frame->Time;
+	}
+}
+
+bool FSavedMove_Blaster::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	// One move per input frame: the server simulates, and acknowledges, every frame
+	if (InputFrame != static_cast<const FSavedMove_Blaster*>(NewMove.Get())->InputFrame)
+		return false;
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+FNetworkPredictionData_Client_Blaster::FNetworkPredictionData_Client_Blaster(const UCharacterMovementComponent& ClientMovement):
+	FNetworkPredictionData_Client_Character(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Blaster::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Blaster());
+}
+
+//
+// Component
+//
+
+UBlasterCharacterMovementComponent::UBlasterCharacterMovementComponent()
+{
+	SetNetworkMoveDataContainer(BlasterMoveDataContainer);
+	SetMoveResponseDataContainer(BlasterMoveResponseDataContainer);
+}
+
+void UBlasterCharacterMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Whoever ends up controlling the character locally samples into it. Small enough (~2 KB) to always have.
+	InputBuffer.Init(InputFrameRate, InputBufferCapacity);
+	AbsorbBudgetCm = ClientErrorToleranceCm;
+}
+
+void UBlasterCharacterMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	// Input added this frame (AddMovementInput), before Super consumes it into the move
+	if (CharacterOwner && CharacterOwner->IsLocallyControlled() && InputBuffer.IsInitialized())
+		InputBuffer.Advance(DeltaTime, GetWorld()->GetTimeSeconds(), GetPendingInputVector());
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+}
+
+FVector UBlasterCharacterMovementComponent::ConsumeInputVector()
+{
+	const FVector HeldInput = Super::ConsumeInputVector();
+
+	// Extra: The locally controlled character moves with its latest fixed-rate input frame, not this render frame's
+	const FBlasterInputFrame* Frame = CharacterOwner && CharacterOwner->IsLocallyControlled() ? InputBuffer.GetLatestFrame() : nullptr;
+	return Frame ? Frame->Move : HeldInput;
+}
+
+FNetworkPredictionData_Client* UBlasterCharacterMovementComponent::GetPredictionData_Client() const
+{
+	// Same lazy creation as the engine's, with our saved moves
+	if (!ClientPredictionData)
+	{
+		UBlasterCharacterMovementComponent* MutableThis = const_cast<UBlasterCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Blaster(*this);
+	}
+	return ClientPredictionData;
+}
+
+float UBlasterCharacterMovementComponent::GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const
+{
+	// Extra: Fixed rate, whatever the frame rate: at high frame rates moves are combined into one packet, at low frame
+	// rates every move goes right away. The engine's rate also drops with the net speed, which we don't want.
+	if (ClientSendRate <= 0.f)
+		return Super::GetClientNetSendDeltaTime(PC, ClientData, NewMove);
+
+	return 1.f / ClientSendRate;
+}
+
+bool UBlasterCharacterMovementComponent::ClientUpdatePositionAfterServerUpdate()
+{
+	// A correction arrived: the capsule is at the server's position for the acknowledged move, which is about to be
+	// replayed from. How far that is from where we predicted we were is the size of the correction.
+	const FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character();
+	if (ClientData && ClientData->bUpdatePosition && ClientData->LastAckedMove.IsValid() && UpdatedComponent)
+	{
+		const FSavedMove_Blaster* AckedMove = static_cast<const FSavedMove_Blaster*>(ClientData->LastAckedMove.Get());
+		const double ErrorCm = FVector::Dist(AckedMove->SavedLocation, UpdatedComponent->GetComponentLocation());
+		const FBlasterInputFrame* LatestFrame = InputBuffer.GetLatestFrame();
+		const int32 AgeFrames = LatestFrame && LastServerInputFrame > 0 ? static_cast<int32>(LatestFrame->Frame - LastServerInputFrame) : 0;
+		const double AgeMs = LatestFrame && AckedMove->InputFrame > 0 ? (LatestFrame->Time - AckedMove->InputTime) * 1000.0 : 0.0;
+		RecordCorrection(ErrorCm, AgeFrames, AgeMs);
+	}
+
+	return Super::ClientUpdatePositionAfterServerUpdate();
+}
+
+void UBlasterCharacterMovementComponent::ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse)
+{
+	// Acks and corrections both say how far the server got. Responses can arrive out of order.
+	const uint32 ServerInputFrame = static_cast<const FBlasterCharacterMoveResponseDataContainer&>(MoveResponse).ServerInputFrame;
+	LastServerInputFrame = FMath::Max(LastServerInputFrame, ServerInputFrame);
+
+	Super::ClientHandleMoveResponse(MoveResponse);
+}
+
+void UBlasterCharacterMovementComponent::ServerMove_PerformMovement(const FCharacterNetworkMoveData& MoveData)
+{
+	const FNetworkPredictionData_Server_Character* ServerData = GetPredictionData_Server_Character();
+	const float PreviousTimeStamp = ServerData ? ServerData->CurrentClientTimeStamp : 0.f;
+
+	Super::ServerMove_PerformMovement(MoveData);
+
+	// The old move is the redundant copy of an important move. It's only run if the server never got the original.
+	if (ServerData && MoveData.NetworkMoveType == FCharacterNetworkMoveData::ENetworkMoveType::OldMove && ServerData->CurrentClientTimeStamp != PreviousTimeStamp)
+	{
+		++TotalStats.RecoveredMoves;
+		++WindowStats.RecoveredMoves;
+		INC_DWORD_STAT(STAT_BlasterNetMovesRecovered);
+	}
+
+	const FBlasterCharacterNetworkMoveData& BlasterMoveData = static_cast<const FBlasterCharacterNetworkMoveData&>(MoveData);
+	LastServerInputFrame = FMath::Max(LastServerInputFrame, BlasterMoveData.InputFrame);
+}
+
+bool UBlasterCharacterMovementComponent::ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	bAbsorbedThisMove = false;
+
+	// Under the engine's own threshold: no correction, and the server keeps its position (the client's isn't taken)
+	if (!Super::ServerCheckClientError(ClientTimeStamp, DeltaTime, Accel, ClientWorldLocation, RelativeClientLocation, ClientMovementBase, ClientBaseBoneName, ClientMovementMode))
+		return false;
+
+	const double ErrorCm = FVector::Dist(ClientWorldLocation, UpdatedComponent->GetComponentLocation());
+
+	// Extra: Small position errors are taken from the client, as long as it's the same movement mode on the same base.
+	// The budget refills at ClientErrorToleranceCm per second, so the most a client can gain this way is that much.
+	const double Now = GetWorld()->GetTimeSeconds();
+	AbsorbBudgetCm = FMath::Min(AbsorbBudgetCm + (Now - LastAbsorbBudgetTime) * ClientErrorToleranceCm, 4.0 * ClientErrorToleranceCm);
+	LastAbsorbBudgetTime = Now;
+
+	const bool bSameMode = ClientMovementMode == PackNetworkMovementMode() && ClientMovementBase == CharacterOwner->GetMovementBase();
+	if (bSameMode && ErrorCm <= ClientErrorToleranceCm && ErrorCm <= AbsorbBudgetCm)
+	{
+		AbsorbBudgetCm -= ErrorCm;
+		bAbsorbedThisMove = true;
+		++TotalStats.Absorbed;
+		++WindowStats.Absorbed;
+		INC_DWORD_STAT(STAT_BlasterNetErrorsAbsorbed);
+		return false;
+	}
+
+	RecordCorrection(ErrorCm, 0, 0.0);
+	return true;
+}
+
+bool UBlasterCharacterMovementComponent::ServerShouldUseAuthoritativePosition(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	// Only the moves ServerCheckClientError charged to the absorb budget move the server to where the client is.
+	// Accepting every uncorrected move would let a client drift just under the engine's threshold, unbudgeted.
+	if (bAbsorbedThisMove)
+	{
+		bAbsorbedThisMove = false;
+		return true;
+	}
+
+	return Super::ServerShouldUseAuthoritativePosition(ClientTimeStamp, DeltaTime, Accel, ClientWorldLocation, RelativeClientLocation, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+}
+
+void UBlasterCharacterMovementComponent::RecordCorrection(const double ErrorCm, const int32 AgeFrames, const double AgeMs)
+{
+	TotalStats.AddCorrection(ErrorCm);
+	TotalStats.TotalCorrectionAgeFrames += AgeFrames;
+	TotalStats.TotalCorrectionAgeMs += AgeMs;
+	WindowStats.AddCorrection(ErrorCm);
+	WindowStats.TotalCorrectionAgeFrames += AgeFrames;
+	WindowStats.TotalCorrectionAgeMs += AgeMs;
+
+	INC_DWORD_STAT(STAT_BlasterNetCorrections);
+	INC_FLOAT_STAT_BY(STAT_BlasterNetCorrectionError, ErrorCm);
+
+	UE_LOG(LogBlaster, Verbose, TEXT("%s: movement corrected by %.1f cm (%d input frames, %.0f ms old)"), *GetNameSafe(CharacterOwner), ErrorCm, AgeFrames, AgeMs);
+}
+
+FBlasterCorrectionStats UBlasterCharacterMovementComponent::ConsumeCorrectionWindow()
+{
+	FBlasterCorrectionStats Window = WindowStats;
+	WindowStats = FBlasterCorrectionStats();
+	return Window;
+}
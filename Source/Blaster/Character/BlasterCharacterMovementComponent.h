@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "BlasterInputBuffer.h"
+#include "BlasterCharacterMovementComponent.generated.h"
+
+// Server corrections of one character's predicted movement, over some window
+struct FBlasterCorrectionStats
+{
+	// Client errors over the tolerance: the server sent a correction
+	int32 Corrections{ 0 };
+	double TotalErrorCm{ 0.0 };
+	double MaxErrorCm{ 0.0 };
+	// Client errors under the tolerance: the server took the client's position instead of correcting it
+	int32 Absorbed{ 0 };
+	// Moves the server only got through the redundant copy of a later packet (the original was lost)
+	int32 RecoveredMoves{ 0 };
+	// Client only: input frames between the last one the server simulated and the latest one (~ round trip in input
+	// frames), and the time between the corrected move's input frame and the latest one
+	int32 TotalCorrectionAgeFrames{ 0 };
+	double TotalCorrectionAgeMs{ 0.0 };
+
+	void AddCorrection(const double ErrorCm)
+	{
+		++Corrections;
+		TotalErrorCm += ErrorCm;
+		MaxErrorCm = FMath::Max(MaxErrorCm, ErrorCm);
+	}
+
+	void Accumulate(const FBlasterCorrectionStats& Other)
+	{
+		Corrections += Other.Corrections;
+		TotalErrorCm += Other.TotalErrorCm;
+		MaxErrorCm = FMath::Max(MaxErrorCm, Other.MaxErrorCm);
+		Absorbed += Other.Absorbed;
+		RecoveredMoves += Other.RecoveredMoves;
+		TotalCorrectionAgeFrames += Other.TotalCorrectionAgeFrames;
+		TotalCorrectionAgeMs += Other.TotalCorrectionAgeMs;
+	}
+
+	double GetAverageErrorCm() const { return Corrections > 0 ? TotalErrorCm / Corrections : 0.0; }
+};
+
+//
+// Extra: Client move data with the input frame the move was made from
+//
+struct FBlasterCharacterNetworkMoveData : public FCharacterNetworkMoveData
+{
+	using Super = FCharacterNetworkMoveData;
+
+	uint32 InputFrame{ 0 };
+
+	virtual void ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
+};
+
+struct FBlasterCharacterNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+	FBlasterCharacterNetworkMoveDataContainer();
+
+	FBlasterCharacterNetworkMoveData BlasterMoveData[3];
+};
+
+// Extra: Server move response (ack or correction) with the last input frame the server simulated
+struct FBlasterCharacterMoveResponseDataContainer : public FCharacterMoveResponseDataContainer
+{
+	using Super = FCharacterMoveResponseDataContainer;
+
+	uint32 ServerInputFrame{ 0 };
+
+	virtual void ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap) override;
+};
+
+class FSavedMove_Blaster : public FSavedMove_Character
+{
+public:
+	using Super = FSavedMove_Character;
+
+	// The input frame the move was made with, and its time
+	uint32 InputFrame{ 0 };
+	double InputTime{ 0.0 };
+
+	virtual void Clear() override;
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+};
+
+class FNetworkPredictionData_Client_Blaster : public FNetworkPredictionData_Client_Character
+{
+public:
+	FNetworkPredictionData_Client_Blaster(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+/**
+ * Character movement with fixed-rate input, batched move packets and correction metrics.
+ *
+ * Prediction and reconciliation stay the engine's: the owning client moves right away, saves each move, sends it, and
+ * on a correction snaps to the server's position and replays the moves the server hasn't acknowledged yet. On top:
+ *  - The locally controlled character samples its movement input at InputFrameRate into a ring buffer
+ *    (FBlasterInputBuffer) and moves with the latest frame's input, whatever the render frame rate.
+ *  - Each saved move carries its input frame number and time. Moves of different input frames aren't combined, so the
+ *    server simulates every input frame, and sends back the last one with each ack or correction. The client times
+ *    its corrections against that frame.
+ *  - Moves are sent at a fixed ClientSendRate instead of the engine's frame- and bandwidth-dependent rate. At the
+ *    default (half the input rate) each packet carries two input frames (the pending and the new move) plus the
+ *    redundant copy of the last important one, so a lost packet is made up by the next.
+ *  - Client errors under ClientErrorToleranceCm are taken by the server instead of corrected: at 100-150 ms of ping a
+ *    correction means a replay of ~10 moves and a visible pop, for an error nobody would see.
+ *  - Corrections are counted, with their size, on both sides ("stat Blaster", Blaster.NetCorrectionStats, load test CSV).
+ */
+UCLASS()
+class BLASTER_API UBlasterCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UBlasterCharacterMovementComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual FVector ConsumeInputVector() override;
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	const FBlasterInputBuffer& GetInputBuffer() const { return InputBuffer; }
+	// Server: latest input frame simulated for the owning client
+	uint32 GetLastServerInputFrame() const { return LastServerInputFrame; }
+
+	// Since the component was created
+	const FBlasterCorrectionStats& GetCorrectionStats() const { return TotalStats; }
+	// Since the last call (for per-second sampling)
+	FBlasterCorrectionStats ConsumeCorrectionWindow();
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual float GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const override;
+	virtual bool ClientUpdatePositionAfterServerUpdate() override;
+	virtual void ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse) override;
+	virtual void ServerMove_PerformMovement(const FCharacterNetworkMoveData& MoveData) override;
+	virtual bool ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+	virtual bool ServerShouldUseAuthoritativePosition(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+
+private:
+	// Input frames per second sampled on the owning client
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)", meta = (ClampMin = "10", ClampMax = "240"))
+	float InputFrameRate{ 60.f };
+
+	// Input frames kept (rounded up to a power of two). Has to cover the round trip to time corrections.
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)", meta = (ClampMin = "16"))
+	int32 InputBufferCapacity{ 64 };
+
+	// Move packets per second sent by the owning client. 0: the engine's default rate.
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)", meta = (ClampMin = "0", ClampMax = "120"))
+	float ClientSendRate{ 30.f };
+
+	// Client position errors up to this are accepted by the server instead of corrected (cm)
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)", meta = (ClampMin = "0"))
+	float ClientErrorToleranceCm{ 3.f };
+
+	FBlasterCharacterNetworkMoveDataContainer BlasterMoveDataContainer;
+	FBlasterCharacterMoveResponseDataContainer BlasterMoveResponseDataContainer;
+	FBlasterInputBuffer InputBuffer;
+
+	// Server: highest input frame received. Client: the last one the server said it simulated.
+	uint32 LastServerInputFrame{ 0 };
+
+	// Server: how much client error can still be absorbed (cm), see ServerCheckClientError
+	double AbsorbBudgetCm{ 0.0 };
+	double LastAbsorbBudgetTime{ 0.0 };
+	// Server: the move just checked was charged to the budget, so its client position is taken
+	bool bAbsorbedThisMove{ false };
+
+	FBlasterCorrectionStats TotalStats;
+	FBlasterCorrectionStats WindowStats;
+
+	void RecordCorrection(double ErrorCm, int32 AgeFrames, double AgeMs);
+};
@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Movement flags packed into one byte per character
+enum class EBlasterMovementFlags : uint8
+{
+	None = 0,
+	InAir = 1 << 0,
+	Accelerating = 1 << 1,
+	Crouched = 1 << 2,
+	LocallyControlled = 1 << 3,
+};
+ENUM_CLASS_FLAGS(EBlasterMovementFlags);
@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterCharacterUpdateSubsystem.h"
+#include "Blaster.h" // Who needs: STATGROUP_Blaster
+#include "BlasterCharacter.h"
+#include "Components/SkeletalMeshComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Update (batched)"), STAT_BlasterCharacterBatchedUpdate, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Characters (batched)"), STAT_BlasterCharacterBatchedCount, STATGROUP_Blaster);
+
+void FBlasterCharacterUpdateTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && TickType != LEVELTICK_ViewportsOnly)
+		Target->UpdateCharacters(DeltaTime);
+}
+
+FString FBlasterCharacterUpdateTickFunction::DiagnosticMessage()
+{
+	return TEXT("FBlasterCharacterUpdateTickFunction");
+}
+
+FName FBlasterCharacterUpdateTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("BlasterCharacterUpdate"));
+}
+
+bool UBlasterCharacterUpdateSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Called on the CDO, so this is the value from the config file
+	return bEnableBatchedUpdate && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UBlasterCharacterUpdateSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UBlasterCharacterUpdateSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	UpdateTickFunction.Target = this;
+	UpdateTickFunction.TickGroup = TG_PrePhysics;
+	UpdateTickFunction.bCanEverTick = true;
+	UpdateTickFunction.bStartWithTickEnabled = true;
+	UpdateTickFunction.bTickEvenWhenPaused = false;
+	UpdateTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UBlasterCharacterUpdateSubsystem::Deinitialize()
+{
+	if (UpdateTickFunction.IsTickFunctionRegistered())
+		UpdateTickFunction.UnRegisterTickFunction();
+	UpdateTickFunction.Target = nullptr;
+
+	for (ABlasterCharacter* Character : Characters)
+	{
+		if (Character) Character->BatchedUpdateIndex = INDEX_NONE;
+	}
+	Characters.Empty();
+
+	Super::Deinitialize();
+}
+
+void UBlasterCharacterUpdateSubsystem::RegisterCharacter(ABlasterCharacter* Character)
+{
+	check(Character);
+	if (Character->BatchedUpdateIndex != INDEX_NONE) return;
+
+	Character->BatchedUpdateIndex = Characters.Add(Character);
+	Velocities.AddZeroed();
+	BaseAimYaws.AddZeroed();
+	BaseAimPitches.AddZeroed();
+	MovementFlags.Add(EBlasterMovementFlags::None);
+	Speeds.AddZeroed();
+	StartingAimYaws.Add(Character->GetBaseAimRotation().Yaw);
+	AO_Yaws.AddZeroed();
+	AO_Pitches.AddZeroed();
+	AirTimes.AddZeroed();
+
+	// Extra: The mesh (and its worker thread anim update, see UBlasterAnimInstance) runs after the batched pass,
+	// like it runs after the actor tick it replaces
+	if (USkeletalMeshComponent* Mesh = Character->GetMesh())
+		Mesh->PrimaryComponentTick.AddPrerequisite(this, UpdateTickFunction);
+}
+
+void UBlasterCharacterUpdateSubsystem::UnregisterCharacter(ABlasterCharacter* Character)
+{
+	check(Character);
+	const int32 Index = Character->BatchedUpdateIndex;
+	if (!Characters.IsValidIndex(Index) || Characters[Index] != Character) return;
+
+	RemoveAtSwap(Index);
+	Character->BatchedUpdateIndex = INDEX_NONE;
+
+	if (USkeletalMeshComponent* Mesh = Character->GetMesh())
+		Mesh->PrimaryComponentTick.RemovePrerequisite(this, UpdateTickFunction);
+}
+
+void UBlasterCharacterUpdateSubsystem::RemoveAtSwap(const int32 Index)
+{
+	Characters.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Velocities.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	BaseAimYaws.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	BaseAimPitches.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	MovementFlags.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Speeds.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	StartingAimYaws.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	AO_Yaws.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	AO_Pitches.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	AirTimes.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+
+	// The last character was moved into the hole
+	if (Characters.IsValidIndex(Index) && Characters[Index])
+		Characters[Index]->BatchedUpdateIndex = Index;
+}
+
+void UBlasterCharacterUpdateSubsystem::UpdateCharacters(const float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterCharacterBatchedUpdate);
+
+	const int32 Num = Characters.Num();
+	SET_DWORD_STAT(STAT_BlasterCharacterBatchedCount, Num);
+
+	// 1. Gather: the only pass that touches the actors and their movement components
+	for (int32 i = 0; i < Num; ++i)
+	{
+		const ABlasterCharacter* Character = Characters[i];
+		if (!Character) continue;
+
+		const FRotator BaseAimRotation = Character->GetBaseAimRotation();
+
+		Velocities[i] = FVector3f(Character->GetVelocity());
+		BaseAimYaws[i] = BaseAimRotation.Yaw;
+		BaseAimPitches[i] = BaseAimRotation.Pitch;
+		MovementFlags[i] = Character->GetMovementFlags();
+	}
+
+	// 2. Update: straight loops over contiguous arrays
+	for (int32 i = 0; i < Num; ++i)
+	{
+		Speeds[i] = FVector2f(Velocities[i]).Size();
+	}
+
+	for (int32 i = 0; i < Num; ++i)
+	{
+		const bool bInAir = EnumHasAnyFlags(MovementFlags[i], EBlasterMovementFlags::InAir);
+		AirTimes[i] = bInAir ? AirTimes[i] + DeltaTime : 0.f;
+		AO_Yaws[i] = BlasterCharacterUpdate::ComputeAimOffsetYaw(BaseAimYaws[i], Speeds[i] == 0.f && !bInAir, StartingAimYaws[i]);
+		AO_Pitches[i] = BlasterCharacterUpdate::ComputeAimOffsetPitch(BaseAimPitches[i], EnumHasAnyFlags(MovementFlags[i], EBlasterMovementFlags::LocallyControlled));
+	}
+
+	// 3. Scatter: write the results back where the animation reads them
+	for (int32 i = 0; i < Num; ++i)
+	{
+		ABlasterCharacter* Character = Characters[i];
+		if (!Character) continue;
+
+		Character->Speed = Speeds[i];
+		Character->AO_Yaw = AO_Yaws[i];
+		Character->AO_Pitch = AO_Pitches[i];
+		Character->StartingAimYaw = StartingAimYaws[i];
+		Character->AirTime = AirTimes[i];
+		Character->bIsInAir = EnumHasAnyFlags(MovementFlags[i], EBlasterMovementFlags::InAir);
+		Character->bIsAccelerating = EnumHasAnyFlags(MovementFlags[i], EBlasterMovementFlags::Accelerating);
+	}
+}
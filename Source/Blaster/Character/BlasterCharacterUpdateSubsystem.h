@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BlasterCharacterTypes.h"
+#include "Engine/EngineBaseTypes.h" // Who needs: FTickFunction
+#include "Subsystems/WorldSubsystem.h"
+#include "BlasterCharacterUpdateSubsystem.generated.h"
+
+class ABlasterCharacter;
+class UBlasterCharacterUpdateSubsystem;
+
+//
+// Per-frame math shared by the batched pass and the old per-actor ABlasterCharacter::Tick,
+// so both paths always produce the same aim offsets.
+//
+namespace BlasterCharacterUpdate
+{
+	// Yaw offset between where the character is aiming and where it was aiming when it stopped moving.
+	// While moving (or in air) the starting yaw follows the aim, so the offset is zero.
+	FORCEINLINE float ComputeAimOffsetYaw(const float BaseAimYaw, const bool bStandingStill, float& InOutStartingAimYaw)
+	{
+		if (!bStandingStill)
+		{
+			InOutStartingAimYaw = BaseAimYaw;
+			return 0.f;
+		}
+		return FRotator::NormalizeAxis(BaseAimYaw - InOutStartingAimYaw);
+	}
+
+	// Pitch is compressed to [0, 360) when sent over the network, so for proxies a negative pitch
+	// arrives as [270, 360). Map it back to [-90, 0).
+	FORCEINLINE float ComputeAimOffsetPitch(const float BaseAimPitch, const bool bLocallyControlled)
+	{
+		if (BaseAimPitch > 90.f && !bLocallyControlled)
+		{
+			return BaseAimPitch - 360.f;
+		}
+		return BaseAimPitch;
+	}
+}
+
+//
+// Tick function that runs the batched pass. It ticks in TG_PrePhysics, the same group the per-actor
+// Tick used to run in, so anything reading the hot state (e.g. the anim blueprint) sees the same frame.
+//
+USTRUCT()
+struct FBlasterCharacterUpdateTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UBlasterCharacterUpdateSubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FBlasterCharacterUpdateTickFunction> : public TStructOpsTypeTraitsBase2<FBlasterCharacterUpdateTickFunction>
+{
+	enum { WithCopy = false };
+};
+
+/**
+ * Owns every ABlasterCharacter in the world and updates their hot per-frame state (aim offsets, movement
+ * flags and timers) in one batched pass, instead of paying for one Tick dispatch per character.
+ *
+ * The hot state lives here in structure-of-arrays form: one contiguous array per field, indexed by the
+ * character's BatchedUpdateIndex. Removal is swap-and-pop, so the arrays never have holes.
+ *
+ * Opt-in through config:
+ *   [/Script/Blaster.BlasterCharacterUpdateSubsystem]
+ *   bEnableBatchedUpdate=True
+ */
+UCLASS(Config=Game)
+class BLASTER_API UBlasterCharacterUpdateSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// Called by the characters themselves on BeginPlay/EndPlay.
+	void RegisterCharacter(ABlasterCharacter* Character);
+	void UnregisterCharacter(ABlasterCharacter* Character);
+
+	int32 GetNumCharacters() const { return Characters.Num(); }
+
+	// The batched pass: gather inputs, update the arrays, scatter the results back.
+	void UpdateCharacters(float DeltaTime);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	UPROPERTY(Config)
+	bool bEnableBatchedUpdate{ false };
+
+	FBlasterCharacterUpdateTickFunction UpdateTickFunction;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<ABlasterCharacter>> Characters;
+
+	//
+	// Hot state, structure-of-arrays. Every array has Characters.Num() elements.
+	//
+
+	// Gathered every frame
+	TArray<FVector3f> Velocities;
+	TArray<float> BaseAimYaws;
+	TArray<float> BaseAimPitches;
+	TArray<EBlasterMovementFlags> MovementFlags;
+
+	// Results (and state carried between frames)
+	TArray<float> Speeds;
+	TArray<float> StartingAimYaws;
+	TArray<float> AO_Yaws;
+	TArray<float> AO_Pitches;
+	TArray<float> AirTimes;
+
+	void RemoveAtSwap(int32 Index);
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// The movement input of the locally controlled character during one fixed-rate input frame
+struct FBlasterInputFrame
+{
+	// Increases by one every frame, never wraps in a match (at 60 Hz a uint32 lasts over two years)
+	uint32 Frame{ 0 };
+	// World time at the end of the frame
+	double Time{ 0.0 };
+	// Movement input held during the frame (world space, each axis in [-1, 1])
+	FVector Move{ FVector::ZeroVector };
+};
+
+/**
+ * Extra: Fixed-rate input history. Samples whatever movement input is held at a fixed rate (InputFrameRate),
+ * independently of the render frame rate, into a ring buffer allocated once. A slow frame produces several input frames
+ * with the same input, a fast one may produce none (the latest frame's input then still applies).
+ *
+ * The character moves with the latest frame's input, each saved move carries its frame number and time, and the
+ * server sends back the last frame it simulated. Frames are looked up by number for as long as they are in the buffer
+ * (Capacity frames back), to time corrections.
+ */
+class FBlasterInputBuffer
+{
+public:
+	void Init(const float InputFrameRate, const int32 Capacity)
+	{
+		FrameInterval = 1.0 / FMath::Max(InputFrameRate, 1.f);
+		Frames.SetNumZeroed(FMath::RoundUpToPowerOfTwo(FMath::Max(Capacity, 2)));
+		Mask = Frames.Num() - 1;
+		NextFrame = 1;
+		Accumulator = 0.0;
+	}
+
+	bool IsInitialized() const { return !Frames.IsEmpty(); }
+
+	// Returns how many input frames were produced
+	int32 Advance(const double DeltaTime, const double Now, const FVector& Move)
+	{
+		Accumulator += DeltaTime;
+
+		// Don't spin after a hitch: a buffer's worth of frames is as far back as anyone can look anyway
+		const int32 MaxFrames = Frames.Num();
+		int32 Produced{ 0 };
+		while (Accumulator >= FrameInterval && Produced < MaxFrames)
+		{
+			Accumulator -= FrameInterval;
+			FBlasterInputFrame& InputFrame = Frames[NextFrame & Mask];
+			InputFrame.Frame = NextFrame++;
+			InputFrame.Time = Now - Accumulator;
+			InputFrame.Move = Move;
+			++Produced;
+		}
+		if (Produced == MaxFrames)
+			Accumulator = FMath::Fmod(Accumulator, FrameInterval);
+
+		return Produced;
+	}
+
+	// nullptr until the first frame is produced
+	const FBlasterInputFrame* GetLatestFrame() const { return FindFrame(NextFrame - 1); }
+
+	const FBlasterInputFrame* FindFrame(const uint32 FrameNumber) const
+	{
+		if (FrameNumber == 0 || FrameNumber >= NextFrame || NextFrame - FrameNumber > static_cast<uint32>(Frames.Num()))
+			return nullptr;
+		return &Frames[FrameNumber & Mask];
+	}
+
+private:
+	TArray<FBlasterInputFrame> Frames;
+	uint32 Mask{ 0 };
+	uint32 NextFrame{ 1 };
+	double FrameInterval{ 1.0 / 60.0 };
+	double Accumulator{ 0.0 };
+};
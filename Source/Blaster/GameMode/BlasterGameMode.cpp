@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterGameMode.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/PlayerState/BlasterPlayerState.h"
+#include "Blaster/Travel/BlasterTravelSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/ConstructorHelpers.h" // Who needs: FClassFinder
+
+namespace
+{
+	bool bSeamlessTravel{ true };
+	FAutoConsoleVariableRef CVarSeamlessTravel(
+		TEXT("Blaster.SeamlessTravel"),
+		bSeamlessTravel,
+		TEXT("Server travel (lobby -> match) keeps the connections and player states. 0: hard travel, every client reconnects."));
+}
+
+ABlasterGameMode::ABlasterGameMode()
+{
+	PlayerStateClass = ABlasterPlayerState::StaticClass();
+
+	// The character blueprint has the mesh and anim blueprint, the C++ class alone is invisible
+	static ConstructorHelpers::FClassFinder<APawn> CharacterBlueprint(TEXT("/Game/Blueprints/Character/BP_BlasterCharacter"));
+	DefaultPawnClass = CharacterBlueprint.Succeeded() ? CharacterBlueprint.Class : TSubclassOf<APawn>(ABlasterCharacter::StaticClass());
+
+	bUseSeamlessTravel = true;
+}
+
+void ABlasterGameMode::ProcessServerTravel(const FString& URL, bool bAbsolute)
+{
+	bUseSeamlessTravel = bSeamlessTravel;
+
+	if (UBlasterTravelSubsystem* TravelSubsystem = GetGameInstance()->GetSubsystem<UBlasterTravelSubsystem>())
+		TravelSubsystem->BeginServerTravel(URL, bUseSeamlessTravel);
+
+	Super::ProcessServerTravel(URL, bAbsolute);
+}
+
+void ABlasterGameMode::HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer)
+{
+	Super::HandleStartingNewPlayer_Implementation(NewPlayer);
+
+	// Called for players that just joined and for the ones that came with a seamless travel: either way, they are in
+	if (UBlasterTravelSubsystem* TravelSubsystem = GetGameInstance()->GetSubsystem<UBlasterTravelSubsystem>())
+		TravelSubsystem->NotifyPlayerArrived(NewPlayer);
+}
+
+void ABlasterGameMode::Logout(AController* Exiting)
+{
+	// A player who drops during a server travel won't arrive
+	if (Exiting && Exiting->IsA<APlayerController>())
+	{
+		if (UBlasterTravelSubsystem* TravelSubsystem = GetGameInstance()->GetSubsystem<UBlasterTravelSubsystem>())
+			TravelSubsystem->NotifyPlayerLeft();
+	}
+
+	Super::Logout(Exiting);
+}
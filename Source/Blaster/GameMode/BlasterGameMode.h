@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameMode.h"
+#include "BlasterGameMode.generated.h"
+
+/**
+ * Game mode of the lobby and the match (picked by map prefix, see GameModeMapPrefixes in DefaultEngine.ini).
+ *
+ * Extra: Travels seamlessly, so going from the lobby to the match keeps every connection, player controller and
+ * ABlasterPlayerState (loadout included) instead of disconnecting the whole lobby and having every client join again.
+ * "Blaster.SeamlessTravel 0" goes back to hard travel, to compare how long clients take to be back in the game
+ * (UBlasterTravelSubsystem measures both).
+ *
+ * There is no transition map asset: with TransitionMap empty the engine travels through an empty world,
+ * which is the cheapest transition there is.
+ */
+UCLASS()
+class BLASTER_API ABlasterGameMode : public AGameMode
+{
+	GENERATED_BODY()
+
+public:
+	ABlasterGameMode();
+
+	virtual void ProcessServerTravel(const FString& URL, bool bAbsolute = false) override;
+	virtual void HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer) override;
+	virtual void Logout(AController* Exiting) override;
+};
@@ -0,0 +1,297 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterLoadTestSubsystem.h"
+#include "Blaster.h" // Who needs: LogBlaster
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/Character/BlasterCharacterMovementComponent.h" // Who needs: ConsumeCorrectionWindow
+#include "Blaster/Net/BlasterReplicationGraph.h" // Who needs: GetLastReplicationTimeMs
+#include "Blaster/Weapon/BlasterHitscanSubsystem.h" // Who needs: GetLastFrameTraceCount, GetLastFrameTraceMs
+#include "Engine/NetConnection.h" // Who needs: OutTotalBytes, InTotalBytes
+#include "Engine/NetDriver.h"
+#include "EngineUtils.h" // Who needs: TActorIterator
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h" // Who needs: GetPlayerName
+#include "EnhancedInputSubsystems.h" // Who needs: UEnhancedInputLocalPlayerSubsystem
+#include "InputActionValue.h"
+#include "Misc/App.h" // Who needs: FApp::GetDeltaTime
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	bool IsLoadTestServer()
+	{
+		return FParse::Param(FCommandLine::Get(), TEXT("LoadTest"));
+	}
+
+	bool IsLoadTestBot()
+	{
+		return FParse::Param(FCommandLine::Get(), TEXT("LoadTestBot"));
+	}
+}
+
+bool UBlasterLoadTestSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return (IsLoadTestServer() || IsLoadTestBot()) && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UBlasterLoadTestSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UBlasterLoadTestSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bServer = IsLoadTestServer();
+	bBot = IsLoadTestBot();
+
+	if (bServer)
+	{
+		// Extra: Actor ticks only. From the first tick group to the last one, so replication (which runs after,
+		// in the net driver's TickFlush) is not counted twice.
+		WorldTickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &ThisClass::OnWorldTickStart);
+		WorldPostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ThisClass::OnWorldPostActorTick);
+
+		// Every map gets its own world and so its own files (Lobby, then the match after ServerTravel)
+		RunName = FString::Printf(TEXT("LoadTest_%s_%s"), *FDateTime::Now().ToString(), *GetWorld()->GetMapName());
+		FParse::Value(FCommandLine::Get(), TEXT("LoadTestDuration="), Duration);
+		RunStartTime = WindowStartTime = FPlatformTime::Seconds();
+
+		SecondRows.Add(TEXT("Second,Clients,Frames,AvgFrameMs,MaxFrameMs,AvgWorldTickMs,MaxWorldTickMs,AvgReplicationMs,MaxReplicationMs,HitscanTraces,AvgHitscanMs,MaxHitscanMs,Corrections,AvgCorrectionCm,MaxCorrectionCm,AbsorbedErrors,RecoveredMoves,OutBytesPerSec,InBytesPerSec"));
+		ConnectionRows.Add(TEXT("Second,Connection,OutBytesPerSec,InBytesPerSec,PingMs"));
+
+		UE_LOG(LogBlaster, Log, TEXT("Load test: measuring %s%s"), *RunName,
+			Duration > 0.0 ? *FString::Printf(TEXT(" for %.0f s"), Duration) : TEXT(""));
+	}
+
+	if (bBot)
+	{
+		int32 Seed{ 0 };
+		FParse::Value(FCommandLine::Get(), TEXT("LoadTestBotSeed="), Seed);
+		BotRandom.Initialize(Seed);
+		UE_LOG(LogBlaster, Log, TEXT("Load test: bot with seed %d"), Seed);
+	}
+}
+
+void UBlasterLoadTestSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(WorldTickStartHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(WorldPostActorTickHandle);
+
+	if (bServer)
+		WriteReport();
+
+	Super::Deinitialize();
+}
+
+TStatId UBlasterLoadTestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBlasterLoadTestSubsystem, STATGROUP_Tickables);
+}
+
+void UBlasterLoadTestSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (bServer && GetWorld()->GetNetMode() != NM_Client)
+		TickServer(DeltaTime);
+
+	if (bBot)
+		TickBot(DeltaTime);
+}
+
+//
+// Server
+//
+
+void UBlasterLoadTestSubsystem::OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == GetWorld())
+		WorldTickStartTime = FPlatformTime::Seconds();
+}
+
+void UBlasterLoadTestSubsystem::OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == GetWorld() && WorldTickStartTime > 0.0)
+		LastWorldTickMs = (FPlatformTime::Seconds() - WorldTickStartTime) * 1000.0;
+}
+
+void UBlasterLoadTestSubsystem::TickServer(float DeltaTime)
+{
+	if (bReportWritten) return;
+
+	// Extra: FApp's delta is the whole frame (game thread wait included), DeltaTime can be dilated/clamped
+	const double FrameMs{ FApp::GetDeltaTime() * 1000.0 };
+
+	// Replication of the last frame. It runs after the tickables, in UNetDriver::TickFlush.
+	double ReplicationMs{ 0.0 };
+	if (const UNetDriver* NetDriver = GetWorld()->GetNetDriver())
+	{
+		if (const UBlasterReplicationGraph* Graph = Cast<UBlasterReplicationGraph>(NetDriver->GetReplicationDriver()))
+			ReplicationMs = Graph->GetLastReplicationTimeMs();
+	}
+
+	int32 HitscanTraces{ 0 };
+	double HitscanMs{ 0.0 };
+	if (const UBlasterHitscanSubsystem* HitscanSubsystem = GetWorld()->GetSubsystem<UBlasterHitscanSubsystem>())
+	{
+		HitscanTraces = HitscanSubsystem->GetLastFrameTraceCount();
+		HitscanMs = HitscanSubsystem->GetLastFrameTraceMs();
+	}
+
+	++Window.Frames;
+	Window.FrameMs += FrameMs;
+	Window.MaxFrameMs = FMath::Max(Window.MaxFrameMs, FrameMs);
+	Window.WorldTickMs += LastWorldTickMs;
+	Window.MaxWorldTickMs = FMath::Max(Window.MaxWorldTickMs, LastWorldTickMs);
+	Window.ReplicationMs += ReplicationMs;
+	Window.MaxReplicationMs = FMath::Max(Window.MaxReplicationMs, ReplicationMs);
+	Window.HitscanTraces += HitscanTraces;
+	Window.HitscanMs += HitscanMs;
+	Window.MaxHitscanMs = FMath::Max(Window.MaxHitscanMs, HitscanMs);
+
+	const double Now{ FPlatformTime::Seconds() };
+	if (Now - WindowStartTime >= 1.0)
+		SampleSecond();
+
+	if (Duration > 0.0 && Now - RunStartTime >= Duration)
+	{
+		WriteReport();
+		UE_LOG(LogBlaster, Log, TEXT("Load test: %.0f s done, exiting"), Duration);
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UBlasterLoadTestSubsystem::SampleSecond()
+{
+	const double Now{ FPlatformTime::Seconds() };
+	const double WindowSeconds{ Now - WindowStartTime };
+	const int32 Second{ FMath::RoundToInt32(Now - RunStartTime) };
+
+	int32 Clients{ 0 };
+	int64 TotalOut{ 0 };
+	int64 TotalIn{ 0 };
+	TMap<TWeakObjectPtr<UNetConnection>, FConnectionTotals> ConnectionTotals;
+	if (const UNetDriver* NetDriver = GetWorld()->GetNetDriver())
+	{
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (!Connection) continue;
+			++Clients;
+
+			const FConnectionTotals Totals{ Connection->OutTotalBytes, Connection->InTotalBytes };
+			ConnectionTotals.Add(Connection, Totals);
+
+			// New connections count from their first sample
+			const FConnectionTotals* Last = LastConnectionTotals.Find(Connection);
+			if (!Last) continue;
+
+			const int64 Out{ Totals.OutBytes - Last->OutBytes };
+			const int64 In{ Totals.InBytes - Last->InBytes };
+			TotalOut += Out;
+			TotalIn += In;
+
+			const APlayerController* PlayerController = Connection->PlayerController;
+			const FString Name = PlayerController && PlayerController->PlayerState ?
+				PlayerController->PlayerState->GetPlayerName() : Connection->LowLevelGetRemoteAddress(true);
+			ConnectionRows.Add(FString::Printf(TEXT("%d,%s,%.0f,%.0f,%.1f"), Second, *Name,
+				Out / WindowSeconds, In / WindowSeconds, Connection->AvgLag * 1000.0));
+		}
+	}
+	LastConnectionTotals = MoveTemp(ConnectionTotals);
+
+	// Server side corrections of all the characters this second
+	FBlasterCorrectionStats Corrections;
+	for (TActorIterator<ABlasterCharacter> It(GetWorld()); It; ++It)
+	{
+		if (UBlasterCharacterMovementComponent* Movement = Cast<UBlasterCharacterMovementComponent>(It->GetCharacterMovement()))
+			Corrections.Accumulate(Movement->ConsumeCorrectionWindow());
+	}
+
+	const int32 Frames{ FMath::Max(Window.Frames, 1) };
+	SecondRows.Add(FString::Printf(TEXT("%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%.3f,%.3f,%d,%.2f,%.2f,%d,%d,%.0f,%.0f"),
+		Second, Clients, Window.Frames,
+		Window.FrameMs / Frames, Window.MaxFrameMs,
+		Window.WorldTickMs / Frames, Window.MaxWorldTickMs,
+		Window.ReplicationMs / Frames, Window.MaxReplicationMs,
+		Window.HitscanTraces, Window.HitscanMs / Frames, Window.MaxHitscanMs,
+		Corrections.Corrections, Corrections.GetAverageErrorCm(), Corrections.MaxErrorCm, Corrections.Absorbed, Corrections.RecoveredMoves,
+		TotalOut / WindowSeconds, TotalIn / WindowSeconds));
+
+	Window = FWindow();
+	WindowStartTime = Now;
+}
+
+void UBlasterLoadTestSubsystem::WriteReport()
+{
+	if (bReportWritten || SecondRows.Num() <= 1) return;
+	bReportWritten = true;
+
+	const FString Dir = FPaths::ProfilingDir();
+	const FString SecondsFile = FPaths::Combine(Dir, RunName + TEXT(".csv"));
+	const FString ConnectionsFile = FPaths::Combine(Dir, RunName + TEXT("_Connections.csv"));
+	const bool bWritten = FFileHelper::SaveStringArrayToFile(SecondRows, *SecondsFile)
+		&& FFileHelper::SaveStringArrayToFile(ConnectionRows, *ConnectionsFile);
+
+	if (bWritten)
+	{
+		UE_LOG(LogBlaster, Log, TEXT("Load test: %d seconds written to %s"), SecondRows.Num() - 1, *SecondsFile);
+	}
+	else
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("Load test: couldn't write %s"), *SecondsFile);
+	}
+}
+
+//
+// Bot
+//
+
+void UBlasterLoadTestSubsystem::TickBot(float DeltaTime)
+{
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (!PlayerController || !PlayerController->IsLocalController()) return;
+
+	ABlasterCharacter* Character = Cast<ABlasterCharacter>(PlayerController->GetPawn());
+	if (!Character || !Character->GetMoveAction()) return;
+
+	UEnhancedInputLocalPlayerSubsystem* InputSubsystem =
+		ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer());
+	if (!InputSubsystem) return;
+
+	BotTime += DeltaTime;
+
+	// Extra: A new leg every 2-5 s: walk in some direction while turning a bit, like a player looking around
+	if (BotTime >= BotLegEndTime)
+	{
+		const float Angle = BotRandom.FRandRange(0.f, 2.f * PI);
+		BotMoveDirection = FVector2D(FMath::Sin(Angle), FMath::Cos(Angle));
+		BotTurnRate = BotRandom.FRandRange(-1.f, 1.f);
+		BotLegEndTime = BotTime + BotRandom.FRandRange(2.f, 5.f);
+
+		if (Character->GetJumpAction() && BotRandom.FRand() < 0.3f)
+			InputSubsystem->InjectInputForAction(Character->GetJumpAction(), FInputActionValue(true));
+	}
+
+	InputSubsystem->InjectInputForAction(Character->GetMoveAction(), FInputActionValue(BotMoveDirection));
+	if (Character->GetLookAction())
+	{
+		// Small pitch wobble, so the aim offset replicates too
+		const FVector2D Look{ BotTurnRate, FMath::Sin(BotTime) * 0.2 };
+		InputSubsystem->InjectInputForAction(Character->GetLookAction(), FInputActionValue(Look));
+	}
+
+	// Extra: Shoot where it looks, ~4 shots per second, so the server validates hitscan shots under load too
+	if (BotTime >= BotNextShotTime)
+	{
+		FVector EyeLocation;
+		FRotator EyeRotation;
+		Character->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+		Character->FireHitscan(EyeLocation, EyeRotation.Vector());
+		BotNextShotTime = BotTime + BotRandom.FRandRange(0.15f, 0.35f);
+	}
+}
@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BlasterLoadTestSubsystem.generated.h"
+
+class UNetConnection;
+
+/**
+ * Load test harness, in two halves. Both are off unless the process is started for a load test
+ * (see Scripts/LoadTest.sh, which starts one server and N -nullrhi clients on localhost over the IP net driver).
+ *
+ * Server (-LoadTest): samples every frame the world tick time (actor ticks), the replication time
+ * (UBlasterReplicationGraph), the hitscan validation (UBlasterHitscanSubsystem), the movement corrections
+ * (UBlasterCharacterMovementComponent) and the frame time, and once per second the bytes sent/received by each connection.
+ * Writes Saved/Profiling/LoadTest_<Run>.csv (one row per second) and LoadTest_<Run>_Connections.csv (one row per
+ * connection per second). -LoadTestDuration=<seconds> quits when done, for unattended runs.
+ *
+ * Client (-LoadTestBot): once it possesses an ABlasterCharacter, drives it with scripted movement by injecting
+ * Enhanced Input into its Move/Look/Jump actions, so the bot goes through the same input path as a player.
+ * It also fires hitscan shots a few times per second.
+ * -LoadTestBotSeed=<n> gives each client its own path.
+ */
+UCLASS()
+class BLASTER_API UBlasterLoadTestSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Writes what was sampled so far. Called on Deinitialize too.
+	void WriteReport();
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	bool bServer{ false };
+	bool bBot{ false };
+
+	//
+	// Server
+	//
+	void TickServer(float DeltaTime);
+	void SampleSecond();
+	void OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+
+	FDelegateHandle WorldTickStartHandle;
+	FDelegateHandle WorldPostActorTickHandle;
+	double WorldTickStartTime{ 0.0 };
+	double LastWorldTickMs{ 0.0 };
+
+	FString RunName;
+	double RunStartTime{ 0.0 };
+	double Duration{ 0.0 };
+	bool bReportWritten{ false };
+
+	// Accumulated over the current second
+	struct FWindow
+	{
+		int32 Frames{ 0 };
+		double FrameMs{ 0.0 };
+		double MaxFrameMs{ 0.0 };
+		double WorldTickMs{ 0.0 };
+		double MaxWorldTickMs{ 0.0 };
+		double ReplicationMs{ 0.0 };
+		double MaxReplicationMs{ 0.0 };
+		int32 HitscanTraces{ 0 };
+		double HitscanMs{ 0.0 };
+		double MaxHitscanMs{ 0.0 };
+	};
+	FWindow Window;
+	double WindowStartTime{ 0.0 };
+
+	struct FConnectionTotals
+	{
+		int64 OutBytes{ 0 };
+		int64 InBytes{ 0 };
+	};
+	TMap<TWeakObjectPtr<UNetConnection>, FConnectionTotals> LastConnectionTotals;
+
+	// CSV rows, written at the end (no file IO while measuring)
+	TArray<FString> SecondRows;
+	TArray<FString> ConnectionRows;
+
+	//
+	// Bot
+	//
+	void TickBot(float DeltaTime);
+
+	FRandomStream BotRandom;
+	double BotTime{ 0.0 };
+	// Current leg of the scripted path: a direction held for a few seconds
+	FVector2D BotMoveDirection{ 0.0, 1.0 };
+	double BotLegEndTime{ 0.0 };
+	float BotTurnRate{ 0.f };
+	double BotNextShotTime{ 0.0 };
+};
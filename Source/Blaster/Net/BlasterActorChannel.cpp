@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterActorChannel.h"
+#include "BlasterNetProfiler.h"
+#include "Net/DataBunch.h" // Who needs: FOutBunch
+
+int64 UBlasterActorChannel::ReplicateActor()
+{
+	if (!FBlasterNetProfiler::IsEnabled())
+		return Super::ReplicateActor();
+
+	// The actor can be gone once it returns (channel closed)
+	const AActor* ReplicatedActor = Actor;
+	bReplicatingActor = true;
+	const int64 Bits = Super::ReplicateActor();
+	bReplicatingActor = false;
+
+	if (ReplicatedActor)
+		FBlasterNetProfiler::RecordReplicateActor(ReplicatedActor, Connection, Bits);
+	return Bits;
+}
+
+FPacketIdRange UBlasterActorChannel::SendBunch(FOutBunch* Bunch, bool Merge)
+{
+	// Property bunches are counted as a whole by ReplicateActor
+	if (FBlasterNetProfiler::IsEnabled() && !bReplicatingActor && Actor && Bunch)
+		FBlasterNetProfiler::RecordRpcBunch(Actor, Connection, Bunch->GetNumBits());
+
+	return Super::SendBunch(Bunch, Merge);
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/ActorChannel.h"
+#include "BlasterActorChannel.generated.h"
+
+/**
+ * Actor channel that reports what it sends to FBlasterNetProfiler: the property bunches of ReplicateActor, and
+ * every other bunch (RPCs). Set as the "Actor" channel class in DefaultEngine.ini. Behaves exactly like the stock
+ * channel while the profiler is off.
+ */
+UCLASS(Transient)
+class BLASTER_API UBlasterActorChannel : public UActorChannel
+{
+	GENERATED_BODY()
+
+public:
+	virtual int64 ReplicateActor() override;
+	virtual FPacketIdRange SendBunch(FOutBunch* Bunch, bool Merge) override;
+
+private:
+	bool bReplicatingActor{ false };
+};
@@ -0,0 +1,265 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterAdaptiveNetUpdate.h"
+#include "BlasterReplicationGraph.h" // Who needs: UBlasterReplicationGraph, UNetReplicationGraphConnection, FNetViewer
+#include "Blaster.h" // Who needs: LogBlaster, STATGROUP_Blaster
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h" // Who needs: TActorIterator
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h" // Who needs: FApp::GetDeltaTime, FApp::GetIdleTime
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+DECLARE_CYCLE_STAT(TEXT("Adaptive Net Update"), STAT_BlasterAdaptiveNetUpdate, STATGROUP_Blaster);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Net Update Pressure"), STAT_BlasterNetUpdatePressure, STATGROUP_Blaster);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Server Busy Time (ms, smoothed)"), STAT_BlasterServerBusyMs, STATGROUP_Blaster);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Character Net Update Rate (Hz, avg)"), STAT_BlasterCharacterNetUpdateHz, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Character/Connection Pairs"), STAT_BlasterNetUpdatePairs, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Character/Connection Pairs Degraded"), STAT_BlasterNetUpdateDegradedPairs, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Saturated Connections"), STAT_BlasterSaturatedConnections, STATGROUP_Blaster);
+CSV_DEFINE_CATEGORY(BlasterNetUpdate, true);
+
+namespace BlasterAdaptiveNetUpdate
+{
+	static int32 Adaptive{ 1 };
+	static FAutoConsoleVariableRef CVarAdaptive(
+		TEXT("Blaster.NetUpdate.Adaptive"),
+		Adaptive,
+		TEXT("0: every character replicates at its full rate to every connection, whatever the server load (the adaptive controller only measures)."));
+
+	static FAutoConsoleCommandWithWorld ReportCommand(
+		TEXT("Blaster.NetUpdate.Report"),
+		TEXT("Prints the server frame and replication time per net update pressure level, and writes it as CSV to Saved/Profiling."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](const UWorld* World)
+		{
+			const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+			const UBlasterReplicationGraph* Graph = NetDriver ? Cast<UBlasterReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+			if (!Graph)
+			{
+				UE_LOG(LogBlaster, Warning, TEXT("Blaster.NetUpdate.Report: no UBlasterReplicationGraph running (not a server?)"));
+				return;
+			}
+			Graph->GetNetUpdateController().Report();
+		}));
+
+	// Smoothing of the busy time and the saturation, per frame
+	constexpr float Smoothing{ 0.1f };
+
+	struct FCharacterInfo
+	{
+		ABlasterCharacter* Character;
+		FVector Location;
+		float BaseFrequency;
+		uint32 BasePeriod;
+		bool bInCombat;
+	};
+}
+
+void FBlasterAdaptiveNetUpdate::Update(UBlasterReplicationGraph& Graph, const FBlasterAdaptiveNetUpdateSettings& Settings, const float TargetFrameMs, const float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterAdaptiveNetUpdate);
+	using namespace BlasterAdaptiveNetUpdate;
+
+	// Time the game thread worked last frame, without what it slept to hold the tick rate. Over the target, the tick
+	// rate is what gives next.
+	LastBusyMs = FMath::Max(FApp::GetDeltaTime() - FApp::GetIdleTime(), 0.0) * 1000.0;
+	SmoothedBusyMs = SmoothedBusyMs > 0.0 ? FMath::Lerp(SmoothedBusyMs, LastBusyMs, static_cast<double>(Smoothing)) : LastBusyMs;
+
+	// A connection that still has bits queued from the last frames can't take more this one. Only tracked while the
+	// controller runs: nothing reads it otherwise.
+	const bool bEnabled = Settings.bEnabled && Adaptive != 0 && (Settings.bOnListenServers || IsRunningDedicatedServer());
+	if (bEnabled)
+	{
+		for (UNetReplicationGraphConnection* ConnectionManager : Graph.Connections)
+		{
+			UNetConnection* Connection = ConnectionManager ? ConnectionManager->NetConnection : nullptr;
+			if (!Connection) continue;
+
+			float& Saturation = ConnectionSaturation.FindOrAdd(ConnectionManager);
+			Saturation = FMath::Lerp(Saturation, Connection->IsNetReady(false) ? 0.f : 1.f, Smoothing);
+		}
+	}
+	else
+	{
+		ConnectionSaturation.Reset();
+	}
+
+	TimeSinceStep += DeltaSeconds;
+	if (TimeSinceStep < FMath::Max(Settings.ControlInterval, 0.05f)) return;
+	const float Interval = TimeSinceStep;
+	TimeSinceStep = 0.f;
+
+	// Closed connections
+	for (auto It = ConnectionSaturation.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().ResolveObjectPtr()) It.RemoveCurrent();
+	}
+
+	if (bEnabled)
+		UpdatePressure(Settings, TargetFrameMs, Interval);
+	else
+		Pressure = 0.f;
+
+	// Once more after it's turned off, to put the full rates back
+	if (bEnabled || bApplied)
+		Apply(Graph, Settings, bEnabled);
+
+	SET_FLOAT_STAT(STAT_BlasterNetUpdatePressure, Pressure);
+	SET_FLOAT_STAT(STAT_BlasterServerBusyMs, SmoothedBusyMs);
+	SET_FLOAT_STAT(STAT_BlasterCharacterNetUpdateHz, AverageNetUpdateFrequency);
+	SET_DWORD_STAT(STAT_BlasterNetUpdatePairs, NumPairs);
+	SET_DWORD_STAT(STAT_BlasterNetUpdateDegradedPairs, NumDegradedPairs);
+	SET_DWORD_STAT(STAT_BlasterSaturatedConnections, NumSaturatedConnections);
+
+	const int32 Level = GetPressureLevel(Pressure);
+	if (Level != LastReportedLevel)
+	{
+		UE_LOG(LogBlaster, Log, TEXT("Adaptive net update: pressure %.2f (busy %.1f ms, target %.1f ms), %d of %d character/connection pairs degraded, %d connections saturated"),
+			Pressure, SmoothedBusyMs, TargetFrameMs, NumDegradedPairs, NumPairs, NumSaturatedConnections);
+		LastReportedLevel = Level;
+	}
+}
+
+void FBlasterAdaptiveNetUpdate::UpdatePressure(const FBlasterAdaptiveNetUpdateSettings& Settings, const float TargetFrameMs, const float Interval)
+{
+	const double Target = FMath::Max(TargetFrameMs, 1.f);
+	const double Overload = (SmoothedBusyMs - Target) / Target;
+	if (Overload > 0.0)
+		Pressure += static_cast<float>(FMath::Min(Overload, 1.0)) * Settings.RiseRate * Interval;
+	else if (SmoothedBusyMs < Target * (1.0 - Settings.RecoverMargin))
+		Pressure -= Settings.RecoverRate * Interval;
+	// In between: hold, it's where the controller should settle
+
+	Pressure = FMath::Clamp(Pressure, 0.f, 1.f);
+}
+
+void FBlasterAdaptiveNetUpdate::Apply(UBlasterReplicationGraph& Graph, const FBlasterAdaptiveNetUpdateSettings& Settings, const bool bEnabled)
+{
+	using namespace BlasterAdaptiveNetUpdate;
+
+	UWorld* World = Graph.GetWorld();
+	if (!World) return;
+
+	const double Now = World->GetTimeSeconds();
+	TArray<FCharacterInfo> Characters;
+	for (TActorIterator<ABlasterCharacter> It(World); It; ++It)
+	{
+		ABlasterCharacter* Character = *It;
+		const double LastCombatTime = Character->GetLastCombatTime();
+		const bool bInCombat = LastCombatTime >= 0.0 && Now - LastCombatTime <= Settings.CombatWindow;
+		// Whoever just started fighting goes first in the next replication frame
+		if (bEnabled && bInCombat && LastCombatTime > LastStepWorldTime)
+			Character->ForceNetUpdate();
+
+		const float BaseFrequency = Character->NetUpdateFrequency;
+		Characters.Add({ Character, Character->GetActorLocation(), BaseFrequency, Graph.GetReplicationPeriodFrameForFrequency(BaseFrequency), bInCombat });
+	}
+	LastStepWorldTime = Now;
+
+	const float CosViewCone = FMath::Cos(FMath::DegreesToRadians(FMath::Clamp(Settings.ViewConeHalfAngle, 0.f, 180.f)));
+	const float DistanceRange = FMath::Max(Settings.FarDistance - Settings.NearDistance, 1.f);
+	const uint32 FrameNum = Graph.GetReplicationGraphFrame();
+	double FrequencySum{ 0.0 };
+	NumPairs = 0;
+	NumDegradedPairs = 0;
+	NumSaturatedConnections = 0;
+
+	for (UNetReplicationGraphConnection* ConnectionManager : Graph.Connections)
+	{
+		UNetConnection* Connection = ConnectionManager ? ConnectionManager->NetConnection : nullptr;
+		if (!Connection || !Connection->ViewTarget) continue;
+
+		const float Saturation = ConnectionSaturation.FindRef(ConnectionManager);
+		if (Saturation > 0.5f) ++NumSaturatedConnections;
+		const float ConnectionPressure = bEnabled ? FMath::Clamp(Pressure + Saturation * Settings.SaturationWeight, 0.f, 1.f) : 0.f;
+		const FNetViewer Viewer(Connection, 0.f);
+
+		for (const FCharacterInfo& Info : Characters)
+		{
+			// Not relevant to this connection yet: the graph sets it up from the class when it is
+			FConnectionReplicationActorInfo* ActorInfo = ConnectionManager->ActorInfoMap.Find(Info.Character);
+			if (!ActorInfo) continue;
+
+			float Frequency = Info.BaseFrequency;
+			// The connection's own pawn (or what it looks through) is never degraded
+			const bool bOwn = Info.Character == Viewer.ViewTarget || Info.Character->GetNetConnection() == Connection;
+			if (ConnectionPressure > 0.f && !Info.bInCombat && !bOwn)
+			{
+				const FVector ToCharacter = Info.Location - Viewer.ViewLocation;
+				const float Distance = ToCharacter.Size();
+				float Importance = 1.f - FMath::Clamp((Distance - Settings.NearDistance) / DistanceRange, 0.f, 1.f);
+				if (Distance > UE_KINDA_SMALL_NUMBER && FVector::DotProduct(Viewer.ViewDir, ToCharacter / Distance) < CosViewCone)
+					Importance *= Settings.OffViewImportance;
+
+				const float MinFrequency = FMath::Clamp(Settings.MinNetUpdateFrequency, 1.f, Info.BaseFrequency);
+				Frequency = FMath::Lerp(Info.BaseFrequency, MinFrequency, ConnectionPressure * (1.f - Importance));
+			}
+
+			const uint32 Period = Frequency < Info.BaseFrequency ? FMath::Max<uint32>(Graph.GetReplicationPeriodFrameForFrequency(Frequency), 1) : Info.BasePeriod;
+			ActorInfo->ReplicationPeriodFrame = static_cast<decltype(ActorInfo->ReplicationPeriodFrame)>(Period);
+			// A rate going back up applies now, not after the last (long) period
+			ActorInfo->NextReplicationFrameNum = FMath::Min<uint32>(ActorInfo->NextReplicationFrameNum, FrameNum + Period);
+
+			++NumPairs;
+			if (Period > Info.BasePeriod) ++NumDegradedPairs;
+			FrequencySum += Frequency;
+		}
+	}
+
+	AverageNetUpdateFrequency = NumPairs > 0 ? static_cast<float>(FrequencySum / NumPairs) : 0.f;
+	bApplied = bEnabled;
+}
+
+void FBlasterAdaptiveNetUpdate::RecordFrame(const double ReplicationMs)
+{
+	CSV_CUSTOM_STAT(BlasterNetUpdate, Pressure, Pressure, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(BlasterNetUpdate, ServerBusyMs, LastBusyMs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(BlasterNetUpdate, DegradedPairs, NumDegradedPairs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(BlasterNetUpdate, SaturatedConnections, NumSaturatedConnections, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(BlasterNetUpdate, AvgCharacterNetUpdateHz, AverageNetUpdateFrequency, ECsvCustomStatOp::Set);
+
+	FPressureLevelBucket& Bucket = PressureLevels[GetPressureLevel(Pressure)];
+	++Bucket.Frames;
+	Bucket.TotalBusyMs += LastBusyMs;
+	Bucket.MaxBusyMs = FMath::Max(Bucket.MaxBusyMs, LastBusyMs);
+	Bucket.TotalReplicationMs += ReplicationMs;
+	Bucket.TotalNetUpdateFrequency += AverageNetUpdateFrequency;
+}
+
+bool FBlasterAdaptiveNetUpdate::HasFrames() const
+{
+	for (const FPressureLevelBucket& Bucket : PressureLevels)
+	{
+		if (Bucket.Frames > 0) return true;
+	}
+	return false;
+}
+
+void FBlasterAdaptiveNetUpdate::Report() const
+{
+	FString Csv = TEXT("Pressure,Frames,AvgBusyMs,MaxBusyMs,AvgReplicationMs,AvgCharacterNetUpdateHz\n");
+
+	UE_LOG(LogBlaster, Log, TEXT("Server frame time per net update pressure level:"));
+	UE_LOG(LogBlaster, Log, TEXT("%10s %10s %12s %12s %12s %12s"), TEXT("Pressure"), TEXT("Frames"), TEXT("Avg busy ms"), TEXT("Max busy ms"), TEXT("Avg rep ms"), TEXT("Avg Hz"));
+	for (int32 Level = 0; Level < NumPressureLevels; ++Level)
+	{
+		const FPressureLevelBucket& Bucket = PressureLevels[Level];
+		if (Bucket.Frames == 0) continue;
+
+		const int32 Percent = Level * 100 / (NumPressureLevels - 1);
+		const double AvgBusyMs = Bucket.TotalBusyMs / Bucket.Frames;
+		const double AvgReplicationMs = Bucket.TotalReplicationMs / Bucket.Frames;
+		const double AvgFrequency = Bucket.TotalNetUpdateFrequency / Bucket.Frames;
+		UE_LOG(LogBlaster, Log, TEXT("%9d%% %10lld %12.3f %12.3f %12.3f %12.1f"), Percent, Bucket.Frames, AvgBusyMs, Bucket.MaxBusyMs, AvgReplicationMs, AvgFrequency);
+		Csv += FString::Printf(TEXT("%d,%lld,%.4f,%.4f,%.4f,%.2f\n"), Percent, Bucket.Frames, AvgBusyMs, Bucket.MaxBusyMs, AvgReplicationMs, AvgFrequency);
+	}
+
+	const FString CsvPath = FPaths::ProfilingDir() / TEXT("BlasterAdaptiveNetUpdate.csv");
+	if (FFileHelper::SaveStringToFile(Csv, *CsvPath))
+		UE_LOG(LogBlaster, Log, TEXT("Wrote %s"), *CsvPath);
+}
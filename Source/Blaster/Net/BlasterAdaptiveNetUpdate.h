@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h" // Who needs: TObjectKey
+#include "BlasterAdaptiveNetUpdate.generated.h"
+
+class UBlasterReplicationGraph;
+class UNetReplicationGraphConnection;
+
+// Config of FBlasterAdaptiveNetUpdate (UBlasterReplicationGraph::AdaptiveNetUpdate in DefaultEngine.ini)
+USTRUCT()
+struct FBlasterAdaptiveNetUpdateSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	bool bEnabled{ true };
+
+	// Listen servers also render, so their frame time says little about replication. Off: dedicated servers only.
+	UPROPERTY()
+	bool bOnListenServers{ false };
+
+	// Busy time per server frame to defend (ms). 0: the frame time of the net driver's max tick rate.
+	UPROPERTY()
+	float TargetFrameMs{ 0.f };
+
+	// Seconds between two decisions
+	UPROPERTY()
+	float ControlInterval{ 0.25f };
+
+	// Pressure added per second when the frame takes twice the target (proportional below that)
+	UPROPERTY()
+	float RiseRate{ 1.f };
+
+	// Pressure removed per second once the frame is RecoverMargin under the target. Slower than the rise, so it
+	// doesn't oscillate around the target.
+	UPROPERTY()
+	float RecoverRate{ 0.25f };
+
+	UPROPERTY()
+	float RecoverMargin{ 0.1f };
+
+	// How much a connection that can't send everything it has (saturated every frame) adds to its own pressure
+	UPROPERTY()
+	float SaturationWeight{ 0.5f };
+
+	// Worst rate of a character nobody looks at, far away and out of combat, at full pressure (Hz)
+	UPROPERTY()
+	float MinNetUpdateFrequency{ 4.f };
+
+	// Closer than this, a character is fully important. Past FarDistance, not at all (cm).
+	UPROPERTY()
+	float NearDistance{ 1500.f };
+
+	UPROPERTY()
+	float FarDistance{ 8000.f };
+
+	// Half angle of the view cone (degrees). Behind the viewer, a character is worth OffViewImportance of what it
+	// would be in front.
+	UPROPERTY()
+	float ViewConeHalfAngle{ 60.f };
+
+	UPROPERTY()
+	float OffViewImportance{ 0.5f };
+
+	// A character that fired or was hit this recently keeps its full rate, whatever the pressure (seconds)
+	UPROPERTY()
+	float CombatWindow{ 3.f };
+};
+
+/**
+ * Extra: Spends the server's replication time where it matters once the server runs out of frame time, instead of
+ * evenly across every character and connection, and lets the update rate of the least important ones fall before
+ * the tick rate does.
+ *
+ * A pressure level (0 to 1) rises while the busy time of a server frame is over the target and falls once it's back
+ * under. Each connection adds its own saturation. Every ControlInterval, each ABlasterCharacter gets a replication
+ * period per connection: its full NetUpdateFrequency at no pressure, down to MinNetUpdateFrequency at full pressure
+ * for a character that is far, out of view and out of combat. Characters in combat, and each connection's own
+ * pawn, always keep their full rate. Entering combat forces a net update (the graph's priority boost).
+ *
+ * "stat Blaster" shows the decisions, the CSV profiler gets them every frame (BlasterNetUpdate category), and
+ * "Blaster.NetUpdate.Report" prints server frame and replication time per pressure level (also written as CSV).
+ * "Blaster.NetUpdate.Adaptive 0" turns it off at runtime, for comparisons.
+ */
+class FBlasterAdaptiveNetUpdate
+{
+public:
+	// Before the graph replicates. TargetFrameMs: the settings' or the graph's default.
+	void Update(UBlasterReplicationGraph& Graph, const FBlasterAdaptiveNetUpdateSettings& Settings, float TargetFrameMs, float DeltaSeconds);
+	// After the graph replicated
+	void RecordFrame(double ReplicationMs);
+
+	float GetPressure() const { return Pressure; }
+	bool HasFrames() const;
+
+	// Prints the frame time per pressure level and writes it as CSV to the profiling folder
+	void Report() const;
+
+private:
+	static constexpr int32 NumPressureLevels{ 5 }; // 0, up to 25%, 50%, 75%, 100%
+
+	float Pressure{ 0.f };
+	double SmoothedBusyMs{ 0.0 };
+	double LastBusyMs{ 0.0 };
+	float TimeSinceStep{ 0.f };
+	double LastStepWorldTime{ 0.0 };
+	bool bApplied{ false };
+
+	// Fraction of recent frames each connection was saturated
+	TMap<TObjectKey<UNetReplicationGraphConnection>, float> ConnectionSaturation;
+
+	// Last decision, for the stats
+	int32 NumPairs{ 0 };
+	int32 NumDegradedPairs{ 0 };
+	int32 NumSaturatedConnections{ 0 };
+	float AverageNetUpdateFrequency{ 0.f };
+	int32 LastReportedLevel{ 0 };
+
+	struct FPressureLevelBucket
+	{
+		int64 Frames{ 0 };
+		double TotalBusyMs{ 0.0 };
+		double MaxBusyMs{ 0.0 };
+		double TotalReplicationMs{ 0.0 };
+		double TotalNetUpdateFrequency{ 0.0 };
+	};
+	FPressureLevelBucket PressureLevels[NumPressureLevels];
+
+	static int32 GetPressureLevel(float InPressure) { return FMath::Clamp(FMath::CeilToInt(InPressure * (NumPressureLevels - 1)), 0, NumPressureLevels - 1); }
+
+	void UpdatePressure(const FBlasterAdaptiveNetUpdateSettings& Settings, float TargetFrameMs, float Interval);
+	void Apply(UBlasterReplicationGraph& Graph, const FBlasterAdaptiveNetUpdateSettings& Settings, bool bEnabled);
+};
@@ -0,0 +1,237 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterNetProfiler.h"
+#include "Blaster.h" // Who needs: LogBlaster
+#include "GameFramework/Actor.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h" // Who needs: GetPlayerName
+#include "Engine/NetConnection.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+bool FBlasterNetProfiler::bEnabled{ false };
+
+namespace BlasterNetProfiler
+{
+	static int32 WindowSeconds{ 10 };
+	static FAutoConsoleVariableRef CVarWindow(
+		TEXT("Blaster.NetProfile.Window"),
+		WindowSeconds,
+		TEXT("Seconds covered by Blaster.NetProfile report/csv (rolling). Changing it restarts the profile."));
+
+	// One second of the rolling window
+	struct FBucket
+	{
+		int64 Second{ -1 };
+		TMap<FName, int64> ClassBits;
+		TMap<FName, int64> PropertyBits;
+		TMap<TWeakObjectPtr<const UNetConnection>, int64> ConnectionBits;
+
+		void Reset(const int64 InSecond)
+		{
+			Second = InSecond;
+			ClassBits.Reset();
+			PropertyBits.Reset();
+			ConnectionBits.Reset();
+		}
+	};
+
+	static TArray<FBucket> Buckets;
+	static double EnabledTime{ 0.0 };
+	static const UFunction* CurrentRpc{ nullptr };
+	// Bits reported by self-serializing properties during the ReplicateActor in progress
+	static int64 SelfSerializedBits{ 0 };
+
+	FBucket& GetCurrentBucket()
+	{
+		if (Buckets.Num() != FMath::Max(WindowSeconds, 1))
+		{
+			Buckets.Reset();
+			Buckets.SetNum(FMath::Max(WindowSeconds, 1));
+			EnabledTime = FPlatformTime::Seconds();
+		}
+
+		const int64 Second = static_cast<int64>(FPlatformTime::Seconds());
+		FBucket& Bucket = Buckets[Second % Buckets.Num()];
+		if (Bucket.Second != Second)
+			Bucket.Reset(Second);
+		return Bucket;
+	}
+
+	FName MakePropertyName(const UClass* Class, const TCHAR* Property)
+	{
+		return FName(FString::Printf(TEXT("%s.%s"), *GetNameSafe(Class), Property));
+	}
+
+	FString GetConnectionName(const UNetConnection* Connection)
+	{
+		if (!Connection) return TEXT("<closed>");
+		const APlayerController* PlayerController = Connection->PlayerController;
+		if (PlayerController && PlayerController->PlayerState)
+			return PlayerController->PlayerState->GetPlayerName();
+		return const_cast<UNetConnection*>(Connection)->LowLevelGetRemoteAddress(true);
+	}
+
+	// Window totals, in bytes
+	struct FTotals
+	{
+		TMap<FString, int64> Classes;
+		TMap<FString, int64> Properties;
+		TMap<FString, int64> Connections;
+		double Seconds{ 0.0 };
+	};
+
+	FTotals GatherTotals()
+	{
+		FTotals Totals;
+		const int64 Now = static_cast<int64>(FPlatformTime::Seconds());
+		for (const FBucket& Bucket : Buckets)
+		{
+			if (Bucket.Second < 0 || Now - Bucket.Second >= Buckets.Num()) continue;
+			for (const TPair<FName, int64>& Pair : Bucket.ClassBits) Totals.Classes.FindOrAdd(Pair.Key.ToString()) += Pair.Value;
+			for (const TPair<FName, int64>& Pair : Bucket.PropertyBits) Totals.Properties.FindOrAdd(Pair.Key.ToString()) += Pair.Value;
+			for (const TPair<TWeakObjectPtr<const UNetConnection>, int64>& Pair : Bucket.ConnectionBits) Totals.Connections.FindOrAdd(GetConnectionName(Pair.Key.Get())) += Pair.Value;
+		}
+
+		for (TMap<FString, int64>* Table : { &Totals.Classes, &Totals.Properties, &Totals.Connections })
+		{
+			for (TPair<FString, int64>& Pair : *Table) Pair.Value = (Pair.Value + 7) / 8;
+		}
+		Totals.Seconds = FMath::Clamp(FPlatformTime::Seconds() - EnabledTime, 1.0, static_cast<double>(Buckets.Num()));
+		return Totals;
+	}
+
+	void LogTable(const TCHAR* Title, TMap<FString, int64>& Table, const int32 TopN, const double Seconds)
+	{
+		Table.ValueSort(TGreater<int64>());
+		UE_LOG(LogBlaster, Log, TEXT("  %s"), Title);
+		int32 Row{ 0 };
+		for (const TPair<FString, int64>& Pair : Table)
+		{
+			if (Row++ >= TopN) break;
+			UE_LOG(LogBlaster, Log, TEXT("    %-56s %10lld B %10.0f B/s"), *Pair.Key, Pair.Value, Pair.Value / Seconds);
+		}
+	}
+
+	static FAutoConsoleCommand ProfileCommand(
+		TEXT("Blaster.NetProfile"),
+		TEXT("Blaster.NetProfile on|off|report [TopN]|csv: replicated bytes per actor class, property/RPC and connection over the last Blaster.NetProfile.Window seconds."),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const FString Action = Args.IsEmpty() ? TEXT("report") : Args[0];
+			if (Action == TEXT("on"))
+				FBlasterNetProfiler::SetEnabled(true);
+			else if (Action == TEXT("off"))
+				FBlasterNetProfiler::SetEnabled(false);
+			else if (Action == TEXT("csv"))
+				FBlasterNetProfiler::WriteCsv();
+			else
+				FBlasterNetProfiler::Report(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 10);
+		}));
+}
+
+void FBlasterNetProfiler::SetEnabled(const bool bInEnabled)
+{
+	if (bEnabled == bInEnabled) return;
+	bEnabled = bInEnabled;
+
+	// Nothing is kept while disabled
+	BlasterNetProfiler::Buckets.Empty();
+	BlasterNetProfiler::CurrentRpc = nullptr;
+	if (bEnabled)
+		BlasterNetProfiler::GetCurrentBucket();
+
+	UE_LOG(LogBlaster, Log, TEXT("Net profile %s"), bEnabled ? TEXT("on") : TEXT("off"));
+}
+
+void FBlasterNetProfiler::RecordReplicateActor(const AActor* Actor, const UNetConnection* Connection, const int64 Bits)
+{
+	// Self-serialized properties were recorded while it ran, the rest is everything else of the actor
+	const int64 SelfSerialized = BlasterNetProfiler::SelfSerializedBits;
+	BlasterNetProfiler::SelfSerializedBits = 0;
+	if (Bits <= 0) return;
+
+	BlasterNetProfiler::FBucket& Bucket = BlasterNetProfiler::GetCurrentBucket();
+	Bucket.ClassBits.FindOrAdd(Actor->GetClass()->GetFName()) += Bits;
+	Bucket.ConnectionBits.FindOrAdd(Connection) += Bits;
+	if (Bits > SelfSerialized)
+		Bucket.PropertyBits.FindOrAdd(BlasterNetProfiler::MakePropertyName(Actor->GetClass(), TEXT("(other properties)"))) += Bits - SelfSerialized;
+}
+
+void FBlasterNetProfiler::RecordRpcBunch(const AActor* Actor, const UNetConnection* Connection, const int64 Bits)
+{
+	const UFunction* Rpc = BlasterNetProfiler::CurrentRpc;
+	BlasterNetProfiler::FBucket& Bucket = BlasterNetProfiler::GetCurrentBucket();
+	Bucket.ClassBits.FindOrAdd(Actor->GetClass()->GetFName()) += Bits;
+	Bucket.ConnectionBits.FindOrAdd(Connection) += Bits;
+	Bucket.PropertyBits.FindOrAdd(BlasterNetProfiler::MakePropertyName(Actor->GetClass(),
+		Rpc ? *FString::Printf(TEXT("%s()"), *Rpc->GetName()) : TEXT("(other RPCs)"))) += Bits;
+}
+
+void FBlasterNetProfiler::RecordProperty(const UClass* Class, const TCHAR* PropertyName, const int64 Bits)
+{
+	BlasterNetProfiler::SelfSerializedBits += Bits;
+	BlasterNetProfiler::GetCurrentBucket().PropertyBits.FindOrAdd(BlasterNetProfiler::MakePropertyName(Class, PropertyName)) += Bits;
+}
+
+FBlasterNetProfiler::FScopedRpc::FScopedRpc(const UFunction* Function)
+{
+	if (!bEnabled) return;
+	Previous = BlasterNetProfiler::CurrentRpc;
+	BlasterNetProfiler::CurrentRpc = Function;
+}
+
+FBlasterNetProfiler::FScopedRpc::~FScopedRpc()
+{
+	if (!bEnabled) return;
+	BlasterNetProfiler::CurrentRpc = Previous;
+}
+
+void FBlasterNetProfiler::Report(const int32 TopN)
+{
+	if (!bEnabled)
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("Net profile is off (Blaster.NetProfile on)"));
+		return;
+	}
+
+	BlasterNetProfiler::FTotals Totals = BlasterNetProfiler::GatherTotals();
+	UE_LOG(LogBlaster, Log, TEXT("Net profile, last %.0f s:"), Totals.Seconds);
+	BlasterNetProfiler::LogTable(TEXT("Actor class"), Totals.Classes, TopN, Totals.Seconds);
+	BlasterNetProfiler::LogTable(TEXT("Property / RPC"), Totals.Properties, TopN, Totals.Seconds);
+	BlasterNetProfiler::LogTable(TEXT("Connection"), Totals.Connections, TopN, Totals.Seconds);
+}
+
+void FBlasterNetProfiler::WriteCsv()
+{
+	if (!bEnabled)
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("Net profile is off (Blaster.NetProfile on)"));
+		return;
+	}
+
+	BlasterNetProfiler::FTotals Totals = BlasterNetProfiler::GatherTotals();
+	TArray<FString> Rows;
+	Rows.Add(TEXT("Table,Name,Bytes,BytesPerSec"));
+	auto AddTable = [&Rows, &Totals](const TCHAR* Table, TMap<FString, int64>& Values)
+	{
+		Values.KeySort(TLess<FString>());
+		for (const TPair<FString, int64>& Pair : Values)
+			Rows.Add(FString::Printf(TEXT("%s,%s,%lld,%.0f"), Table, *Pair.Key, Pair.Value, Pair.Value / Totals.Seconds));
+	};
+	AddTable(TEXT("Class"), Totals.Classes);
+	AddTable(TEXT("Property"), Totals.Properties);
+	AddTable(TEXT("Connection"), Totals.Connections);
+
+	const FString Filename = FPaths::Combine(FPaths::ProfilingDir(), FString::Printf(TEXT("NetProfile_%s.csv"), *FDateTime::Now().ToString()));
+	if (FFileHelper::SaveStringArrayToFile(Rows, *Filename))
+	{
+		UE_LOG(LogBlaster, Log, TEXT("Net profile: %d rows written to %s"), Rows.Num() - 1, *Filename);
+	}
+	else
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("Net profile: couldn't write %s"), *Filename);
+	}
+}
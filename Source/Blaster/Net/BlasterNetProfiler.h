@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+class UFunction;
+class UNetConnection;
+
+/**
+ * Replicated bytes per actor class, per property / RPC and per connection, over a rolling window
+ * (Blaster.NetProfile.Window seconds). Fed by UBlasterActorChannel, which every actor channel is (DefaultEngine.ini).
+ *
+ * "Blaster.NetProfile on|off|report [TopN]|csv". report prints the top N of each table, csv writes every row to
+ * Saved/Profiling/NetProfile_<Date>.csv sorted by name, so two builds can be diffed.
+ *
+ * Properties: the engine doesn't tell which property a bit belongs to, so the structs with their own serialization
+ * (FBlasterRepMovement) report their bits themselves, and the rest of an actor's property bunches goes to
+ * "<Class>.(other properties)". RPCs are named by the actors that scope their calls (FScopedRpc).
+ *
+ * Disabled, every hook is a single branch on IsEnabled(). Game thread only, like replication.
+ */
+class BLASTER_API FBlasterNetProfiler
+{
+public:
+	static bool IsEnabled() { return bEnabled; }
+	static void SetEnabled(bool bInEnabled);
+
+	// Property bunches written by one UActorChannel::ReplicateActor
+	static void RecordReplicateActor(const AActor* Actor, const UNetConnection* Connection, int64 Bits);
+	// A bunch sent outside ReplicateActor: an RPC
+	static void RecordRpcBunch(const AActor* Actor, const UNetConnection* Connection, int64 Bits);
+	// One property that serializes itself, from its NetSerialize/NetDeltaSerialize
+	static void RecordProperty(const UClass* Class, const TCHAR* PropertyName, int64 Bits);
+
+	// Names the RPC bunches sent while in scope
+	struct FScopedRpc
+	{
+		explicit FScopedRpc(const UFunction* Function);
+		~FScopedRpc();
+
+	private:
+		const UFunction* Previous{ nullptr };
+	};
+
+	static void Report(int32 TopN);
+	static void WriteCsv();
+
+private:
+	static bool bEnabled;
+};
@@ -0,0 +1,330 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterRepMovement.h"
+#include "Blaster.h" // Who needs: LogBlaster
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/Character/BlasterCharacterTypes.h" // Who needs: EBlasterMovementFlags
+#include "BlasterNetProfiler.h"
+#include "Engine/NetConnection.h"
+#include "Engine/PackageMapClient.h"
+#include "HAL/IConsoleManager.h"
+
+namespace BlasterRepMovement
+{
+	// Flags that are worth sending. LocallyControlled means nothing on the other side.
+	constexpr uint8 ReplicatedFlagsMask = static_cast<uint8>(EBlasterMovementFlags::Crouched | EBlasterMovementFlags::Accelerating | EBlasterMovementFlags::InAir);
+	constexpr int32 NumFlagBits = 3;
+
+	//
+	// Signed value, bit-packed by magnitude:
+	//   0           -> 1 bit
+	//   otherwise   -> 1 bit + 2 bit size class + 6/10/16/32 bits (zigzag encoded)
+	// Deltas of a walking character are almost always in the first two classes.
+	//
+	constexpr int32 SizeClassBits[4] = { 6, 10, 16, 32 };
+
+	void SerializeSignedPacked(FArchive& Ar, int32& Value)
+	{
+		uint8 bNonZero = Value != 0;
+		Ar.SerializeBits(&bNonZero, 1);
+		if (!bNonZero)
+		{
+			Value = 0;
+			return;
+		}
+
+		uint32 ZigZag = Ar.IsSaving() ? (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31) : 0;
+		uint8 SizeClass = 0;
+		if (Ar.IsSaving())
+		{
+			while (SizeClass < 3 && ZigZag >= (1u << SizeClassBits[SizeClass])) ++SizeClass;
+		}
+		Ar.SerializeBits(&SizeClass, 2);
+		Ar.SerializeBits(&ZigZag, SizeClassBits[SizeClass & 3]);
+
+		if (Ar.IsLoading())
+		{
+			Value = static_cast<int32>((ZigZag >> 1) ^ (~(ZigZag & 1) + 1));
+		}
+	}
+
+	int32 QuantizeAngle(const double Degrees, const int32 Bits)
+	{
+		const int32 Steps = 1 << Bits;
+		return FMath::RoundToInt32(FRotator::ClampAxis(Degrees) * Steps / 360.0) & (Steps - 1);
+	}
+
+	double DequantizeAngle(const int32 Value, const int32 Bits)
+	{
+		return FRotator::NormalizeAxis(Value * 360.0 / (1 << Bits));
+	}
+
+	// Angles wrap, so take the shortest way around
+	int32 AngleDelta(const int32 New, const int32 Old, const int32 Bits)
+	{
+		const int32 Steps = 1 << Bits;
+		const int32 Half = Steps / 2;
+		return ((New - Old + Half) & (Steps - 1)) - Half;
+	}
+
+	int32 ApplyAngleDelta(const int32 Old, const int32 Delta, const int32 Bits)
+	{
+		return (Old + Delta) & ((1 << Bits) - 1);
+	}
+
+	// Writes State as a delta from Base (a keyframe is a delta from zero). Reading overwrites State.
+	void SerializeState(FArchive& Ar, FBlasterQuantizedMovement& State, const FBlasterQuantizedMovement& Base, const int32 RotationBits)
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			int32 Delta = State.Location[Axis] - Base.Location[Axis];
+			SerializeSignedPacked(Ar, Delta);
+			State.Location[Axis] = Base.Location[Axis] + Delta;
+		}
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			int32 Delta = State.Velocity[Axis] - Base.Velocity[Axis];
+			SerializeSignedPacked(Ar, Delta);
+			State.Velocity[Axis] = Base.Velocity[Axis] + Delta;
+		}
+
+		int32* const StateAngles[3] = { &State.ActorYaw, &State.AimPitch, &State.AimYaw };
+		const int32 BaseAngles[3] = { Base.ActorYaw, Base.AimPitch, Base.AimYaw };
+		for (int32 i = 0; i < 3; ++i)
+		{
+			int32 Delta = AngleDelta(*StateAngles[i], BaseAngles[i], RotationBits);
+			SerializeSignedPacked(Ar, Delta);
+			*StateAngles[i] = ApplyAngleDelta(BaseAngles[i], Delta, RotationBits);
+		}
+
+		Ar.SerializeBits(&State.Flags, NumFlagBits);
+	}
+
+	//
+	// Bandwidth report, per connection. Also estimates what the stock FRepMovement would have cost
+	// for the same sends, so both can be compared on the same run.
+	//
+	static bool bTrackBandwidth = false;
+	static FAutoConsoleVariableRef CVarTrackBandwidth(
+		TEXT("Blaster.Net.TrackMovementBandwidth"),
+		bTrackBandwidth,
+		TEXT("Track bytes sent per connection by FBlasterRepMovement (and the stock FRepMovement estimate). See Blaster.Net.MovementBandwidthReport."));
+
+	struct FConnectionBandwidth
+	{
+		int64 Bits{ 0 };
+		int64 StockBits{ 0 };
+		int64 Sends{ 0 };
+		int64 Keyframes{ 0 };
+		double StartTime{ 0.0 };
+	};
+	static TMap<TWeakObjectPtr<UNetConnection>, FConnectionBandwidth> BandwidthByConnection;
+
+	void TrackSend(const UPackageMap* Map, const int64 Bits, const bool bKeyframe, const FBlasterQuantizedMovement& State, const FBlasterMovementQuantization& Quantization)
+	{
+		const UPackageMapClient* PackageMapClient = Cast<UPackageMapClient>(Map);
+		UNetConnection* Connection = PackageMapClient ? const_cast<UPackageMapClient*>(PackageMapClient)->GetConnection() : nullptr;
+		if (!Connection) return;
+
+		FConnectionBandwidth& Bandwidth = BandwidthByConnection.FindOrAdd(Connection);
+		if (Bandwidth.Sends == 0) Bandwidth.StartTime = FPlatformTime::Seconds();
+		Bandwidth.Bits += Bits;
+		++Bandwidth.Sends;
+		if (bKeyframe) ++Bandwidth.Keyframes;
+
+		// Stock: FRepMovement + RemoteViewPitch (1 byte) + bIsCrouched (1 bit)
+		FRepMovement StockMovement;
+		StockMovement.Location = FVector(State.Location) * Quantization.LocationPrecision;
+		StockMovement.LinearVelocity = FVector(State.Velocity) * Quantization.VelocityPrecision;
+		StockMovement.Rotation = FRotator(0.0, DequantizeAngle(State.ActorYaw, Quantization.RotationBits), 0.0);
+		FBitWriter Scratch(0, true);
+		bool bSuccess = true;
+		StockMovement.NetSerialize(Scratch, const_cast<UPackageMap*>(Map), bSuccess);
+		Bandwidth.StockBits += Scratch.GetNumBits() + 8 + 1;
+	}
+
+	static FAutoConsoleCommand ReportCommand(
+		TEXT("Blaster.Net.MovementBandwidthReport"),
+		TEXT("Prints bytes/second per connection sent by FBlasterRepMovement vs. the stock FRepMovement estimate. Pass 'reset' to start over."),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (!bTrackBandwidth)
+				UE_LOG(LogBlaster, Warning, TEXT("Blaster.Net.TrackMovementBandwidth is 0, nothing is being tracked"));
+
+			const double Now = FPlatformTime::Seconds();
+			UE_LOG(LogBlaster, Log, TEXT("%-40s %10s %10s %8s %8s %10s"), TEXT("Connection"), TEXT("Blaster B/s"), TEXT("Stock B/s"), TEXT("Ratio"), TEXT("Sends"), TEXT("Keyframes"));
+			for (const TPair<TWeakObjectPtr<UNetConnection>, FConnectionBandwidth>& Pair : BandwidthByConnection)
+			{
+				const FConnectionBandwidth& Bandwidth = Pair.Value;
+				const double Seconds = FMath::Max(Now - Bandwidth.StartTime, 0.001);
+				const double BytesPerSecond = Bandwidth.Bits / 8.0 / Seconds;
+				const double StockBytesPerSecond = Bandwidth.StockBits / 8.0 / Seconds;
+				const FString Name = Pair.Key.IsValid() ? Pair.Key->LowLevelGetRemoteAddress(true) : FString(TEXT("(closed)"));
+				UE_LOG(LogBlaster, Log, TEXT("%-40s %10.1f %10.1f %8.2f %8lld %10lld"), *Name, BytesPerSecond, StockBytesPerSecond,
+					StockBytesPerSecond > 0.0 ? BytesPerSecond / StockBytesPerSecond : 0.0, Bandwidth.Sends, Bandwidth.Keyframes);
+			}
+
+			if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+				BandwidthByConnection.Reset();
+		}));
+}
+
+void FBlasterRepMovement::Capture(const ABlasterCharacter& Character)
+{
+	const FBlasterMovementQuantization& Quantization = GetQuantization();
+	const FRotator AimRotation = Character.GetBaseAimRotation();
+
+	FBlasterQuantizedMovement NewState;
+	const FVector Location = Character.GetActorLocation();
+	const FVector Velocity = Character.GetVelocity();
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		NewState.Location[Axis] = FMath::RoundToInt32(Location[Axis] / Quantization.LocationPrecision);
+		NewState.Velocity[Axis] = FMath::RoundToInt32(Velocity[Axis] / Quantization.VelocityPrecision);
+	}
+	NewState.ActorYaw = BlasterRepMovement::QuantizeAngle(Character.GetActorRotation().Yaw, Quantization.RotationBits);
+	NewState.AimPitch = BlasterRepMovement::QuantizeAngle(AimRotation.Pitch, Quantization.RotationBits);
+	NewState.AimYaw = BlasterRepMovement::QuantizeAngle(AimRotation.Yaw, Quantization.RotationBits);
+	NewState.Flags = static_cast<uint8>(Character.GetMovementFlags()) & BlasterRepMovement::ReplicatedFlagsMask;
+
+	if (!bCaptured || !(NewState == Current))
+	{
+		bCaptured = true;
+		Current = NewState;
+		++Sequence;
+	}
+}
+
+bool FBlasterRepMovement::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	const int32 RotationBits = GetQuantization().RotationBits;
+
+	if (DeltaParms.Writer)
+	{
+		FBitWriter& Writer = *DeltaParms.Writer;
+		const FBlasterRepMovementDeltaState* OldState = static_cast<const FBlasterRepMovementDeltaState*>(DeltaParms.OldState);
+
+		// Nothing captured yet, or this connection already has the current state
+		if (!bCaptured || (OldState && OldState->Sequence == Sequence)) return false;
+
+		const bool bKeyframe = !OldState || OldState->SendsSinceKeyframe + 1 >= GetQuantization().KeyframeInterval;
+
+		TSharedPtr<FBlasterRepMovementDeltaState> NewState = MakeShared<FBlasterRepMovementDeltaState>();
+		NewState->State = Current;
+		NewState->Sequence = Sequence;
+		NewState->SendsSinceKeyframe = bKeyframe ? 0 : OldState->SendsSinceKeyframe + 1;
+		*DeltaParms.NewState = NewState;
+
+		const int64 StartBits = Writer.GetNumBits();
+
+		uint8 bKeyframeBit = bKeyframe;
+		Writer.SerializeBits(&bKeyframeBit, 1);
+		uint16 SequenceToWrite = Sequence;
+		Writer << SequenceToWrite;
+
+		FBlasterQuantizedMovement State = Current;
+		if (bKeyframe)
+		{
+			BlasterRepMovement::SerializeState(Writer, State, FBlasterQuantizedMovement(), RotationBits);
+		}
+		else
+		{
+			uint16 BaseSequence = OldState->Sequence;
+			Writer << BaseSequence;
+			BlasterRepMovement::SerializeState(Writer, State, OldState->State, RotationBits);
+		}
+
+		if (BlasterRepMovement::bTrackBandwidth)
+			BlasterRepMovement::TrackSend(DeltaParms.Map, Writer.GetNumBits() - StartBits, bKeyframe, Current, GetQuantization());
+		if (FBlasterNetProfiler::IsEnabled())
+			FBlasterNetProfiler::RecordProperty(ABlasterCharacter::StaticClass(), TEXT("BlasterMovement"), Writer.GetNumBits() - StartBits);
+
+		return true;
+	}
+
+	if (DeltaParms.Reader)
+	{
+		FBitReader& Reader = *DeltaParms.Reader;
+
+		uint8 bKeyframe = 0;
+		Reader.SerializeBits(&bKeyframe, 1);
+		uint16 ReceivedSequence = 0;
+		Reader << ReceivedSequence;
+
+		FBlasterQuantizedMovement State;
+		bool bHasBase = true;
+		if (bKeyframe)
+		{
+			BlasterRepMovement::SerializeState(Reader, State, FBlasterQuantizedMovement(), RotationBits);
+		}
+		else
+		{
+			uint16 BaseSequence = 0;
+			Reader << BaseSequence;
+			const FBlasterQuantizedMovement* Base = FindHistory(BaseSequence);
+			bHasBase = Base != nullptr;
+			// The deltas are read either way, so the rest of the bunch stays aligned
+			BlasterRepMovement::SerializeState(Reader, State, bHasBase ? *Base : FBlasterQuantizedMovement(), RotationBits);
+		}
+
+		if (Reader.IsError()) return false;
+
+		if (!bHasBase)
+		{
+			// Should not happen (the base is always a state we acknowledged), but if it does the next keyframe fixes it
+			UE_LOG(LogBlaster, Verbose, TEXT("FBlasterRepMovement: missing delta base, waiting for keyframe"));
+			return true;
+		}
+
+		PushHistory(ReceivedSequence, State);
+		Current = State;
+		Sequence = ReceivedSequence;
+		ApplyToOwner();
+		return true;
+	}
+
+	return true;
+}
+
+void FBlasterRepMovement::PushHistory(const uint16 InSequence, const FBlasterQuantizedMovement& State)
+{
+	HistoryHead = (HistoryHead + 1) % HistorySize;
+	History[HistoryHead] = State;
+	HistorySequences[HistoryHead] = InSequence;
+	HistoryCount = FMath::Min(HistoryCount + 1, HistorySize);
+}
+
+const FBlasterQuantizedMovement* FBlasterRepMovement::FindHistory(const uint16 InSequence) const
+{
+	for (int32 i = 0; i < HistoryCount; ++i)
+	{
+		const int32 Index = (HistoryHead - i + HistorySize) % HistorySize;
+		if (HistorySequences[Index] == InSequence) return &History[Index];
+	}
+	return nullptr;
+}
+
+const FBlasterMovementQuantization& FBlasterRepMovement::GetQuantization() const
+{
+	// Always the class defaults, so both ends agree even before the owner finished spawning
+	static const FBlasterMovementQuantization DefaultQuantization;
+	const ABlasterCharacter* DefaultCharacter = Owner ? Owner->GetClass()->GetDefaultObject<ABlasterCharacter>() : nullptr;
+	return DefaultCharacter ? DefaultCharacter->GetMovementQuantization() : DefaultQuantization;
+}
+
+void FBlasterRepMovement::ApplyToOwner() const
+{
+	if (!Owner) return;
+
+	const FBlasterMovementQuantization& Quantization = GetQuantization();
+	const FVector Location = FVector(Current.Location) * Quantization.LocationPrecision;
+	const FVector Velocity = FVector(Current.Velocity) * Quantization.VelocityPrecision;
+	const float ActorYaw = BlasterRepMovement::DequantizeAngle(Current.ActorYaw, Quantization.RotationBits);
+	const FRotator AimRotation(
+		BlasterRepMovement::DequantizeAngle(Current.AimPitch, Quantization.RotationBits),
+		BlasterRepMovement::DequantizeAngle(Current.AimYaw, Quantization.RotationBits),
+		0.0);
+
+	Owner->ApplyReplicatedMovement(Location, Velocity, ActorYaw, AimRotation, static_cast<EBlasterMovementFlags>(Current.Flags));
+}
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h" // Who needs: FNetDeltaSerializeInfo, INetDeltaBaseState
+#include "BlasterRepMovement.generated.h"
+
+class ABlasterCharacter;
+
+// Precision of each replicated movement field. Server and clients read it from the same class defaults.
+USTRUCT(BlueprintType)
+struct FBlasterMovementQuantization
+{
+	GENERATED_BODY()
+
+	// Size of one location step (cm)
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0.01"))
+	float LocationPrecision{ 0.1f };
+
+	// Size of one velocity step (cm/s)
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "0.01"))
+	float VelocityPrecision{ 1.f };
+
+	// Bits per rotation axis (actor yaw, aim pitch, aim yaw). 12 bits = ~0.09 degrees.
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "6", ClampMax = "16"))
+	int32 RotationBits{ 12 };
+
+	// Send a full state (no delta) every N sends to each connection, so a client that lost its base recovers
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "1"))
+	int32 KeyframeInterval{ 30 };
+};
+
+// Movement state in the quantized (integer) domain. This is what gets delta-encoded.
+struct FBlasterQuantizedMovement
+{
+	FIntVector Location{ 0 };
+	FIntVector Velocity{ 0 };
+	int32 ActorYaw{ 0 };
+	int32 AimPitch{ 0 };
+	int32 AimYaw{ 0 };
+	uint8 Flags{ 0 }; // EBlasterMovementFlags
+
+	bool operator==(const FBlasterQuantizedMovement& Other) const
+	{
+		return Location == Other.Location && Velocity == Other.Velocity && ActorYaw == Other.ActorYaw
+			&& AimPitch == Other.AimPitch && AimYaw == Other.AimYaw && Flags == Other.Flags;
+	}
+};
+
+/**
+ * Movement and aim state of an ABlasterCharacter, replicated to simulated proxies through NetDeltaSerialize
+ * instead of the stock FRepMovement.
+ *
+ * Every field is quantized with FBlasterMovementQuantization and bit-packed. Each send is delta-encoded
+ * against the base state of that connection, which the engine keeps per connection and rolls back to the
+ * last acknowledged one when a packet is lost. The base is identified by its Sequence, and clients keep a
+ * short history of received states to decode against.
+ */
+USTRUCT()
+struct BLASTER_API FBlasterRepMovement
+{
+	GENERATED_BODY()
+
+	// Server: quantizes the character's current state. Bumps the sequence if it changed.
+	void Capture(const ABlasterCharacter& Character);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+	// Not replicated. Set by the owning character.
+	ABlasterCharacter* Owner{ nullptr };
+
+private:
+	FBlasterQuantizedMovement Current;
+	uint16 Sequence{ 0 };
+	bool bCaptured{ false };
+
+	// Client: last received states, to decode deltas against
+	static constexpr int32 HistorySize = 32;
+	FBlasterQuantizedMovement History[HistorySize];
+	uint16 HistorySequences[HistorySize]{};
+	int32 HistoryCount{ 0 };
+	int32 HistoryHead{ 0 };
+
+	void PushHistory(uint16 InSequence, const FBlasterQuantizedMovement& State);
+	const FBlasterQuantizedMovement* FindHistory(uint16 InSequence) const;
+
+	const FBlasterMovementQuantization& GetQuantization() const;
+	void ApplyToOwner() const;
+};
+
+template<>
+struct TStructOpsTypeTraits<FBlasterRepMovement> : public TStructOpsTypeTraitsBase2<FBlasterRepMovement>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+// Per-connection base state kept by the engine for FBlasterRepMovement
+class FBlasterRepMovementDeltaState : public INetDeltaBaseState
+{
+public:
+	virtual bool IsStateEqual(INetDeltaBaseState* OtherState) override
+	{
+		const FBlasterRepMovementDeltaState* Other = static_cast<FBlasterRepMovementDeltaState*>(OtherState);
+		return Sequence == Other->Sequence;
+	}
+
+	FBlasterQuantizedMovement State;
+	uint16 Sequence{ 0 };
+	int32 SendsSinceKeyframe{ 0 };
+};
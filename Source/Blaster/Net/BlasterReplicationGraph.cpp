@@ -0,0 +1,267 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterReplicationGraph.h"
+#include "Blaster.h" // Who needs: LogBlaster, STATGROUP_Blaster
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+DECLARE_CYCLE_STAT(TEXT("Server Replicate Actors"), STAT_BlasterServerReplicateActors, STATGROUP_Blaster);
+CSV_DEFINE_CATEGORY(BlasterReplication, true);
+
+namespace BlasterReplicationGraph
+{
+	static FAutoConsoleCommandWithWorld ReportCommand(
+		TEXT("Blaster.RepGraph.Report"),
+		TEXT("Prints the server replication time per frame, grouped by number of connections, and writes it as CSV to Saved/Profiling."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](const UWorld* World)
+		{
+			const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+			const UBlasterReplicationGraph* Graph = NetDriver ? Cast<UBlasterReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+			if (!Graph)
+			{
+				UE_LOG(LogBlaster, Warning, TEXT("Blaster.RepGraph.Report: no UBlasterReplicationGraph running (not a server?)"));
+				return;
+			}
+			Graph->ReportReplicationTimes();
+		}));
+}
+
+void UBlasterReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Explicit policies. Everything else is derived from the class defaults below.
+	ClassRepNodePolicies.Set(AInfo::StaticClass(), EBlasterClassRepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(APlayerState::StaticClass(), EBlasterClassRepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), EBlasterClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(APlayerController::StaticClass(), EBlasterClassRepNodeMapping::NotRouted); // Per-connection node handles it
+	ClassRepNodePolicies.Set(ABlasterCharacter::StaticClass(), EBlasterClassRepNodeMapping::Spatialize_Dynamic);
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+		if (!ActorCDO || !ActorCDO->GetIsReplicated()) continue;
+
+		// Skip blueprint skeleton/reinstanced classes
+		const FString ClassName = Class->GetName();
+		if (ClassName.StartsWith(TEXT("SKEL_")) || ClassName.StartsWith(TEXT("REINST_"))) continue;
+
+		const EBlasterClassRepNodeMapping Policy = GetMappingPolicy(Class);
+		const bool bSpatialize = Policy == EBlasterClassRepNodeMapping::Spatialize_Static
+			|| Policy == EBlasterClassRepNodeMapping::Spatialize_Dynamic
+			|| Policy == EBlasterClassRepNodeMapping::Spatialize_Dormancy;
+
+		FClassReplicationInfo ClassInfo;
+		InitClassReplicationInfo(ClassInfo, Class, bSpatialize);
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+EBlasterClassRepNodeMapping UBlasterReplicationGraph::GetMappingPolicy(const UClass* Class)
+{
+	if (const EBlasterClassRepNodeMapping* ExplicitPolicy = ClassRepNodePolicies.FindWithoutClassRecursion(Class))
+		return *ExplicitPolicy;
+
+	const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+	if (!ActorCDO || !ActorCDO->GetIsReplicated()) return EBlasterClassRepNodeMapping::NotRouted;
+
+	EBlasterClassRepNodeMapping Policy;
+	if (ActorCDO->bAlwaysRelevant && !ActorCDO->bOnlyRelevantToOwner)
+	{
+		Policy = EBlasterClassRepNodeMapping::RelevantAllConnections;
+	}
+	else if (ActorCDO->bOnlyRelevantToOwner)
+	{
+		// The graph doesn't check owners: only the owning connection's node may gather these
+		Policy = EBlasterClassRepNodeMapping::RelevantOwnerConnection;
+	}
+	else if (ActorCDO->bNetUseOwnerRelevancy)
+	{
+		// Attached to (or carried by) their owner, so in the same cells. Follow it through the grid.
+		Policy = EBlasterClassRepNodeMapping::Spatialize_Dynamic;
+	}
+	else if (ActorCDO->NetDormancy > DORM_Awake)
+	{
+		Policy = EBlasterClassRepNodeMapping::Spatialize_Dormancy;
+	}
+	else if (!ActorCDO->IsRootComponentMovable())
+	{
+		Policy = EBlasterClassRepNodeMapping::Spatialize_Static;
+	}
+	else
+	{
+		Policy = EBlasterClassRepNodeMapping::Spatialize_Dynamic;
+	}
+
+	ClassRepNodePolicies.Set(Class, Policy);
+	return Policy;
+}
+
+void UBlasterReplicationGraph::InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, const bool bSpatialize) const
+{
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+	if (bSpatialize)
+	{
+		const float CullDistanceSquared = ActorCDO->NetCullDistanceSquared > 0.f ? ActorCDO->NetCullDistanceSquared : FMath::Square(DefaultCullDistance);
+		Info.SetCullDistanceSquared(CullDistanceSquared);
+	}
+	Info.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO->NetUpdateFrequency);
+}
+
+void UBlasterReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = GridSpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UBlasterReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// The connection's own controller, pawn, view target and owner-only actors are always relevant to it
+	UBlasterReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantForConnectionNode = CreateNewNode<UBlasterReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantForConnectionNode, RepGraphConnection);
+}
+
+void UBlasterReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EBlasterClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case EBlasterClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case EBlasterClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case EBlasterClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	case EBlasterClassRepNodeMapping::RelevantOwnerConnection:
+		OwnerOnlyActors.Add(ActorInfo.Actor);
+		break;
+	default:
+		break;
+	}
+}
+
+void UBlasterReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EBlasterClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case EBlasterClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case EBlasterClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case EBlasterClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	case EBlasterClassRepNodeMapping::RelevantOwnerConnection:
+		OwnerOnlyActors.RemoveFast(ActorInfo.Actor);
+		break;
+	default:
+		break;
+	}
+}
+
+int32 UBlasterReplicationGraph::ServerReplicateActors(const float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterServerReplicateActors);
+
+	// The frame the server can afford at its tick rate, unless set
+	const float TickRate = NetDriver ? static_cast<float>(NetDriver->GetNetServerMaxTickRate()) : 0.f;
+	const float TargetFrameMs = AdaptiveNetUpdate.TargetFrameMs > 0.f ? AdaptiveNetUpdate.TargetFrameMs : TickRate > 0.f ? 1000.f / TickRate : 33.3f;
+	NetUpdateController.Update(*this, AdaptiveNetUpdate, TargetFrameMs, DeltaSeconds);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 Result = Super::ServerReplicateActors(DeltaSeconds);
+	const double ElapsedMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	LastReplicationTimeMs = ElapsedMs;
+
+	const int32 NumConnections = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+	CSV_CUSTOM_STAT(BlasterReplication, ServerReplicateActorsMs, ElapsedMs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(BlasterReplication, NumConnections, NumConnections, ECsvCustomStatOp::Set);
+
+	if (NumConnections > 0)
+	{
+		FReplicationTimeBucket& Bucket = ReplicationTimeByConnections.FindOrAdd(NumConnections);
+		++Bucket.Frames;
+		Bucket.TotalMs += ElapsedMs;
+		Bucket.MaxMs = FMath::Max(Bucket.MaxMs, ElapsedMs);
+
+		NetUpdateController.RecordFrame(ElapsedMs);
+	}
+
+	return Result;
+}
+
+void UBlasterReplicationGraph::BeginDestroy()
+{
+	// Headless runs just quit, so leave the numbers behind
+	if (!HasAnyFlags(RF_ClassDefaultObject) && !ReplicationTimeByConnections.IsEmpty())
+		ReportReplicationTimes();
+	if (!HasAnyFlags(RF_ClassDefaultObject) && NetUpdateController.HasFrames())
+		NetUpdateController.Report();
+
+	Super::BeginDestroy();
+}
+
+void UBlasterReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	Super::GatherActorListsForConnection(Params);
+
+	const UBlasterReplicationGraph* Graph = Cast<UBlasterReplicationGraph>(GetOuter());
+	if (!Graph) return;
+
+	OwnedActorList.Reset();
+	for (AActor* Actor : Graph->GetOwnerOnlyActors())
+	{
+		if (Actor && Actor->GetNetConnection() == Params.ConnectionManager.NetConnection)
+			OwnedActorList.Add(Actor);
+	}
+
+	if (OwnedActorList.Num() > 0)
+		Params.OutGatheredReplicationLists.AddReplicationActorList(OwnedActorList);
+}
+
+void UBlasterReplicationGraph::ReportReplicationTimes() const
+{
+	FString Csv = TEXT("Connections,Frames,AvgMs,MaxMs\n");
+
+	UE_LOG(LogBlaster, Log, TEXT("Server replication time per frame:"));
+	UE_LOG(LogBlaster, Log, TEXT("%12s %10s %10s %10s"), TEXT("Connections"), TEXT("Frames"), TEXT("Avg ms"), TEXT("Max ms"));
+	for (const TPair<int32, FReplicationTimeBucket>& Pair : ReplicationTimeByConnections)
+	{
+		const FReplicationTimeBucket& Bucket = Pair.Value;
+		const double AvgMs = Bucket.Frames > 0 ? Bucket.TotalMs / Bucket.Frames : 0.0;
+		UE_LOG(LogBlaster, Log, TEXT("%12d %10lld %10.3f %10.3f"), Pair.Key, Bucket.Frames, AvgMs, Bucket.MaxMs);
+		Csv += FString::Printf(TEXT("%d,%lld,%.4f,%.4f\n"), Pair.Key, Bucket.Frames, AvgMs, Bucket.MaxMs);
+	}
+
+	const FString CsvPath = FPaths::ProfilingDir() / TEXT("BlasterReplicationTimes.csv");
+	if (FFileHelper::SaveStringToFile(Csv, *CsvPath))
+		UE_LOG(LogBlaster, Log, TEXT("Wrote %s"), *CsvPath);
+}
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "BlasterAdaptiveNetUpdate.h"
+#include "BlasterReplicationGraph.generated.h"
+
+// How an actor class gets routed into the graph
+UENUM()
+enum class EBlasterClassRepNodeMapping : uint8
+{
+	NotRouted,				// Doesn't go anywhere (handled by some other node, e.g. the per-connection one)
+	RelevantAllConnections,	// Always relevant to everyone (game state, player states)
+	Spatialize_Static,		// Goes in the grid, never moves
+	Spatialize_Dynamic,		// Goes in the grid, moves (characters). Re-bucketed every frame.
+	Spatialize_Dormancy,	// Goes in the grid, static while dormant and dynamic while awake
+	RelevantOwnerConnection,	// Only relevant to its owner (bOnlyRelevantToOwner): gathered by the owning connection's node
+};
+
+/**
+ * The connection's own controller, pawn and view target (the stock node), plus the owner-only actors
+ * (bOnlyRelevantToOwner) currently owned by the connection. Ownership changes at runtime (weapons get picked up and
+ * dropped), so it's checked every gather instead of routed once.
+ */
+UCLASS()
+class BLASTER_API UBlasterReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode_AlwaysRelevant_ForConnection
+{
+	GENERATED_BODY()
+
+public:
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+private:
+	FActorRepListRefView OwnedActorList;
+};
+
+/**
+ * Replication graph for Blaster.
+ *
+ * Instead of the net driver testing every actor against every connection every frame, actors are routed
+ * once into nodes and each connection only gathers from the nodes around its viewer:
+ * - GridNode: 2D spatial grid. Characters go here and are only considered by connections in nearby cells.
+ * - AlwaysRelevantNode: game state, player states and other always-relevant actors, shared by every connection.
+ * - Per-connection AlwaysRelevant_ForConnection node: the connection's own controller, pawn and view target, and the
+ *   owner-only actors the connection owns.
+ * Actors relevant through their owner (bNetUseOwnerRelevancy) are spatialized: they go where their owner goes.
+ * Dormant actors go through the grid's dormancy nodes, which track dormancy per connection.
+ *
+ * Enabled in DefaultEngine.ini through ReplicationDriverClassName. Use "Blaster.RepGraph.Report" to print
+ * the server replication time per frame, grouped by number of connections.
+ *
+ * Under load, the replication period of each character per connection is set by FBlasterAdaptiveNetUpdate.
+ */
+UCLASS(Transient, Config=Engine)
+class BLASTER_API UBlasterReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+	virtual void BeginDestroy() override;
+
+	// Prints the replication time table to the log and writes it as CSV to the profiling folder
+	void ReportReplicationTimes() const;
+	// Time spent in the last ServerReplicateActors (ms)
+	double GetLastReplicationTimeMs() const { return LastReplicationTimeMs; }
+	const FBlasterAdaptiveNetUpdate& GetNetUpdateController() const { return NetUpdateController; }
+	// Every owner-only actor, whoever owns it (see UBlasterReplicationGraphNode_AlwaysRelevant_ForConnection)
+	const FActorRepListRefView& GetOwnerOnlyActors() const { return OwnerOnlyActors; }
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+private:
+	// Size of one grid cell (cm). Roughly the distance a character covers in a couple of seconds.
+	UPROPERTY(Config)
+	float GridCellSize{ 10000.f };
+
+	// Lower left corner of the grid. Actors outside it are clamped into the border cells.
+	UPROPERTY(Config)
+	FVector2D GridSpatialBias{ -200000.f, -200000.f };
+
+	// Default cull distance for spatialized actors that don't set their own
+	UPROPERTY(Config)
+	float DefaultCullDistance{ 15000.f };
+
+	// Extra: Net update rate of the characters under load (see FBlasterAdaptiveNetUpdate)
+	UPROPERTY(Config)
+	FBlasterAdaptiveNetUpdateSettings AdaptiveNetUpdate;
+	FBlasterAdaptiveNetUpdate NetUpdateController;
+
+	TClassMap<EBlasterClassRepNodeMapping> ClassRepNodePolicies;
+	FActorRepListRefView OwnerOnlyActors;
+
+	EBlasterClassRepNodeMapping GetMappingPolicy(const UClass* Class);
+	void InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize) const;
+
+	//
+	// Measurement: replication time per frame, grouped by number of connections
+	//
+	struct FReplicationTimeBucket
+	{
+		int64 Frames{ 0 };
+		double TotalMs{ 0.0 };
+		double MaxMs{ 0.0 };
+	};
+	TSortedMap<int32, FReplicationTimeBucket> ReplicationTimeByConnections;
+	double LastReplicationTimeMs{ 0.0 };
+};
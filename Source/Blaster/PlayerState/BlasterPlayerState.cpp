@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterPlayerState.h"
+#include "Blaster/Net/BlasterNetProfiler.h" // Who needs: FBlasterNetProfiler::FScopedRpc
+#include "Net/UnrealNetwork.h"
+
+void ABlasterPlayerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ABlasterPlayerState, Loadout);
+}
+
+void ABlasterPlayerState::CopyProperties(APlayerState* PlayerState)
+{
+	Super::CopyProperties(PlayerState);
+
+	if (ABlasterPlayerState* BlasterPlayerState = Cast<ABlasterPlayerState>(PlayerState))
+	{
+		BlasterPlayerState->Loadout = Loadout;
+		BlasterPlayerState->SeamlessTravelCount = SeamlessTravelCount;
+	}
+}
+
+void ABlasterPlayerState::SeamlessTravelTo(APlayerState* NewPlayerState)
+{
+	Super::SeamlessTravelTo(NewPlayerState);
+
+	// Not in CopyProperties: that one also makes the inactive copy of a disconnecting player, and a reconnect isn't a travel
+	if (ABlasterPlayerState* BlasterPlayerState = Cast<ABlasterPlayerState>(NewPlayerState))
+		BlasterPlayerState->SeamlessTravelCount = SeamlessTravelCount + 1;
+}
+
+void ABlasterPlayerState::OverrideWith(APlayerState* PlayerState)
+{
+	Super::OverrideWith(PlayerState);
+
+	if (const ABlasterPlayerState* BlasterPlayerState = Cast<ABlasterPlayerState>(PlayerState))
+	{
+		Loadout = BlasterPlayerState->Loadout;
+		SeamlessTravelCount = BlasterPlayerState->SeamlessTravelCount;
+	}
+}
+
+bool ABlasterPlayerState::CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack)
+{
+	const FBlasterNetProfiler::FScopedRpc ProfilerScope(Function);
+	return Super::CallRemoteFunction(Function, Parameters, OutParms, Stack);
+}
+
+void ABlasterPlayerState::ServerSetLoadout_Implementation(const FBlasterLoadout& NewLoadout)
+{
+	Loadout = NewLoadout;
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerState.h"
+#include "BlasterPlayerState.generated.h"
+
+// What a player picked in the lobby and takes into the match
+USTRUCT(BlueprintType)
+struct FBlasterLoadout
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FName PrimaryWeapon;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	uint8 SkinIndex{ 0 };
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	uint8 TeamIndex{ 0 };
+};
+
+/**
+ * Player state that survives the lobby -> match seamless travel (and a reconnect, through OverrideWith).
+ * Anything added here that must survive the map change has to be copied in CopyProperties.
+ */
+UCLASS()
+class BLASTER_API ABlasterPlayerState : public APlayerState
+{
+	GENERATED_BODY()
+
+public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Seamless travel: the server copies the old player state into the one spawned by the new game mode. Also used
+	// for the inactive copy kept when a player disconnects.
+	virtual void CopyProperties(APlayerState* PlayerState) override;
+	// Seamless travel only (the copy above, then the travel count)
+	virtual void SeamlessTravelTo(APlayerState* NewPlayerState) override;
+	// Reconnect: the inactive player state left by the same player is copied back
+	virtual void OverrideWith(APlayerState* PlayerState) override;
+
+	// Extra: Names the RPC bunches for the net profiler (Blaster.NetProfile)
+	virtual bool CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack) override;
+
+	FORCEINLINE const FBlasterLoadout& GetLoadout() const { return Loadout; }
+
+	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Loadout")
+	void ServerSetLoadout(const FBlasterLoadout& NewLoadout);
+
+	// Extra: How many maps this player state has travelled through without a reconnect (0 in the first one)
+	FORCEINLINE int32 GetSeamlessTravelCount() const { return SeamlessTravelCount; }
+
+private:
+	UPROPERTY(Replicated)
+	FBlasterLoadout Loadout;
+
+	int32 SeamlessTravelCount{ 0 };
+};
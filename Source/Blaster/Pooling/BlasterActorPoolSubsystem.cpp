@@ -0,0 +1,289 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterActorPoolSubsystem.h"
+#include "BlasterPoolableActor.h"
+#include "Blaster.h" // Who needs: STATGROUP_Blaster, LogBlaster
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h" // Who needs: ReleaseActorAfter
+#include "UObject/UObjectGlobals.h" // Who needs: FCoreUObjectDelegates::GetPreGarbageCollectDelegate
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Actors Available"), STAT_BlasterPoolAvailable, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Actors In Use"), STAT_BlasterPoolInUse, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pool Hits"), STAT_BlasterPoolHits, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pool Misses"), STAT_BlasterPoolMisses, STATGROUP_Blaster);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Pool Spawn Time Saved (ms)"), STAT_BlasterPoolSpawnTimeSaved, STATGROUP_Blaster);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("GC Time (ms, total)"), STAT_BlasterPoolGarbageCollectTime, STATGROUP_Blaster);
+DECLARE_CYCLE_STAT(TEXT("Pool Acquire"), STAT_BlasterPoolAcquire, STATGROUP_Blaster);
+DECLARE_CYCLE_STAT(TEXT("Pool Release"), STAT_BlasterPoolRelease, STATGROUP_Blaster);
+
+namespace BlasterActorPool
+{
+	bool bEnable{ true };
+	FAutoConsoleVariableRef CVarEnable(
+		TEXT("Blaster.ActorPool.Enable"),
+		bEnable,
+		TEXT("Hand out pooled actors. 0: spawn and destroy every time (to compare)."));
+
+	static FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("Blaster.ActorPoolStats"),
+		TEXT("Prints each actor pool's occupancy, hits and misses, and the spawn and GC time."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (const UBlasterActorPoolSubsystem* Subsystem = World ? World->GetSubsystem<UBlasterActorPoolSubsystem>() : nullptr)
+				Subsystem->LogStats();
+		}));
+}
+
+void UBlasterActorPoolSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &ThisClass::OnPreGarbageCollect);
+	PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &ThisClass::OnPostGarbageCollect);
+}
+
+void UBlasterActorPoolSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	for (const FBlasterActorPoolConfig& Config : PrewarmPools)
+	{
+		if (Config.bCosmetic && IsRunningDedicatedServer()) continue;
+
+		// Loading here is fine: it's the map load, not a firefight
+		if (UClass* ActorClass = Config.ActorClass.LoadSynchronous())
+			Prewarm(ActorClass, Config.PrewarmCount, Config.MaxSize);
+		else
+			UE_LOG(LogBlaster, Warning, TEXT("Actor pool: couldn't load %s"), *Config.ActorClass.ToString());
+	}
+}
+
+void UBlasterActorPoolSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
+
+	// The parked actors go with the world
+	Pools.Empty();
+	PendingReleases.Empty();
+	UpdateStats();
+
+	Super::Deinitialize();
+}
+
+AActor* UBlasterActorPoolSubsystem::AcquireActor(const TSubclassOf<AActor> ActorClass, const FTransform& Transform, AActor* Owner, APawn* Instigator)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterPoolAcquire);
+	if (!ActorClass) return nullptr;
+	LLM_SCOPE_BYTAG(Blaster);
+
+	if (!BlasterActorPool::bEnable)
+		return SpawnPooledActor(ActorClass, Transform, Owner, Instigator);
+
+	FBlasterActorPool& Pool = Pools.FindOrAdd(ActorClass);
+
+	// Parked actors can still be destroyed by someone else (level streaming, a stray Destroy)
+	AActor* Actor{ nullptr };
+	while (!Actor && !Pool.Available.IsEmpty())
+	{
+		Actor = Pool.Available.Pop(EAllowShrinking::No);
+		if (!IsValid(Actor)) Actor = nullptr;
+	}
+
+	if (Actor)
+	{
+		++Pool.Hits;
+		INC_DWORD_STAT(STAT_BlasterPoolHits);
+		Unpark(Actor, Transform, Owner, Instigator);
+	}
+	else
+	{
+		++Pool.Misses;
+		INC_DWORD_STAT(STAT_BlasterPoolMisses);
+		Actor = SpawnPooledActor(ActorClass, Transform, Owner, Instigator);
+		if (!Actor) return nullptr;
+	}
+
+	Pool.InUse.Add(Actor);
+	if (Actor->Implements<UBlasterPoolableActor>())
+		IBlasterPoolableActor::Execute_OnAcquiredFromPool(Actor);
+
+	UpdateStats();
+	return Actor;
+}
+
+void UBlasterActorPoolSubsystem::ReleaseActor(AActor* Actor)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterPoolRelease);
+	if (!IsValid(Actor)) return;
+
+	// Released early: the timed release must not catch it again after it's handed out to someone else
+	FTimerHandle PendingRelease;
+	if (PendingReleases.RemoveAndCopyValue(Actor, PendingRelease))
+		GetWorld()->GetTimerManager().ClearTimer(PendingRelease);
+
+	FBlasterActorPool* Pool = Pools.Find(Actor->GetClass());
+	if (!Pool || !Pool->InUse.Remove(Actor) || !BlasterActorPool::bEnable || Pool->Available.Num() >= Pool->MaxSize)
+	{
+		if (Pool && BlasterActorPool::bEnable) ++Pool->Overflows;
+		++TotalDestroys;
+		Actor->Destroy();
+		UpdateStats();
+		return;
+	}
+
+	Park(Actor);
+	if (Actor->Implements<UBlasterPoolableActor>())
+		IBlasterPoolableActor::Execute_OnReturnedToPool(Actor);
+	Pool->Available.Add(Actor);
+
+	UpdateStats();
+}
+
+void UBlasterActorPoolSubsystem::ReleaseActorAfter(AActor* Actor, const float Seconds)
+{
+	if (!IsValid(Actor)) return;
+
+	FTimerHandle& Handle = PendingReleases.FindOrAdd(Actor);
+	GetWorld()->GetTimerManager().SetTimer(Handle, FTimerDelegate::CreateWeakLambda(this, [this, WeakActor = TWeakObjectPtr<AActor>(Actor)]()
+	{
+		PendingReleases.Remove(WeakActor);
+		ReleaseActor(WeakActor.Get());
+	}), FMath::Max(Seconds, UE_KINDA_SMALL_NUMBER), false);
+}
+
+void UBlasterActorPoolSubsystem::Prewarm(const TSubclassOf<AActor> ActorClass, const int32 Count, const int32 MaxSize)
+{
+	if (!ActorClass) return;
+	LLM_SCOPE_BYTAG(Blaster);
+
+	FBlasterActorPool& Pool = Pools.FindOrAdd(ActorClass);
+	Pool.MaxSize = FMath::Max(MaxSize, Count);
+
+	const FTransform ParkingTransform{ FVector(0.0, 0.0, -100000.0) };
+	while (Pool.Available.Num() < Count)
+	{
+		AActor* Actor = SpawnPooledActor(ActorClass, ParkingTransform, nullptr, nullptr);
+		if (!Actor) break;
+
+		Park(Actor);
+		if (Actor->Implements<UBlasterPoolableActor>())
+			IBlasterPoolableActor::Execute_OnReturnedToPool(Actor);
+		Pool.Available.Add(Actor);
+	}
+
+	UE_LOG(LogBlaster, Log, TEXT("Actor pool: %d %s ready"), Pool.Available.Num(), *ActorClass->GetName());
+	UpdateStats();
+}
+
+AActor* UBlasterActorPoolSubsystem::SpawnPooledActor(UClass* ActorClass, const FTransform& Transform, AActor* Owner, APawn* Instigator)
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = Owner;
+	SpawnParameters.Instigator = Instigator;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	const double StartTime{ FPlatformTime::Seconds() };
+	AActor* Actor = GetWorld()->SpawnActor(ActorClass, &Transform, SpawnParameters);
+
+	TotalSpawnSeconds += FPlatformTime::Seconds() - StartTime;
+	++TotalSpawns;
+	return Actor;
+}
+
+void UBlasterActorPoolSubsystem::Park(AActor* Actor) const
+{
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+	Actor->SetLifeSpan(0.f);
+	Actor->GetWorldTimerManager().ClearAllTimersForObject(Actor);
+
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		if (Component && Component->IsActive()) Component->Deactivate();
+	}
+
+	// Extra: Clients see it hidden, then stop hearing about it until it's handed out again
+	if (Actor->GetIsReplicated() && Actor->HasAuthority())
+	{
+		Actor->ForceNetUpdate();
+		Actor->SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+void UBlasterActorPoolSubsystem::Unpark(AActor* Actor, const FTransform& Transform, AActor* Owner, APawn* Instigator) const
+{
+	Actor->SetOwner(Owner);
+	Actor->SetInstigator(Instigator);
+	Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		if (Component && Component->bAutoActivate) Component->Activate(true);
+	}
+
+	Actor->SetActorTickEnabled(Actor->PrimaryActorTick.bStartWithTickEnabled);
+	Actor->SetActorEnableCollision(true);
+	Actor->SetActorHiddenInGame(false);
+
+	if (Actor->GetIsReplicated() && Actor->HasAuthority())
+		Actor->SetNetDormancy(DORM_Awake);
+}
+
+void UBlasterActorPoolSubsystem::UpdateStats()
+{
+#if STATS
+	int32 Available{ 0 };
+	int32 InUse{ 0 };
+	int32 Hits{ 0 };
+	for (const TPair<TObjectPtr<UClass>, FBlasterActorPool>& Pair : Pools)
+	{
+		Available += Pair.Value.Available.Num();
+		InUse += Pair.Value.InUse.Num();
+		Hits += Pair.Value.Hits;
+	}
+	SET_DWORD_STAT(STAT_BlasterPoolAvailable, Available);
+	SET_DWORD_STAT(STAT_BlasterPoolInUse, InUse);
+
+	// Each hit is a spawn that didn't happen, at the average cost of the ones that did
+	const double AverageSpawnMs{ TotalSpawns > 0 ? TotalSpawnSeconds * 1000.0 / TotalSpawns : 0.0 };
+	SET_FLOAT_STAT(STAT_BlasterPoolSpawnTimeSaved, Hits * AverageSpawnMs);
+#endif
+}
+
+void UBlasterActorPoolSubsystem::OnPreGarbageCollect()
+{
+	GarbageCollectStartTime = FPlatformTime::Seconds();
+}
+
+void UBlasterActorPoolSubsystem::OnPostGarbageCollect()
+{
+	if (GarbageCollectStartTime == 0.0) return;
+
+	TotalGarbageCollectSeconds += FPlatformTime::Seconds() - GarbageCollectStartTime;
+	++NumGarbageCollects;
+	GarbageCollectStartTime = 0.0;
+	SET_FLOAT_STAT(STAT_BlasterPoolGarbageCollectTime, TotalGarbageCollectSeconds * 1000.0);
+}
+
+void UBlasterActorPoolSubsystem::LogStats() const
+{
+	UE_LOG(LogBlaster, Log, TEXT("Actor pools (%s):"), BlasterActorPool::bEnable ? TEXT("on") : TEXT("off"));
+	int32 TotalHits{ 0 };
+	for (const TPair<TObjectPtr<UClass>, FBlasterActorPool>& Pair : Pools)
+	{
+		const FBlasterActorPool& Pool = Pair.Value;
+		TotalHits += Pool.Hits;
+		UE_LOG(LogBlaster, Log, TEXT("  %s: %d available, %d in use (max %d). %d hits, %d misses, %d destroyed (pool full)"),
+			*GetNameSafe(Pair.Key), Pool.Available.Num(), Pool.InUse.Num(), Pool.MaxSize, Pool.Hits, Pool.Misses, Pool.Overflows);
+	}
+
+	const double AverageSpawnMs{ TotalSpawns > 0 ? TotalSpawnSeconds * 1000.0 / TotalSpawns : 0.0 };
+	UE_LOG(LogBlaster, Log, TEXT("  %d spawns (%.3f ms each), %d destroys; %d spawns and destroys avoided (~%.1f ms of spawning)"),
+		TotalSpawns, AverageSpawnMs, TotalDestroys, TotalHits, TotalHits * AverageSpawnMs);
+	UE_LOG(LogBlaster, Log, TEXT("  GC: %d collections, %.1f ms total (compare with Blaster.ActorPool.Enable 0)"),
+		NumGarbageCollects, TotalGarbageCollectSeconds * 1000.0);
+}
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/TimerHandle.h" // Who needs: FTimerHandle
+#include "BlasterActorPoolSubsystem.generated.h"
+
+// One pool to fill when the world begins play
+USTRUCT()
+struct FBlasterActorPoolConfig
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	TSoftClassPtr<AActor> ActorClass;
+
+	// Spawned up front, so the first firefight doesn't pay for them
+	UPROPERTY(EditAnywhere)
+	int32 PrewarmCount{ 0 };
+
+	// Actors released to a full pool are destroyed
+	UPROPERTY(EditAnywhere)
+	int32 MaxSize{ 64 };
+
+	// Shell casings, impact effects: no pool on dedicated servers
+	UPROPERTY(EditAnywhere)
+	bool bCosmetic{ false };
+};
+
+USTRUCT()
+struct FBlasterActorPool
+{
+	GENERATED_BODY()
+
+	// Parked actors, ready to hand out. Held here, so they are never garbage.
+	UPROPERTY()
+	TArray<TObjectPtr<AActor>> Available;
+
+	// Handed out and not back yet
+	TSet<TWeakObjectPtr<AActor>> InUse;
+
+	int32 MaxSize{ 64 };
+	int32 Hits{ 0 };
+	int32 Misses{ 0 };
+	int32 Overflows{ 0 }; // Released to a full pool (destroyed)
+};
+
+/**
+ * Extra: Per-class actor pools for what weapons fire at high rates (projectiles, shell casings, impact effects).
+ * AcquireActor hands out a parked actor instead of spawning one, ReleaseActor parks it again instead of destroying it,
+ * so a firefight doesn't churn through SpawnActor/Destroy (allocations, component registration, garbage for the GC).
+ *
+ * A parked actor is hidden, without collision, tick or active components, and dormant if it replicates.
+ * Actors implementing IBlasterPoolableActor are told when they come and go, to reset themselves.
+ *
+ * Pools are local to each machine: the server pools its replicated projectiles, each client its cosmetic actors.
+ * "Blaster.ActorPool.Enable 0" spawns and destroys every time, to compare (GC time included, see "Blaster.ActorPoolStats").
+ *
+ * Config:
+ *   [/Script/Blaster.BlasterActorPoolSubsystem]
+ *   +PrewarmPools=(ActorClass="/Game/Blueprints/Weapon/BP_Casing.BP_Casing_C",PrewarmCount=32,MaxSize=128,bCosmetic=True)
+ */
+UCLASS(Config=Game)
+class BLASTER_API UBlasterActorPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// Pooled replacement of SpawnActor. nullptr only if the spawn itself fails.
+	AActor* AcquireActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform, AActor* Owner = nullptr, APawn* Instigator = nullptr);
+
+	template<typename T>
+	T* AcquireActor(TSubclassOf<T> ActorClass, const FTransform& Transform, AActor* Owner = nullptr, APawn* Instigator = nullptr)
+	{
+		return Cast<T>(AcquireActor(TSubclassOf<AActor>(ActorClass), Transform, Owner, Instigator));
+	}
+
+	// Pooled replacement of Destroy. Actors that didn't come from a pool are destroyed.
+	void ReleaseActor(AActor* Actor);
+	// Pooled replacement of SetLifeSpan
+	void ReleaseActorAfter(AActor* Actor, float Seconds);
+
+	// Spawns and parks actors until the pool holds Count of them
+	void Prewarm(TSubclassOf<AActor> ActorClass, int32 Count, int32 MaxSize = 64);
+
+	void LogStats() const;
+
+private:
+	UPROPERTY(Config)
+	TArray<FBlasterActorPoolConfig> PrewarmPools;
+
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<UClass>, FBlasterActorPool> Pools;
+
+	// ReleaseActorAfter timers, cleared when the actor is released before
+	TMap<TWeakObjectPtr<AActor>, FTimerHandle> PendingReleases;
+
+	AActor* SpawnPooledActor(UClass* ActorClass, const FTransform& Transform, AActor* Owner, APawn* Instigator);
+	void Park(AActor* Actor) const;
+	void Unpark(AActor* Actor, const FTransform& Transform, AActor* Owner, APawn* Instigator) const;
+	void UpdateStats();
+
+	// Actors created by the pools and destroyed by them (overflow, disabled pooling). Hits avoid both.
+	int32 TotalSpawns{ 0 };
+	int32 TotalDestroys{ 0 };
+	double TotalSpawnSeconds{ 0.0 };
+
+	// GC of the whole process while this world lives, to compare runs with and without pooling
+	void OnPreGarbageCollect();
+	void OnPostGarbageCollect();
+	FDelegateHandle PreGarbageCollectHandle;
+	FDelegateHandle PostGarbageCollectHandle;
+	double GarbageCollectStartTime{ 0.0 };
+	double TotalGarbageCollectSeconds{ 0.0 };
+	int32 NumGarbageCollects{ 0 };
+};
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "BlasterPoolableActor.generated.h"
+
+UINTERFACE(MinimalAPI, BlueprintType)
+class UBlasterPoolableActor : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Optional, for actors handed out by UBlasterActorPoolSubsystem. A pooled actor gets BeginPlay once, when it's
+ * first spawned, and then goes back and forth between the pool and the game: these are where it resets.
+ */
+class BLASTER_API IBlasterPoolableActor
+{
+	GENERATED_BODY()
+
+public:
+	// Taken from the pool: already moved to the spawn transform, with owner and instigator set. Do here what
+	// BeginPlay would do for a fresh actor (e.g. launch the projectile, restart the effect).
+	UFUNCTION(BlueprintNativeEvent, Category = "Pooling")
+	void OnAcquiredFromPool();
+
+	// Back in the pool: already hidden, without collision and tick. Clear timers, bindings, and per-use state.
+	UFUNCTION(BlueprintNativeEvent, Category = "Pooling")
+	void OnReturnedToPool();
+};
@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterReplayFormat.h"
+
+uint8 FBlasterReplayCharacterState::GetChangedMask(const FBlasterReplayCharacterState& Baseline) const
+{
+	uint8 Mask{ 0 };
+	if (Location != Baseline.Location) Mask |= BlasterReplay::Changed_Location;
+	if (Velocity != Baseline.Velocity) Mask |= BlasterReplay::Changed_Velocity;
+	if (ActorYaw != Baseline.ActorYaw || AimYaw != Baseline.AimYaw || AimPitch != Baseline.AimPitch) Mask |= BlasterReplay::Changed_Rotation;
+	if (Flags != Baseline.Flags) Mask |= BlasterReplay::Changed_Flags;
+	return Mask;
+}
+
+FRotator FBlasterReplayCharacterState::GetAimRotation() const
+{
+	return FRotator(FRotator::DecompressAxisFromShort(AimPitch), FRotator::DecompressAxisFromShort(AimYaw), 0.0);
+}
+
+void FBlasterReplayChunkHeader::Write(uint8* Dest) const
+{
+	const uint32 Magic{ BlasterReplay::ChunkMagic };
+	FMemory::Memcpy(Dest, &Magic, 4);
+	FMemory::Memcpy(Dest + 4, &PayloadBytes, 4);
+	FMemory::Memcpy(Dest + 8, &StartTime, 8);
+	FMemory::Memcpy(Dest + 16, &EndTime, 8);
+	FMemory::Memcpy(Dest + 24, &NumFrames, 4);
+}
+
+bool FBlasterReplayChunkHeader::Read(const uint8* Source)
+{
+	uint32 Magic{ 0 };
+	FMemory::Memcpy(&Magic, Source, 4);
+	if (Magic != BlasterReplay::ChunkMagic) return false;
+
+	FMemory::Memcpy(&PayloadBytes, Source + 4, 4);
+	FMemory::Memcpy(&StartTime, Source + 8, 8);
+	FMemory::Memcpy(&EndTime, Source + 16, 8);
+	FMemory::Memcpy(&NumFrames, Source + 24, 4);
+	return true;
+}
+
+void FBlasterReplayByteWriter::WriteVarUInt(uint32 Value)
+{
+	while (Value >= 0x80)
+	{
+		Bytes.Add(static_cast<uint8>(Value | 0x80));
+		Value >>= 7;
+	}
+	Bytes.Add(static_cast<uint8>(Value));
+}
+
+void FBlasterReplayByteWriter::WriteString(const FString& Value)
+{
+	const FTCHARToUTF8 Utf8(*Value);
+	WriteVarUInt(Utf8.Length());
+	Bytes.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+}
+
+uint8 FBlasterReplayByteReader::ReadByte()
+{
+	if (Offset >= Num)
+	{
+		bError = true;
+		return 0;
+	}
+	return Data[Offset++];
+}
+
+uint32 FBlasterReplayByteReader::ReadVarUInt()
+{
+	uint32 Value{ 0 };
+	for (int32 Shift = 0; Shift < 35; Shift += 7)
+	{
+		const uint8 Byte = ReadByte();
+		Value |= static_cast<uint32>(Byte & 0x7F) << Shift;
+		if (!(Byte & 0x80)) return Value;
+	}
+	bError = true;
+	return 0;
+}
+
+FString FBlasterReplayByteReader::ReadString()
+{
+	const int32 Length = ReadVarUInt();
+	if (Length < 0 || Length > Num - Offset)
+	{
+		bError = true;
+		return FString();
+	}
+
+	const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Data + Offset), Length);
+	Offset += Length;
+	return FString(Converted.Length(), Converted.Get());
+}
+
+namespace BlasterReplay
+{
+	bool WriteState(FBlasterReplayByteWriter& Writer, const FBlasterReplayCharacterState& State, const FBlasterReplayCharacterState& Baseline)
+	{
+		const uint8 Mask = State.GetChangedMask(Baseline);
+		if (!Mask) return false;
+
+		Writer.WriteVarUInt(State.Id);
+		Writer.WriteByte(Mask);
+		if (Mask & Changed_Location)
+		{
+			Writer.WriteVarInt(State.Location.X - Baseline.Location.X);
+			Writer.WriteVarInt(State.Location.Y - Baseline.Location.Y);
+			Writer.WriteVarInt(State.Location.Z - Baseline.Location.Z);
+		}
+		if (Mask & Changed_Velocity)
+		{
+			Writer.WriteVarInt(State.Velocity.X - Baseline.Velocity.X);
+			Writer.WriteVarInt(State.Velocity.Y - Baseline.Velocity.Y);
+			Writer.WriteVarInt(State.Velocity.Z - Baseline.Velocity.Z);
+		}
+		if (Mask & Changed_Rotation)
+		{
+			// Angles wrap: the int16 difference is the shortest way around
+			Writer.WriteVarInt(static_cast<int16>(State.ActorYaw - Baseline.ActorYaw));
+			Writer.WriteVarInt(static_cast<int16>(State.AimYaw - Baseline.AimYaw));
+			Writer.WriteVarInt(static_cast<int16>(State.AimPitch - Baseline.AimPitch));
+		}
+		if (Mask & Changed_Flags)
+			Writer.WriteByte(State.Flags);
+
+		return true;
+	}
+
+	bool ReadState(FBlasterReplayByteReader& Reader, TMap<uint32, FBlasterReplayCharacterState>& States)
+	{
+		const uint32 Id = Reader.ReadVarUInt();
+		const uint8 Mask = Reader.ReadByte();
+
+		FBlasterReplayCharacterState& State = States.FindOrAdd(Id);
+		State.Id = Id;
+		if (Mask & Changed_Location)
+		{
+			State.Location.X += Reader.ReadVarInt();
+			State.Location.Y += Reader.ReadVarInt();
+			State.Location.Z += Reader.ReadVarInt();
+		}
+		if (Mask & Changed_Velocity)
+		{
+			State.Velocity.X += Reader.ReadVarInt();
+			State.Velocity.Y += Reader.ReadVarInt();
+			State.Velocity.Z += Reader.ReadVarInt();
+		}
+		if (Mask & Changed_Rotation)
+		{
+			State.ActorYaw = static_cast<uint16>(State.ActorYaw + Reader.ReadVarInt());
+			State.AimYaw = static_cast<uint16>(State.AimYaw + Reader.ReadVarInt());
+			State.AimPitch = static_cast<uint16>(State.AimPitch + Reader.ReadVarInt());
+		}
+		if (Mask & Changed_Flags)
+			State.Flags = Reader.ReadByte();
+
+		return !Reader.HasError();
+	}
+}
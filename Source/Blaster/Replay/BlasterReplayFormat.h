@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Replay file layout (little endian):
+ *
+ *   File header:  Magic 'BRPL', Version, SnapshotRate (float), MapName (varint length + UTF-8)
+ *   Chunk*:       Magic 'BRCK', PayloadBytes (uint32), StartTime, EndTime (double, server world time), NumFrames (uint32),
+ *                 then PayloadBytes of records
+ *
+ * Every chunk starts with a keyframe and can be decoded on its own, which is what seeking relies on: find the chunk
+ * around the time, decode it from its start. A truncated last chunk (crashed server) is just ignored.
+ *
+ * Records inside a chunk, each one: Type (1 byte), TimeMs since the chunk start (varint), then
+ *   Character: Id (varint), PlayerName (string). Re-sent at the start of every chunk for the characters alive then.
+ *   Removed:   Id (varint)
+ *   Frame:     NumStates (varint), then per state: Id (varint), ChangedMask (1 byte), the changed fields as zigzag varint
+ *              deltas from the last state of that Id in the chunk (from zero in the keyframe). Unchanged characters are
+ *              left out. Location/velocity in cm (cm/s), rotations as 16 bit angles.
+ *   Hitscan:   ShooterId, HitId (0: nothing) (varints), HitBoxIndex (1 byte, 255: none)
+ */
+namespace BlasterReplay
+{
+	constexpr uint32 FileMagic{ 0x4C505242 }; // "BRPL"
+	constexpr uint32 ChunkMagic{ 0x4B435242 }; // "BRCK"
+	constexpr uint32 Version{ 1 };
+	constexpr int32 ChunkHeaderBytes{ 4 + 4 + 8 + 8 + 4 };
+
+	enum class ERecordType : uint8
+	{
+		Character,
+		Removed,
+		Frame,
+		Hitscan,
+	};
+
+	enum EChangedField : uint8
+	{
+		Changed_Location = 1 << 0,
+		Changed_Velocity = 1 << 1,
+		Changed_Rotation = 1 << 2,
+		Changed_Flags = 1 << 3,
+	};
+}
+
+// What is recorded of one character, already quantized
+struct FBlasterReplayCharacterState
+{
+	uint32 Id{ 0 };
+	FIntVector Location{ 0 };
+	FIntVector Velocity{ 0 };
+	uint16 ActorYaw{ 0 };
+	uint16 AimYaw{ 0 };
+	uint16 AimPitch{ 0 };
+	uint8 Flags{ 0 };
+
+	uint8 GetChangedMask(const FBlasterReplayCharacterState& Baseline) const;
+
+	FVector GetLocation() const { return FVector(Location); }
+	FRotator GetAimRotation() const;
+};
+
+struct FBlasterReplayChunkHeader
+{
+	uint32 PayloadBytes{ 0 };
+	double StartTime{ 0.0 };
+	double EndTime{ 0.0 };
+	uint32 NumFrames{ 0 };
+
+	void Write(uint8* Dest) const;
+	bool Read(const uint8* Source);
+};
+
+// Appends to a byte array (varints, zigzag for signed values)
+class FBlasterReplayByteWriter
+{
+public:
+	explicit FBlasterReplayByteWriter(TArray<uint8>& InBytes) : Bytes(InBytes) {}
+
+	void WriteByte(const uint8 Value) { Bytes.Add(Value); }
+	void WriteVarUInt(uint32 Value);
+	void WriteVarInt(const int32 Value) { WriteVarUInt((static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31)); }
+	void WriteString(const FString& Value);
+
+private:
+	TArray<uint8>& Bytes;
+};
+
+// Reads what FBlasterReplayByteWriter wrote. Reading past the end sets the error flag and returns zeros.
+class FBlasterReplayByteReader
+{
+public:
+	FBlasterReplayByteReader(const uint8* InData, const int32 InNum) : Data(InData), Num(InNum) {}
+
+	uint8 ReadByte();
+	uint32 ReadVarUInt();
+	int32 ReadVarInt() { const uint32 Value = ReadVarUInt(); return static_cast<int32>(Value >> 1) ^ -static_cast<int32>(Value & 1); }
+	FString ReadString();
+
+	bool IsAtEnd() const { return Offset >= Num; }
+	int32 GetOffset() const { return Offset; }
+	bool HasError() const { return bError; }
+
+private:
+	const uint8* Data;
+	int32 Num;
+	int32 Offset{ 0 };
+	bool bError{ false };
+};
+
+namespace BlasterReplay
+{
+	// Delta-encodes State against Baseline. Writes nothing and returns false if nothing changed.
+	bool WriteState(FBlasterReplayByteWriter& Writer, const FBlasterReplayCharacterState& State, const FBlasterReplayCharacterState& Baseline);
+	// Applies one encoded state onto its baseline (looked up in States by Id, added if missing)
+	bool ReadState(FBlasterReplayByteReader& Reader, TMap<uint32, FBlasterReplayCharacterState>& States);
+}
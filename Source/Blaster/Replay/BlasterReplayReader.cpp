@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterReplayReader.h"
+#include "Blaster.h" // Who needs: LogBlaster
+#include "Algo/BinarySearch.h" // Who needs: Algo::UpperBoundBy
+#include "HAL/PlatformFileManager.h"
+
+bool FBlasterReplayReader::Open(const FString& InFilename)
+{
+	Filename = InFilename;
+	Keyframes.Reset();
+
+	TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*Filename, true));
+	if (!File) return false;
+
+	// File header: magic, version, rate, then the map name (at most a few hundred bytes)
+	uint8 HeaderBytes[512];
+	const int64 HeaderRead = FMath::Min<int64>(sizeof(HeaderBytes), File->Size());
+	if (HeaderRead < 12 || !File->Read(HeaderBytes, HeaderRead)) return false;
+
+	uint32 Magic{ 0 };
+	uint32 FileVersion{ 0 };
+	FMemory::Memcpy(&Magic, HeaderBytes, 4);
+	FMemory::Memcpy(&FileVersion, HeaderBytes + 4, 4);
+	FMemory::Memcpy(&SnapshotRate, HeaderBytes + 8, 4);
+	if (Magic != BlasterReplay::FileMagic || FileVersion != BlasterReplay::Version)
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("Replay: %s is not a replay (or a different version)"), *Filename);
+		return false;
+	}
+
+	FBlasterReplayByteReader HeaderReader(HeaderBytes + 12, HeaderRead - 12);
+	MapName = HeaderReader.ReadString();
+	if (HeaderReader.HasError()) return false;
+	int64 Offset = 12 + HeaderReader.GetOffset();
+
+	// Chunk headers only: the index of the keyframes
+	const int64 FileSize = File->Size();
+	uint8 ChunkHeaderBytes[BlasterReplay::ChunkHeaderBytes];
+	while (Offset + BlasterReplay::ChunkHeaderBytes <= FileSize)
+	{
+		FBlasterReplayChunkHeader Header;
+		if (!File->Seek(Offset) || !File->Read(ChunkHeaderBytes, BlasterReplay::ChunkHeaderBytes) || !Header.Read(ChunkHeaderBytes))
+			break;
+
+		const int64 PayloadOffset = Offset + BlasterReplay::ChunkHeaderBytes;
+		// Truncated last chunk
+		if (PayloadOffset + Header.PayloadBytes > FileSize) break;
+
+		Keyframes.Add({ PayloadOffset, Header.PayloadBytes, Header.StartTime, Header.EndTime });
+		Offset = PayloadOffset + Header.PayloadBytes;
+	}
+
+	return true;
+}
+
+bool FBlasterReplayReader::Seek(double Time, FBlasterReplayFrame& OutFrame)
+{
+	OutFrame = FBlasterReplayFrame();
+	if (Keyframes.IsEmpty()) return false;
+
+	Time = FMath::Clamp(Time, GetStartTime(), GetEndTime());
+
+	// Last keyframe at or before Time
+	const int32 Index = FMath::Max(0, Algo::UpperBoundBy(Keyframes, Time, &FKeyframe::StartTime) - 1);
+	const FKeyframe& Keyframe = Keyframes[Index];
+
+	TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*Filename, true));
+	Payload.SetNumUninitialized(Keyframe.PayloadBytes, EAllowShrinking::No);
+	if (!File || !File->Seek(Keyframe.Offset) || !File->Read(Payload.GetData(), Payload.Num())) return false;
+
+	// Decode from the keyframe up to Time
+	FBlasterReplayByteReader Reader(Payload.GetData(), Payload.Num());
+	OutFrame.Time = Keyframe.StartTime;
+	while (!Reader.IsAtEnd())
+	{
+		const BlasterReplay::ERecordType Type = static_cast<BlasterReplay::ERecordType>(Reader.ReadByte());
+		const double RecordTime = Keyframe.StartTime + Reader.ReadVarUInt() / 1000.0;
+		if (RecordTime > Time) break;
+
+		switch (Type)
+		{
+		case BlasterReplay::ERecordType::Character:
+		{
+			const uint32 Id = Reader.ReadVarUInt();
+			OutFrame.PlayerNames.Add(Id, Reader.ReadString());
+			break;
+		}
+		case BlasterReplay::ERecordType::Removed:
+		{
+			const uint32 Id = Reader.ReadVarUInt();
+			OutFrame.States.Remove(Id);
+			OutFrame.PlayerNames.Remove(Id);
+			break;
+		}
+		case BlasterReplay::ERecordType::Frame:
+		{
+			const uint32 NumStates = Reader.ReadVarUInt();
+			for (uint32 i = 0; i < NumStates && !Reader.HasError(); ++i)
+				BlasterReplay::ReadState(Reader, OutFrame.States);
+			OutFrame.Time = RecordTime;
+			break;
+		}
+		case BlasterReplay::ERecordType::Hitscan:
+		{
+			FBlasterReplayFrame::FHitscan& Hitscan = OutFrame.Hitscans.AddDefaulted_GetRef();
+			Hitscan.Time = RecordTime;
+			Hitscan.ShooterId = Reader.ReadVarUInt();
+			Hitscan.HitId = Reader.ReadVarUInt();
+			Hitscan.HitBoxIndex = Reader.ReadByte();
+			break;
+		}
+		default:
+			UE_LOG(LogBlaster, Warning, TEXT("Replay: unknown record %d in %s, chunk %d"), static_cast<int32>(Type), *Filename, Index);
+			return false;
+		}
+
+		if (Reader.HasError())
+		{
+			UE_LOG(LogBlaster, Warning, TEXT("Replay: chunk %d of %s is corrupted"), Index, *Filename);
+			return false;
+		}
+	}
+
+	return true;
+}
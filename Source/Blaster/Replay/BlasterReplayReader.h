@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BlasterReplayFormat.h"
+
+class IFileHandle;
+
+// Everything known at one point of the replay
+struct FBlasterReplayFrame
+{
+	double Time{ 0.0 };
+	TMap<uint32, FBlasterReplayCharacterState> States;
+	TMap<uint32, FString> PlayerNames;
+
+	struct FHitscan
+	{
+		double Time{ 0.0 };
+		uint32 ShooterId{ 0 };
+		uint32 HitId{ 0 };
+		uint8 HitBoxIndex{ 0xFF };
+	};
+	// Shots in the decoded part of the chunk, up to Time
+	TArray<FHitscan> Hitscans;
+};
+
+/**
+ * Reads a replay written by UBlasterReplaySubsystem. Open() only reads the chunk headers, to build the keyframe index;
+ * Seek() then reads the one chunk around the time and decodes it from its keyframe. Reads the file while it is still
+ * being written too (up to the last complete chunk at the time of Open).
+ */
+class FBlasterReplayReader
+{
+public:
+	bool Open(const FString& Filename);
+
+	double GetStartTime() const { return Keyframes.IsEmpty() ? 0.0 : Keyframes[0].StartTime; }
+	double GetEndTime() const { return Keyframes.IsEmpty() ? 0.0 : Keyframes.Last().EndTime; }
+	int32 GetNumKeyframes() const { return Keyframes.Num(); }
+	float GetSnapshotRate() const { return SnapshotRate; }
+	const FString& GetMapName() const { return MapName; }
+
+	// State at Time (clamped to the recording), or false if the chunk can't be read
+	bool Seek(double Time, FBlasterReplayFrame& OutFrame);
+
+private:
+	struct FKeyframe
+	{
+		int64 Offset{ 0 };
+		uint32 PayloadBytes{ 0 };
+		double StartTime{ 0.0 };
+		double EndTime{ 0.0 };
+	};
+	TArray<FKeyframe> Keyframes;
+
+	FString Filename;
+	float SnapshotRate{ 0.f };
+	FString MapName;
+
+	// Payload of the last chunk read, reused
+	TArray<uint8> Payload;
+};
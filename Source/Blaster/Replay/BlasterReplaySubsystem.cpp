@@ -0,0 +1,360 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterReplaySubsystem.h"
+#include "Blaster.h" // Who needs: STATGROUP_Blaster, LogBlaster
+#include "BlasterReplayReader.h"
+#include "BlasterReplayWriter.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/Weapon/BlasterHitscanSubsystem.h" // Who needs: OnHitscanResolved
+#include "Engine/World.h"
+#include "EngineUtils.h" // Who needs: TActorIterator
+#include "GameFramework/PlayerState.h" // Who needs: GetPlayerName
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+
+DECLARE_CYCLE_STAT(TEXT("Replay Record"), STAT_BlasterReplayRecord, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Replay Bytes"), STAT_BlasterReplayBytes, STATGROUP_Blaster);
+
+namespace BlasterReplayRecording
+{
+	static FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("Blaster.ReplayStats"),
+		TEXT("Prints the cost of the replay recording so far: game thread time per frame, bytes per minute, drops."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (const UBlasterReplaySubsystem* Subsystem = World ? World->GetSubsystem<UBlasterReplaySubsystem>() : nullptr)
+				Subsystem->LogStats();
+		}));
+
+	static FAutoConsoleCommand SeekCommand(
+		TEXT("Blaster.ReplaySeek"),
+		TEXT("Blaster.ReplaySeek <File> <Seconds>: prints every character of a replay at that many seconds from its start. ")
+		TEXT("Relative files are looked up in Saved/BlasterReplays."),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (Args.IsEmpty()) return;
+
+			FString Filename = Args[0];
+			if (FPaths::IsRelative(Filename))
+				Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("BlasterReplays"), Filename);
+
+			FBlasterReplayReader Reader;
+			if (!Reader.Open(Filename))
+			{
+				UE_LOG(LogBlaster, Warning, TEXT("Replay: couldn't open %s"), *Filename);
+				return;
+			}
+
+			const double Seconds = Args.Num() > 1 ? FCString::Atod(*Args[1]) : 0.0;
+			FBlasterReplayFrame Frame;
+			if (!Reader.Seek(Reader.GetStartTime() + Seconds, Frame)) return;
+
+			UE_LOG(LogBlaster, Log, TEXT("Replay %s (%s): %.1f s, %d keyframes. At %.2f s:"), *FPaths::GetCleanFilename(Filename),
+				*Reader.GetMapName(), Reader.GetEndTime() - Reader.GetStartTime(), Reader.GetNumKeyframes(), Frame.Time - Reader.GetStartTime());
+			for (const TPair<uint32, FBlasterReplayCharacterState>& Pair : Frame.States)
+			{
+				const FString* Name = Frame.PlayerNames.Find(Pair.Key);
+				UE_LOG(LogBlaster, Log, TEXT("  %u %s: %s aim %s flags %d"), Pair.Key, Name ? **Name : TEXT("?"),
+					*Pair.Value.GetLocation().ToCompactString(), *Pair.Value.GetAimRotation().ToCompactString(), Pair.Value.Flags);
+			}
+			for (const FBlasterReplayFrame::FHitscan& Hitscan : Frame.Hitscans)
+			{
+				UE_LOG(LogBlaster, Log, TEXT("  %.2f s: %u shot %u (hit box %d)"), Hitscan.Time - Reader.GetStartTime(),
+					Hitscan.ShooterId, Hitscan.HitId, Hitscan.HitBoxIndex == 0xFF ? -1 : Hitscan.HitBoxIndex);
+			}
+		}));
+}
+
+bool UBlasterReplaySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UBlasterReplaySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// The server's view is the one to review
+	if (InWorld.GetNetMode() == NM_Client || InWorld.GetNetMode() == NM_Standalone) return;
+	if (!bRecordMatches && !FParse::Param(FCommandLine::Get(), TEXT("RecordReplay"))) return;
+	LLM_SCOPE_BYTAG(Blaster_Replay);
+
+	const FString MapName = InWorld.GetMapName();
+	const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("BlasterReplays"),
+		FString::Printf(TEXT("%s_%s.brpl"), *MapName, *FDateTime::Now().ToString()));
+
+	Writer = MakeUnique<FBlasterReplayWriter>(Filename, SnapshotRate, MapName, FMath::Max(ChunkKB, 4) * 1024, FMath::Max(MaxBufferedChunks, 2));
+	if (!Writer->IsOpen())
+	{
+		Writer.Reset();
+		return;
+	}
+
+	if (UBlasterHitscanSubsystem* HitscanSubsystem = InWorld.GetSubsystem<UBlasterHitscanSubsystem>())
+		HitscanHandle = HitscanSubsystem->OnHitscanResolved.AddUObject(this, &ThisClass::OnHitscanResolved);
+
+	PendingHitscans.Reserve(MaxPendingHitscans);
+	RecordStartTime = InWorld.GetTimeSeconds();
+	UE_LOG(LogBlaster, Log, TEXT("Replay: recording to %s (%d KB max in memory)"), *Filename,
+		static_cast<int32>(Writer->GetAllocatedSize() / 1024));
+}
+
+void UBlasterReplaySubsystem::Deinitialize()
+{
+	if (Writer)
+	{
+		if (UBlasterHitscanSubsystem* HitscanSubsystem = GetWorld()->GetSubsystem<UBlasterHitscanSubsystem>())
+			HitscanSubsystem->OnHitscanResolved.Remove(HitscanHandle);
+
+		RecordFrame(GetWorld()->GetTimeSeconds());
+		SubmitChunk();
+		LogStats();
+
+		// Waits for the writer thread to write what's queued
+		Writer.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+TStatId UBlasterReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBlasterReplaySubsystem, STATGROUP_Tickables);
+}
+
+void UBlasterReplaySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SnapshotAccumulator += DeltaTime;
+	const double Interval{ 1.0 / FMath::Max(SnapshotRate, 1.f) };
+	if (SnapshotAccumulator < Interval) return;
+
+	// One snapshot per frame at most, a hitch doesn't make up for the missed ones
+	SnapshotAccumulator = FMath::Fmod(SnapshotAccumulator, Interval);
+	RecordFrame(GetWorld()->GetTimeSeconds());
+}
+
+void UBlasterReplaySubsystem::RecordFrame(const double Now)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterReplayRecord);
+	LLM_SCOPE_BYTAG(Blaster_Replay);
+	const double StartTime{ FPlatformTime::Seconds() };
+
+	if (CurrentChunk && Now - CurrentChunk->Header.StartTime >= KeyframeInterval)
+		SubmitChunk();
+
+	GatherStates();
+
+	bool bKeyframe{ false };
+	if (!CurrentChunk)
+	{
+		bKeyframe = StartChunk(Now);
+		if (!bKeyframe)
+		{
+			++DroppedFrames;
+			return;
+		}
+	}
+
+	EncodeRecords(Now, bKeyframe);
+	if (CurrentChunk->Bytes.Num() + Scratch.Num() > Writer->GetChunkCapacity())
+	{
+		// Full: this frame becomes the keyframe of the next chunk
+		SubmitChunk();
+		if (!StartChunk(Now))
+		{
+			++DroppedFrames;
+			return;
+		}
+		EncodeRecords(Now, true);
+		if (CurrentChunk->Bytes.Num() + Scratch.Num() > Writer->GetChunkCapacity())
+		{
+			UE_LOG(LogBlaster, Warning, TEXT("Replay: a keyframe (%d bytes) doesn't fit in a chunk, raise ChunkKB"), Scratch.Num());
+			++DroppedFrames;
+			return;
+		}
+	}
+
+	CurrentChunk->Bytes.Append(Scratch);
+	CurrentChunk->Header.EndTime = Now;
+	++CurrentChunk->Header.NumFrames;
+	for (const FBlasterReplayCharacterState& State : States)
+		Baselines.Add(State.Id, State);
+	for (const uint32 Id : RemovedIds)
+		Baselines.Remove(Id);
+	PendingHitscans.Reset();
+
+	++RecordedFrames;
+	const double RecordMs{ (FPlatformTime::Seconds() - StartTime) * 1000.0 };
+	TotalRecordMs += RecordMs;
+	MaxRecordMs = FMath::Max(MaxRecordMs, RecordMs);
+	SET_DWORD_STAT(STAT_BlasterReplayBytes, Scratch.Num());
+}
+
+void UBlasterReplaySubsystem::GatherStates()
+{
+	States.Reset();
+	NewIds.Reset();
+	RemovedIds.Reset();
+
+	for (auto It = CharacterIds.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			RemovedIds.Add(It.Value());
+			It.RemoveCurrent();
+		}
+	}
+
+	for (TActorIterator<ABlasterCharacter> It(GetWorld()); It; ++It)
+	{
+		ABlasterCharacter* Character = *It;
+		uint32* ExistingId = CharacterIds.Find(Character);
+		if (!ExistingId)
+		{
+			ExistingId = &CharacterIds.Add(Character, NextCharacterId++);
+			NewIds.Add(*ExistingId);
+		}
+
+		const FVector Location = Character->GetActorLocation();
+		const FVector Velocity = Character->GetVelocity();
+		const FRotator AimRotation = Character->GetBaseAimRotation();
+
+		FBlasterReplayCharacterState& State = States.AddDefaulted_GetRef();
+		State.Id = *ExistingId;
+		State.Location = FIntVector(FMath::RoundToInt32(Location.X), FMath::RoundToInt32(Location.Y), FMath::RoundToInt32(Location.Z));
+		State.Velocity = FIntVector(FMath::RoundToInt32(Velocity.X), FMath::RoundToInt32(Velocity.Y), FMath::RoundToInt32(Velocity.Z));
+		State.ActorYaw = FRotator::CompressAxisToShort(Character->GetActorRotation().Yaw);
+		State.AimYaw = FRotator::CompressAxisToShort(AimRotation.Yaw);
+		State.AimPitch = FRotator::CompressAxisToShort(AimRotation.Pitch);
+		State.Flags = static_cast<uint8>(Character->GetMovementFlags() & ~EBlasterMovementFlags::LocallyControlled);
+	}
+}
+
+void UBlasterReplaySubsystem::EncodeRecords(const double Now, const bool bKeyframe)
+{
+	Scratch.Reset();
+	FBlasterReplayByteWriter RecordWriter(Scratch);
+
+	auto WriteRecordHeader = [this, &RecordWriter](const BlasterReplay::ERecordType Type, const double Time)
+	{
+		RecordWriter.WriteByte(static_cast<uint8>(Type));
+		RecordWriter.WriteVarUInt(static_cast<uint32>(FMath::Max(0.0, Time - CurrentChunk->Header.StartTime) * 1000.0));
+	};
+
+	// Names: all of them in a keyframe, so a chunk decodes on its own. Otherwise only the new ones.
+	for (const TPair<TWeakObjectPtr<ABlasterCharacter>, uint32>& Pair : CharacterIds)
+	{
+		if (!bKeyframe && !NewIds.Contains(Pair.Value)) continue;
+
+		const ABlasterCharacter* Character = Pair.Key.Get();
+		const APlayerState* PlayerState = Character ? Character->GetPlayerState() : nullptr;
+		WriteRecordHeader(BlasterReplay::ERecordType::Character, Now);
+		RecordWriter.WriteVarUInt(Pair.Value);
+		RecordWriter.WriteString(PlayerState ? PlayerState->GetPlayerName() : GetNameSafe(Character));
+	}
+
+	if (!bKeyframe)
+	{
+		for (const uint32 Id : RemovedIds)
+		{
+			WriteRecordHeader(BlasterReplay::ERecordType::Removed, Now);
+			RecordWriter.WriteVarUInt(Id);
+		}
+	}
+
+	for (const FPendingHitscan& Hitscan : PendingHitscans)
+	{
+		WriteRecordHeader(BlasterReplay::ERecordType::Hitscan, Hitscan.Time);
+		RecordWriter.WriteVarUInt(Hitscan.ShooterId);
+		RecordWriter.WriteVarUInt(Hitscan.HitId);
+		RecordWriter.WriteByte(Hitscan.HitBoxIndex);
+	}
+
+	// The state count comes first, but unchanged characters are left out: encode the states apart, then count
+	StateScratch.Reset();
+	FBlasterReplayByteWriter StateWriter(StateScratch);
+	uint32 NumStates{ 0 };
+	for (const FBlasterReplayCharacterState& State : States)
+	{
+		const FBlasterReplayCharacterState* Baseline = bKeyframe ? nullptr : Baselines.Find(State.Id);
+		if (Baseline)
+		{
+			NumStates += BlasterReplay::WriteState(StateWriter, State, *Baseline) ? 1 : 0;
+			continue;
+		}
+
+		// No baseline (keyframe, new character): always written, even if it's all zeros
+		FBlasterReplayCharacterState Zero;
+		Zero.Id = State.Id;
+		if (!BlasterReplay::WriteState(StateWriter, State, Zero))
+		{
+			StateWriter.WriteVarUInt(State.Id);
+			StateWriter.WriteByte(0);
+		}
+		++NumStates;
+	}
+
+	WriteRecordHeader(BlasterReplay::ERecordType::Frame, Now);
+	RecordWriter.WriteVarUInt(NumStates);
+	Scratch.Append(StateScratch);
+}
+
+bool UBlasterReplaySubsystem::StartChunk(const double Now)
+{
+	CurrentChunk = Writer->AcquireChunk();
+	if (!CurrentChunk) return false;
+
+	CurrentChunk->Header.StartTime = Now;
+	CurrentChunk->Header.EndTime = Now;
+	Baselines.Reset();
+	return true;
+}
+
+void UBlasterReplaySubsystem::SubmitChunk()
+{
+	if (!CurrentChunk) return;
+
+	Writer->SubmitChunk(CurrentChunk);
+	CurrentChunk = nullptr;
+}
+
+uint32 UBlasterReplaySubsystem::GetCharacterId(const ABlasterCharacter* Character) const
+{
+	const uint32* Id = Character ? CharacterIds.Find(Character) : nullptr;
+	return Id ? *Id : 0;
+}
+
+void UBlasterReplaySubsystem::OnHitscanResolved(const FBlasterHitscanResult& Result)
+{
+	if (PendingHitscans.Num() >= MaxPendingHitscans)
+	{
+		++DroppedHitscans;
+		return;
+	}
+
+	FPendingHitscan& Hitscan = PendingHitscans.AddDefaulted_GetRef();
+	Hitscan.Time = GetWorld()->GetTimeSeconds();
+	Hitscan.ShooterId = GetCharacterId(Result.Request.Shooter.Get());
+	Hitscan.HitId = GetCharacterId(Result.HitCharacter.Get());
+	Hitscan.HitBoxIndex = Result.HitBoxIndex == INDEX_NONE ? 0xFF : static_cast<uint8>(Result.HitBoxIndex);
+}
+
+void UBlasterReplaySubsystem::LogStats() const
+{
+	if (!Writer)
+	{
+		UE_LOG(LogBlaster, Log, TEXT("Replay: not recording"));
+		return;
+	}
+
+	const double Minutes = FMath::Max((GetWorld()->GetTimeSeconds() - RecordStartTime) / 60.0, 1.0 / 60.0);
+	UE_LOG(LogBlaster, Log, TEXT("Replay: %d frames recorded, %d dropped, %d shots dropped. Record %.3f ms avg, %.3f ms max per snapshot. ")
+		TEXT("%.1f KB written, %.1f KB/min. %d KB buffer."),
+		RecordedFrames, DroppedFrames, DroppedHitscans,
+		RecordedFrames > 0 ? TotalRecordMs / RecordedFrames : 0.0, MaxRecordMs,
+		Writer->GetBytesWritten() / 1024.0, Writer->GetBytesWritten() / 1024.0 / Minutes,
+		static_cast<int32>(Writer->GetAllocatedSize() / 1024));
+}
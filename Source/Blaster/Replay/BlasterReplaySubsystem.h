@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BlasterReplayFormat.h"
+#include "BlasterReplaySubsystem.generated.h"
+
+class ABlasterCharacter;
+class FBlasterReplayWriter;
+struct FBlasterReplayChunk;
+struct FBlasterHitscanResult;
+
+/**
+ * Records the match on the server, for anti-cheat review: every ABlasterCharacter's state at SnapshotRate, plus who
+ * joined, who left and every validated hitscan shot. Written to Saved/BlasterReplays/<Map>_<Date>.brpl in the format
+ * described in BlasterReplayFormat.h, a keyframe every KeyframeInterval seconds.
+ *
+ * The game thread only quantizes and delta-encodes into the current chunk; full chunks go to the disk from the
+ * FBlasterReplayWriter thread. Memory is fixed at MaxBufferedChunks * ChunkKB for the whole match: if the disk falls
+ * that far behind, frames are dropped (and counted) instead of buffered.
+ *
+ * Off unless bRecordMatches (DefaultGame.ini) or -RecordReplay. "Blaster.ReplayStats" prints the recording cost per
+ * frame and the bytes per minute, "Blaster.ReplaySeek <File> <Seconds>" decodes a replay at some point of the match.
+ */
+UCLASS(Config = Game)
+class BLASTER_API UBlasterReplaySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override { return Writer.IsValid(); }
+
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	UPROPERTY(Config)
+	bool bRecordMatches{ false };
+
+	// Character snapshots per second
+	UPROPERTY(Config)
+	float SnapshotRate{ 20.f };
+
+	// Seconds between keyframes (a new chunk starts at each one, sooner if the chunk is full)
+	UPROPERTY(Config)
+	float KeyframeInterval{ 5.f };
+
+	UPROPERTY(Config)
+	int32 ChunkKB{ 64 };
+
+	// Chunks being filled or waiting for the disk. Times ChunkKB, the memory cap of the recording.
+	UPROPERTY(Config)
+	int32 MaxBufferedChunks{ 8 };
+
+	TUniquePtr<FBlasterReplayWriter> Writer;
+	FBlasterReplayChunk* CurrentChunk{ nullptr };
+
+	TMap<TWeakObjectPtr<ABlasterCharacter>, uint32> CharacterIds;
+	uint32 NextCharacterId{ 1 };
+
+	// Reused every frame
+	TArray<FBlasterReplayCharacterState> States;
+	TArray<uint32> NewIds;
+	TArray<uint32> RemovedIds;
+	TArray<uint8> Scratch;
+	TArray<uint8> StateScratch;
+	// Last state written of each id in the current chunk (delta baseline)
+	TMap<uint32, FBlasterReplayCharacterState> Baselines;
+
+	struct FPendingHitscan
+	{
+		double Time{ 0.0 };
+		uint32 ShooterId{ 0 };
+		uint32 HitId{ 0 };
+		uint8 HitBoxIndex{ 0xFF };
+	};
+	// Shots since the last snapshot. Capped, like everything else.
+	TArray<FPendingHitscan> PendingHitscans;
+	static constexpr int32 MaxPendingHitscans{ 512 };
+	FDelegateHandle HitscanHandle;
+
+	double SnapshotAccumulator{ 0.0 };
+	double RecordStartTime{ 0.0 };
+
+	// Metrics
+	int32 RecordedFrames{ 0 };
+	int32 DroppedFrames{ 0 };
+	int32 DroppedHitscans{ 0 };
+	double TotalRecordMs{ 0.0 };
+	double MaxRecordMs{ 0.0 };
+
+	void RecordFrame(double Now);
+	void GatherStates();
+	void EncodeRecords(double Now, bool bKeyframe);
+	bool StartChunk(double Now);
+	void SubmitChunk();
+
+	uint32 GetCharacterId(const ABlasterCharacter* Character) const;
+	void OnHitscanResolved(const FBlasterHitscanResult& Result);
+};
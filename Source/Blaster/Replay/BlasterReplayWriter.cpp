@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterReplayWriter.h"
+#include "Blaster.h" // Who needs: LogBlaster
+#include "HAL/PlatformFileManager.h"
+#include "HAL/RunnableThread.h"
+
+FBlasterReplayWriter::FBlasterReplayWriter(const FString& InFilename, const float SnapshotRate, const FString& MapName, const int32 ChunkBytes, const int32 NumChunks):
+	Filename(InFilename),
+	ChunkCapacity(ChunkBytes)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+	File.Reset(PlatformFile.OpenWrite(*Filename));
+	if (!File)
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("Replay: couldn't open %s"), *Filename);
+		return;
+	}
+
+	// The file header is tiny, write it right away
+	TArray<uint8> Header;
+	FBlasterReplayByteWriter HeaderWriter(Header);
+	Header.Append(reinterpret_cast<const uint8*>(&BlasterReplay::FileMagic), 4);
+	Header.Append(reinterpret_cast<const uint8*>(&BlasterReplay::Version), 4);
+	Header.Append(reinterpret_cast<const uint8*>(&SnapshotRate), 4);
+	HeaderWriter.WriteString(MapName);
+	File->Write(Header.GetData(), Header.Num());
+	BytesWritten = Header.Num();
+
+	Chunks.Reserve(NumChunks);
+	for (int32 i = 0; i < NumChunks; ++i)
+	{
+		TUniquePtr<FBlasterReplayChunk>& Chunk = Chunks.Add_GetRef(MakeUnique<FBlasterReplayChunk>());
+		Chunk->Bytes.Reserve(ChunkBytes);
+		FreeChunks.Enqueue(Chunk.Get());
+	}
+
+	WorkEvent = FPlatformProcess::GetSynchEventFromPool();
+	Thread = FRunnableThread::Create(this, TEXT("BlasterReplayWriter"), 0, TPri_BelowNormal);
+}
+
+FBlasterReplayWriter::~FBlasterReplayWriter()
+{
+	if (Thread)
+	{
+		// Run() writes whatever is still queued before it returns
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	if (WorkEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		WorkEvent = nullptr;
+	}
+
+	File.Reset();
+}
+
+FBlasterReplayChunk* FBlasterReplayWriter::AcquireChunk()
+{
+	FBlasterReplayChunk* Chunk{ nullptr };
+	if (!FreeChunks.Dequeue(Chunk)) return nullptr;
+
+	Chunk->Header = FBlasterReplayChunkHeader();
+	Chunk->Bytes.SetNumUninitialized(BlasterReplay::ChunkHeaderBytes, EAllowShrinking::No);
+	return Chunk;
+}
+
+void FBlasterReplayWriter::SubmitChunk(FBlasterReplayChunk* Chunk)
+{
+	Chunk->Header.PayloadBytes = Chunk->Bytes.Num() - BlasterReplay::ChunkHeaderBytes;
+	Chunk->Header.Write(Chunk->Bytes.GetData());
+	FullChunks.Enqueue(Chunk);
+	WorkEvent->Trigger();
+}
+
+SIZE_T FBlasterReplayWriter::GetAllocatedSize() const
+{
+	SIZE_T Size = Chunks.GetAllocatedSize();
+	for (const TUniquePtr<FBlasterReplayChunk>& Chunk : Chunks)
+		Size += sizeof(FBlasterReplayChunk) + Chunk->Bytes.GetAllocatedSize();
+	return Size;
+}
+
+uint32 FBlasterReplayWriter::Run()
+{
+	while (!bStopping)
+	{
+		WorkEvent->Wait(FTimespan::FromMilliseconds(100));
+		WriteFullChunks();
+	}
+
+	WriteFullChunks();
+	File->Flush();
+	return 0;
+}
+
+void FBlasterReplayWriter::Stop()
+{
+	bStopping = true;
+	if (WorkEvent)
+		WorkEvent->Trigger();
+}
+
+void FBlasterReplayWriter::WriteFullChunks()
+{
+	FBlasterReplayChunk* Chunk{ nullptr };
+	while (FullChunks.Dequeue(Chunk))
+	{
+		if (File->Write(Chunk->Bytes.GetData(), Chunk->Bytes.Num()))
+		{
+			BytesWritten.fetch_add(Chunk->Bytes.Num(), std::memory_order_relaxed);
+		}
+		else
+		{
+			UE_LOG(LogBlaster, Warning, TEXT("Replay: write to %s failed, chunk lost"), *Filename);
+		}
+		FreeChunks.Enqueue(Chunk);
+	}
+}
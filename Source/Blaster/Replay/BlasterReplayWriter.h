@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BlasterReplayFormat.h"
+#include "Containers/Queue.h"
+#include "HAL/Runnable.h"
+#include <atomic>
+
+class FRunnableThread;
+class IFileHandle;
+
+// A chunk being filled by the game thread, or waiting for the writer thread
+struct FBlasterReplayChunk
+{
+	FBlasterReplayChunkHeader Header;
+	// Header bytes first (filled in on submit), then the records
+	TArray<uint8> Bytes;
+};
+
+/**
+ * Writes replay chunks to disk from its own thread, so the game thread never waits on the file.
+ *
+ * All the chunks are allocated up front (NumChunks * ChunkBytes): that is the whole memory of the recording, however
+ * long the match. The game thread fills one chunk at a time and submits it; the writer thread writes it and hands it
+ * back. If the disk can't keep up, AcquireChunk returns nothing until a chunk comes back, and the recorder drops frames.
+ */
+class FBlasterReplayWriter : public FRunnable
+{
+public:
+	FBlasterReplayWriter(const FString& InFilename, float SnapshotRate, const FString& MapName, int32 ChunkBytes, int32 NumChunks);
+	virtual ~FBlasterReplayWriter() override;
+
+	bool IsOpen() const { return Thread != nullptr; }
+
+	// Game thread. nullptr if every chunk is waiting to be written.
+	FBlasterReplayChunk* AcquireChunk();
+	// Game thread. The chunk belongs to the writer until it comes back through AcquireChunk.
+	void SubmitChunk(FBlasterReplayChunk* Chunk);
+
+	int32 GetChunkCapacity() const { return ChunkCapacity; }
+	SIZE_T GetAllocatedSize() const;
+	uint64 GetBytesWritten() const { return BytesWritten.load(std::memory_order_relaxed); }
+	const FString& GetFilename() const { return Filename; }
+
+	//~ Begin FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	//~ End FRunnable
+
+private:
+	FString Filename;
+	int32 ChunkCapacity{ 0 };
+
+	TArray<TUniquePtr<FBlasterReplayChunk>> Chunks;
+	// Game thread -> writer thread, and back
+	TQueue<FBlasterReplayChunk*, EQueueMode::Spsc> FullChunks;
+	TQueue<FBlasterReplayChunk*, EQueueMode::Spsc> FreeChunks;
+
+	TUniquePtr<IFileHandle> File;
+	FEvent* WorkEvent{ nullptr };
+	FRunnableThread* Thread{ nullptr };
+	std::atomic<bool> bStopping{ false };
+	std::atomic<uint64> BytesWritten{ 0 };
+
+	void WriteFullChunks();
+};
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterMemoryBudget.h"
+#include "Blaster.h" // Who needs: LogBlaster, LLM tags
+#include "HAL/IConsoleManager.h"
+#include "HAL/LowLevelMemTracker.h" // Who needs: FLowLevelMemTracker
+#include "Misc/App.h" // Who needs: FApp::CanEverRender
+
+namespace
+{
+	FString Budgets{ TEXT("Blaster/Characters=64,Blaster/Replay=32,MultiplayerSessions/Search=16,MultiplayerSessions/UI=32") };
+	FAutoConsoleVariableRef CVarBudgets(
+		TEXT("Blaster.Memory.Budgets"),
+		Budgets,
+		TEXT("Budget of each memory tag, in MB: \"Tag=MB\" pairs separated by commas (e.g. \"Blaster/Characters=64\"). A tag with no budget is only reported."));
+
+	float SampleInterval{ 10.f };
+	FAutoConsoleVariableRef CVarSampleInterval(
+		TEXT("Blaster.Memory.SampleInterval"),
+		SampleInterval,
+		TEXT("Seconds between memory tag budget checks on a headless run."));
+
+	FAutoConsoleCommandWithOutputDevice ReportCommand(
+		TEXT("Blaster.MemBudget"),
+		TEXT("Prints the current and peak memory of the Blaster and MultiplayerSessions tags against their budgets (needs -llm)."),
+		FConsoleCommandWithOutputDeviceDelegate::CreateStatic(&FBlasterMemoryBudget::Report));
+
+	// Parents first, in the order they are printed
+	const TCHAR* const TagNames[]
+	{
+		TEXT("Blaster"),
+		TEXT("Blaster/Characters"),
+		TEXT("Blaster/Replay"),
+		TEXT("MultiplayerSessions"),
+		TEXT("MultiplayerSessions/Search"),
+		TEXT("MultiplayerSessions/UI"),
+	};
+
+	constexpr double BytesPerMB{ 1024.0 * 1024.0 };
+
+	// 0: no budget
+	int32 GetBudgetMB(const TCHAR* TagName)
+	{
+		TArray<FString> Pairs;
+		Budgets.ParseIntoArray(Pairs, TEXT(","));
+		for (const FString& Pair : Pairs)
+		{
+			FString Tag, MB;
+			if (Pair.Split(TEXT("="), &Tag, &MB) && Tag.TrimStartAndEnd().Equals(TagName, ESearchCase::IgnoreCase))
+				return FMath::Max(FCString::Atoi(*MB.TrimStartAndEnd()), 0);
+		}
+		return 0;
+	}
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	int64 GetTagAmount(const TCHAR* TagName, const UE::LLM::ESizeParams SizeParams)
+	{
+		return FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default, FName(TagName), ELLMTagSet::None, SizeParams);
+	}
+#endif
+}
+
+FTSTicker::FDelegateHandle FBlasterMemoryBudget::SampleHandle;
+TSet<FName> FBlasterMemoryBudget::OverBudgetReported;
+
+void FBlasterMemoryBudget::Startup()
+{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	if (GIsEditor || !FLowLevelMemTracker::IsEnabled()) return;
+
+	// Extra: Only unattended runs log it, a player or a developer asks with Blaster.MemBudget
+	if (IsRunningDedicatedServer() || !FApp::CanEverRender())
+		SampleHandle = FTSTicker::GetCoreTicker().AddTicker(TEXT("BlasterMemoryBudget"), FMath::Max(SampleInterval, 1.f), &FBlasterMemoryBudget::Sample);
+#endif
+}
+
+void FBlasterMemoryBudget::Shutdown()
+{
+	if (SampleHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(SampleHandle);
+		SampleHandle.Reset();
+
+		Report(*GLog);
+	}
+}
+
+void FBlasterMemoryBudget::Report(FOutputDevice& Ar)
+{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	if (!FLowLevelMemTracker::IsEnabled())
+	{
+		Ar.Log(TEXT("Memory budget: the low-level memory tracker is off, run with -llm"));
+		return;
+	}
+
+	Ar.Logf(TEXT("Memory budget (MB):"));
+	Ar.Logf(TEXT("  %-28s %10s %10s %10s"), TEXT("Tag"), TEXT("Current"), TEXT("Peak"), TEXT("Budget"));
+	for (const TCHAR* TagName : TagNames)
+	{
+		const int64 Current = GetTagAmount(TagName, UE::LLM::ESizeParams::ReportCurrent);
+		const int64 Peak = GetTagAmount(TagName, UE::LLM::ESizeParams::ReportPeak);
+		const int32 BudgetMB = GetBudgetMB(TagName);
+		Ar.Logf(TEXT("  %-28s %10.1f %10.1f %10s%s"), TagName, Current / BytesPerMB, Peak / BytesPerMB,
+			BudgetMB > 0 ? *FString::FromInt(BudgetMB) : TEXT("-"),
+			BudgetMB > 0 && Peak > BudgetMB * BytesPerMB ? TEXT("  OVER") : TEXT(""));
+	}
+#else
+	Ar.Log(TEXT("Memory budget: the low-level memory tracker is compiled out of this build"));
+#endif
+}
+
+bool FBlasterMemoryBudget::Sample(float DeltaTime)
+{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	for (const TCHAR* TagName : TagNames)
+	{
+		const int32 BudgetMB = GetBudgetMB(TagName);
+		if (BudgetMB <= 0 || OverBudgetReported.Contains(TagName)) continue;
+
+		const int64 Current = GetTagAmount(TagName, UE::LLM::ESizeParams::ReportCurrent);
+		if (Current > BudgetMB * BytesPerMB)
+		{
+			OverBudgetReported.Add(TagName);
+			UE_LOG(LogBlaster, Warning, TEXT("Memory budget: %s uses %.1f MB, over its %d MB budget"), TagName, Current / BytesPerMB, BudgetMB);
+		}
+	}
+#endif
+
+	return true;
+}
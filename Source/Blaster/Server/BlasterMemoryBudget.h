@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h" // Who needs: FTSTicker
+
+/**
+ * Extra: Current and peak memory of our low-level memory tracker tags (Blaster/..., MultiplayerSessions/..., see
+ * Blaster.h and MultiplayerSessions.h) against a budget per tag, so growth can be pinned on a part of our code.
+ *
+ * "Blaster.MemBudget" prints the table. On a headless run (dedicated server, or -nullrhi) the tags are also checked
+ * every Blaster.Memory.SampleInterval seconds, and going over a budget is logged once per tag. Budgets are set with
+ * Blaster.Memory.Budgets. The tags only count anything when the process runs with -llm.
+ */
+class FBlasterMemoryBudget
+{
+public:
+	static void Startup();
+	static void Shutdown();
+
+	static void Report(FOutputDevice& Ar);
+
+private:
+	static bool Sample(float DeltaTime);
+
+	static FTSTicker::FDelegateHandle SampleHandle;
+	static TSet<FName> OverBudgetReported;
+};
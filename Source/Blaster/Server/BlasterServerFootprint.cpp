@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterServerFootprint.h"
+#include "Blaster.h" // Who needs: LogBlaster, BlasterProfiling::AppendCsvRow
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CoreDelegates.h" // Who needs: OnFEngineLoopInitComplete
+
+namespace
+{
+	int32 MemoryBudgetMB{ 0 };
+	FAutoConsoleVariableRef CVarMemoryBudgetMB(
+		TEXT("Blaster.Server.MemoryBudgetMB"),
+		MemoryBudgetMB,
+		TEXT("Resident memory a dedicated server is expected to stay under, in MB. Going over it is logged once. 0: no budget."));
+
+	float SampleInterval{ 10.f };
+	FAutoConsoleVariableRef CVarSampleInterval(
+		TEXT("Blaster.Server.MemorySampleInterval"),
+		SampleInterval,
+		TEXT("Seconds between resident memory samples on a dedicated server."));
+
+	constexpr double BytesPerMB{ 1024.0 * 1024.0 };
+}
+
+FDelegateHandle FBlasterServerFootprint::EngineLoopInitHandle;
+FTSTicker::FDelegateHandle FBlasterServerFootprint::SampleHandle;
+uint64 FBlasterServerFootprint::PeakResidentBytes{ 0 };
+bool FBlasterServerFootprint::bOverBudgetReported{ false };
+
+void FBlasterServerFootprint::Startup()
+{
+	if (GIsEditor) return;
+	if (!IsRunningDedicatedServer() && !FParse::Param(FCommandLine::Get(), TEXT("ServerFootprint"))) return;
+
+	EngineLoopInitHandle = FCoreDelegates::OnFEngineLoopInitComplete.AddStatic(&FBlasterServerFootprint::OnEngineLoopInitComplete);
+}
+
+void FBlasterServerFootprint::Shutdown()
+{
+	FCoreDelegates::OnFEngineLoopInitComplete.Remove(EngineLoopInitHandle);
+
+	if (SampleHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(SampleHandle);
+		SampleHandle.Reset();
+
+		Sample(0.f);
+		AppendRow(TEXT("Exit"), FPlatformTime::Seconds() - GStartTime);
+		UE_LOG(LogBlaster, Log, TEXT("Server footprint: peak resident memory %.1f MB"), PeakResidentBytes / BytesPerMB);
+	}
+}
+
+void FBlasterServerFootprint::OnEngineLoopInitComplete()
+{
+	const double StartupSeconds{ FPlatformTime::Seconds() - GStartTime };
+	const FPlatformMemoryStats Stats = FPlatformMemory::GetStats();
+	PeakResidentBytes = FMath::Max<uint64>(Stats.UsedPhysical, Stats.PeakUsedPhysical);
+
+	UE_LOG(LogBlaster, Log, TEXT("%s footprint: started in %.2f s, resident memory %.1f MB (peak %.1f MB), virtual %.1f MB"),
+		IsRunningDedicatedServer() ? TEXT("Server") : TEXT("Game"), StartupSeconds,
+		Stats.UsedPhysical / BytesPerMB, Stats.PeakUsedPhysical / BytesPerMB, Stats.UsedVirtual / BytesPerMB);
+	AppendRow(TEXT("Startup"), StartupSeconds);
+
+	// Extra: Only servers run for hours, the client's memory is tracked with the usual tools (memreport, Insights)
+	if (IsRunningDedicatedServer())
+		SampleHandle = FTSTicker::GetCoreTicker().AddTicker(TEXT("BlasterServerFootprint"), FMath::Max(SampleInterval, 1.f), &FBlasterServerFootprint::Sample);
+}
+
+bool FBlasterServerFootprint::Sample(float DeltaTime)
+{
+	const FPlatformMemoryStats Stats = FPlatformMemory::GetStats();
+	PeakResidentBytes = FMath::Max<uint64>(PeakResidentBytes, Stats.UsedPhysical);
+
+	const uint64 BudgetBytes{ static_cast<uint64>(FMath::Max(MemoryBudgetMB, 0)) * 1024 * 1024 };
+	if (BudgetBytes > 0 && Stats.UsedPhysical > BudgetBytes && !bOverBudgetReported)
+	{
+		bOverBudgetReported = true;
+		UE_LOG(LogBlaster, Warning, TEXT("Server footprint: resident memory %.1f MB is over the %d MB budget"),
+			Stats.UsedPhysical / BytesPerMB, MemoryBudgetMB);
+	}
+
+	return true;
+}
+
+void FBlasterServerFootprint::AppendRow(const TCHAR* Event, const double Seconds)
+{
+	const FPlatformMemoryStats Stats = FPlatformMemory::GetStats();
+
+	// One row per event, so runs of different builds/targets line up in the same file
+	BlasterProfiling::AppendCsvRow(TEXT("ServerFootprint.csv"), TEXT("Time,Target,Event,Seconds,ResidentMB,PeakResidentMB,VirtualMB,BudgetMB"),
+		FString::Printf(TEXT("%s,%s,%s,%.2f,%.1f,%.1f,%.1f,%d\n"),
+		*FDateTime::Now().ToString(), IsRunningDedicatedServer() ? TEXT("Server") : TEXT("Game"), Event, Seconds,
+		Stats.UsedPhysical / BytesPerMB, PeakResidentBytes / BytesPerMB, Stats.UsedVirtual / BytesPerMB, MemoryBudgetMB));
+}
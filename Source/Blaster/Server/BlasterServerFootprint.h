@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h" // Who needs: FTSTicker
+
+/**
+ * Extra: How long a game or server process takes to start, and how much memory it keeps resident, so the density
+ * of matches per host can be compared between the BlasterServer target and a listen server (and between builds).
+ *
+ * Logs the startup time and resident memory once the engine loop is up and adds a row to
+ * Saved/Profiling/ServerFootprint.csv. On a dedicated server, also samples resident memory every few seconds,
+ * warns once when it goes over Blaster.Server.MemoryBudgetMB, and writes the peak when the process exits.
+ * Active on dedicated servers, and in a game process only with -ServerFootprint (to measure a listen server), so
+ * players' machines don't collect a CSV nobody reads. Never in the editor.
+ */
+class FBlasterServerFootprint
+{
+public:
+	static void Startup();
+	static void Shutdown();
+
+private:
+	static void OnEngineLoopInitComplete();
+	static bool Sample(float DeltaTime);
+	static void AppendRow(const TCHAR* Event, double Seconds);
+
+	static FDelegateHandle EngineLoopInitHandle;
+	static FTSTicker::FDelegateHandle SampleHandle;
+	static uint64 PeakResidentBytes;
+	static bool bOverBudgetReported;
+};
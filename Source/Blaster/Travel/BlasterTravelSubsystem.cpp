@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterTravelSubsystem.h"
+#include "Blaster.h" // Who needs: LogBlaster, BlasterProfiling::AppendCsvRow
+#include "Engine/GameInstance.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "UObject/UObjectGlobals.h" // Who needs: FCoreUObjectDelegates::PreLoadMap
+
+namespace
+{
+	// A travel that hasn't ended by then failed (or the players quit); stop waiting for it
+	constexpr double TravelTimeout{ 120.0 };
+
+	const TCHAR* TravelTypeName(const bool bSeamless)
+	{
+		return bSeamless ? TEXT("Seamless") : TEXT("Hard");
+	}
+}
+
+void UBlasterTravelSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	SeamlessTravelStartHandle = FWorldDelegates::OnSeamlessTravelStart.AddUObject(this, &ThisClass::OnSeamlessTravelStart);
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddUObject(this, &ThisClass::OnPreLoadMap);
+}
+
+void UBlasterTravelSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnSeamlessTravelStart.Remove(SeamlessTravelStartHandle);
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FTSTicker::GetCoreTicker().RemoveTicker(LocalTravelTickerHandle);
+
+	Super::Deinitialize();
+}
+
+//
+// Server
+//
+
+void UBlasterTravelSubsystem::BeginServerTravel(const FString& URL, const bool bSeamless)
+{
+	const UWorld* World = GetGameInstance()->GetWorld();
+	const AGameStateBase* GameState = World ? World->GetGameState() : nullptr;
+
+	bServerTravelling = true;
+	bServerTravelSeamless = bSeamless;
+	ServerTravelURL = URL;
+	ServerTravelStartTime = FPlatformTime::Seconds();
+	ServerPlayersBefore = GameState ? GameState->PlayerArray.Num() : 0;
+	ServerPlayersArrived = 0;
+
+	UE_LOG(LogBlaster, Log, TEXT("Travel: %s server travel to %s with %d players"), TravelTypeName(bSeamless), *URL, ServerPlayersBefore);
+}
+
+void UBlasterTravelSubsystem::NotifyPlayerArrived(const APlayerController* PlayerController)
+{
+	if (!bServerTravelling || !PlayerController) return;
+
+	const double Seconds{ FPlatformTime::Seconds() - ServerTravelStartTime };
+	if (Seconds > TravelTimeout)
+	{
+		// Someone joining long after the travel, not someone arriving with it
+		UE_LOG(LogBlaster, Warning, TEXT("Travel: gave up waiting for %d of %d players after %.0f s"),
+			ServerPlayersBefore - ServerPlayersArrived, ServerPlayersBefore, Seconds);
+		bServerTravelling = false;
+		return;
+	}
+
+	const FString Player = PlayerController->PlayerState ? PlayerController->PlayerState->GetPlayerName() : PlayerController->GetName();
+	++ServerPlayersArrived;
+
+	UE_LOG(LogBlaster, Log, TEXT("Travel: %s in game %.2f s after the server travel (%d/%d)"),
+		*Player, Seconds, ServerPlayersArrived, ServerPlayersBefore);
+	AppendRow(TEXT("Server"), bServerTravelSeamless, ServerTravelURL, Player, Seconds);
+
+	if (ServerPlayersArrived >= ServerPlayersBefore)
+		EndServerTravel(Seconds);
+}
+
+void UBlasterTravelSubsystem::NotifyPlayerLeft()
+{
+	if (!bServerTravelling) return;
+
+	// Whether they had arrived or not, they're not waited for any more
+	ServerPlayersBefore = FMath::Max(ServerPlayersBefore - 1, 0);
+	if (ServerPlayersArrived >= ServerPlayersBefore)
+		EndServerTravel(FPlatformTime::Seconds() - ServerTravelStartTime);
+}
+
+void UBlasterTravelSubsystem::EndServerTravel(const double Seconds)
+{
+	UE_LOG(LogBlaster, Log, TEXT("Travel: %s travel done, all %d remaining players in game after %.2f s"),
+		TravelTypeName(bServerTravelSeamless), ServerPlayersArrived, Seconds);
+	bServerTravelling = false;
+}
+
+//
+// Local player
+//
+
+void UBlasterTravelSubsystem::OnSeamlessTravelStart(UWorld* FromWorld, const FString& MapName)
+{
+	if (FromWorld && FromWorld->GetGameInstance() == GetGameInstance())
+		BeginLocalTravel(FromWorld, MapName, true);
+}
+
+void UBlasterTravelSubsystem::OnPreLoadMap(const FString& MapName)
+{
+	// Also broadcast while a seamless travel loads its maps: that travel is already being timed
+	if (!LocalTravelTickerHandle.IsValid())
+		BeginLocalTravel(GetGameInstance()->GetWorld(), MapName, false);
+}
+
+void UBlasterTravelSubsystem::BeginLocalTravel(UWorld* FromWorld, const FString& MapName, const bool bSeamless)
+{
+	// No local player (dedicated server): nothing to time here
+	if (!GetGameInstance()->GetFirstGamePlayer()) return;
+
+	bLocalTravelSeamless = bSeamless;
+	LocalTravelMap = MapName;
+	LocalTravelStartTime = FPlatformTime::Seconds();
+	LocalTravelFromWorld = FromWorld;
+
+	if (!LocalTravelTickerHandle.IsValid())
+		LocalTravelTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickLocalTravel));
+}
+
+bool UBlasterTravelSubsystem::TickLocalTravel(float DeltaTime)
+{
+	const double Seconds{ FPlatformTime::Seconds() - LocalTravelStartTime };
+	if (Seconds > TravelTimeout)
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("Travel: gave up waiting for the travel to %s after %.0f s"), *LocalTravelMap, Seconds);
+		LocalTravelTickerHandle.Reset();
+		return false;
+	}
+
+	// Still in the old world, or in the transition one (no pawn there)
+	UWorld* World = GetGameInstance()->GetWorld();
+	if (!World || World == LocalTravelFromWorld.Get() || !World->HasBegunPlay()) return true;
+
+	const APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController(World);
+	const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (!Pawn || Pawn->GetWorld() != World) return true;
+
+	UE_LOG(LogBlaster, Log, TEXT("Travel: %s travel to %s, in game after %.2f s"), TravelTypeName(bLocalTravelSeamless), *LocalTravelMap, Seconds);
+	AppendRow(TEXT("Local"), bLocalTravelSeamless, LocalTravelMap,
+		PlayerController->PlayerState ? PlayerController->PlayerState->GetPlayerName() : FString(), Seconds);
+
+	LocalTravelTickerHandle.Reset();
+	return false;
+}
+
+void UBlasterTravelSubsystem::AppendRow(const TCHAR* Side, const bool bSeamless, const FString& Map, const FString& Player, const double Seconds) const
+{
+	BlasterProfiling::AppendCsvRow(TEXT("Travel.csv"), TEXT("Time,Side,Travel,Map,Player,Seconds"),
+		FString::Printf(TEXT("%s,%s,%s,%s,%s,%.3f\n"), *FDateTime::Now().ToString(), Side, TravelTypeName(bSeamless), *Map, *Player, Seconds));
+}
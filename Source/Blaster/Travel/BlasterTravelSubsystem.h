@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h" // Who needs: FTSTicker
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "BlasterTravelSubsystem.generated.h"
+
+/**
+ * Extra: Measures how long a map change keeps players out of the game, for seamless and hard travel alike.
+ *
+ * Server: from ABlasterGameMode::ProcessServerTravel to each player being handed a pawn in the new map
+ * (ABlasterGameMode::HandleStartingNewPlayer), and to the last of the players that were there when the travel started.
+ * Players who leave meanwhile aren't waited for, and the server travel stops being timed after TravelTimeout anyway.
+ * Local player (clients and the listen server host): from leaving the old world to possessing a pawn in the new one.
+ *
+ * Logged, and added to Saved/Profiling/Travel.csv (one row per player per travel).
+ * Lives in the game instance, so it is the one thing that is sure to survive the travel it measures.
+ */
+UCLASS()
+class BLASTER_API UBlasterTravelSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void BeginServerTravel(const FString& URL, bool bSeamless);
+	void NotifyPlayerArrived(const APlayerController* PlayerController);
+	void NotifyPlayerLeft();
+
+private:
+	//
+	// Server
+	//
+	bool bServerTravelling{ false };
+	bool bServerTravelSeamless{ false };
+	FString ServerTravelURL;
+	double ServerTravelStartTime{ 0.0 };
+	int32 ServerPlayersBefore{ 0 };
+	int32 ServerPlayersArrived{ 0 };
+	void EndServerTravel(double Seconds);
+
+	//
+	// Local player
+	//
+	void OnSeamlessTravelStart(UWorld* FromWorld, const FString& MapName);
+	void OnPreLoadMap(const FString& MapName);
+	void BeginLocalTravel(UWorld* FromWorld, const FString& MapName, bool bSeamless);
+	bool TickLocalTravel(float DeltaTime);
+
+	bool bLocalTravelSeamless{ false };
+	FString LocalTravelMap;
+	double LocalTravelStartTime{ 0.0 };
+	TWeakObjectPtr<UWorld> LocalTravelFromWorld;
+	FTSTicker::FDelegateHandle LocalTravelTickerHandle;
+
+	FDelegateHandle SeamlessTravelStartHandle;
+	FDelegateHandle PreLoadMapHandle;
+
+	void AppendRow(const TCHAR* Side, bool bSeamless, const FString& Map, const FString& Player, double Seconds) const;
+};
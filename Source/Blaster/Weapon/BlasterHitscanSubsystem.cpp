@@ -0,0 +1,227 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterHitscanSubsystem.h"
+#include "Blaster.h" // Who needs: STATGROUP_Blaster
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h" // Who needs: TActorIterator
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hitscan (game thread)"), STAT_BlasterHitscan, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitscan Traces"), STAT_BlasterHitscanTraces, STATGROUP_Blaster);
+
+namespace BlasterHitscan
+{
+	bool bAsync{ true };
+	FAutoConsoleVariableRef CVarAsync(
+		TEXT("Blaster.Hitscan.Async"),
+		bAsync,
+		TEXT("Validate hitscan shots with batched async traces (resolved a frame later). 0: one synchronous trace per shot."));
+
+	// Characters further than this from the shot line are not rewound at all
+	constexpr double BroadPhaseRadius{ 250.0 };
+}
+
+void FBlasterHitscanTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && TickType != LEVELTICK_ViewportsOnly)
+		Target->ProcessShots();
+}
+
+FString FBlasterHitscanTickFunction::DiagnosticMessage()
+{
+	return TEXT("FBlasterHitscanTickFunction");
+}
+
+FName FBlasterHitscanTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("BlasterHitscan"));
+}
+
+bool UBlasterHitscanSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UBlasterHitscanSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Shots are only validated where there is authority
+	if (InWorld.GetNetMode() == NM_Client) return;
+
+	TickFunction.Target = this;
+	TickFunction.TickGroup = TG_PostUpdateWork;
+	TickFunction.bCanEverTick = true;
+	TickFunction.bStartWithTickEnabled = true;
+	TickFunction.bTickEvenWhenPaused = false;
+	TickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UBlasterHitscanSubsystem::Deinitialize()
+{
+	if (TickFunction.IsTickFunctionRegistered())
+		TickFunction.UnRegisterTickFunction();
+	TickFunction.Target = nullptr;
+
+	PendingShots.Empty();
+	InFlightShots.Empty();
+
+	Super::Deinitialize();
+}
+
+void UBlasterHitscanSubsystem::QueueShot(const FBlasterHitscanRequest& Request)
+{
+	PendingShots.Add(Request);
+}
+
+void UBlasterHitscanSubsystem::ProcessShots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterHitscan);
+	const double StartTime{ FPlatformTime::Seconds() };
+	LastFrameTraceCount = PendingShots.Num();
+
+	// Last frame's answers first, so a switch to sync mode doesn't leave them behind
+	ResolveShots();
+	if (BlasterHitscan::bAsync)
+		SubmitShots();
+	else
+		TraceShotsSynchronously();
+
+	LastFrameTraceMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	SET_DWORD_STAT(STAT_BlasterHitscanTraces, LastFrameTraceCount);
+}
+
+FCollisionQueryParams UBlasterHitscanSubsystem::MakeQueryParams(const FBlasterHitscanRequest& Request) const
+{
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(BlasterHitscan), true, Request.Shooter.Get());
+	return Params;
+}
+
+namespace BlasterHitscan
+{
+	// Geometry only: characters are where they were at the shot time, not where their capsules are now
+	FCollisionResponseParams MakeResponseParams()
+	{
+		FCollisionResponseParams Response;
+		Response.CollisionResponse.SetResponse(ECC_Pawn, ECR_Ignore);
+		return Response;
+	}
+}
+
+void UBlasterHitscanSubsystem::SubmitShots()
+{
+	if (PendingShots.IsEmpty()) return;
+
+	UWorld* World = GetWorld();
+	const FCollisionResponseParams Response = BlasterHitscan::MakeResponseParams();
+	InFlightShots.Reserve(InFlightShots.Num() + PendingShots.Num());
+	for (const FBlasterHitscanRequest& Request : PendingShots)
+	{
+		FInFlightShot& Shot = InFlightShots.AddDefaulted_GetRef();
+		Shot.Request = Request;
+		Shot.Handle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Request.Start, Request.End, ECC_Visibility,
+			MakeQueryParams(Request), Response);
+	}
+	PendingShots.Reset();
+}
+
+void UBlasterHitscanSubsystem::ResolveShots()
+{
+	if (InFlightShots.IsEmpty()) return;
+
+	const UWorld* World = GetWorld();
+	FTraceDatum Datum;
+	for (const FInFlightShot& Shot : InFlightShots)
+	{
+		// Results only live for the frame after the request. Not there: the trace was dropped, resolve as a miss.
+		const FHitResult* BlockingHit{ nullptr };
+		if (World->QueryTraceData(Shot.Handle, Datum) && !Datum.OutHits.IsEmpty() && Datum.OutHits[0].bBlockingHit)
+			BlockingHit = &Datum.OutHits[0];
+		Resolve(Shot.Request, BlockingHit);
+	}
+	InFlightShots.Reset();
+}
+
+void UBlasterHitscanSubsystem::TraceShotsSynchronously()
+{
+	const UWorld* World = GetWorld();
+	const FCollisionResponseParams Response = BlasterHitscan::MakeResponseParams();
+	for (const FBlasterHitscanRequest& Request : PendingShots)
+	{
+		FHitResult Hit;
+		const bool bHit = World->LineTraceSingleByChannel(Hit, Request.Start, Request.End, ECC_Visibility, MakeQueryParams(Request), Response);
+		Resolve(Request, bHit ? &Hit : nullptr);
+	}
+	PendingShots.Reset();
+}
+
+void UBlasterHitscanSubsystem::Resolve(const FBlasterHitscanRequest& Request, const FHitResult* BlockingHit)
+{
+	FBlasterHitscanResult Result;
+	Result.Request = Request;
+	if (BlockingHit)
+	{
+		Result.bBlocked = true;
+		Result.WorldHit = *BlockingHit;
+	}
+
+	FindRewoundCharacterHit(Result);
+
+	// Both ends of a shot are in combat (see FBlasterAdaptiveNetUpdate)
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (ABlasterCharacter* Shooter = Request.Shooter.Get())
+		Shooter->NotifyCombat(Now);
+	if (ABlasterCharacter* HitCharacter = Result.HitCharacter.Get())
+		HitCharacter->NotifyCombat(Now);
+
+	OnHitscanResolved.Broadcast(Result);
+}
+
+void UBlasterHitscanSubsystem::FindRewoundCharacterHit(FBlasterHitscanResult& Result) const
+{
+	const FBlasterHitscanRequest& Request = Result.Request;
+	const FVector End = Result.bBlocked ? Result.WorldHit.Location : Request.End;
+	const FVector Direction = (End - Request.Start).GetSafeNormal();
+	double ClosestDistance{ FVector::Dist(Request.Start, End) };
+
+	for (TActorIterator<ABlasterCharacter> It(GetWorld()); It; ++It)
+	{
+		ABlasterCharacter* Character = *It;
+		if (Character == Request.Shooter.Get()) continue;
+
+		// Broad phase on the current location: a character doesn't move far in the rewind window
+		const FVector Closest = FMath::ClosestPointOnSegment(Character->GetActorLocation(), Request.Start, End);
+		if (FVector::DistSquared(Closest, Character->GetActorLocation()) > FMath::Square(BlasterHitscan::BroadPhaseRadius)) continue;
+
+		const ULagCompensationComponent* LagCompensation = Character->GetLagCompensation();
+		if (!LagCompensation || !LagCompensation->GetHitBoxTransformsAtTime(Request.ShotTime, RewoundHitBoxes)) continue;
+
+		const TArray<FBlasterHitBox>& HitBoxes = LagCompensation->GetHitBoxes();
+		for (int32 i = 0; i < HitBoxes.Num(); ++i)
+		{
+			// Segment in the box's space, where it's an axis aligned box
+			const FTransform& BoxTransform = RewoundHitBoxes[i];
+			const FVector LocalStart = BoxTransform.InverseTransformPositionNoScale(Request.Start);
+			const FVector LocalEnd = BoxTransform.InverseTransformPositionNoScale(End);
+			const FBox LocalBox(-HitBoxes[i].BoxExtent, HitBoxes[i].BoxExtent);
+
+			FVector LocalHit;
+			FVector LocalNormal;
+			float HitTime;
+			if (!FMath::LineExtentBoxIntersection(LocalBox, LocalStart, LocalEnd, FVector::ZeroVector, LocalHit, LocalNormal, HitTime)) continue;
+
+			const FVector HitLocation = BoxTransform.TransformPositionNoScale(LocalHit);
+			const double Distance = FVector::DotProduct(HitLocation - Request.Start, Direction);
+			if (Distance < ClosestDistance)
+			{
+				ClosestDistance = Distance;
+				Result.HitCharacter = Character;
+				Result.HitBoxIndex = i;
+				Result.HitLocation = HitLocation;
+			}
+		}
+	}
+}
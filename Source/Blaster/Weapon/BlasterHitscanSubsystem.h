@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h" // Who needs: FTickFunction
+#include "Engine/HitResult.h"
+#include "WorldCollision.h" // Who needs: FTraceHandle
+#include "Subsystems/WorldSubsystem.h"
+#include "BlasterHitscanSubsystem.generated.h"
+
+class ABlasterCharacter;
+class UBlasterHitscanSubsystem;
+
+// One shot to validate, as the server received it
+struct FBlasterHitscanRequest
+{
+	TWeakObjectPtr<ABlasterCharacter> Shooter;
+	FVector Start{ FVector::ZeroVector };
+	FVector End{ FVector::ZeroVector };
+	// Server world time the shooter saw when firing (for the rewind)
+	double ShotTime{ 0.0 };
+};
+
+struct FBlasterHitscanResult
+{
+	FBlasterHitscanRequest Request;
+
+	// First blocking geometry along the shot (characters are tested separately, rewound)
+	bool bBlocked{ false };
+	FHitResult WorldHit;
+
+	// Character hit before the geometry, at ShotTime
+	TWeakObjectPtr<ABlasterCharacter> HitCharacter;
+	int32 HitBoxIndex{ INDEX_NONE };
+	FVector HitLocation{ FVector::ZeroVector };
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FBlasterOnHitscanResolved, const FBlasterHitscanResult&);
+
+//
+// Tick function that submits the shots of the frame and resolves the ones of the previous frame. Ticks in
+// TG_PostUpdateWork: every shot received this frame (RPCs are processed before the tick groups) is queued by then.
+// The world runs the async traces requested during a frame while the next one ticks, so they're ready by this point
+// of the next frame.
+//
+USTRUCT()
+struct FBlasterHitscanTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UBlasterHitscanSubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FBlasterHitscanTickFunction> : public TStructOpsTypeTraitsBase2<FBlasterHitscanTickFunction>
+{
+	enum { WithCopy = false };
+};
+
+/**
+ * Server-side hitscan validation, batched. Shots are queued as they arrive (ABlasterCharacter::ServerFireHitscan),
+ * submitted together as async line traces at the end of the frame, and resolved together at the end of the next one,
+ * when the physics scene has answered them off the game thread. Characters are then tested against their hit boxes
+ * rewound to the shot time (ULagCompensationComponent), up to the first blocking geometry.
+ *
+ * "Blaster.Hitscan.Async 0" traces each shot synchronously instead, in the same place, to compare.
+ * "stat Blaster" shows the traces per frame and the game thread time spent on them; the load test CSV has both too.
+ */
+UCLASS()
+class BLASTER_API UBlasterHitscanSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	void QueueShot(const FBlasterHitscanRequest& Request);
+
+	// Submit the shots of this frame, resolve the ones of the last frame
+	void ProcessShots();
+
+	FBlasterOnHitscanResolved OnHitscanResolved;
+
+	// Last frame, for the load test
+	int32 GetLastFrameTraceCount() const { return LastFrameTraceCount; }
+	double GetLastFrameTraceMs() const { return LastFrameTraceMs; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	FBlasterHitscanTickFunction TickFunction;
+
+	TArray<FBlasterHitscanRequest> PendingShots;
+
+	struct FInFlightShot
+	{
+		FBlasterHitscanRequest Request;
+		FTraceHandle Handle;
+	};
+	TArray<FInFlightShot> InFlightShots;
+
+	int32 LastFrameTraceCount{ 0 };
+	double LastFrameTraceMs{ 0.0 };
+
+	void SubmitShots();
+	void ResolveShots();
+	void TraceShotsSynchronously();
+
+	FCollisionQueryParams MakeQueryParams(const FBlasterHitscanRequest& Request) const;
+	void Resolve(const FBlasterHitscanRequest& Request, const FHitResult* BlockingHit);
+	void FindRewoundCharacterHit(FBlasterHitscanResult& Result) const;
+
+	// Reused between frames
+	mutable TArray<FTransform> RewoundHitBoxes;
+	TArray<FHitResult> SyncHits;
+};
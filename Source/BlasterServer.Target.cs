@@ -0,0 +1,19 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+public class BlasterServerTarget : TargetRules
+{
+	public BlasterServerTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Server;
+		DefaultBuildSettings = BuildSettingsVersion.V5;
+		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_4;
+		ExtraModuleNames.Add("Blaster");
+
+		// Extra: A server has no renderer, audio device or UI; the Server target type already compiles them out
+		// (no RHI, no audio mixer, no Slate application). Keep the logs in Shipping, they are all we get from a host.
+		bUseLoggingInShipping = true;
+	}
+}